@@ -0,0 +1,1608 @@
+// Game Character Manager - Benchmark project (console, references GameCharacterManager and CharacterManagementSystem)
+
+// 1. BenchmarkRunner.cs - Timing and allocation measurement
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Text;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public readonly struct BenchmarkResult
+    {
+        public string Name { get; }
+        public long Operations { get; }
+        public TimeSpan Elapsed { get; }
+        public long AllocatedBytes { get; }
+        public int Gen0 { get; }
+        public int Gen1 { get; }
+        public int Gen2 { get; }
+
+        public BenchmarkResult(string name, long operations, TimeSpan elapsed, long allocatedBytes, int gen0, int gen1, int gen2)
+        {
+            Name = name;
+            Operations = operations;
+            Elapsed = elapsed;
+            AllocatedBytes = allocatedBytes;
+            Gen0 = gen0;
+            Gen1 = gen1;
+            Gen2 = gen2;
+        }
+
+        public double NanosecondsPerOperation => Elapsed.TotalMilliseconds * 1_000_000.0 / Math.Max(1, Operations);
+
+        public override string ToString()
+        {
+            return $"{Name,-40} {Elapsed.TotalMilliseconds,10:F2} ms {NanosecondsPerOperation,12:F1} ns/op {AllocatedBytes / 1024.0,12:F1} KB  gen0/1/2 {Gen0}/{Gen1}/{Gen2}";
+        }
+    }
+
+    public static class BenchmarkRunner
+    {
+        // Run the body once cold, without warmup, to capture first-call cost
+        public static BenchmarkResult RunCold(string name, long operations, Action body)
+        {
+            return BenchmarkLog.Record(Measure(name, operations, body));
+        }
+
+        // Warm up, then report the best of several measured iterations
+        public static BenchmarkResult Run(string name, long operations, Action body, int iterations = 5)
+        {
+            body();
+
+            BenchmarkResult best = default;
+            for (int i = 0; i < iterations; i++)
+            {
+                BenchmarkResult result = Measure(name, operations, body);
+                if (i == 0 || result.Elapsed < best.Elapsed)
+                    best = result;
+            }
+            return BenchmarkLog.Record(best);
+        }
+
+        private static BenchmarkResult Measure(string name, long operations, Action body)
+        {
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            GC.Collect();
+
+            int gen0 = GC.CollectionCount(0);
+            int gen1 = GC.CollectionCount(1);
+            int gen2 = GC.CollectionCount(2);
+            long allocated = GC.GetAllocatedBytesForCurrentThread();
+            Stopwatch stopwatch = Stopwatch.StartNew();
+
+            body();
+
+            stopwatch.Stop();
+            return new BenchmarkResult(
+                name,
+                operations,
+                stopwatch.Elapsed,
+                GC.GetAllocatedBytesForCurrentThread() - allocated,
+                GC.CollectionCount(0) - gen0,
+                GC.CollectionCount(1) - gen1,
+                GC.CollectionCount(2) - gen2);
+        }
+    }
+
+    // Every result BenchmarkRunner reports, appended to a CSV file when one is open. Runs on
+    // two commits, labelled with the commit, are compared by Compare.
+    public static class BenchmarkLog
+    {
+        public const string Header = "label,name,operations,elapsed_ms,ns_per_op,allocated_bytes,gen0,gen1,gen2";
+
+        private static TextWriter _writer;
+        private static string _label;
+
+        public static void Open(string path, string label)
+        {
+            bool exists = File.Exists(path) && new FileInfo(path).Length > 0;
+            _writer = new StreamWriter(path, true) { AutoFlush = true };
+            _label = label;
+            if (!exists)
+                _writer.WriteLine(Header);
+        }
+
+        public static BenchmarkResult Record(BenchmarkResult result)
+        {
+            if (_writer != null)
+            {
+                _writer.WriteLine(string.Join(",",
+                    Quote(_label),
+                    Quote(result.Name),
+                    result.Operations.ToString(CultureInfo.InvariantCulture),
+                    result.Elapsed.TotalMilliseconds.ToString("F3", CultureInfo.InvariantCulture),
+                    result.NanosecondsPerOperation.ToString("F1", CultureInfo.InvariantCulture),
+                    result.AllocatedBytes.ToString(CultureInfo.InvariantCulture),
+                    result.Gen0.ToString(CultureInfo.InvariantCulture),
+                    result.Gen1.ToString(CultureInfo.InvariantCulture),
+                    result.Gen2.ToString(CultureInfo.InvariantCulture)));
+            }
+            return result;
+        }
+
+        // Print ns/op and allocation of each benchmark in both files, the last row per name
+        // winning. Slowdowns beyond threshold are flagged and set a failing exit code.
+        public static void Compare(string baselinePath, string currentPath, double threshold)
+        {
+            Dictionary<string, string[]> baseline = Load(baselinePath);
+            Dictionary<string, string[]> current = Load(currentPath);
+            int regressions = 0;
+
+            Console.WriteLine($"{"benchmark",-40} {"base ns/op",12} {"ns/op",12} {"change",8} {"base KB",12} {"KB",12}");
+            foreach (KeyValuePair<string, string[]> row in current)
+            {
+                if (!baseline.TryGetValue(row.Key, out string[] before))
+                    continue;
+
+                double baseNs = double.Parse(before[4], CultureInfo.InvariantCulture);
+                double ns = double.Parse(row.Value[4], CultureInfo.InvariantCulture);
+                double change = baseNs > 0 ? ns / baseNs - 1 : 0;
+                long baseBytes = long.Parse(before[5], CultureInfo.InvariantCulture);
+                long bytes = long.Parse(row.Value[5], CultureInfo.InvariantCulture);
+                bool regressed = change > threshold;
+                if (regressed)
+                    regressions++;
+                Console.WriteLine($"{row.Key,-40} {baseNs,12:F1} {ns,12:F1} {change,8:P0} {baseBytes / 1024.0,12:F1} {bytes / 1024.0,12:F1}{(regressed ? "  REGRESSION" : "")}");
+            }
+
+            Console.WriteLine($"{regressions} regressions beyond {threshold:P0}");
+            if (regressions > 0)
+                Environment.ExitCode = 1;
+        }
+
+        private static Dictionary<string, string[]> Load(string path)
+        {
+            var rows = new Dictionary<string, string[]>();
+            foreach (string line in File.ReadLines(path))
+            {
+                if (line.Length == 0 || line == Header)
+                    continue;
+                string[] fields = Split(line);
+                rows[fields[1]] = fields;
+            }
+            return rows;
+        }
+
+        private static string Quote(string value)
+        {
+            if (value.IndexOfAny(new[] { ',', '"' }) < 0)
+                return value;
+            return "\"" + value.Replace("\"", "\"\"") + "\"";
+        }
+
+        private static string[] Split(string line)
+        {
+            var fields = new List<string>();
+            var field = new StringBuilder();
+            bool quoted = false;
+            for (int i = 0; i < line.Length; i++)
+            {
+                char c = line[i];
+                if (quoted)
+                {
+                    if (c != '"')
+                        field.Append(c);
+                    else if (i + 1 < line.Length && line[i + 1] == '"')
+                        field.Append(line[++i]);
+                    else
+                        quoted = false;
+                }
+                else if (c == '"')
+                    quoted = true;
+                else if (c == ',')
+                {
+                    fields.Add(field.ToString());
+                    field.Clear();
+                }
+                else
+                    field.Append(c);
+            }
+            fields.Add(field.ToString());
+            return fields.ToArray();
+        }
+    }
+}
+
+// 2. SampleRoster.cs - Deterministic rosters for benchmarks
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class SampleRoster
+    {
+        private static readonly string[] Weapons = { "Sword", "Bow", "Staff", "Dagger", "Axe", "Hammer" };
+        private static readonly string[] Armors = { "Light", "Medium", "Heavy", "Magic" };
+        private static readonly string[] Abilities = { "Fireball", "Heal", "Stealth", "Shield Bash", "Frost Nova", "Backstab", "Volley", "Smite" };
+
+        public static List<Character> Create(int count, int seed = 42)
+        {
+            var characters = new List<Character>(count);
+            characters.AddRange(Stream(count, seed));
+            return characters;
+        }
+
+        // Same characters as Create, produced one at a time for rosters too big to hold as objects
+        public static IEnumerable<Character> Stream(int count, int seed = 42)
+        {
+            var random = new Random(seed);
+            for (int i = 0; i < count; i++)
+            {
+                var abilities = new List<string>();
+                int abilityCount = random.Next(0, 5);
+                for (int j = 0; j < abilityCount; j++)
+                    abilities.Add(Abilities[random.Next(Abilities.Length)]);
+
+                yield return new Character(
+                    $"Character {i}",
+                    random.Next(1, 101),
+                    random.Next(1, 1001),
+                    random.Next(0, 1001),
+                    abilities,
+                    Weapons[random.Next(Weapons.Length)],
+                    (CharacterClass)random.Next(5),
+                    Armors[random.Next(Armors.Length)]);
+            }
+        }
+    }
+}
+
+// 3. JsonBenchmarks.cs - Reflection vs source-generated JSON
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text.Json;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class JsonBenchmarks
+    {
+        // The serialization path CharacterRepository used before the generated context
+        private static void SaveWithReflection(Stream stream, List<Character> characters)
+        {
+            var options = new JsonSerializerOptions { WriteIndented = true };
+            JsonSerializer.Serialize(stream, characters, options);
+        }
+
+        private static List<Character> LoadWithReflection(Stream stream)
+        {
+            return JsonSerializer.Deserialize<List<Character>>(stream);
+        }
+
+        // First save/load in a fresh process; run once per path, each in its own process
+        public static void RunStartup(string path)
+        {
+            List<Character> characters = SampleRoster.Create(100);
+            var stream = new MemoryStream();
+
+            if (path == "reflection")
+            {
+                Console.WriteLine(BenchmarkRunner.RunCold("json startup save (reflection)", 1, () => SaveWithReflection(stream, characters)));
+                stream.Position = 0;
+                Console.WriteLine(BenchmarkRunner.RunCold("json startup load (reflection)", 1, () => LoadWithReflection(stream)));
+            }
+            else
+            {
+                Console.WriteLine(BenchmarkRunner.RunCold("json startup save (generated)", 1, () => CharacterJsonCodec.Write(stream, characters)));
+                stream.Position = 0;
+                Console.WriteLine(BenchmarkRunner.RunCold("json startup load (generated)", 1, () => new List<Character>(CharacterJsonCodec.Read(stream))));
+            }
+        }
+
+        public static void RunThroughput(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var stream = new MemoryStream();
+
+            Console.WriteLine(BenchmarkRunner.Run($"json save {count} (reflection)", count, () =>
+            {
+                stream.SetLength(0);
+                SaveWithReflection(stream, characters);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"json save {count} (generated)", count, () =>
+            {
+                stream.SetLength(0);
+                CharacterJsonCodec.Write(stream, characters);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"json load {count} (reflection)", count, () =>
+            {
+                stream.Position = 0;
+                LoadWithReflection(stream);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"json load {count} (generated)", count, () =>
+            {
+                stream.Position = 0;
+                new List<Character>(CharacterJsonCodec.Read(stream));
+            }));
+        }
+    }
+}
+
+// 4. XmlBenchmarks.cs - XmlSerializer vs streaming XML codec
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Xml.Serialization;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class XmlBenchmarks
+    {
+        // Tiered compilation needs many passes over a large roster before either side runs fully
+        // optimized code, so fewer iterations mostly compare the unoptimized tiers
+        private const int Iterations = 40;
+
+        // The serialization path CharacterRepository used before the streaming codec
+        private static void SaveWithSerializer(Stream stream, List<Character> characters)
+        {
+            XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
+            serializer.Serialize(stream, characters);
+        }
+
+        private static List<Character> LoadWithSerializer(Stream stream)
+        {
+            XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
+            return (List<Character>)serializer.Deserialize(stream);
+        }
+
+        public static void RunThroughput(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var stream = new MemoryStream();
+
+            Console.WriteLine(BenchmarkRunner.Run($"xml save {count} (XmlSerializer)", count, () =>
+            {
+                stream.SetLength(0);
+                SaveWithSerializer(stream, characters);
+            }, Iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"xml save {count} (codec)", count, () =>
+            {
+                stream.SetLength(0);
+                CharacterXmlCodec.Write(stream, characters);
+            }, Iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"xml load {count} (XmlSerializer)", count, () =>
+            {
+                stream.Position = 0;
+                LoadWithSerializer(stream);
+            }, Iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"xml load {count} (codec)", count, () =>
+            {
+                stream.Position = 0;
+                new List<Character>(CharacterXmlCodec.Read(stream));
+            }, Iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"xml stream {count} (codec)", count, () =>
+            {
+                stream.Position = 0;
+                foreach (Character character in CharacterXmlCodec.Read(stream))
+                {
+                }
+            }, Iterations));
+        }
+    }
+}
+
+// 5. BinaryBenchmarks.cs - Binary roster format vs JSON and XML
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class BinaryBenchmarks
+    {
+        public static void RunThroughput(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var json = new MemoryStream();
+            var xml = new MemoryStream();
+            var binary = new MemoryStream();
+            CharacterJsonCodec.Write(json, characters);
+            CharacterXmlCodec.Write(xml, characters);
+            CharacterBinaryCodec.Write(binary, characters);
+
+            Console.WriteLine($"file size {count}: json {json.Length / 1024.0:F1} KB, xml {xml.Length / 1024.0:F1} KB, " +
+                $"binary {binary.Length / 1024.0:F1} KB ({(double)json.Length / binary.Length:F1}x smaller than json)");
+
+            Console.WriteLine(BenchmarkRunner.Run($"binary save {count}", count, () =>
+            {
+                binary.SetLength(0);
+                CharacterBinaryCodec.Write(binary, characters);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"json load {count}", count, () =>
+            {
+                json.Position = 0;
+                new List<Character>(CharacterJsonCodec.Read(json));
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"binary load {count}", count, () =>
+            {
+                binary.Position = 0;
+                new List<Character>(CharacterBinaryCodec.Read(binary));
+            }));
+        }
+
+        // Open a large roster through the memory-mapped view and touch a sample of it
+        public static void RunMapped(int count)
+        {
+            string path = Path.Combine(Path.GetTempPath(), $"roster-{count}.bin");
+            using (FileStream fs = File.Create(path))
+                CharacterBinaryCodec.Write(fs, SampleRoster.Create(count));
+
+            try
+            {
+                long workingSet = Environment.WorkingSet;
+                MappedCharacterRoster roster = null;
+                Console.WriteLine(BenchmarkRunner.RunCold($"mapped open {count}", 1, () => roster = MappedCharacterRoster.Open(path)));
+
+                using (roster)
+                {
+                    Console.WriteLine($"working set after open: +{(Environment.WorkingSet - workingSet) / (1024.0 * 1024.0):F1} MB");
+
+                    var random = new Random(7);
+                    const int lookups = 1_000;
+                    Console.WriteLine(BenchmarkRunner.RunCold($"mapped random access x{lookups} (cold)", lookups, () =>
+                    {
+                        for (int i = 0; i < lookups; i++)
+                            _ = roster[random.Next(roster.Count)];
+                    }));
+                    Console.WriteLine($"working set after random access: +{(Environment.WorkingSet - workingSet) / (1024.0 * 1024.0):F1} MB");
+
+                    long total = 0;
+                    Console.WriteLine(BenchmarkRunner.Run($"mapped scan levels {count}", count, () =>
+                    {
+                        foreach (CharacterRecord record in roster.Records)
+                            total += record.Level;
+                    }));
+                    Console.WriteLine($"working set after full scan: +{(Environment.WorkingSet - workingSet) / (1024.0 * 1024.0):F1} MB");
+                }
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+    }
+}
+
+// 6. JournalBenchmarks.cs - Full JSON rewrite vs journaled save of one edit
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class JournalBenchmarks
+    {
+        public static void RunSaveChanges(int count)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "journal-benchmark");
+            Directory.CreateDirectory(directory);
+            string previous = Environment.CurrentDirectory;
+            Environment.CurrentDirectory = directory;
+
+            try
+            {
+                var repository = new CharacterRepository();
+                repository.SaveToJson(SampleRoster.Create(count));
+                List<Character> characters = repository.LoadFromJson();
+                var random = new Random(3);
+
+                Console.WriteLine(BenchmarkRunner.Run($"json full save {count}", 1, () => repository.SaveToJson(characters), 3));
+
+                characters = repository.LoadFromJson();
+                Console.WriteLine(BenchmarkRunner.Run($"json journaled save of 1 edit ({count})", 1, () =>
+                {
+                    int index = random.Next(characters.Count);
+                    Character edited = characters[index].CloneWithName(characters[index].Name);
+                    edited.Id = characters[index].Id;
+                    edited.Mana++;
+                    characters[index] = edited;
+                    repository.RecordReplace(edited);
+                    repository.SaveChanges(characters);
+                }));
+                repository.WaitForCompaction();
+            }
+            finally
+            {
+                Environment.CurrentDirectory = previous;
+                Directory.Delete(directory, true);
+            }
+        }
+    }
+}
+
+// 7. StoreBenchmarks.cs - Columnar statistics vs scanning List<Character>
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class StoreBenchmarks
+    {
+        // Level/Health/Mana statistics, a range count and two histograms
+        public static void RunStatistics(int count)
+        {
+            CharacterStore store = CharacterStore.Load(SampleRoster.Stream(count));
+            Console.WriteLine(BenchmarkRunner.Run($"store stats query {count}", count, () =>
+            {
+                store.GetStatistics(CharacterColumn.Level);
+                store.GetStatistics(CharacterColumn.Health);
+                store.GetStatistics(CharacterColumn.Mana);
+                store.CountInRange(CharacterColumn.Level, 20, 60);
+                store.Histogram(CharacterColumn.Health, 0, 100, 11);
+                store.ClassHistogram();
+            }));
+            store = null;
+
+            // A List<Character> of the full size does not fit comfortably in memory, so the
+            // object baseline runs on at most 1M characters; compare ns/op
+            int listCount = Math.Min(count, 1_000_000);
+            List<Character> characters = SampleRoster.Create(listCount);
+            Console.WriteLine(BenchmarkRunner.Run($"list stats query {listCount}", listCount, () => ScanList(characters)));
+        }
+
+        private static void ScanList(List<Character> characters)
+        {
+            long levelSum = 0, healthSum = 0, manaSum = 0;
+            int levelMin = int.MaxValue, levelMax = int.MinValue;
+            int healthMin = int.MaxValue, healthMax = int.MinValue;
+            int manaMin = int.MaxValue, manaMax = int.MinValue;
+            int inRange = 0;
+            var healthBuckets = new int[11];
+            var classes = new int[5];
+
+            foreach (Character character in characters)
+            {
+                levelSum += character.Level;
+                levelMin = Math.Min(levelMin, character.Level);
+                levelMax = Math.Max(levelMax, character.Level);
+                healthSum += character.Health;
+                healthMin = Math.Min(healthMin, character.Health);
+                healthMax = Math.Max(healthMax, character.Health);
+                manaSum += character.Mana;
+                manaMin = Math.Min(manaMin, character.Mana);
+                manaMax = Math.Max(manaMax, character.Mana);
+                if (character.Level >= 20 && character.Level <= 60)
+                    inRange++;
+                if (character.Health >= 0 && character.Health < 1100)
+                    healthBuckets[character.Health / 100]++;
+                classes[(int)character.Class]++;
+            }
+        }
+    }
+}
+
+// 8. AbilityMemoryReport.cs - Retained memory of pooled vs per-character ability strings
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text.Json;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class AbilityMemoryReport
+    {
+        // Character as it was before AbilityPool: every ability a separate string in a List<string>
+        private sealed class LegacyCharacter
+        {
+            public string Name { get; set; }
+            public int Level { get; set; }
+            public int Health { get; set; }
+            public int Mana { get; set; }
+            public List<string> Abilities { get; set; }
+            public string WeaponType { get; set; }
+            public CharacterClass Class { get; set; }
+            public string ArmorType { get; set; }
+        }
+
+        public static void Run(int count)
+        {
+            var json = new MemoryStream();
+            CharacterJsonCodec.Write(json, SampleRoster.Stream(count));
+            long abilityCount = 0;
+
+            long baseline = RetainedBytes(() =>
+            {
+                json.Position = 0;
+                return JsonSerializer.Deserialize<List<LegacyCharacter>>(json);
+            });
+            long pooled = RetainedBytes(() =>
+            {
+                json.Position = 0;
+                var characters = new List<Character>(CharacterJsonCodec.Read(json));
+                foreach (Character character in characters)
+                    abilityCount += character.Abilities.Count;
+                return characters;
+            });
+
+            Console.WriteLine($"roster of {count} characters, {abilityCount} abilities, {AbilityPool.Count} distinct");
+            Console.WriteLine($"  List<string> abilities  {baseline / (1024.0 * 1024.0),10:F1} MB  {(double)baseline / count,8:F1} B/character");
+            Console.WriteLine($"  AbilityPool ids         {pooled / (1024.0 * 1024.0),10:F1} MB  {(double)pooled / count,8:F1} B/character");
+            Console.WriteLine($"  saved                   {(baseline - pooled) / (1024.0 * 1024.0),10:F1} MB  ({1 - (double)pooled / baseline:P0})");
+        }
+
+        private static long RetainedBytes(Func<object> load)
+        {
+            long before = GC.GetTotalMemory(true);
+            object roster = load();
+            long after = GC.GetTotalMemory(true);
+            GC.KeepAlive(roster);
+            return after - before;
+        }
+    }
+}
+
+// 9. CloneBenchmarks.cs - Copy-on-write Clone() vs eagerly copying the ability list
+using System;
+using System.Collections.Generic;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class CloneBenchmarks
+    {
+        private static object _sink;
+
+        // Clone prototypes with growing ability lists; COW cost and allocation should not grow
+        public static void Run(int clones)
+        {
+            foreach (int abilityCount in new[] { 0, 16, 1024 })
+            {
+                var prototype = new Character("Prototype", 10, 100, 50,
+                    Enumerable.Range(0, abilityCount).Select(i => $"Ability {i}"),
+                    "Sword", CharacterClass.Warrior, "Plate");
+                var abilities = new List<string>(prototype.Abilities);
+
+                // Just the ability copy a pre-COW Clone() paid on top of the object itself
+                Console.WriteLine(BenchmarkRunner.Run($"eager ability copy {abilityCount}", clones, () =>
+                {
+                    for (int i = 0; i < clones; i++)
+                        _sink = new List<string>(abilities);
+                }));
+                Console.WriteLine(BenchmarkRunner.Run($"cow clone {abilityCount} abilities", clones, () =>
+                {
+                    for (int i = 0; i < clones; i++)
+                        _sink = prototype.Clone();
+                }));
+                // The copy is paid on the first mutation instead
+                Console.WriteLine(BenchmarkRunner.Run($"cow clone+write {abilityCount} abilities", clones, () =>
+                {
+                    for (int i = 0; i < clones; i++)
+                    {
+                        var clone = (Character)prototype.Clone();
+                        clone.Abilities.Add("Extra");
+                        _sink = clone;
+                    }
+                }));
+            }
+        }
+    }
+}
+
+// 10. SpawnBenchmarks.cs - Bulk CloneMany vs cloning one character at a time
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class SpawnBenchmarks
+    {
+        // One server tick: stamp out count instances of a template
+        public static void Run(int count)
+        {
+            var registry = new PrototypeRegistry();
+            registry.Register("Goblin Lv5 Warrior", new Character("Goblin", 5, 120, 20,
+                new[] { "Stab", "Dodge", "Flee" }, "Dagger", CharacterClass.Warrior, "Leather"));
+            Character prototype = registry.Spawn("Goblin Lv5 Warrior");
+            var variation = new StatVariation(2, 15, 5, 1234);
+
+            Console.WriteLine(BenchmarkRunner.Run($"Clone() into List {count}", count, () =>
+            {
+                var spawned = new List<Character>();
+                for (int i = 0; i < count; i++)
+                    spawned.Add((Character)prototype.Clone());
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"CloneMany {count}", count, () =>
+                registry.SpawnMany("Goblin Lv5 Warrior", count)));
+            Console.WriteLine(BenchmarkRunner.Run($"CloneMany with variation {count}", count, () =>
+                registry.SpawnMany("Goblin Lv5 Warrior", count, variation)));
+            Console.WriteLine($"parallel above {PrototypeRegistry.ParallelThreshold} clones on {Environment.ProcessorCount} cores");
+        }
+    }
+}
+
+// 11. PoolBenchmarks.cs - GC pressure of reload and spawn loops with and without CharacterPool
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class PoolBenchmarks
+    {
+        private const int Rounds = 10;
+
+        // Steady state: each round drops or returns the previous roster; compare the gen0/1/2 columns
+        public static void Run(int count)
+        {
+            var json = new MemoryStream();
+            CharacterJsonCodec.Write(json, SampleRoster.Stream(count));
+
+            var loaded = new List<Character>();
+            Console.WriteLine(BenchmarkRunner.Run($"json reload x{Rounds} {count}", (long)count * Rounds, () =>
+            {
+                for (int round = 0; round < Rounds; round++)
+                {
+                    json.Position = 0;
+                    loaded = new List<Character>(CharacterJsonCodec.Read(json));
+                }
+            }));
+
+            var pool = new CharacterPool();
+            var pooled = new List<Character>();
+            Console.WriteLine(BenchmarkRunner.Run($"pooled json reload x{Rounds} {count}", (long)count * Rounds, () =>
+            {
+                for (int round = 0; round < Rounds; round++)
+                {
+                    json.Position = 0;
+                    pool.ReturnAll(pooled);
+                    pooled.AddRange(CharacterJsonCodec.Read(json, pool));
+                }
+            }));
+            loaded = null;
+            pool.ReturnAll(pooled);
+
+            var prototype = new Character("Goblin", 5, 120, 20, new[] { "Stab", "Dodge", "Flee" }, "Dagger", CharacterClass.Warrior, "Leather");
+            var spawned = new Character[count];
+            Console.WriteLine(BenchmarkRunner.Run($"spawn x{Rounds} {count}", (long)count * Rounds, () =>
+            {
+                for (int round = 0; round < Rounds; round++)
+                    PrototypeRegistry.CloneMany(prototype, spawned, 0, count);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"pooled spawn x{Rounds} {count}", (long)count * Rounds, () =>
+            {
+                for (int round = 0; round < Rounds; round++)
+                {
+                    PrototypeRegistry.CloneMany(prototype, spawned, 0, count, default, null, pool);
+                    foreach (Character character in spawned)
+                        pool.Return(character);
+                }
+            }));
+        }
+    }
+}
+
+// 12. RosterBenchmarks.cs - Indexed roster lookups vs scanning List<Character>
+using System;
+using System.Collections.Generic;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class RosterBenchmarks
+    {
+        private const int Lookups = 1000;
+
+        // Linear scans are slow enough at 1M characters that fewer lookups suffice; compare ns/op
+        private const int ScanLookups = 20;
+
+        public static void Run(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var roster = new CharacterRoster(new List<Character>(characters));
+            var random = new Random(42);
+            Character[] targets = Enumerable.Range(0, Lookups).Select(_ => characters[random.Next(count)]).ToArray();
+            Character[] scanTargets = targets.Take(ScanLookups).ToArray();
+            int sink = 0;
+
+            // What btnEdit_Click did before: locate the selected character by reference
+            Console.WriteLine(BenchmarkRunner.Run($"List.IndexOf {count}", ScanLookups, () =>
+            {
+                foreach (Character target in scanTargets)
+                    sink += characters.IndexOf(target);
+            }, 3));
+            Console.WriteLine(BenchmarkRunner.Run($"roster IndexOf(id) {count}", Lookups, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.IndexOf(target.Id);
+            }));
+
+            Console.WriteLine(BenchmarkRunner.Run($"scan by name {count}", ScanLookups, () =>
+            {
+                foreach (Character target in scanTargets)
+                    sink += characters.Count(c => c.Name == target.Name);
+            }, 3));
+            Console.WriteLine(BenchmarkRunner.Run($"roster FindByName {count}", Lookups, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.FindByName(target.Name).Count();
+            }));
+
+            Console.WriteLine(BenchmarkRunner.Run($"scan by level {count}", ScanLookups, () =>
+            {
+                foreach (Character target in scanTargets)
+                    sink += characters.Count(c => c.Level == target.Level);
+            }, 3));
+            Console.WriteLine(BenchmarkRunner.Run($"roster InLevelRange first 10 {count}", Lookups, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.InLevelRange(target.Level, target.Level).Take(10).Count();
+            }));
+
+            // Incremental maintenance: edit then delete through the indexes
+            Console.WriteLine(BenchmarkRunner.Run($"roster Replace {count}", Lookups, () =>
+            {
+                foreach (Character target in targets)
+                {
+                    Character edited = target.CloneWithName(target.Name);
+                    edited.Id = target.Id;
+                    edited.Level = target.Level + 1;
+                    sink += roster.Replace(edited);
+                }
+            }));
+            GC.KeepAlive(sink);
+        }
+    }
+}
+
+// 13. QueryBenchmarks.cs - Compiled queries vs hand-written LINQ scans
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class QueryBenchmarks
+    {
+        private const string Query = "Class = Mage and Level > 50 and Mana < 100";
+
+        public static void Run(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var roster = new CharacterRoster(new List<Character>(characters));
+            int sink = 0;
+
+            // Parse and compile once; later Parse calls hit the cache
+            Console.WriteLine(BenchmarkRunner.RunCold("query parse + compile", 1, () => sink += CharacterQuery.Parse(Query + " order by Health").Text.Length));
+            Console.WriteLine(BenchmarkRunner.Run("query parse (cached)", 100_000, () =>
+            {
+                for (int i = 0; i < 100_000; i++)
+                    sink += CharacterQuery.Parse(Query).Limit;
+            }));
+
+            CharacterQuery query = CharacterQuery.Parse(Query);
+            Console.WriteLine(query.Explain(roster));
+            Console.WriteLine(BenchmarkRunner.Run($"LINQ scan {count}", count, () =>
+                sink += characters.Where(c => c.Class == CharacterClass.Mage && c.Level > 50 && c.Mana < 100).ToList().Count));
+            Console.WriteLine(BenchmarkRunner.Run($"query over List {count}", count, () => sink += query.Execute(characters).Count));
+            Console.WriteLine(BenchmarkRunner.Run($"query over roster {count}", count, () => sink += query.Execute(roster).Count));
+
+            // A narrow Level range is answered from the roster's Level index
+            CharacterQuery narrow = CharacterQuery.Parse("Level = 100 and Class = Mage");
+            Console.WriteLine(narrow.Explain(roster));
+            Console.WriteLine(BenchmarkRunner.Run($"LINQ scan Level = 100 {count}", count, () =>
+                sink += characters.Where(c => c.Level == 100 && c.Class == CharacterClass.Mage).ToList().Count));
+            Console.WriteLine(BenchmarkRunner.Run($"query Level = 100 over roster {count}", count, () => sink += narrow.Execute(roster).Count));
+
+            CharacterQuery sorted = CharacterQuery.Parse(Query + " order by Health desc limit 100");
+            Console.WriteLine(BenchmarkRunner.Run($"LINQ scan + order + take {count}", count, () =>
+                sink += characters.Where(c => c.Class == CharacterClass.Mage && c.Level > 50 && c.Mana < 100)
+                    .OrderByDescending(c => c.Health).Take(100).Count()));
+            Console.WriteLine(BenchmarkRunner.Run($"query order + limit over roster {count}", count, () => sink += sorted.Execute(roster).Count));
+
+            // Header-only filtering on the mapped file materializes just the matches
+            string path = Path.Combine(Path.GetTempPath(), $"query-{count}.bin");
+            using (FileStream fs = File.Create(path))
+                CharacterBinaryCodec.Write(fs, characters);
+            try
+            {
+                using (MappedCharacterRoster mapped = MappedCharacterRoster.Open(path))
+                {
+                    Console.WriteLine(query.Explain(mapped));
+                    Console.WriteLine(BenchmarkRunner.Run($"materialize + LINQ scan mapped {count}", count, () =>
+                        sink += mapped.Where(c => c.Class == CharacterClass.Mage && c.Level > 50 && c.Mana < 100).Count()));
+                    Console.WriteLine(BenchmarkRunner.Run($"query over mapped {count}", count, () => sink += query.Execute(mapped).Count));
+                }
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+            GC.KeepAlive(sink);
+        }
+    }
+}
+
+// 14. SearchBenchmarks.cs - Name search index vs a linear Contains scan, per keystroke
+using System;
+using System.Collections.Generic;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class SearchBenchmarks
+    {
+        private const int Limit = 50;
+
+        public static void Run(int count)
+        {
+            List<Character> characters = SampleRoster.Create(count);
+            var index = new NameSearchIndex();
+            int sink = 0;
+
+            Console.WriteLine(BenchmarkRunner.RunCold($"index build {count}", count, () =>
+            {
+                for (int i = 0; i < characters.Count; i++)
+                    index.Add(i + 1, characters[i].Name);
+            }));
+
+            // Every prefix of the text, as typed into the search box
+            string typed = $"Character {count / 3}";
+            string[] keystrokes = Enumerable.Range(1, typed.Length).Select(n => typed.Substring(0, n)).ToArray();
+            Console.WriteLine(BenchmarkRunner.Run($"Contains scan per keystroke {count}", keystrokes.Length, () =>
+            {
+                foreach (string text in keystrokes)
+                    sink += characters.Where(c => c.Name.Contains(text, StringComparison.OrdinalIgnoreCase)).Take(Limit).Count();
+            }, 3));
+            Console.WriteLine(BenchmarkRunner.Run($"index Search per keystroke {count}", keystrokes.Length, () =>
+            {
+                foreach (string text in keystrokes)
+                    sink += index.Search(text, Limit).Count;
+            }));
+
+            // A rare substring has to scan the whole list before giving up
+            string middle = typed.Substring(4);
+            Console.WriteLine(BenchmarkRunner.Run($"Contains scan substring '{middle}' {count}", 1, () =>
+                sink += characters.Where(c => c.Name.Contains(middle, StringComparison.OrdinalIgnoreCase)).Take(Limit).Count(), 3));
+            Console.WriteLine(BenchmarkRunner.Run($"index substring '{middle}' {count}", 1, () => sink += index.FindSubstring(middle, Limit).Count));
+
+            string typo = typed.Remove(3, 1);
+            Console.WriteLine(BenchmarkRunner.Run($"index fuzzy '{typo}' {count}", 1, () => sink += index.FindFuzzy(typo, 2, Limit).Count));
+
+            // Keeping the index current as characters are cloned and deleted
+            Character[] clones = characters.Take(1000).Select(c => c.Clone()).Cast<Character>().ToArray();
+            for (int i = 0; i < clones.Length; i++)
+                clones[i].Id = count + 1 + i;
+            Console.WriteLine(BenchmarkRunner.Run($"index add + remove clone {count}", clones.Length, () =>
+            {
+                foreach (Character clone in clones)
+                    index.Add(clone.Id, clone.Name);
+                foreach (Character clone in clones)
+                    index.Remove(clone.Id, clone.Name);
+            }));
+            GC.KeepAlive(sink);
+        }
+    }
+}
+
+// 15. AbilityIndexBenchmarks.cs - Bitmap ability queries vs scanning Character.Abilities
+using System;
+using System.Collections.Generic;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class AbilityIndexBenchmarks
+    {
+        private const int DistinctAbilities = 2000;
+
+        public static void Run(int count)
+        {
+            // Up to six abilities each, skewed so a few are common and most are rare
+            var random = new Random(42);
+            int[] abilityIds = Enumerable.Range(0, DistinctAbilities).Select(i => AbilityPool.Intern($"Ability {i}")).ToArray();
+            var characters = new List<Character>(count);
+            for (int i = 0; i < count; i++)
+            {
+                var character = new Character { Id = i + 1 };
+                int abilities = random.Next(7);
+                for (int k = 0; k < abilities; k++)
+                {
+                    double skew = random.NextDouble();
+                    character.AbilityList.AddId(abilityIds[(int)(skew * skew * skew * DistinctAbilities)]);
+                }
+                characters.Add(character);
+            }
+
+            var index = new AbilityIndex();
+            long before = GC.GetTotalMemory(true);
+            Console.WriteLine(BenchmarkRunner.RunCold($"index build {count}", count, () =>
+            {
+                foreach (Character character in characters)
+                    index.Add(character.Id, character.AbilityList.Ids);
+            }));
+            Console.WriteLine($"index memory: {(GC.GetTotalMemory(true) - before) / (1024.0 * 1024.0):F1} MB for {count} characters");
+
+            // Common, common-but-fewer and rare abilities
+            string[] all = { "Ability 0", "Ability 1" };
+            string[] none = { "Ability 2" };
+            string[] rare = { "Ability 1500", "Ability 3" };
+            int sink = 0;
+
+            Console.WriteLine(BenchmarkRunner.Run($"scan has 0 AND 1 NOT 2 {count}", count, () =>
+                sink += characters.Count(c => c.Abilities.Contains(all[0]) && c.Abilities.Contains(all[1]) && !c.Abilities.Contains(none[0])), 3));
+            Console.WriteLine(BenchmarkRunner.Run($"bitmap 0 AND 1 NOT 2 {count}", count, () =>
+                sink += (int)index.Query(all, none: none).Cardinality));
+
+            Console.WriteLine(BenchmarkRunner.Run($"scan has 1500 AND 3 {count}", count, () =>
+                sink += characters.Count(c => c.Abilities.Contains(rare[0]) && c.Abilities.Contains(rare[1])), 3));
+            Console.WriteLine(BenchmarkRunner.Run($"bitmap 1500 AND 3 {count}", count, () =>
+                sink += (int)index.Query(rare).Cardinality));
+
+            string[] any = Enumerable.Range(0, 50).Select(i => $"Ability {i}").ToArray();
+            Console.WriteLine(BenchmarkRunner.Run($"bitmap OR of 50 abilities {count}", count, () =>
+                sink += (int)index.Query(null, any).Cardinality));
+
+            // Incremental upkeep, as when CharacterForm changes one character's abilities
+            Console.WriteLine(BenchmarkRunner.Run($"index remove + add one character {count}", 10_000, () =>
+            {
+                for (int i = 0; i < 10_000; i++)
+                {
+                    Character character = characters[random.Next(count)];
+                    index.Remove(character.Id, character.AbilityList.Ids);
+                    index.Add(character.Id, character.AbilityList.Ids);
+                }
+            }));
+            GC.KeepAlive(sink);
+        }
+    }
+}
+
+// 16. ViewBenchmarks.cs - Full list rebuild vs view model change per edit
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class ViewBenchmarks
+    {
+        // Rows a list shows at once; a virtual list asks for about this many after a change
+        private const int VisibleRows = 30;
+        private const int Edits = 100;
+
+        public static void Run(int count)
+        {
+            var view = new RosterViewModel(new CharacterRoster(SampleRoster.Create(count)));
+            var rows = new List<string>(count);
+            int sink = 0;
+
+            // What UpdateCharactersList did after every edit: every row's text, inserted again
+            Console.WriteLine(BenchmarkRunner.Run($"rebuild all rows per edit {count}", Edits, () =>
+            {
+                for (int edit = 0; edit < Edits; edit++)
+                {
+                    rows.Clear();
+                    foreach (Character character in view.Roster)
+                        rows.Add(character.ToString());
+                }
+            }, 3));
+
+            view.Changed += (sender, e) =>
+            {
+                for (int row = 0; row < VisibleRows && row < view.Count; row++)
+                    sink += view.GetText(row).Length;
+            };
+            Console.WriteLine(BenchmarkRunner.Run($"view model edit + visible rows {count}", Edits, () =>
+            {
+                for (int edit = 0; edit < Edits; edit++)
+                {
+                    Character target = view[edit];
+                    Character edited = target.CloneWithName(target.Name);
+                    edited.Id = target.Id;
+                    edited.Level++;
+                    view.Replace(edited);
+                }
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"view model add clone + visible rows {count}", Edits, () =>
+            {
+                for (int edit = 0; edit < Edits; edit++)
+                    view.Add((Character)view[edit].Clone());
+            }));
+            GC.KeepAlive(sink);
+        }
+    }
+}
+
+// 17. LazyLoadBenchmarks.cs - Time to first list and retained memory, full vs header-only JSON load
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class LazyLoadBenchmarks
+    {
+        private const int Selections = 100;
+
+        // The same roster with few and with many abilities per character; header-only loading
+        // should take about the same time for both
+        public static void Run(int count)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "lazy-benchmark");
+            Directory.CreateDirectory(directory);
+            string previous = Environment.CurrentDirectory;
+            Environment.CurrentDirectory = directory;
+
+            try
+            {
+                foreach (int abilities in new[] { 4, 64 })
+                {
+                    var repository = new CharacterRepository();
+                    repository.SaveToJson(Roster(count, abilities).ToList());
+                    Console.WriteLine($"{abilities} abilities per character, {new FileInfo("characters.json").Length / (1024.0 * 1024.0):F1} MB");
+
+                    Console.WriteLine(BenchmarkRunner.Run($"json full load {count}", count, () => repository.LoadFromJson(), 3));
+                    Console.WriteLine(BenchmarkRunner.Run($"json header load {count}", count, () => repository.LoadHeadersFromJson(), 3));
+
+                    Console.WriteLine($"  retained full    {RetainedBytes(repository.LoadFromJson) / (1024.0 * 1024.0),10:F1} MB");
+                    Console.WriteLine($"  retained headers {RetainedBytes(repository.LoadHeadersFromJson) / (1024.0 * 1024.0),10:F1} MB");
+
+                    // What selecting a character costs once it was loaded header-only
+                    List<Character> characters = repository.LoadHeadersFromJson();
+                    var random = new Random(5);
+                    Console.WriteLine(BenchmarkRunner.RunCold($"load details on select x{Selections}", Selections, () =>
+                    {
+                        for (int i = 0; i < Selections; i++)
+                            characters[random.Next(characters.Count)].LoadDetails();
+                    }));
+                }
+            }
+            finally
+            {
+                Environment.CurrentDirectory = previous;
+                Directory.Delete(directory, true);
+            }
+        }
+
+        private static IEnumerable<Character> Roster(int count, int abilities)
+        {
+            string[] names = Enumerable.Range(0, abilities).Select(i => $"Ability {i}").ToArray();
+            foreach (Character character in SampleRoster.Stream(count))
+            {
+                character.Abilities = new AbilityList(names);
+                yield return character;
+            }
+        }
+
+        private static long RetainedBytes(Func<List<Character>> load)
+        {
+            long before = GC.GetTotalMemory(true);
+            List<Character> roster = load();
+            long after = GC.GetTotalMemory(true);
+            GC.KeepAlive(roster);
+            return after - before;
+        }
+    }
+}
+
+// 18. PagingBenchmarks.cs - Offset-indexed pages vs streaming up to the page
+using System;
+using System.IO;
+using System.Linq;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class PagingBenchmarks
+    {
+        private const int PageSize = 100;
+
+        public static void Run(int count)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "paging-benchmark");
+            Directory.CreateDirectory(directory);
+            string previous = Environment.CurrentDirectory;
+            Environment.CurrentDirectory = directory;
+
+            try
+            {
+                var repository = new CharacterRepository();
+                Console.WriteLine(BenchmarkRunner.RunCold($"json save with index {count}", count, () => repository.SaveToJson(SampleRoster.Create(count))));
+                Console.WriteLine(BenchmarkRunner.RunCold($"xml save with index {count}", count, () => repository.SaveToXml(SampleRoster.Create(count))));
+
+                long page = count / PageSize * 9 / 10;
+                long offset = page * PageSize;
+                Console.WriteLine(BenchmarkRunner.Run($"json stream to page {page}", PageSize, () => repository.StreamFromJson().Skip((int)offset).Take(PageSize).ToList(), 3));
+                Console.WriteLine(BenchmarkRunner.Run($"json indexed page {page}", PageSize, () => repository.LoadPageFromJson(offset, PageSize)));
+                Console.WriteLine(BenchmarkRunner.Run($"xml stream to page {page}", PageSize, () => repository.StreamFromXml().Skip((int)offset).Take(PageSize).ToList(), 3));
+                Console.WriteLine(BenchmarkRunner.Run($"xml indexed page {page}", PageSize, () => repository.LoadPageFromXml(offset, PageSize)));
+                Console.WriteLine(BenchmarkRunner.Run($"json count {count}", 1, () => repository.CountJson()));
+
+                // A roster written by something else has no index until the first page is asked for
+                Console.WriteLine(BenchmarkRunner.RunCold($"json index rebuild {count}", count, () =>
+                {
+                    File.Delete(RosterOffsetIndex.PathFor("characters.json"));
+                    repository.CountJson();
+                }));
+                Console.WriteLine(BenchmarkRunner.RunCold($"xml index rebuild {count}", count, () =>
+                {
+                    File.Delete(RosterOffsetIndex.PathFor("characters.xml"));
+                    repository.CountXml();
+                }));
+            }
+            finally
+            {
+                Environment.CurrentDirectory = previous;
+                Directory.Delete(directory, true);
+            }
+        }
+    }
+}
+
+// 19. ShardBenchmarks.cs - Single-file JSON vs parallel shards, by shard count
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class ShardBenchmarks
+    {
+        // Throughput should grow with the shard count up to the number of cores
+        public static void Run(int count)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "shard-benchmark");
+            Directory.CreateDirectory(directory);
+            string previous = Environment.CurrentDirectory;
+            Environment.CurrentDirectory = directory;
+
+            try
+            {
+                var repository = new CharacterRepository();
+                List<Character> characters = SampleRoster.Create(count);
+                for (int i = 0; i < characters.Count; i++)
+                    characters[i].Id = i + 1;
+                Console.WriteLine($"{Environment.ProcessorCount} cores");
+
+                Console.WriteLine(BenchmarkRunner.Run($"json save, one file {count}", count, () => repository.SaveToJson(characters), 3));
+                Console.WriteLine(BenchmarkRunner.Run($"json load, one file {count}", count, () => repository.LoadFromJson(), 3));
+
+                var shardCounts = new SortedSet<int> { 2, 4, Environment.ProcessorCount, Environment.ProcessorCount * 2 };
+                foreach (int shards in shardCounts)
+                {
+                    if (shards < 2)
+                        continue;
+                    RosterSharding sharding = RosterSharding.ByIdRange(shards);
+                    Console.WriteLine(BenchmarkRunner.Run($"json save, {shards} id-range shards", count, () => repository.SaveToJsonShards(characters, sharding), 3));
+                    Console.WriteLine(BenchmarkRunner.Run($"json load, {shards} id-range shards", count, () => repository.LoadFromJsonShards(), 3));
+                }
+
+                RosterSharding byClass = RosterSharding.ByClass();
+                Console.WriteLine(BenchmarkRunner.Run($"json save, {byClass.ShardCount} class shards", count, () => repository.SaveToJsonShards(characters, byClass), 3));
+                Console.WriteLine(BenchmarkRunner.Run($"json load, {byClass.ShardCount} class shards", count, () => repository.LoadFromJsonShards(), 3));
+            }
+            finally
+            {
+                Environment.CurrentDirectory = previous;
+                Directory.Delete(directory, true);
+            }
+        }
+    }
+}
+
+// 20. ScaleBenchmarks.cs - Clone, serialization, lookups and mutations from 1k to 10M characters
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using LegacyCharacter = CharacterManagementSystem.Character;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class ScaleBenchmarks
+    {
+        public static readonly int[] Sizes = { 1_000, 100_000, 1_000_000, 10_000_000 };
+
+        private const int Lookups = 100_000;
+        private const int Mutations = 1_000;
+
+        private static object _sink;
+
+        // The same operations at every size up to maxCount, so growth that is worse than linear
+        // shows as rising ns/op. 10M characters take several GB between the lists and files.
+        public static void Run(int maxCount)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "scale-benchmark");
+            Directory.CreateDirectory(directory);
+            try
+            {
+                foreach (int count in Sizes)
+                {
+                    if (count <= maxCount)
+                        RunSize(count, directory);
+                }
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+
+        private static void RunSize(int count, string directory)
+        {
+            // A single measured pass past 1M; the warmup pass still runs first
+            int iterations = count >= 1_000_000 ? 1 : 5;
+            List<Character> characters = SampleRoster.Create(count);
+
+            Console.WriteLine(BenchmarkRunner.Run($"Clone {count} (nya)", count, () =>
+            {
+                foreach (Character character in characters)
+                    _sink = character.Clone();
+            }, iterations));
+            RunLegacyClone(characters, iterations);
+
+            var repository = new CharacterRepository(
+                Path.Combine(directory, "characters.json"),
+                Path.Combine(directory, "characters.xml"),
+                Path.Combine(directory, "characters.bin"));
+            Console.WriteLine(BenchmarkRunner.Run($"SaveToJson {count}", count, () => repository.SaveToJson(characters), iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"LoadFromJson {count}", count, () => _sink = repository.LoadFromJson(), iterations));
+            _sink = null;
+            Console.WriteLine(BenchmarkRunner.Run($"SaveToXml {count}", count, () => repository.SaveToXml(characters), iterations));
+            Console.WriteLine(BenchmarkRunner.Run($"LoadFromXml {count}", count, () => _sink = repository.LoadFromXml(), iterations));
+            _sink = null;
+
+            var roster = new CharacterRoster(characters);
+            var random = new Random(42);
+            Character[] targets = Enumerable.Range(0, Math.Min(count, Lookups)).Select(_ => roster[random.Next(count)]).ToArray();
+            long sink = 0;
+
+            Console.WriteLine(BenchmarkRunner.Run($"roster FindById {count}", targets.Length, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.FindById(target.Id).Level;
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"roster FindByName {count}", targets.Length, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.FindByName(target.Name).Count();
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"roster OfClass first 10 {count}", targets.Length, () =>
+            {
+                foreach (Character target in targets)
+                    sink += roster.OfClass(target.Class).Take(10).Count();
+            }));
+
+            Character[] edits = targets.Take(Mutations).ToArray();
+            Console.WriteLine(BenchmarkRunner.Run($"roster Add+Remove at end {count}", edits.Length, () =>
+            {
+                var added = new long[edits.Length];
+                for (int i = 0; i < edits.Length; i++)
+                {
+                    var character = (Character)edits[i].Clone();
+                    roster.Add(character);
+                    added[i] = character.Id;
+                }
+                for (int i = added.Length - 1; i >= 0; i--)
+                    sink += roster.Remove(added[i]);
+            }));
+            Console.WriteLine(BenchmarkRunner.Run($"roster Replace {count}", edits.Length, () =>
+            {
+                foreach (Character target in edits)
+                {
+                    Character edited = target.CloneWithName(target.Name);
+                    edited.Id = target.Id;
+                    edited.Level = target.Level % 100 + 1;
+                    sink += roster.Replace(edited);
+                }
+            }, iterations));
+
+            // Removing from the middle leaves an empty slot rather than shifting later positions,
+            // O(log n) per call. Each character can only be removed once, so this is a single cold
+            // pass, run last.
+            Character[] removals = edits.Take(count >= 1_000_000 ? 10 : 100).ToArray();
+            Console.WriteLine(BenchmarkRunner.RunCold($"roster Remove from middle {count}", removals.Length, () =>
+            {
+                foreach (Character target in removals)
+                    sink += roster.Remove(target.Id);
+            }));
+            GC.KeepAlive(sink);
+        }
+
+        // Rabotaet.cpp's Character, whose Clone() shares an AbilityList with copy-on-write
+        private static void RunLegacyClone(List<Character> characters, int iterations)
+        {
+            var legacy = new List<LegacyCharacter>(characters.Count);
+            foreach (Character character in characters)
+            {
+                legacy.Add(new LegacyCharacter(character.Name, character.Level, character.Health, character.Mana,
+                    new List<string>(character.Abilities), character.WeaponType, character.Class.ToString(), character.ArmorType));
+            }
+
+            Console.WriteLine(BenchmarkRunner.Run($"Clone {legacy.Count} (Rabotaet)", legacy.Count, () =>
+            {
+                foreach (LegacyCharacter character in legacy)
+                    _sink = character.Clone();
+            }, iterations));
+            _sink = null;
+        }
+    }
+}
+
+// 21. CompressionBenchmarks.cs - Plain vs GZip and Brotli rosters, pipelined vs compressing after the save
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.Compression;
+
+namespace GameCharacterManager.Benchmarks
+{
+    public static class CompressionBenchmarks
+    {
+        // A pipelined save should take about as long as the plain one, not plain plus compression
+        public static void Run(int count)
+        {
+            string directory = Path.Combine(Path.GetTempPath(), "compression-benchmark");
+            Directory.CreateDirectory(directory);
+
+            try
+            {
+                List<Character> characters = SampleRoster.Create(count);
+                Console.WriteLine($"{Environment.ProcessorCount} cores");
+
+                foreach (RosterCompression compression in new[] { RosterCompression.None, RosterCompression.GZip, RosterCompression.Brotli })
+                {
+                    string extension = CompressedRosterStream.ExtensionOf(compression);
+                    var repository = new CharacterRepository(Path.Combine(directory, "characters.json" + extension),
+                        Path.Combine(directory, "characters.xml" + extension), Path.Combine(directory, "characters.bin"));
+                    string name = compression.ToString().ToLowerInvariant();
+
+                    Console.WriteLine(BenchmarkRunner.Run($"json save, {name} {count}", count, () => repository.SaveToJson(characters), 3));
+                    Console.WriteLine(BenchmarkRunner.Run($"json load, {name} {count}", count, () => repository.LoadFromJson(), 3));
+                    Console.WriteLine(BenchmarkRunner.Run($"xml save, {name} {count}", count, () => repository.SaveToXml(characters), 3));
+                    Console.WriteLine(BenchmarkRunner.Run($"xml load, {name} {count}", count, () => repository.LoadFromXml(), 3));
+                    Console.WriteLine($"  json {new FileInfo(repository.JsonFilePath).Length / 1024} KB, xml {new FileInfo(repository.XmlFilePath).Length / 1024} KB");
+                }
+
+                // The same bytes compressed on the saving thread once the plain file is written
+                var plain = new CharacterRepository(Path.Combine(directory, "sequential.json"),
+                    Path.Combine(directory, "sequential.xml"), Path.Combine(directory, "sequential.bin"));
+                Console.WriteLine(BenchmarkRunner.Run($"json save then gzip {count}", count, () =>
+                {
+                    plain.SaveToJson(characters);
+                    using (FileStream source = File.OpenRead(plain.JsonFilePath))
+                    using (FileStream target = File.Create(plain.JsonFilePath + ".gz"))
+                    using (var gzip = new GZipStream(target, CompressionLevel.Fastest))
+                    {
+                        source.CopyTo(gzip);
+                    }
+                }, 3));
+            }
+            finally
+            {
+                Directory.Delete(directory, true);
+            }
+        }
+    }
+}
+
+// 22. Program.cs - Benchmark entry point
+using System;
+
+namespace GameCharacterManager.Benchmarks
+{
+    static class Program
+    {
+        // Usage: benchmarks json-startup <reflection|generated>
+        //        benchmarks json [count]
+        //        benchmarks xml [count]
+        //        benchmarks binary [count]
+        //        benchmarks mapped [count]
+        //        benchmarks journal [count]
+        //        benchmarks store [count]
+        //        benchmarks ability-memory [count]
+        //        benchmarks clone [clones]
+        //        benchmarks spawn [count]
+        //        benchmarks pool [count]
+        //        benchmarks roster [count]
+        //        benchmarks query [count]
+        //        benchmarks search [count]
+        //        benchmarks abilities [count]
+        //        benchmarks view [count]
+        //        benchmarks lazy [count]
+        //        benchmarks paging [count]
+        //        benchmarks shards [count]
+        //        benchmarks scale [max count]
+        //        benchmarks compression [count]
+        //        benchmarks compare <baseline.csv> <current.csv> [threshold %]
+        // --csv <path> [--label <text>] before the suite appends every result to a CSV file;
+        // label rows with the commit they were measured on and compare two such files.
+        static void Main(string[] args)
+        {
+            int first = 0;
+            string csvPath = null;
+            string label = "current";
+            while (first + 1 < args.Length && args[first].StartsWith("--", StringComparison.Ordinal))
+            {
+                if (args[first] == "--csv")
+                    csvPath = args[first + 1];
+                else if (args[first] == "--label")
+                    label = args[first + 1];
+                else
+                    break;
+                first += 2;
+            }
+            args = args[first..];
+            if (csvPath != null)
+                BenchmarkLog.Open(csvPath, label);
+
+            string suite = args.Length > 0 ? args[0] : "json";
+            switch (suite)
+            {
+                case "json-startup":
+                    JsonBenchmarks.RunStartup(args.Length > 1 ? args[1] : "generated");
+                    break;
+                case "json":
+                    JsonBenchmarks.RunThroughput(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "xml":
+                    XmlBenchmarks.RunThroughput(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "binary":
+                    BinaryBenchmarks.RunThroughput(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "mapped":
+                    BinaryBenchmarks.RunMapped(args.Length > 1 ? int.Parse(args[1]) : 5_000_000);
+                    break;
+                case "journal":
+                    JournalBenchmarks.RunSaveChanges(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "store":
+                    StoreBenchmarks.RunStatistics(args.Length > 1 ? int.Parse(args[1]) : 10_000_000);
+                    break;
+                case "ability-memory":
+                    AbilityMemoryReport.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "clone":
+                    CloneBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "spawn":
+                    SpawnBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "pool":
+                    PoolBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "roster":
+                    RosterBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "query":
+                    QueryBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "search":
+                    SearchBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "abilities":
+                    AbilityIndexBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 10_000_000);
+                    break;
+                case "view":
+                    ViewBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "lazy":
+                    LazyLoadBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 100_000);
+                    break;
+                case "paging":
+                    PagingBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "shards":
+                    ShardBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "scale":
+                    ScaleBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 10_000_000);
+                    break;
+                case "compression":
+                    CompressionBenchmarks.Run(args.Length > 1 ? int.Parse(args[1]) : 1_000_000);
+                    break;
+                case "compare" when args.Length >= 3:
+                    BenchmarkLog.Compare(args[1], args[2], args.Length > 3 ? double.Parse(args[3]) / 100 : 0.10);
+                    break;
+                default:
+                    Console.WriteLine($"Unknown benchmark suite '{suite}'.");
+                    break;
+            }
+        }
+    }
+}
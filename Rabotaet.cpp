@@ -1,10 +1,19 @@
+// Character Management System - WinForms app (references GameCharacterManager for AbilityList,
+// NameSearchIndex, PositionTree and the roster change events)
+
 using System;
+using System.Collections;
 using System.Collections.Generic;
+using System.ComponentModel;
 using System.IO;
 using System.Linq;
+using System.Text;
 using System.Text.Json;
+using System.Text.Json.Serialization;
 using System.Windows.Forms;
+using System.Xml;
 using System.Xml.Serialization;
+using GameCharacterManager;
 
 namespace CharacterManagementSystem
 {
@@ -23,18 +32,42 @@ namespace CharacterManagementSystem
     [Serializable]
     public class Character : ICloneable
     {
+        private AbilityList abilities;
+
+        // Стабільний ідентифікатор; 0 - ще не призначений, його видає CharacterRoster
+        public long Id { get; set; }
         public string Name { get; set; }
         public int Level { get; set; }
         public int Health { get; set; }
         public int Mana { get; set; }
-        public List<string> Abilities { get; set; }
+
+        // Завжди AbilityList; інший список при присвоєнні копіюється, тож його подальші
+        // зміни не видно. JSON заповнює наявний список, а не будує копію
+        [XmlIgnore]
+        [JsonObjectCreationHandling(JsonObjectCreationHandling.Populate)]
+        public IList<string> Abilities
+        {
+            get => abilities;
+            set => abilities = value == null ? null : value as AbilityList ?? new AbilityList(value);
+        }
+
+        // Той самий список для XmlSerializer, який не працює з властивостями-інтерфейсами
+        [JsonIgnore]
+        [XmlArray("Abilities")]
+        [EditorBrowsable(EditorBrowsableState.Never)]
+        public AbilityList AbilityList
+        {
+            get => abilities;
+            set => abilities = value;
+        }
+
         public string WeaponType { get; set; }
         public string CharacterClass { get; set; }
         public string ArmorType { get; set; }
 
         public Character()
         {
-            Abilities = new List<string>();
+            Abilities = new AbilityList();
         }
 
         public Character(string name, int level, int health, int mana, List<string> abilities, 
@@ -44,7 +77,7 @@ namespace CharacterManagementSystem
             Level = level;
             Health = health;
             Mana = mana;
-            Abilities = abilities ?? new List<string>();
+            Abilities = abilities != null ? new AbilityList(abilities) : new AbilityList();
             WeaponType = weaponType;
             CharacterClass = characterClass;
             ArmorType = armorType;
@@ -52,8 +85,10 @@ namespace CharacterManagementSystem
 
         public object Clone()
         {
+            // Копія ділить масив здібностей з оригіналом до першої зміни
             Character clone = (Character)this.MemberwiseClone();
-            clone.Abilities = new List<string>(this.Abilities);
+            clone.Id = 0;
+            clone.abilities = this.abilities?.Share();
             return clone;
         }
 
@@ -63,10 +98,529 @@ namespace CharacterManagementSystem
         }
     }
 
+    // Список персонажів з індексами, що оновлюються при кожній зміні:
+    // за Id та ім'ям (хеш-таблиці) і за рівнем та класом (відсортовані множини).
+    // Позиція в списку більше не служить ідентифікатором персонажа.
+    //
+    // Персонаж лишається в слоті, куди його додали. Видалення звільняє слот, а не зсуває всі
+    // наступні, і позиції рахуються за зайнятими слотами через PositionTree за O(log n).
+    // Порожні слоти прибираються за один прохід, коли їх стає більше, ніж персонажів
+    public class CharacterRoster : IReadOnlyList<Character>
+    {
+        // Найменша кількість порожніх слотів, заради якої варто їх прибирати
+        private const int MinGapsToClose = 64;
+
+        // Видалені персонажі лишають null у своєму слоті
+        private readonly List<Character> slots;
+        private readonly Dictionary<long, int> slotById = new Dictionary<long, int>();
+        private readonly PositionTree positions;
+        private int count;
+        private readonly Dictionary<string, HashSet<long>> byName = new Dictionary<string, HashSet<long>>(StringComparer.Ordinal);
+        private readonly SortedSet<(int Level, long Id)> byLevel = new SortedSet<(int Level, long Id)>();
+        private readonly SortedSet<(string Class, long Id)> byClass = new SortedSet<(string Class, long Id)>();
+        private NameSearchIndex nameSearch;
+        private long nextId = 1;
+
+        public CharacterRoster()
+            : this(new List<Character>())
+        {
+        }
+
+        // Приймає завантажений список; персонажі без Id або з дубльованим Id отримують новий
+        public CharacterRoster(List<Character> characters)
+        {
+            slots = characters ?? new List<Character>();
+            slots.RemoveAll(c => c == null);
+
+            foreach (var character in slots)
+                nextId = Math.Max(nextId, character.Id + 1);
+
+            for (int i = 0; i < slots.Count; i++)
+                AddToIndexes(slots[i], i);
+            count = slots.Count;
+            positions = new PositionTree(count);
+        }
+
+        public int Count => count;
+
+        // O(1), доки нічого не видалено, і O(log n), поки є порожні слоти
+        public Character this[int index]
+        {
+            get
+            {
+                if ((uint)index >= (uint)count)
+                    throw new ArgumentOutOfRangeException(nameof(index));
+                return slots[HasGaps ? positions.Select(index) : index];
+            }
+        }
+
+        private bool HasGaps => slots.Count != count;
+
+        // Список у порядку відображення, для серіалізації
+        public List<Character> ToList()
+        {
+            var characters = new List<Character>(count);
+            foreach (var character in this)
+                characters.Add(character);
+            return characters;
+        }
+
+        public void Add(Character character)
+        {
+            AddToIndexes(character, slots.Count);
+            slots.Add(character);
+            positions.Append();
+            count++;
+        }
+
+        // Заміняє персонажа з тим самим Id і повертає його позицію
+        public int Replace(Character character)
+        {
+            int slot = slotById[character.Id];
+            RemoveKeys(slots[slot]);
+            slots[slot] = character;
+            AddKeys(character);
+            return PositionOf(slot);
+        }
+
+        // O(log n): звільняє слот, не зсуваючи наступних персонажів
+        public bool Remove(long id)
+        {
+            if (!slotById.Remove(id, out int slot))
+                return false;
+
+            RemoveKeys(slots[slot]);
+            slots[slot] = null;
+            positions.Remove(slot);
+            count--;
+
+            // Прибирання коштує O(n) один раз на n видалень
+            if (slots.Count - count > Math.Max(count, MinGapsToClose))
+                CloseGaps();
+            return true;
+        }
+
+        public Character FindById(long id)
+        {
+            return slotById.TryGetValue(id, out int slot) ? slots[slot] : null;
+        }
+
+        public int IndexOf(long id)
+        {
+            return slotById.TryGetValue(id, out int slot) ? PositionOf(slot) : -1;
+        }
+
+        public IEnumerable<Character> FindByName(string name)
+        {
+            if (name != null && byName.TryGetValue(name, out var ids))
+            {
+                foreach (long id in ids)
+                    yield return FindById(id);
+            }
+        }
+
+        public IEnumerable<Character> InLevelRange(int min, int max)
+        {
+            if (min > max)
+                yield break;
+
+            foreach (var key in byLevel.GetViewBetween((min, long.MinValue), (max, long.MaxValue)))
+                yield return FindById(key.Id);
+        }
+
+        public IEnumerable<Character> OfClass(string characterClass)
+        {
+            foreach (var key in byClass.GetViewBetween((characterClass, long.MinValue), (characterClass, long.MaxValue)))
+                yield return FindById(key.Id);
+        }
+
+        // Пошук за іменем без урахування регістру: спершу за префіксом, потім за підрядком,
+        // а якщо нічого не знайдено - з помилками. Індекс будується при першому пошуку
+        // і далі оновлюється в Add, Replace та Remove
+        public List<Character> SearchNames(string text, int limit)
+        {
+            if (nameSearch == null)
+            {
+                nameSearch = new NameSearchIndex();
+                foreach (var character in this)
+                    nameSearch.Add(character.Id, character.Name);
+            }
+
+            var result = new List<Character>();
+            foreach (NameMatch match in nameSearch.Search(text, limit))
+                result.Add(FindById(match.Id));
+            return result;
+        }
+
+        public IEnumerator<Character> GetEnumerator()
+        {
+            foreach (var character in slots)
+            {
+                if (character != null)
+                    yield return character;
+            }
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        private int PositionOf(int slot)
+        {
+            return HasGaps ? positions.Rank(slot) : slot;
+        }
+
+        private void CloseGaps()
+        {
+            int live = 0;
+            for (int slot = 0; slot < slots.Count; slot++)
+            {
+                var character = slots[slot];
+                if (character == null)
+                    continue;
+                slotById[character.Id] = live;
+                slots[live++] = character;
+            }
+            slots.RemoveRange(live, slots.Count - live);
+            positions.Reset(live);
+        }
+
+        private void AddToIndexes(Character character, int slot)
+        {
+            if (character.Id <= 0 || slotById.ContainsKey(character.Id))
+                character.Id = nextId++;
+            else
+                nextId = Math.Max(nextId, character.Id + 1);
+
+            slotById.Add(character.Id, slot);
+            AddKeys(character);
+        }
+
+        // Старі ключі знаходяться за поточними значеннями персонажа, тому редагувати
+        // слід копію і передавати її в Replace, як це робить CharacterForm
+        private void AddKeys(Character character)
+        {
+            if (character.Name != null)
+            {
+                if (!byName.TryGetValue(character.Name, out var ids))
+                    byName[character.Name] = ids = new HashSet<long>();
+                ids.Add(character.Id);
+                nameSearch?.Add(character.Id, character.Name);
+            }
+            byLevel.Add((character.Level, character.Id));
+            byClass.Add((character.CharacterClass ?? string.Empty, character.Id));
+        }
+
+        private void RemoveKeys(Character character)
+        {
+            if (character.Name != null && byName.TryGetValue(character.Name, out var ids))
+            {
+                ids.Remove(character.Id);
+                if (ids.Count == 0)
+                    byName.Remove(character.Name);
+                nameSearch?.Remove(character.Id, character.Name);
+            }
+            byLevel.Remove((character.Level, character.Id));
+            byClass.Remove((character.CharacterClass ?? string.Empty, character.Id));
+        }
+    }
+
+    // Рядки головного вікна: усі персонажі або результати пошуку за іменем. Кожна зміна
+    // повідомляє лише про свій рядок, а текст рядків видається на запит, тож список
+    // у віртуальному режимі оновлює тільки видиме. Не залежить від WinForms
+    public class RosterViewModel
+    {
+        // Id знайдених персонажів у порядку рядків; null, коли пошуку немає
+        private List<long> matches;
+
+        public RosterViewModel()
+        {
+            Roster = new CharacterRoster();
+        }
+
+        public event EventHandler<RosterChangedEventArgs> Changed;
+
+        public CharacterRoster Roster { get; private set; }
+
+        public string SearchText { get; private set; } = string.Empty;
+
+        public int SearchLimit { get; set; } = 200;
+
+        public int Count => matches?.Count ?? Roster.Count;
+
+        public Character this[int row] => matches != null ? Roster.FindById(matches[row]) : Roster[row];
+
+        public int IndexOf(long id)
+        {
+            return matches != null ? matches.IndexOf(id) : Roster.IndexOf(id);
+        }
+
+        public void Load(CharacterRoster roster)
+        {
+            Roster = roster;
+            RunSearch();
+            OnChanged(RosterChangeKind.Reset, -1);
+        }
+
+        public void Search(string text)
+        {
+            text = text?.Trim() ?? string.Empty;
+            if (text == SearchText)
+                return;
+
+            SearchText = text;
+            RunSearch();
+            OnChanged(RosterChangeKind.Reset, -1);
+        }
+
+        public void Add(Character character)
+        {
+            Roster.Add(character);
+            if (matches == null)
+            {
+                OnChanged(RosterChangeKind.Insert, Roster.Count - 1);
+            }
+            else if (MatchesSearch(character))
+            {
+                matches.Add(character.Id);
+                OnChanged(RosterChangeKind.Insert, matches.Count - 1);
+            }
+        }
+
+        public void Replace(Character character)
+        {
+            int index = Roster.Replace(character);
+            int row = matches != null ? matches.IndexOf(character.Id) : index;
+            bool visible = matches == null || MatchesSearch(character);
+
+            if (row >= 0 && visible)
+            {
+                OnChanged(RosterChangeKind.Replace, row);
+            }
+            else if (row >= 0)
+            {
+                matches.RemoveAt(row);
+                OnChanged(RosterChangeKind.Remove, row);
+            }
+            else if (visible)
+            {
+                matches.Add(character.Id);
+                OnChanged(RosterChangeKind.Insert, matches.Count - 1);
+            }
+        }
+
+        public void Remove(long id)
+        {
+            int row = IndexOf(id);
+            if (!Roster.Remove(id) || row < 0)
+                return;
+
+            matches?.RemoveAt(row);
+            OnChanged(RosterChangeKind.Remove, row);
+        }
+
+        private void RunSearch()
+        {
+            matches = SearchText.Length == 0 ? null : Roster.SearchNames(SearchText, SearchLimit).Select(c => c.Id).ToList();
+        }
+
+        // До наступного пошуку нові й відредаговані персонажі потрапляють у результати,
+        // якщо їхнє ім'я містить текст пошуку
+        private bool MatchesSearch(Character character)
+        {
+            return character.Name != null && character.Name.Contains(SearchText, StringComparison.OrdinalIgnoreCase);
+        }
+
+        private void OnChanged(RosterChangeKind kind, int index)
+        {
+            Changed?.Invoke(this, new RosterChangedEventArgs(kind, index));
+        }
+    }
+
+    // Згенеровані під час компіляції метадані JSON для списку персонажів
+    [JsonSourceGenerationOptions(WriteIndented = true)]
+    [JsonSerializable(typeof(List<Character>))]
+    internal partial class CharacterJsonContext : JsonSerializerContext
+    {
+    }
+
+    // Потоковий XML у тій самій розмітці ArrayOfCharacter, що й у XmlSerializer, тож старі
+    // файли читаються, а нові відкриває XmlSerializer. Персонажі пишуться й читаються по
+    // одному елементу через XmlWriter/XmlReader, без рефлексії та згенерованого коду серіалізації
+    internal static class CharacterXmlFile
+    {
+        private const string XsiNamespace = "http://www.w3.org/2001/XMLSchema-instance";
+        private const string XsdNamespace = "http://www.w3.org/2001/XMLSchema";
+
+        public static void Write(Stream stream, IEnumerable<Character> characters)
+        {
+            var settings = new XmlWriterSettings { Indent = true, Encoding = new UTF8Encoding(false) };
+            using (XmlWriter writer = XmlWriter.Create(stream, settings))
+            {
+                writer.WriteStartDocument();
+                writer.WriteStartElement("ArrayOfCharacter");
+                writer.WriteAttributeString("xmlns", "xsi", null, XsiNamespace);
+                writer.WriteAttributeString("xmlns", "xsd", null, XsdNamespace);
+                foreach (Character character in characters)
+                    WriteCharacter(writer, character);
+                writer.WriteEndElement();
+            }
+        }
+
+        public static List<Character> Read(Stream stream)
+        {
+            var characters = new List<Character>();
+            var settings = new XmlReaderSettings { IgnoreWhitespace = true, IgnoreComments = true, IgnoreProcessingInstructions = true };
+            using (XmlReader reader = XmlReader.Create(stream, settings))
+            {
+                if (reader.MoveToContent() != XmlNodeType.Element || reader.LocalName != "ArrayOfCharacter")
+                    throw new XmlException("Очікувався кореневий елемент ArrayOfCharacter.");
+                if (reader.IsEmptyElement)
+                    return characters;
+
+                reader.ReadStartElement();
+                while (reader.MoveToContent() == XmlNodeType.Element)
+                {
+                    // Порожні записи (xsi:nil) у списку не зберігаються
+                    if (reader.LocalName == "Character" && !IsNil(reader))
+                        characters.Add(ReadCharacter(reader));
+                    else
+                        reader.Skip();
+                }
+            }
+            return characters;
+        }
+
+        // Як і XmlSerializer, рядки зі значенням null не записуємо зовсім
+        private static void WriteCharacter(XmlWriter writer, Character character)
+        {
+            writer.WriteStartElement("Character");
+            writer.WriteElementString("Id", XmlConvert.ToString(character.Id));
+            WriteString(writer, "Name", character.Name);
+            writer.WriteElementString("Level", XmlConvert.ToString(character.Level));
+            writer.WriteElementString("Health", XmlConvert.ToString(character.Health));
+            writer.WriteElementString("Mana", XmlConvert.ToString(character.Mana));
+            if (character.AbilityList != null)
+            {
+                writer.WriteStartElement("Abilities");
+                foreach (string ability in character.AbilityList)
+                {
+                    if (ability == null)
+                    {
+                        writer.WriteStartElement("string");
+                        writer.WriteAttributeString("xsi", "nil", XsiNamespace, "true");
+                        writer.WriteEndElement();
+                    }
+                    else
+                    {
+                        writer.WriteElementString("string", ability);
+                    }
+                }
+                writer.WriteEndElement();
+            }
+            WriteString(writer, "WeaponType", character.WeaponType);
+            WriteString(writer, "CharacterClass", character.CharacterClass);
+            WriteString(writer, "ArmorType", character.ArmorType);
+            writer.WriteEndElement();
+        }
+
+        private static void WriteString(XmlWriter writer, string name, string value)
+        {
+            if (value != null)
+                writer.WriteElementString(name, value);
+        }
+
+        // Відсутні елементи лишають значення за замовчуванням, як у XmlSerializer
+        private static Character ReadCharacter(XmlReader reader)
+        {
+            var character = new Character();
+            if (reader.IsEmptyElement)
+            {
+                reader.Read();
+                return character;
+            }
+
+            reader.ReadStartElement();
+            while (reader.MoveToContent() == XmlNodeType.Element)
+            {
+                switch (reader.LocalName)
+                {
+                    case "Id":
+                        character.Id = reader.ReadElementContentAsLong();
+                        break;
+                    case "Name":
+                        character.Name = reader.ReadElementContentAsString();
+                        break;
+                    case "Level":
+                        character.Level = reader.ReadElementContentAsInt();
+                        break;
+                    case "Health":
+                        character.Health = reader.ReadElementContentAsInt();
+                        break;
+                    case "Mana":
+                        character.Mana = reader.ReadElementContentAsInt();
+                        break;
+                    case "Abilities":
+                        ReadAbilities(reader, character.AbilityList);
+                        break;
+                    case "WeaponType":
+                        character.WeaponType = reader.ReadElementContentAsString();
+                        break;
+                    case "CharacterClass":
+                        character.CharacterClass = reader.ReadElementContentAsString();
+                        break;
+                    case "ArmorType":
+                        character.ArmorType = reader.ReadElementContentAsString();
+                        break;
+                    default:
+                        reader.Skip();
+                        break;
+                }
+            }
+            reader.ReadEndElement();
+            return character;
+        }
+
+        private static void ReadAbilities(XmlReader reader, AbilityList abilities)
+        {
+            if (reader.IsEmptyElement)
+            {
+                reader.Read();
+                return;
+            }
+
+            reader.ReadStartElement();
+            while (reader.MoveToContent() == XmlNodeType.Element)
+            {
+                if (reader.LocalName != "string")
+                {
+                    reader.Skip();
+                }
+                else if (IsNil(reader))
+                {
+                    abilities.Add(null);
+                    reader.Skip();
+                }
+                else
+                {
+                    abilities.Add(reader.ReadElementContentAsString());
+                }
+            }
+            reader.ReadEndElement();
+        }
+
+        private static bool IsNil(XmlReader reader)
+        {
+            return reader.GetAttribute("nil", XsiNamespace) == "true";
+        }
+    }
+
     // Головна форма програми
     public class MainForm : Form
     {
-        private ListBox charactersListBox;
+        private ListView charactersListView;
+        private TextBox searchTextBox;
         private Button createButton;
         private Button cloneButton;
         private Button editButton;
@@ -76,25 +630,53 @@ namespace CharacterManagementSystem
         private Button loadXmlButton;
         private Button deleteButton;
 
-        private List<Character> characters;
+        private readonly RosterViewModel characters = new RosterViewModel();
 
         public MainForm()
         {
             InitializeComponents();
-            characters = new List<Character>();
+            characters.Changed += Characters_Changed;
         }
 
+        private Character SelectedCharacter =>
+            charactersListView.SelectedIndices.Count > 0 ? characters[charactersListView.SelectedIndices[0]] : null;
+
         private void InitializeComponents()
         {
             this.Text = "Система керування персонажами";
             this.Size = new System.Drawing.Size(600, 400);
 
-            charactersListBox = new ListBox
+            Panel listPanel = new Panel
             {
                 Dock = DockStyle.Left,
                 Width = 300
             };
 
+            searchTextBox = new TextBox
+            {
+                Dock = DockStyle.Top,
+                PlaceholderText = "Пошук за іменем"
+            };
+            searchTextBox.TextChanged += SearchTextBox_TextChanged;
+
+            // Віртуальний режим: список сам запитує рядки, які показує
+            charactersListView = new ListView
+            {
+                Dock = DockStyle.Fill,
+                View = View.Details,
+                HeaderStyle = ColumnHeaderStyle.None,
+                FullRowSelect = true,
+                MultiSelect = false,
+                HideSelection = false,
+                VirtualMode = true
+            };
+            charactersListView.Columns.Add(new ColumnHeader { Width = 275 });
+            charactersListView.RetrieveVirtualItem += CharactersListView_RetrieveVirtualItem;
+
+            // Fill додається першим, щоб рядок пошуку зайняв верх панелі
+            listPanel.Controls.Add(charactersListView);
+            listPanel.Controls.Add(searchTextBox);
+
             Panel buttonPanel = new Panel
             {
                 Dock = DockStyle.Fill
@@ -173,7 +755,7 @@ namespace CharacterManagementSystem
             buttonPanel.Controls.Add(loadJsonButton);
             buttonPanel.Controls.Add(loadXmlButton);
 
-            this.Controls.Add(charactersListBox);
+            this.Controls.Add(listPanel);
             this.Controls.Add(buttonPanel);
         }
 
@@ -183,19 +765,16 @@ namespace CharacterManagementSystem
             if (characterForm.ShowDialog() == DialogResult.OK)
             {
                 characters.Add(characterForm.Character);
-                UpdateCharactersList();
             }
         }
 
         private void CloneButton_Click(object sender, EventArgs e)
         {
-            if (charactersListBox.SelectedIndex >= 0)
+            if (SelectedCharacter is Character original)
             {
-                Character original = characters[charactersListBox.SelectedIndex];
                 Character clone = (Character)original.Clone();
                 clone.Name += " (копія)";
                 characters.Add(clone);
-                UpdateCharactersList();
             }
             else
             {
@@ -205,15 +784,14 @@ namespace CharacterManagementSystem
 
         private void EditButton_Click(object sender, EventArgs e)
         {
-            if (charactersListBox.SelectedIndex >= 0)
+            if (SelectedCharacter is Character selectedCharacter)
             {
-                Character selectedCharacter = characters[charactersListBox.SelectedIndex];
                 CharacterForm characterForm = new CharacterForm(selectedCharacter);
                 
                 if (characterForm.ShowDialog() == DialogResult.OK)
                 {
-                    characters[charactersListBox.SelectedIndex] = characterForm.Character;
-                    UpdateCharactersList();
+                    // Копія зберігає Id, тож оригінал знаходиться за ним, а не за позицією у списку
+                    characters.Replace(characterForm.Character);
                 }
             }
             else
@@ -224,10 +802,9 @@ namespace CharacterManagementSystem
 
         private void DeleteButton_Click(object sender, EventArgs e)
         {
-            if (charactersListBox.SelectedIndex >= 0)
+            if (SelectedCharacter is Character selectedCharacter)
             {
-                characters.RemoveAt(charactersListBox.SelectedIndex);
-                UpdateCharactersList();
+                characters.Remove(selectedCharacter.Id);
             }
             else
             {
@@ -237,7 +814,7 @@ namespace CharacterManagementSystem
 
         private void SaveJsonButton_Click(object sender, EventArgs e)
         {
-            if (characters.Count == 0)
+            if (characters.Roster.Count == 0)
             {
                 MessageBox.Show("Немає персонажів для збереження.");
                 return;
@@ -245,8 +822,10 @@ namespace CharacterManagementSystem
 
             try
             {
-                string json = JsonSerializer.Serialize(characters, new JsonSerializerOptions { WriteIndented = true });
-                File.WriteAllText("characters.json", json);
+                using (FileStream fs = new FileStream("characters.json", FileMode.Create))
+                {
+                    JsonSerializer.Serialize(fs, characters.Roster.ToList(), CharacterJsonContext.Default.ListCharacter);
+                }
                 MessageBox.Show("Персонажі успішно збережені у файл characters.json");
             }
             catch (Exception ex)
@@ -257,7 +836,7 @@ namespace CharacterManagementSystem
 
         private void SaveXmlButton_Click(object sender, EventArgs e)
         {
-            if (characters.Count == 0)
+            if (characters.Roster.Count == 0)
             {
                 MessageBox.Show("Немає персонажів для збереження.");
                 return;
@@ -265,10 +844,9 @@ namespace CharacterManagementSystem
 
             try
             {
-                XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
                 using (FileStream fs = new FileStream("characters.xml", FileMode.Create))
                 {
-                    serializer.Serialize(fs, characters);
+                    CharacterXmlFile.Write(fs, characters.Roster);
                 }
                 MessageBox.Show("Персонажі успішно збережені у файл characters.xml");
             }
@@ -284,9 +862,12 @@ namespace CharacterManagementSystem
             {
                 if (File.Exists("characters.json"))
                 {
-                    string json = File.ReadAllText("characters.json");
-                    characters = JsonSerializer.Deserialize<List<Character>>(json);
-                    UpdateCharactersList();
+                    List<Character> loaded;
+                    using (FileStream fs = new FileStream("characters.json", FileMode.Open, FileAccess.Read))
+                    {
+                        loaded = JsonSerializer.Deserialize(fs, CharacterJsonContext.Default.ListCharacter);
+                    }
+                    characters.Load(new CharacterRoster(loaded));
                     MessageBox.Show("Персонажі успішно завантажені з файлу characters.json");
                 }
                 else
@@ -306,12 +887,12 @@ namespace CharacterManagementSystem
             {
                 if (File.Exists("characters.xml"))
                 {
-                    XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
-                    using (FileStream fs = new FileStream("characters.xml", FileMode.Open))
+                    List<Character> loaded;
+                    using (FileStream fs = new FileStream("characters.xml", FileMode.Open, FileAccess.Read))
                     {
-                        characters = (List<Character>)serializer.Deserialize(fs);
+                        loaded = CharacterXmlFile.Read(fs);
                     }
-                    UpdateCharactersList();
+                    characters.Load(new CharacterRoster(loaded));
                     MessageBox.Show("Персонажі успішно завантажені з файлу characters.xml");
                 }
                 else
@@ -325,13 +906,28 @@ namespace CharacterManagementSystem
             }
         }
 
-        private void UpdateCharactersList()
+        private void SearchTextBox_TextChanged(object sender, EventArgs e)
+        {
+            characters.Search(searchTextBox.Text);
+        }
+
+        // Оновлюємо лише кількість рядків і видиму частину списку
+        private void Characters_Changed(object sender, RosterChangedEventArgs e)
         {
-            charactersListBox.Items.Clear();
-            foreach (var character in characters)
+            if (e.Kind == RosterChangeKind.Replace)
             {
-                charactersListBox.Items.Add(character);
+                charactersListView.RedrawItems(e.Index, e.Index, false);
+                return;
             }
+
+            charactersListView.SelectedIndices.Clear();
+            charactersListView.VirtualListSize = characters.Count;
+            charactersListView.Invalidate();
+        }
+
+        private void CharactersListView_RetrieveVirtualItem(object sender, RetrieveVirtualItemEventArgs e)
+        {
+            e.Item = new ListViewItem(characters[e.ItemIndex].ToString());
         }
     }
 
@@ -361,6 +957,7 @@ namespace CharacterManagementSystem
             if (character != null)
             {
                 Character = (Character)character.Clone();
+                Character.Id = character.Id;
                 FillFormWithCharacterData();
             }
             else
@@ -531,7 +1128,7 @@ namespace CharacterManagementSystem
             Character.Health = (int)healthNumeric.Value;
             Character.Mana = (int)manaNumeric.Value;
             
-            Character.Abilities = new List<string>();
+            Character.Abilities = new AbilityList();
             foreach (var item in abilitiesListBox.Items)
             {
                 Character.Abilities.Add(item.ToString());
@@ -0,0 +1,459 @@
+// Game Character Manager - Roster command line tool (console, references GameCharacterManager)
+
+// 1. StageTimer.cs - Per-stage timing and throughput of a streamed pipeline
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+
+namespace GameCharacterManager.Cli
+{
+    // One step of a pipeline. Stages pull from the ones upstream of them, so the time spent in a
+    // stage's MoveNext includes theirs; Elapsed subtracts it to give the stage's own share.
+    public sealed class PipelineStage
+    {
+        private readonly PipelineStage[] _upstream;
+        private long _ticks;
+
+        internal PipelineStage(string name, PipelineStage[] upstream)
+        {
+            Name = name;
+            _upstream = upstream;
+        }
+
+        public string Name { get; }
+        public long Records { get; set; }
+
+        // Bytes read or written by the stage, or 0 when it only transforms records
+        public long Bytes { get; set; }
+
+        public TimeSpan Inclusive => TimeSpan.FromSeconds((double)_ticks / Stopwatch.Frequency);
+
+        public TimeSpan Elapsed
+        {
+            get
+            {
+                long ticks = _ticks;
+                foreach (PipelineStage stage in _upstream)
+                    ticks -= stage._ticks;
+                return TimeSpan.FromSeconds(Math.Max(0, ticks) / (double)Stopwatch.Frequency);
+            }
+        }
+
+        // Pass source through, timing each step and counting the records
+        public IEnumerable<Character> Track(IEnumerable<Character> source)
+        {
+            long start = Stopwatch.GetTimestamp();
+            using (IEnumerator<Character> enumerator = source.GetEnumerator())
+            {
+                while (true)
+                {
+                    bool more = enumerator.MoveNext();
+                    Character character = more ? enumerator.Current : null;
+                    _ticks += Stopwatch.GetTimestamp() - start;
+                    if (!more)
+                        yield break;
+
+                    Records++;
+                    yield return character;
+                    start = Stopwatch.GetTimestamp();
+                }
+            }
+        }
+
+        // Time a sink that drains the stages upstream
+        public void Time(Action action)
+        {
+            long start = Stopwatch.GetTimestamp();
+            try
+            {
+                action();
+            }
+            finally
+            {
+                _ticks += Stopwatch.GetTimestamp() - start;
+            }
+        }
+    }
+
+    public sealed class StageTimer
+    {
+        private readonly List<PipelineStage> _stages = new List<PipelineStage>();
+        private readonly long _start = Stopwatch.GetTimestamp();
+
+        public PipelineStage Stage(string name, params PipelineStage[] upstream)
+        {
+            var stage = new PipelineStage(name, upstream);
+            _stages.Add(stage);
+            return stage;
+        }
+
+        public void Report(TextWriter output)
+        {
+            foreach (PipelineStage stage in _stages)
+            {
+                double seconds = Math.Max(stage.Elapsed.TotalSeconds, 1e-9);
+                string line = $"{stage.Name,-24} {stage.Records,12:N0} records {stage.Elapsed.TotalMilliseconds,10:F1} ms {stage.Records / seconds,14:N0} records/s";
+                if (stage.Bytes > 0)
+                    line += $" {stage.Bytes / seconds / (1024 * 1024),9:F1} MB/s";
+                output.WriteLine(line);
+            }
+            TimeSpan total = TimeSpan.FromSeconds((Stopwatch.GetTimestamp() - _start) / (double)Stopwatch.Frequency);
+            output.WriteLine($"{"total",-24} {"",20} {total.TotalMilliseconds,10:F1} ms");
+        }
+    }
+}
+
+// 2. RosterValidator.cs - Checks a streamed roster against what the editor accepts
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Cli
+{
+    // Ranges match CharacterForm's numeric fields, which refuse values outside them. Ids are
+    // remembered in a CharacterBitmap, so duplicates are found without holding the roster.
+    public sealed class RosterValidator
+    {
+        public const int MinLevel = 1;
+        public const int MaxLevel = 100;
+        public const int MinHealth = 1;
+        public const int MaxHealth = 1000;
+        public const int MinMana = 0;
+        public const int MaxMana = 1000;
+
+        private readonly CharacterBitmap _ids = new CharacterBitmap();
+        private readonly List<string> _problems = new List<string>();
+        private readonly int _problemLimit;
+        private long _position;
+
+        public RosterValidator(int problemLimit = 100)
+        {
+            _problemLimit = problemLimit;
+        }
+
+        public long ProblemCount { get; private set; }
+
+        // The first problemLimit problems, as "#position: text"
+        public IReadOnlyList<string> Problems => _problems;
+
+        public void Check(Character character)
+        {
+            long position = _position++;
+            if (character == null)
+            {
+                Report(position, "null entry");
+                return;
+            }
+
+            if (character.Id != 0 && !_ids.Add(character.Id))
+                Report(position, $"duplicate Id {character.Id}");
+            if (string.IsNullOrWhiteSpace(character.Name))
+                Report(position, "empty Name");
+            if (character.Level < MinLevel || character.Level > MaxLevel)
+                Report(position, $"Level {character.Level} outside {MinLevel}..{MaxLevel}");
+            if (!Enum.IsDefined(character.Class))
+                Report(position, $"undefined Class {(int)character.Class}");
+
+            // Only read when already loaded, so a header-only character stays that way
+            if (!character.DetailsLoaded)
+                return;
+            if (character.Health < MinHealth || character.Health > MaxHealth)
+                Report(position, $"Health {character.Health} outside {MinHealth}..{MaxHealth}");
+            if (character.Mana < MinMana || character.Mana > MaxMana)
+                Report(position, $"Mana {character.Mana} outside {MinMana}..{MaxMana}");
+        }
+
+        private void Report(long position, string problem)
+        {
+            ProblemCount++;
+            if (_problems.Count < _problemLimit)
+                _problems.Add($"#{position}: {problem}");
+        }
+    }
+}
+
+// 3. RosterCommands.cs - convert, merge, filter and validate over streamed roster files
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Cli
+{
+    // Each command streams its inputs record by record into its output, so rosters of any size
+    // run in memory bounded by the codecs' buffers. Formats follow the file extensions.
+    public static class RosterCommands
+    {
+        // Synthesize count characters straight into output; pooled, so memory stays flat
+        public static int Generate(string output, long count, RosterGeneratorOptions options)
+        {
+            var generator = new RosterGenerator(options);
+
+            var timer = new StageTimer();
+            PipelineStage generate = timer.Stage("generate");
+            PipelineStage write = timer.Stage($"write {Path.GetFileName(output)}", generate);
+
+            IEnumerable<Character> characters = generate.Track(generator.Generate(count, new CharacterPool(16)));
+            write.Time(() => CharacterRepository.SaveToFile(output, characters));
+
+            write.Records = generate.Records;
+            write.Bytes = new FileInfo(output).Length;
+            timer.Report(Console.Out);
+            return 0;
+        }
+
+        public static int Convert(string input, string output)
+        {
+            var timer = new StageTimer();
+            PipelineStage read = timer.Stage($"read {Path.GetFileName(input)}");
+            PipelineStage write = timer.Stage($"write {Path.GetFileName(output)}", read);
+
+            IEnumerable<Character> characters = read.Track(CharacterRepository.StreamFromFile(input));
+            write.Time(() => CharacterRepository.SaveToFile(output, characters));
+
+            Finish(timer, read, input, write, output);
+            return 0;
+        }
+
+        // Concatenate rosters in argument order. A character whose Id an earlier one already has
+        // gets the next free Id, one past the highest seen so far, as CharacterRoster gives it;
+        // with dedupe it is dropped instead, so the first input wins. Characters without an Id
+        // are left for the next load to number.
+        public static int Merge(string output, IReadOnlyList<string> inputs, bool dedupe = false)
+        {
+            var timer = new StageTimer();
+            var reads = new PipelineStage[inputs.Count];
+            for (int i = 0; i < inputs.Count; i++)
+                reads[i] = timer.Stage($"read {Path.GetFileName(inputs[i])}");
+            PipelineStage merge = timer.Stage("merge", reads);
+            PipelineStage write = timer.Stage($"write {Path.GetFileName(output)}", merge);
+
+            var ids = new CharacterBitmap();
+            long nextId = 1;
+            long dropped = 0;
+            long renumbered = 0;
+            IEnumerable<Character> Concatenate()
+            {
+                for (int i = 0; i < inputs.Count; i++)
+                {
+                    foreach (Character character in reads[i].Track(CharacterRepository.StreamFromFile(inputs[i])))
+                    {
+                        if (character != null && character.Id > 0 && !ids.Add(character.Id))
+                        {
+                            if (dedupe)
+                            {
+                                dropped++;
+                                continue;
+                            }
+                            character.Id = nextId;
+                            ids.Add(character.Id);
+                            renumbered++;
+                        }
+                        if (character != null && character.Id >= nextId)
+                            nextId = character.Id + 1;
+                        yield return character;
+                    }
+                }
+            }
+
+            IEnumerable<Character> characters = merge.Track(Concatenate());
+            write.Time(() => CharacterRepository.SaveToFile(output, characters));
+
+            for (int i = 0; i < inputs.Count; i++)
+                reads[i].Bytes = new FileInfo(inputs[i]).Length;
+            write.Records = merge.Records;
+            write.Bytes = new FileInfo(output).Length;
+            timer.Report(Console.Out);
+            if (dropped > 0)
+                Console.WriteLine($"{dropped:N0} characters dropped as duplicate Ids");
+            if (renumbered > 0)
+                Console.WriteLine($"{renumbered:N0} characters given new Ids in place of duplicates");
+            return 0;
+        }
+
+        public static int Filter(string input, string output, string queryText)
+        {
+            CharacterQuery query = CharacterQuery.Parse(queryText);
+
+            var timer = new StageTimer();
+            PipelineStage read = timer.Stage($"read {Path.GetFileName(input)}");
+            PipelineStage filter = timer.Stage("filter", read);
+            PipelineStage write = timer.Stage($"write {Path.GetFileName(output)}", filter);
+
+            IEnumerable<Character> characters = filter.Track(query.Filter(read.Track(CharacterRepository.StreamFromFile(input))));
+            write.Time(() => CharacterRepository.SaveToFile(output, characters));
+
+            write.Records = filter.Records;
+            Finish(timer, read, input, write, output);
+            return 0;
+        }
+
+        // Exit code 1 when any roster has problems
+        public static int Validate(IReadOnlyList<string> inputs)
+        {
+            var timer = new StageTimer();
+            int exitCode = 0;
+            foreach (string input in inputs)
+            {
+                PipelineStage read = timer.Stage($"read {Path.GetFileName(input)}");
+                PipelineStage check = timer.Stage("validate", read);
+
+                var validator = new RosterValidator();
+                check.Time(() =>
+                {
+                    foreach (Character character in read.Track(CharacterRepository.StreamFromFile(input)))
+                        validator.Check(character);
+                });
+                check.Records = read.Records;
+                read.Bytes = new FileInfo(input).Length;
+
+                foreach (string problem in validator.Problems)
+                    Console.WriteLine($"{input} {problem}");
+                if (validator.ProblemCount > validator.Problems.Count)
+                    Console.WriteLine($"{input}: {validator.ProblemCount - validator.Problems.Count:N0} more problems");
+                Console.WriteLine($"{input}: {read.Records:N0} characters, {validator.ProblemCount:N0} problems");
+                if (validator.ProblemCount > 0)
+                    exitCode = 1;
+            }
+            timer.Report(Console.Out);
+            return exitCode;
+        }
+
+        private static void Finish(StageTimer timer, PipelineStage read, string input, PipelineStage write, string output)
+        {
+            read.Bytes = new FileInfo(input).Length;
+            if (write.Records == 0)
+                write.Records = read.Records;
+            write.Bytes = new FileInfo(output).Length;
+            timer.Report(Console.Out);
+        }
+    }
+}
+
+// 4. Program.cs - Command line entry point
+using System;
+using System.Globalization;
+using System.IO;
+using System.Linq;
+using System.Text.Json;
+using System.Xml;
+
+namespace GameCharacterManager.Cli
+{
+    static class Program
+    {
+        // Usage: roster generate <output> <count> [generator options]
+        //        roster convert <input> <output>
+        //        roster merge [--dedupe] <output> <input> <input>...
+        //        roster filter <input> <output> <query>
+        //        roster validate <input>...
+        // Files are .json, .xml or .bin, and .json.gz, .json.br, .xml.gz or .xml.br for compressed
+        // rosters; see CharacterQuery for the query syntax. merge gives a character whose Id an
+        // earlier one has a new Id, or with --dedupe drops it.
+        // Generator options: --seed N, --level MIN-MAX, --health MIN-MAX, --mana MIN-MAX,
+        // --classes W,W,W,W,W, --abilities MIN-MAX, --vocabulary N, --ability-skew S,
+        // --count-skew S, --collisions RATE, --no-ids. See RosterGeneratorOptions.
+        static int Main(string[] args)
+        {
+            string command = args.Length > 0 ? args[0] : "";
+            try
+            {
+                switch (command)
+                {
+                    case "generate" when args.Length >= 3:
+                        return RosterCommands.Generate(args[1], long.Parse(args[2], CultureInfo.InvariantCulture), ParseGeneratorOptions(args, 3));
+                    case "convert" when args.Length == 3:
+                        return RosterCommands.Convert(args[1], args[2]);
+                    case "merge" when args.Length >= 4 && args[1] == "--dedupe":
+                        return RosterCommands.Merge(args[2], args.Skip(3).ToArray(), true);
+                    case "merge" when args.Length >= 3:
+                        return RosterCommands.Merge(args[1], args.Skip(2).ToArray());
+                    case "filter" when args.Length == 4:
+                        return RosterCommands.Filter(args[1], args[2], args[3]);
+                    case "validate" when args.Length >= 2:
+                        return RosterCommands.Validate(args.Skip(1).ToArray());
+                    default:
+                        Console.Error.WriteLine("Usage: roster generate <output> <count> [options]");
+                        Console.Error.WriteLine("       roster convert <input> <output>");
+                        Console.Error.WriteLine("       roster merge [--dedupe] <output> <input> <input>...");
+                        Console.Error.WriteLine("       roster filter <input> <output> <query>");
+                        Console.Error.WriteLine("       roster validate <input>...");
+                        return 2;
+                }
+            }
+            catch (Exception ex) when (ex is IOException || ex is UnauthorizedAccessException
+                || ex is ArgumentException || ex is FormatException || ex is InvalidDataException
+                || ex is JsonException || ex is XmlException)
+            {
+                Console.Error.WriteLine($"roster {command}: {ex.Message}");
+                return 1;
+            }
+        }
+
+        private static RosterGeneratorOptions ParseGeneratorOptions(string[] args, int start)
+        {
+            var options = new RosterGeneratorOptions();
+            for (int i = start; i < args.Length; i++)
+            {
+                string option = args[i];
+                if (option == "--no-ids")
+                {
+                    options.AssignIds = false;
+                    continue;
+                }
+                if (i + 1 == args.Length)
+                    throw new ArgumentException($"{option} needs a value.");
+
+                string value = args[++i];
+                switch (option)
+                {
+                    case "--seed":
+                        options.Seed = int.Parse(value, CultureInfo.InvariantCulture);
+                        break;
+                    case "--level":
+                        options.Level = ParseRange(value);
+                        break;
+                    case "--health":
+                        options.Health = ParseRange(value);
+                        break;
+                    case "--mana":
+                        options.Mana = ParseRange(value);
+                        break;
+                    case "--classes":
+                        options.ClassWeights = value.Split(',').Select(w => double.Parse(w, CultureInfo.InvariantCulture)).ToArray();
+                        break;
+                    case "--abilities":
+                        StatDistribution abilities = ParseRange(value);
+                        options.MinAbilities = abilities.Min;
+                        options.MaxAbilities = abilities.Max;
+                        break;
+                    case "--vocabulary":
+                        options.AbilityVocabulary = int.Parse(value, CultureInfo.InvariantCulture);
+                        break;
+                    case "--ability-skew":
+                        options.AbilitySkew = double.Parse(value, CultureInfo.InvariantCulture);
+                        break;
+                    case "--count-skew":
+                        options.AbilityCountSkew = double.Parse(value, CultureInfo.InvariantCulture);
+                        break;
+                    case "--collisions":
+                        options.NameCollisionRate = double.Parse(value, CultureInfo.InvariantCulture);
+                        break;
+                    default:
+                        throw new ArgumentException($"Unknown option {option}.");
+                }
+            }
+            return options;
+        }
+
+        // MIN-MAX, drawn uniformly
+        private static StatDistribution ParseRange(string value)
+        {
+            int dash = value.IndexOf('-', 1);
+            if (dash < 0)
+                throw new FormatException($"{value} is not a MIN-MAX range.");
+            return StatDistribution.Uniform(
+                int.Parse(value.Substring(0, dash), CultureInfo.InvariantCulture),
+                int.Parse(value.Substring(dash + 1), CultureInfo.InvariantCulture));
+        }
+    }
+}
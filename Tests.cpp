@@ -0,0 +1,1049 @@
+// Game Character Manager - Test project (console, references GameCharacterManager)
+
+// 1. TestRunner.cs - Test attribute, assertions and a runner that needs no window
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+
+namespace GameCharacterManager.Tests
+{
+    // Marks a public static parameterless method as a test
+    [AttributeUsage(AttributeTargets.Method)]
+    public sealed class TestAttribute : Attribute
+    {
+    }
+
+    public sealed class AssertionException : Exception
+    {
+        public AssertionException(string message)
+            : base(message)
+        {
+        }
+    }
+
+    public static class Assert
+    {
+        public static void True(bool condition, string message)
+        {
+            if (!condition)
+                throw new AssertionException(message);
+        }
+
+        public static void Equal<T>(T expected, T actual, string what)
+        {
+            if (!EqualityComparer<T>.Default.Equals(expected, actual))
+                throw new AssertionException($"{what}: expected {expected}, got {actual}");
+        }
+
+        public static TException Throws<TException>(Action action) where TException : Exception
+        {
+            try
+            {
+                action();
+            }
+            catch (TException ex)
+            {
+                return ex;
+            }
+            throw new AssertionException($"expected {typeof(TException).Name}");
+        }
+
+        // Same characters in the same order, field by field
+        public static void SameCharacters(IReadOnlyList<Character> expected, IReadOnlyList<Character> actual)
+        {
+            Equal(expected.Count, actual.Count, "character count");
+            for (int i = 0; i < expected.Count; i++)
+                SameCharacter(expected[i], actual[i], i);
+        }
+
+        public static void SameCharacter(Character expected, Character actual, int index = 0)
+        {
+            string at = $"character {index}";
+            Equal(expected.Id, actual.Id, at + " Id");
+            Equal(expected.Name, actual.Name, at + " Name");
+            Equal(expected.Level, actual.Level, at + " Level");
+            Equal(expected.Health, actual.Health, at + " Health");
+            Equal(expected.Mana, actual.Mana, at + " Mana");
+            Equal(expected.Class, actual.Class, at + " Class");
+            Equal(expected.WeaponType, actual.WeaponType, at + " WeaponType");
+            Equal(expected.ArmorType, actual.ArmorType, at + " ArmorType");
+            Equal(string.Join("|", expected.Abilities ?? new AbilityList()),
+                string.Join("|", actual.Abilities ?? new AbilityList()), at + " Abilities");
+        }
+    }
+
+    // A scratch directory removed with everything in it
+    public sealed class TempDirectory : IDisposable
+    {
+        public TempDirectory()
+        {
+            Path = System.IO.Path.Combine(System.IO.Path.GetTempPath(), "gcm-tests-" + Guid.NewGuid().ToString("N"));
+            Directory.CreateDirectory(Path);
+        }
+
+        public string Path { get; }
+
+        public string Combine(string fileName)
+        {
+            return System.IO.Path.Combine(Path, fileName);
+        }
+
+        public CharacterRepository Repository(string extension = "")
+        {
+            return new CharacterRepository(Combine("characters.json" + extension), Combine("characters.xml" + extension),
+                Combine("characters.bin"));
+        }
+
+        public void Dispose()
+        {
+            try
+            {
+                Directory.Delete(Path, true);
+            }
+            catch (IOException)
+            {
+            }
+        }
+    }
+
+    public static class TestRunner
+    {
+        // Runs every [Test] method whose full name contains filter; returns the number that failed
+        public static int Run(string filter)
+        {
+            var tests = Assembly.GetExecutingAssembly().GetTypes()
+                .SelectMany(type => type.GetMethods(BindingFlags.Public | BindingFlags.Static))
+                .Where(method => method.GetCustomAttribute<TestAttribute>() != null)
+                .Where(method => filter == null || FullName(method).Contains(filter, StringComparison.OrdinalIgnoreCase))
+                .OrderBy(FullName, StringComparer.Ordinal)
+                .ToList();
+
+            int failed = 0;
+            var stopwatch = Stopwatch.StartNew();
+            foreach (MethodInfo test in tests)
+            {
+                try
+                {
+                    test.Invoke(null, null);
+                    Console.WriteLine($"PASS {FullName(test)}");
+                }
+                catch (TargetInvocationException ex)
+                {
+                    failed++;
+                    Console.WriteLine($"FAIL {FullName(test)}: {ex.InnerException?.GetType().Name}: {ex.InnerException?.Message}");
+                    if (ex.InnerException is not AssertionException)
+                        Console.WriteLine(ex.InnerException?.StackTrace);
+                }
+            }
+
+            Console.WriteLine($"{tests.Count - failed} passed, {failed} failed in {stopwatch.ElapsedMilliseconds} ms");
+            return failed;
+        }
+
+        private static string FullName(MethodInfo method)
+        {
+            return method.DeclaringType.Name + "." + method.Name;
+        }
+    }
+
+    internal static class Samples
+    {
+        // Characters covering the awkward cases: no abilities, empty, repeated, escaped and non-ASCII text
+        public static List<Character> Characters()
+        {
+            var characters = new List<Character>
+            {
+                new Character("Aria", 12, 340, 120, new[] { "Fireball", "Blink" }, "Staff", CharacterClass.Mage, "Light"),
+                new Character("Bran", 40, 900, 0, new string[0], "Axe", CharacterClass.Warrior, "Heavy"),
+                new Character("Éowyn \"Shieldmaiden\" <&>", 99, 1000, 50, new[] { "Parry & <Riposte>", "Ш", "Fireball" }, "Bow", CharacterClass.Warrior, "Magic"),
+                new Character(string.Empty, 1, 1, 1, new[] { "" }, "", CharacterClass.Mage, "")
+            };
+            CharacterRoster.AssignIds(characters);
+            return characters;
+        }
+
+        public static List<Character> Generated(int count, int seed = 7)
+        {
+            return new RosterGenerator(new RosterGeneratorOptions { Seed = seed }).Generate(count).ToList();
+        }
+    }
+}
+
+// 2. ViewModelTests.cs - Change notifications of RosterViewModel with and without a search
+using System.Collections.Generic;
+
+namespace GameCharacterManager.Tests
+{
+    public static class ViewModelTests
+    {
+        private static (RosterViewModel view, List<RosterChangedEventArgs> changes) Create(params string[] names)
+        {
+            var roster = new CharacterRoster();
+            foreach (string name in names)
+                roster.Add(new Character(name, 1, 10, 10, new string[0], "Sword", CharacterClass.Warrior, "Light"));
+
+            var view = new RosterViewModel(roster);
+            var changes = new List<RosterChangedEventArgs>();
+            view.Changed += (sender, e) => changes.Add(e);
+            return (view, changes);
+        }
+
+        private static Character Renamed(Character character, string name)
+        {
+            Character edited = character.CloneWithName(name);
+            edited.Id = character.Id;
+            return edited;
+        }
+
+        private static void Single(List<RosterChangedEventArgs> changes, RosterChangeKind kind, int index)
+        {
+            Assert.Equal(1, changes.Count, "notifications");
+            Assert.Equal(kind, changes[0].Kind, "change kind");
+            Assert.Equal(index, changes[0].Index, "change index");
+            changes.Clear();
+        }
+
+        [Test]
+        public static void InsertReplaceRemoveWithoutSearch()
+        {
+            var (view, changes) = Create("Aria", "Bran", "Cole");
+
+            view.Add(new Character("Dara", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            Single(changes, RosterChangeKind.Insert, 3);
+
+            Character bran = view[1];
+            view.Replace(Renamed(bran, "Brandt"));
+            Single(changes, RosterChangeKind.Replace, 1);
+            Assert.Equal("Brandt", view[1].Name, "replaced name");
+
+            view.Remove(view[0].Id);
+            Single(changes, RosterChangeKind.Remove, 0);
+            Assert.Equal(3, view.Count, "count");
+            Assert.Equal(0, view.IndexOf(bran.Id), "row of Bran after the first row went");
+        }
+
+        [Test]
+        public static void LoadAndSearchReset()
+        {
+            var (view, changes) = Create("Aria", "Bran");
+
+            view.Search("  ar ");
+            Single(changes, RosterChangeKind.Reset, -1);
+            Assert.Equal("ar", view.SearchText, "trimmed search text");
+            Assert.Equal(1, view.Count, "matches");
+
+            view.Search("ar");
+            Assert.Equal(0, changes.Count, "same search notifications");
+
+            var loaded = new CharacterRoster();
+            loaded.Add(new Character("Arlo", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            loaded.Add(new Character("Mara", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            loaded.Add(new Character("Zed", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            view.Load(loaded);
+            Single(changes, RosterChangeKind.Reset, -1);
+            Assert.Equal(2, view.Count, "matches kept the search after a load");
+
+            view.Search(string.Empty);
+            Single(changes, RosterChangeKind.Reset, -1);
+            Assert.Equal(3, view.Count, "rows without a search");
+        }
+
+        [Test]
+        public static void InsertUnderSearch()
+        {
+            var (view, changes) = Create("Aria", "Bran", "Arlo");
+            view.Search("ar");
+            changes.Clear();
+
+            view.Add(new Character("Cole", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            Assert.Equal(0, changes.Count, "notifications for a hidden add");
+            Assert.Equal(2, view.Count, "matches");
+            Assert.Equal(4, view.Roster.Count, "roster count");
+
+            view.Add(new Character("Mara", 1, 10, 10, new string[0], "Bow", CharacterClass.Mage, "Light"));
+            Single(changes, RosterChangeKind.Insert, 2);
+            Assert.Equal("Mara", view[2].Name, "inserted row");
+        }
+
+        [Test]
+        public static void ReplaceUnderSearch()
+        {
+            var (view, changes) = Create("Aria", "Bran", "Arlo");
+            view.Search("ar");
+            changes.Clear();
+
+            Character arlo = view.Roster[2];
+            int row = view.IndexOf(arlo.Id);
+            view.Replace(Renamed(arlo, "Arlon"));
+            Single(changes, RosterChangeKind.Replace, row);
+
+            view.Replace(Renamed(arlo, "Dusk"));
+            Single(changes, RosterChangeKind.Remove, row);
+            Assert.Equal(-1, view.IndexOf(arlo.Id), "row of a character that stopped matching");
+            Assert.Equal(1, view.Count, "matches");
+
+            Character bran = view.Roster[1];
+            view.Replace(Renamed(bran, "Barbara"));
+            Single(changes, RosterChangeKind.Insert, 1);
+            Assert.Equal(bran.Id, view[1].Id, "row of a character that started matching");
+        }
+
+        [Test]
+        public static void RemoveUnderSearch()
+        {
+            var (view, changes) = Create("Aria", "Bran", "Arlo", "Mara");
+            view.Search("ar");
+            changes.Clear();
+
+            Assert.Equal(1, view.Remove(view.Roster[1].Id), "roster position of a hidden remove");
+            Assert.Equal(0, changes.Count, "notifications for a hidden remove");
+
+            long first = view[0].Id;
+            view.Remove(first);
+            Single(changes, RosterChangeKind.Remove, 0);
+            Assert.Equal(2, view.Count, "matches");
+            Assert.Equal(2, view.Roster.Count, "roster count");
+
+            Assert.Equal(-1, view.Remove(first), "second remove of the same Id");
+            Assert.Equal(0, changes.Count, "notifications for a missing Id");
+        }
+    }
+}
+
+// 3. CodecTests.cs - Round trips through the JSON, XML and binary codecs and the repository
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading.Tasks;
+using System.Xml.Serialization;
+
+namespace GameCharacterManager.Tests
+{
+    public static class CodecTests
+    {
+        [Test]
+        public static void JsonRoundTrip()
+        {
+            List<Character> characters = Samples.Characters();
+            var stream = new MemoryStream();
+            CharacterJsonCodec.Write(stream, characters);
+            stream.Position = 0;
+            Assert.SameCharacters(characters, CharacterJsonCodec.Read(stream).ToList());
+        }
+
+        [Test]
+        public static void XmlRoundTrip()
+        {
+            List<Character> characters = Samples.Characters();
+            var stream = new MemoryStream();
+            CharacterXmlCodec.Write(stream, characters);
+            stream.Position = 0;
+            Assert.SameCharacters(characters, CharacterXmlCodec.Read(stream).ToList());
+        }
+
+        // Abilities takes any IList<string>, copied on assignment, and XmlSerializer, which cannot
+        // handle an interface-typed member, still writes the codec's layout and reads it back
+        [Test]
+        public static void AbilitiesKeepTheListSurface()
+        {
+            var abilities = new List<string> { "Fireball", "Frost" };
+            var character = new Character { Abilities = abilities };
+            abilities.Add("Later");
+            Assert.Equal("Fireball|Frost", string.Join("|", character.Abilities), "abilities after the list changed");
+
+            List<Character> characters = Samples.Characters();
+            var serializer = new XmlSerializer(typeof(List<Character>));
+            var xml = new MemoryStream();
+            serializer.Serialize(xml, characters);
+            var codec = new MemoryStream();
+            CharacterXmlCodec.Write(codec, characters);
+            Assert.Equal(System.Convert.ToBase64String(xml.ToArray()), System.Convert.ToBase64String(codec.ToArray()), "XmlSerializer bytes");
+
+            xml.Position = 0;
+            Assert.SameCharacters(characters, (List<Character>)serializer.Deserialize(xml));
+        }
+
+        // As with XmlSerializer, a missing element leaves the default of new Character()
+        [Test]
+        public static void XmlNullTextReadsAsDefault()
+        {
+            var character = new Character("Aria", 1, 1, 1, new string[0], null, CharacterClass.Mage, null);
+            var stream = new MemoryStream();
+            CharacterXmlCodec.Write(stream, new[] { character });
+            stream.Position = 0;
+            Character read = CharacterXmlCodec.Read(stream).Single();
+            Assert.Equal(new Character().WeaponType, read.WeaponType, "WeaponType");
+            Assert.Equal(new Character().ArmorType, read.ArmorType, "ArmorType");
+        }
+
+        [Test]
+        public static void BinaryRoundTrip()
+        {
+            List<Character> characters = Samples.Characters();
+            var stream = new MemoryStream();
+            CharacterBinaryCodec.Write(stream, characters);
+            stream.Position = 0;
+            Assert.SameCharacters(characters, CharacterBinaryCodec.Read(stream).ToList());
+        }
+
+        [Test]
+        public static void EmptyRosterRoundTrip()
+        {
+            var empty = new List<Character>();
+            var stream = new MemoryStream();
+            CharacterJsonCodec.Write(stream, empty);
+            stream.Position = 0;
+            Assert.Equal(0, CharacterJsonCodec.Read(stream).Count(), "JSON count");
+
+            stream = new MemoryStream();
+            CharacterXmlCodec.Write(stream, empty);
+            stream.Position = 0;
+            Assert.Equal(0, CharacterXmlCodec.Read(stream).Count(), "XML count");
+
+            stream = new MemoryStream();
+            CharacterBinaryCodec.Write(stream, empty);
+            stream.Position = 0;
+            Assert.Equal(0, CharacterBinaryCodec.Read(stream).Count(), "binary count");
+        }
+
+        // Threads racing to a header-only character's details read them once and all see them
+        [Test]
+        public static void DeferredDetailsLoadOnceAcrossThreads()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(2000);
+                string path = directory.Combine("characters.json");
+                using (var fs = new FileStream(path, FileMode.Create))
+                    CharacterJsonCodec.Write(fs, characters);
+
+                List<Character> headers;
+                CharacterDetailSource details = CharacterDetailSource.Open(path);
+                using (var fs = new FileStream(path, FileMode.Open, FileAccess.Read))
+                    headers = CharacterJsonCodec.ReadHeaders(fs, details).ToList();
+                Assert.Equal(2000, details.Pending, "pending details");
+
+                var failures = new List<string>();
+                Parallel.For(0, 8, worker =>
+                {
+                    for (int i = 0; i < headers.Count; i++)
+                    {
+                        if (headers[i].Health != characters[i].Health || headers[i].Abilities.Count != characters[i].Abilities.Count)
+                        {
+                            lock (failures)
+                                failures.Add($"worker {worker} saw character {i} before its details");
+                        }
+                    }
+                });
+
+                Assert.Equal(0, failures.Count, failures.FirstOrDefault());
+                Assert.Equal(0, details.Pending, "pending details");
+                Assert.SameCharacters(characters, headers);
+            }
+        }
+
+        [Test]
+        public static void BinaryAsyncRoundTripAndCancel()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(10000);
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToBinaryAsync(characters).Wait();
+                Assert.SameCharacters(characters, repository.LoadFromBinaryAsync().Result);
+
+                // Cancelled after the first progress report: the earlier file is kept
+                using (var cancel = new System.Threading.CancellationTokenSource())
+                {
+                    var progress = new SynchronousProgress(() => cancel.Cancel());
+                    Assert.Throws<System.AggregateException>(() => repository.SaveToBinaryAsync(Samples.Generated(20000, 3), progress, cancel.Token).Wait());
+                }
+                Assert.SameCharacters(characters, repository.LoadFromBinary());
+                Assert.Equal(1, Directory.GetFiles(directory.Path).Length, "files after a cancelled save");
+            }
+        }
+
+        // Progress<T> posts its reports; this one runs the callback on the reporting thread
+        private sealed class SynchronousProgress : System.IProgress<(long done, long total)>
+        {
+            private readonly System.Action _report;
+
+            public SynchronousProgress(System.Action report)
+            {
+                _report = report;
+            }
+
+            public void Report((long done, long total) value)
+            {
+                _report();
+            }
+        }
+
+        [Test]
+        public static void RepositoryFilesRoundTrip()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(500);
+                CharacterRepository repository = directory.Repository();
+
+                repository.SaveToJson(characters);
+                Assert.SameCharacters(characters, repository.LoadFromJson());
+                Assert.SameCharacters(characters, repository.LoadHeadersFromJson());
+                Assert.Equal(500L, repository.CountJson(), "JSON count");
+                Assert.SameCharacters(characters.GetRange(100, 50), repository.LoadPageFromJson(100, 50));
+
+                repository.SaveToXml(characters);
+                Assert.SameCharacters(characters, repository.LoadFromXml());
+                Assert.SameCharacters(characters.GetRange(490, 10), repository.LoadPageFromXml(490, 20));
+
+                repository.ConvertJsonToBinary();
+                Assert.SameCharacters(characters, repository.LoadFromBinary());
+                using (MappedCharacterRoster mapped = repository.OpenBinaryRoster())
+                    Assert.SameCharacters(characters, mapped.ToList());
+            }
+        }
+    }
+}
+
+// 4. JournalTests.cs - Recorded changes, replay and recovery from a torn write
+using System.Collections.Generic;
+using System.IO;
+using System.Threading.Tasks;
+
+namespace GameCharacterManager.Tests
+{
+    public static class JournalTests
+    {
+        private static Character Edited(Character character, int level)
+        {
+            var edited = (Character)character.Clone();
+            edited.Id = character.Id;
+            edited.Level = level;
+            return edited;
+        }
+
+        [Test]
+        public static void SaveChangesReplaysOnLoad()
+        {
+            using (var directory = new TempDirectory())
+            {
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJson(Samples.Characters());
+
+                List<Character> characters = repository.LoadFromJson();
+                var roster = new CharacterRoster(characters);
+                var added = new Character("Dara", 5, 50, 50, new[] { "Volley" }, "Bow", CharacterClass.Mage, "Light");
+                roster.Add(added);
+                repository.RecordAdd(added);
+                Character edited = Edited(roster[0], 77);
+                roster.Replace(edited);
+                repository.RecordReplace(edited);
+                long removed = roster[1].Id;
+                roster.Remove(removed);
+                repository.RecordRemove(removed);
+                repository.SaveChanges(roster.ToList());
+
+                Assert.SameCharacters(roster.ToList(), directory.Repository().LoadFromJson());
+            }
+        }
+
+        [Test]
+        public static void TruncatedTailIsIgnoredAndOverwritten()
+        {
+            using (var directory = new TempDirectory())
+            {
+                string snapshotPath = directory.Combine("snapshot.json");
+                File.WriteAllText(snapshotPath, "[]");
+                SnapshotFingerprint snapshot = SnapshotFingerprint.Of(snapshotPath);
+                List<Character> characters = Samples.Characters();
+
+                var journal = new CharacterJournal(directory.Combine("snapshot.journal"));
+                journal.Append(snapshot, new[] { new JournalEntry(JournalOperation.Replace, characters[0].Id, Edited(characters[0], 2)) });
+                long firstLength = journal.Length;
+                journal.Append(snapshot, new[] { new JournalEntry(JournalOperation.Remove, characters[1].Id, null) });
+
+                // A write torn by a crash: the second frame is cut short
+                using (var fs = new FileStream(journal.Path, FileMode.Open))
+                    fs.SetLength(journal.Length - 3);
+
+                var reopened = new CharacterJournal(journal.Path);
+                List<Character> replayed = Samples.Characters();
+                Assert.True(reopened.Replay(snapshot, replayed), "journal matched its snapshot");
+                Assert.Equal(4, replayed.Count, "characters after replaying the intact entry");
+                Assert.Equal(2, replayed[0].Level, "level from the intact entry");
+
+                // The next append replaces the torn frame instead of hiding behind it
+                reopened.Append(snapshot, new[] { new JournalEntry(JournalOperation.Remove, characters[3].Id, null) });
+                Assert.True(reopened.Length > firstLength, "journal grew past the intact entry");
+                replayed = Samples.Characters();
+                new CharacterJournal(journal.Path).Replay(snapshot, replayed);
+                Assert.Equal(3, replayed.Count, "characters after the append");
+                Assert.Equal(characters[2].Id, replayed[2].Id, "last character kept");
+                Assert.Equal(2, replayed[0].Level, "level kept");
+            }
+        }
+
+        [Test]
+        public static void JournalOfAnotherSnapshotIsIgnored()
+        {
+            using (var directory = new TempDirectory())
+            {
+                string snapshotPath = directory.Combine("snapshot.json");
+                File.WriteAllText(snapshotPath, "[]");
+                List<Character> characters = Samples.Characters();
+
+                var journal = new CharacterJournal(directory.Combine("snapshot.journal"));
+                journal.Append(SnapshotFingerprint.Of(snapshotPath), new[] { new JournalEntry(JournalOperation.Remove, characters[0].Id, null) });
+
+                File.WriteAllText(snapshotPath, "[ ]");
+                Assert.True(!journal.Replay(SnapshotFingerprint.Of(snapshotPath), characters), "replay against a rewritten snapshot");
+                Assert.Equal(4, characters.Count, "characters untouched");
+            }
+        }
+
+        // Pages and counts of a snapshot with a pending journal match the replayed roster, also
+        // where the snapshot's saved Ids are missing or repeated
+        [Test]
+        public static void PagesLayTheJournalOverTheSnapshot()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> saved = Samples.Generated(1000);
+                saved[10].Id = 0;
+                saved[20].Id = saved[21].Id;
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJson(saved);
+
+                var roster = new CharacterRoster(repository.LoadFromJson());
+                for (int i = 0; i < 100; i++)
+                {
+                    long removed = roster[i * 7].Id;
+                    roster.Remove(removed);
+                    repository.RecordRemove(removed);
+                }
+                for (int i = 0; i < 50; i++)
+                {
+                    Character edited = Edited(roster[i * 13], 60);
+                    roster.Replace(edited);
+                    repository.RecordReplace(edited);
+                    var added = new Character($"Added {i}", 3, 30, 30, new[] { "Volley" }, "Bow", CharacterClass.Mage, "Light");
+                    roster.Add(added);
+                    repository.RecordAdd(added);
+                }
+                long lastAdded = roster[roster.Count - 1].Id;
+                roster.Remove(lastAdded);
+                repository.RecordRemove(lastAdded);
+                repository.SaveChanges(roster.ToList());
+
+                List<Character> expected = roster.ToList();
+                Assert.Equal((long)expected.Count, repository.CountJson(), "count");
+                foreach ((int offset, int count) in new[] { (0, 10), (5, 300), (880, 100), (930, 40), (940, 20) })
+                {
+                    int available = System.Math.Min(count, expected.Count - offset);
+                    Assert.SameCharacters(expected.GetRange(offset, available), repository.LoadPageFromJson(offset, count));
+                }
+
+                // The compaction scheduled by the first page leaves the same roster
+                repository.WaitForCompaction();
+                Assert.SameCharacters(expected, repository.LoadFromJson());
+            }
+        }
+
+        // A full save racing a journal append that starts compaction: whichever runs first, the
+        // full save's roster is what loads back
+        [Test]
+        public static void FullSaveRacingCompactionWins()
+        {
+            using (var directory = new TempDirectory())
+            {
+                CharacterRepository repository = directory.Repository();
+                for (int round = 0; round < 5; round++)
+                {
+                    repository.SaveToJson(Samples.Generated(20000, round));
+                    List<Character> characters = repository.LoadFromJson();
+                    for (int i = 0; i < characters.Count; i++)
+                    {
+                        characters[i] = Edited(characters[i], 90);
+                        repository.RecordReplace(characters[i]);
+                    }
+
+                    List<Character> replacement = Samples.Generated(3000, round + 100);
+                    Task changes = Task.Run(() => repository.SaveChanges(characters));
+                    Task save = repository.SaveToJsonAsync(replacement);
+                    Task.WaitAll(changes, save);
+                    repository.WaitForCompaction();
+
+                    Assert.SameCharacters(replacement, repository.LoadFromJson());
+                }
+            }
+        }
+    }
+}
+
+// 5. ShardTests.cs - Sharded saves, the manifest and merging on load
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+
+namespace GameCharacterManager.Tests
+{
+    public static class ShardTests
+    {
+        [Test]
+        public static void IdRangeShardsRoundTrip()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(2000);
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJsonShards(characters, RosterSharding.ByIdRange(4));
+
+                RosterManifest manifest = repository.ReadManifest();
+                Assert.Equal(RosterPartition.IdRange, manifest.Partition, "partition");
+                Assert.Equal(4, manifest.Shards.Count, "shards");
+                foreach (RosterShardInfo shard in manifest.Shards)
+                    Assert.True(File.Exists(directory.Combine(shard.File)), "shard file " + shard.File);
+
+                Assert.SameCharacters(characters, repository.LoadFromJsonShards());
+            }
+        }
+
+        [Test]
+        public static void ClassShardsRoundTrip()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(2000);
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJsonShards(characters, RosterSharding.ByClass());
+                Assert.SameCharacters(characters, repository.LoadFromJsonShards());
+            }
+        }
+
+        // A roster out of Id order, as after edits and imports, comes back in its own order
+        [Test]
+        public static void ShardsKeepRosterOrder()
+        {
+            List<Character> characters = Samples.Generated(3000);
+            var random = new Random(3);
+            for (int i = characters.Count - 1; i > 0; i--)
+            {
+                int j = random.Next(i + 1);
+                (characters[i], characters[j]) = (characters[j], characters[i]);
+            }
+
+            foreach (RosterSharding sharding in new[] { RosterSharding.ByIdRange(4), RosterSharding.ByClass() })
+            {
+                using (var directory = new TempDirectory())
+                {
+                    CharacterRepository repository = directory.Repository();
+                    repository.SaveToJsonShards(characters, sharding);
+                    Assert.True(repository.ReadManifest().Order != null, "order file of a shuffled roster");
+                    Assert.SameCharacters(characters, repository.LoadFromJsonShards());
+                    Assert.SameCharacters(characters, repository.LoadFromJson());
+                }
+            }
+        }
+
+        // After a sharded save there is no characters.json; every JSON read goes through the manifest
+        [Test]
+        public static void JsonReadsFollowTheManifest()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(1000);
+                characters.Reverse();
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJson(Samples.Generated(10, 99));
+                repository.SaveToJsonShards(characters, RosterSharding.ByClass(3));
+                Assert.True(!File.Exists(repository.JsonFilePath), "characters.json removed");
+
+                Assert.SameCharacters(characters, repository.LoadFromJson());
+                Assert.SameCharacters(characters, repository.LoadHeadersFromJson());
+                Assert.SameCharacters(characters, repository.LoadFromJsonAsync().Result);
+                Assert.SameCharacters(characters, repository.LoadHeadersFromJsonAsync().Result);
+                Assert.SameCharacters(characters, repository.StreamFromJson().ToList());
+                Assert.Equal(1000L, repository.CountJson(), "count");
+                Assert.SameCharacters(characters.GetRange(333, 100), repository.LoadPageFromJson(333, 100));
+                Assert.SameCharacters(characters.GetRange(990, 10), repository.LoadPageFromJson(990, 50));
+
+                var pooled = new List<Character>();
+                repository.LoadFromJson(pooled, new CharacterPool());
+                Assert.SameCharacters(characters, pooled);
+            }
+        }
+
+        [Test]
+        public static void ResaveRemovesOldShards()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(300);
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToJsonShards(characters, RosterSharding.ByIdRange(3));
+                List<RosterShardInfo> old = repository.ReadManifest().Shards;
+
+                characters.RemoveRange(0, 100);
+                repository.SaveToJsonShards(characters, RosterSharding.ByIdRange(2));
+                foreach (RosterShardInfo shard in old)
+                    Assert.True(!File.Exists(directory.Combine(shard.File)), "old shard file " + shard.File);
+                Assert.SameCharacters(characters, repository.LoadFromJsonShards());
+            }
+        }
+    }
+}
+
+// 6. CompressionTests.cs - Compressed rosters and their detection
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager.Tests
+{
+    public static class CompressionTests
+    {
+        [Test]
+        public static void GZipJsonRoundTrip()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(1000);
+                CharacterRepository repository = directory.Repository(".gz");
+                repository.SaveToJson(characters);
+
+                Assert.Equal(RosterCompression.GZip, CompressedRosterStream.Detect(repository.JsonFilePath), "detected compression");
+                Assert.SameCharacters(characters, repository.LoadFromJson());
+                Assert.Equal(1000L, repository.CountJson(), "count");
+                Assert.SameCharacters(characters.GetRange(10, 5), repository.LoadPageFromJson(10, 5));
+            }
+        }
+
+        [Test]
+        public static void BrotliXmlRoundTrip()
+        {
+            using (var directory = new TempDirectory())
+            {
+                List<Character> characters = Samples.Generated(1000);
+                CharacterRepository repository = directory.Repository(".br");
+                repository.SaveToXml(characters);
+
+                Assert.Equal(RosterCompression.Brotli, CompressedRosterStream.Detect(repository.XmlFilePath), "detected compression");
+                Assert.SameCharacters(characters, repository.LoadFromXml());
+            }
+        }
+
+        // characters.json, .json.gz and .json.br side by side each keep their own journal and manifest
+        [Test]
+        public static void CompressedRostersKeepTheirOwnSidecars()
+        {
+            using (var directory = new TempDirectory())
+            {
+                CharacterRepository plain = directory.Repository();
+                CharacterRepository gzip = directory.Repository(".gz");
+                CharacterRepository brotli = directory.Repository(".br");
+                List<Character> plainCharacters = Samples.Generated(100, 1);
+                List<Character> gzipCharacters = Samples.Generated(200, 2);
+                plain.SaveToJson(plainCharacters);
+                gzip.SaveToJson(gzipCharacters);
+
+                List<Character> loaded = gzip.LoadFromJson();
+                gzip.RecordRemove(loaded[0].Id);
+                loaded.RemoveAt(0);
+                gzip.SaveChanges(loaded);
+
+                brotli.SaveToJsonShards(Samples.Generated(300, 3), RosterSharding.ByIdRange(2));
+
+                Assert.SameCharacters(plainCharacters, plain.LoadFromJson());
+                Assert.SameCharacters(loaded, gzip.LoadFromJson());
+                Assert.Equal(300L, brotli.CountJson(), "sharded Brotli count");
+                Assert.True(plain.ReadManifest() == null && gzip.ReadManifest() == null, "manifest only for the Brotli roster");
+
+                plain.SaveToJson(plainCharacters);
+                Assert.Equal(300L, brotli.CountJson(), "sharded Brotli count after a plain save");
+                Assert.SameCharacters(loaded, gzip.LoadFromJson());
+            }
+        }
+
+        [Test]
+        public static void CompressedStreamRoundTrip()
+        {
+            List<Character> characters = Samples.Characters();
+            foreach (RosterCompression compression in Enum.GetValues<RosterCompression>())
+            {
+                // MemoryStream keeps its bytes after ForWrite's stream is disposed
+                var stream = new MemoryStream();
+                using (Stream compressed = CompressedRosterStream.ForWrite(stream, compression))
+                    CharacterJsonCodec.Write(compressed, characters);
+
+                using (var directory = new TempDirectory())
+                {
+                    string path = directory.Combine("roster.json" + CompressedRosterStream.ExtensionOf(compression));
+                    File.WriteAllBytes(path, stream.ToArray());
+                    using (var file = new FileStream(path, FileMode.Open, FileAccess.Read))
+                    using (Stream decompressed = CompressedRosterStream.ForRead(file, path))
+                        Assert.SameCharacters(characters, new List<Character>(CharacterJsonCodec.Read(decompressed)));
+                }
+            }
+        }
+    }
+}
+
+// 7. MetricsTests.cs - What the RosterMetrics instruments count
+using System;
+using System.Collections.Generic;
+using System.Diagnostics.Metrics;
+
+namespace GameCharacterManager.Tests
+{
+    public static class MetricsTests
+    {
+        // Sums of one instrument's measurements by tag value while the listener is attached
+        private sealed class Recorder : IDisposable
+        {
+            private readonly MeterListener _listener = new MeterListener();
+            private readonly string _tag;
+
+            public Recorder(string instrument, string tag = null)
+            {
+                _tag = tag;
+                _listener.InstrumentPublished = (published, listener) =>
+                {
+                    if (published.Meter.Name == RosterMetrics.MeterName && published.Name == instrument)
+                        listener.EnableMeasurementEvents(published);
+                };
+                _listener.SetMeasurementEventCallback<long>(OnMeasurement);
+                _listener.Start();
+            }
+
+            public Dictionary<string, long> Totals { get; } = new Dictionary<string, long>();
+
+            public long Total(string key = "") => Totals.TryGetValue(key, out long total) ? total : 0;
+
+            private void OnMeasurement(Instrument instrument, long value, ReadOnlySpan<KeyValuePair<string, object>> tags, object state)
+            {
+                string key = "";
+                foreach (KeyValuePair<string, object> tag in tags)
+                {
+                    if (tag.Key == _tag)
+                        key = (string)tag.Value;
+                }
+                lock (Totals)
+                    Totals[key] = Total(key) + value;
+            }
+
+            public void Dispose()
+            {
+                _listener.Dispose();
+            }
+        }
+
+        [Test]
+        public static void ClonesAreCountedOncePerCharacter()
+        {
+            var prototype = new Character("Aria", 12, 340, 120, new[] { "Fireball" }, "Staff", CharacterClass.Mage, "Light");
+            var pool = new CharacterPool();
+            using (var clones = new Recorder("gcm.clones"))
+            {
+                prototype.Clone();
+                prototype.CloneWithName("Bran", pool);
+                PrototypeRegistry.CloneMany(prototype, 10);
+                PrototypeRegistry.CloneMany(prototype, new Character[5], 0, 5, pool: pool);
+                Assert.Equal(17L, clones.Total(), "clones");
+
+                var registry = new PrototypeRegistry();
+                registry.Register("mage", prototype);
+                Assert.Equal(17L, clones.Total(), "clones after storing a template");
+                registry.Spawn("mage");
+                registry.SpawnMany("mage", 3);
+                Assert.Equal(21L, clones.Total(), "clones after spawning");
+            }
+        }
+
+        [Test]
+        public static void CompressedFilesAreTypedByTheirFormat()
+        {
+            using (var directory = new TempDirectory())
+            using (var written = new Recorder("gcm.repository.bytes_written", "type"))
+            {
+                directory.Repository(".gz").SaveToJson(Samples.Characters());
+                Assert.True(written.Total("json") > 0, "bytes counted as json");
+                Assert.Equal(0L, written.Total("gz"), "bytes counted as gz");
+            }
+        }
+
+        [Test]
+        public static void MappedRosterIsNotCountedAsRead()
+        {
+            using (var directory = new TempDirectory())
+            {
+                CharacterRepository repository = directory.Repository();
+                repository.SaveToBinary(Samples.Generated(1000));
+                using (var read = new Recorder("gcm.repository.bytes_read", "type"))
+                using (MappedCharacterRoster roster = repository.OpenBinaryRoster())
+                {
+                    Assert.Equal(1000, roster.Count, "mapped characters");
+                    Assert.Equal(0L, read.Total("bin"), "bytes counted for a mapping");
+                }
+            }
+        }
+    }
+}
+
+// 8. RosterTests.cs - Queries over CharacterRoster's indexes
+using System.Collections.Generic;
+using System.Linq;
+
+namespace GameCharacterManager.Tests
+{
+    public static class RosterTests
+    {
+        private static void SameIds(IEnumerable<Character> expected, IEnumerable<Character> actual, string what)
+        {
+            Assert.Equal(string.Join(",", expected.Select(c => c.Id).OrderBy(id => id)),
+                string.Join(",", actual.Select(c => c.Id).OrderBy(id => id)), what);
+        }
+
+        [Test]
+        public static void EmptyAbilityConstraintsMatchEveryone()
+        {
+            var roster = new CharacterRoster(Samples.Generated(117));
+            Assert.Equal(117, roster.WithAbilities(new string[0], new string[0]).Count, "empty all and any");
+            Assert.Equal(117, roster.WithAbilities(null).Count, "null all");
+            Assert.Equal(117, roster.WithAbilities(new string[0], new string[0], new string[0]).Count, "empty all, any and none");
+            Assert.Equal(0, roster.WithAbilities(new string[0], new[] { "No Such Ability" }).Count, "any of unknown abilities");
+        }
+
+        [Test]
+        public static void AbilityQueriesMatchAScan()
+        {
+            List<Character> characters = Samples.Generated(2000);
+            var roster = new CharacterRoster(characters);
+            string[] abilities = characters.SelectMany(c => c.Abilities).Distinct().OrderBy(a => a).Take(6).ToArray();
+            string[] all = { abilities[0] };
+            string[] any = { abilities[1], abilities[2] };
+            string[] none = { abilities[3] };
+
+            SameIds(characters.Where(c => c.Abilities.Contains(all[0])), roster.WithAbilities(all), "all");
+            SameIds(characters.Where(c => any.Any(c.Abilities.Contains)), roster.WithAbilities(null, any), "any");
+            SameIds(characters.Where(c => c.Abilities.Contains(all[0]) && any.Any(c.Abilities.Contains) && !c.Abilities.Contains(none[0])),
+                roster.WithAbilities(all, any, none), "all, any and none");
+        }
+    }
+}
+
+// 9. Program.cs - Entry point; the first argument filters tests by name
+namespace GameCharacterManager.Tests
+{
+    internal static class Program
+    {
+        private static int Main(string[] args)
+        {
+            return TestRunner.Run(args.Length > 0 ? args[0] : null) == 0 ? 0 : 1;
+        }
+    }
+}
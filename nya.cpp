@@ -3,69 +3,246 @@
 // 1. Character.cs - Base character class implementing ICloneable
 using System;
 using System.Collections.Generic;
+using System.ComponentModel;
 using System.Linq;
 using System.Text.Json.Serialization;
+using System.Threading;
+using System.Xml.Serialization;
 
 namespace GameCharacterManager
 {
     [Serializable]
     public class Character : ICloneable
     {
+        // Stable identity, assigned by CharacterRoster when 0; clones start without one
+        public long Id { get; set; }
+
+        private int _health;
+        private int _mana;
+        private AbilityList _abilities;
+        private string _weaponType;
+        private string _armorType;
+
+        // Where the fields above still wait in a roster file; null once they are loaded
+        [NonSerialized]
+        private CharacterDetailSource _detailSource;
+        private long _detailOffset;
+        private int _detailLength;
+
+        // Guards the load of the fields above; created by DeferDetails, so only header-only
+        // characters carry one
+        [NonSerialized]
+        private object _detailLock;
+
         // Basic characteristics
         public string Name { get; set; }
         public int Level { get; set; }
-        public int Health { get; set; }
-        public int Mana { get; set; }
-        public List<string> Abilities { get; set; }
+
+        public int Health
+        {
+            get { LoadDetails(); return _health; }
+            set { LoadDetails(); _health = value; }
+        }
+
+        public int Mana
+        {
+            get { LoadDetails(); return _mana; }
+            set { LoadDetails(); _mana = value; }
+        }
+
+        // Always an AbilityList underneath; any other list assigned is copied into one, so later
+        // changes to it are not seen. JSON fills the existing list instead of building a copy.
+        [XmlIgnore]
+        [JsonObjectCreationHandling(JsonObjectCreationHandling.Populate)]
+        public IList<string> Abilities
+        {
+            get { LoadDetails(); return _abilities; }
+            set { LoadDetails(); _abilities = value == null ? null : value as AbilityList ?? new AbilityList(value); }
+        }
+
+        // The same list as its concrete type, for code working on pool ids or shared storage, and
+        // for XmlSerializer, which cannot handle an interface-typed member
+        [JsonIgnore]
+        [XmlArray("Abilities")]
+        [EditorBrowsable(EditorBrowsableState.Never)]
+        public AbilityList AbilityList
+        {
+            get { LoadDetails(); return _abilities; }
+            set { LoadDetails(); _abilities = value; }
+        }
 
         // Specific properties
-        public string WeaponType { get; set; }
+        public string WeaponType
+        {
+            get { LoadDetails(); return _weaponType; }
+            set { LoadDetails(); _weaponType = value; }
+        }
+
         public CharacterClass Class { get; set; }
-        public string ArmorType { get; set; }
+
+        public string ArmorType
+        {
+            get { LoadDetails(); return _armorType; }
+            set { LoadDetails(); _armorType = value; }
+        }
+
+        // False for a header-only character whose other fields are read on first use
+        [JsonIgnore]
+        public bool DetailsLoaded => Volatile.Read(ref _detailSource) == null;
 
         // Default constructor
         public Character()
         {
-            Name = "New Character";
-            Level = 1;
-            Health = 100;
-            Mana = 100;
-            Abilities = new List<string>();
-            WeaponType = "None";
-            Class = CharacterClass.Warrior;
-            ArmorType = "Light";
+            Reset();
         }
 
         // Constructor with parameters
-        public Character(string name, int level, int health, int mana, List<string> abilities, 
+        public Character(string name, int level, int health, int mana, IEnumerable<string> abilities, 
                         string weaponType, CharacterClass characterClass, string armorType)
         {
             Name = name;
             Level = level;
             Health = health;
             Mana = mana;
-            Abilities = abilities ?? new List<string>();
+            Abilities = abilities != null ? new AbilityList(abilities) : new AbilityList();
             WeaponType = weaponType;
             Class = characterClass;
             ArmorType = armorType;
         }
 
+        // Header-only character, filled in later through DeferDetails
+        internal Character(long id, string name, int level, CharacterClass characterClass)
+        {
+            Id = id;
+            Name = name;
+            Level = level;
+            Class = characterClass;
+        }
+
+        // Copy constructor used by Clone
+        private Character(Character prototype, string name)
+        {
+            CopyFrom(prototype, name);
+        }
+
         // Clone method from ICloneable interface
         public object Clone()
         {
-            // Deep copy of the abilities list
-            List<string> abilitiesCopy = new List<string>(Abilities);
-            
-            return new Character(
-                Name + " (Copy)",
-                Level,
-                Health,
-                Mana,
-                abilitiesCopy,
-                WeaponType,
-                Class,
-                ArmorType
-            );
+            // O(1): the clone copies the ability list only if one side changes it later
+            RosterMetrics.Cloned(1);
+            return new Character(this, Name + " (Copy)");
+        }
+
+        // Clone into a character rented from pool
+        public Character Clone(CharacterPool pool)
+        {
+            return CloneWithName(Name + " (Copy)", pool);
+        }
+
+        // Clone under a given name; used for bulk spawning where every copy keeps one name
+        public Character CloneWithName(string name)
+        {
+            RosterMetrics.Cloned(1);
+            return new Character(this, name);
+        }
+
+        public Character CloneWithName(string name, CharacterPool pool)
+        {
+            RosterMetrics.Cloned(1);
+            if (pool == null)
+                return new Character(this, name);
+
+            Character clone = pool.Rent();
+            clone.CopyFrom(this, name);
+            return clone;
+        }
+
+        // Back to the state of a new Character. The ability list object and its storage
+        // are kept, so a pooled character refills them without allocating.
+        internal void Reset()
+        {
+            if (_detailSource != null)
+            {
+                lock (_detailLock)
+                {
+                    _detailSource?.Release();
+                    _detailSource = null;
+                }
+            }
+            Id = 0;
+            Name = "New Character";
+            Level = 1;
+            Health = 100;
+            Mana = 100;
+            if (Abilities != null)
+                Abilities.Clear();
+            else
+                Abilities = new AbilityList();
+            WeaponType = "None";
+            Class = CharacterClass.Warrior;
+            ArmorType = "Light";
+        }
+
+        // CloneWithName for copies that are not clones to the user, such as an edit form's
+        // working copy or a stored template; bulk clones count themselves per batch
+        internal Character CopyWithName(string name)
+        {
+            return new Character(this, name);
+        }
+
+        // Take every value but Id from prototype; abilities are shared copy-on-write
+        internal void CopyFrom(Character prototype, string name)
+        {
+            Id = 0;
+            Name = name;
+            Level = prototype.Level;
+            Health = prototype.Health;
+            Mana = prototype.Mana;
+            if (prototype.AbilityList == null)
+                AbilityList = null;
+            else if (AbilityList == null)
+                AbilityList = prototype.AbilityList.Share();
+            else
+                AbilityList.ShareFrom(prototype.AbilityList);
+            WeaponType = prototype.WeaponType;
+            Class = prototype.Class;
+            ArmorType = prototype.ArmorType;
+        }
+
+        // Read the deferred fields now, e.g. when the character is selected
+        public void LoadDetails()
+        {
+            if (Volatile.Read(ref _detailSource) != null)
+                LoadDeferredDetails();
+        }
+
+        // Leave everything but Id, Name, Level and Class in the file until first use
+        internal void DeferDetails(CharacterDetailSource source, long offset, int length)
+        {
+            _detailLock ??= new object();
+            _detailSource = source;
+            _detailOffset = offset;
+            _detailLength = length;
+        }
+
+        // Threads touching the character first read and release the source once, and the source
+        // is cleared only after the fields are filled in
+        private void LoadDeferredDetails()
+        {
+            lock (_detailLock)
+            {
+                CharacterDetailSource source = _detailSource;
+                if (source == null)
+                    return;
+
+                Character details = source.Read(_detailOffset, _detailLength);
+                _health = details._health;
+                _mana = details._mana;
+                _abilities = details._abilities;
+                _weaponType = details._weaponType;
+                _armorType = details._armorType;
+                Volatile.Write(ref _detailSource, null);
+            }
         }
 
         // Override ToString for display in UI
@@ -88,502 +265,2269 @@ namespace GameCharacterManager
 
 // 2. CharacterRepository.cs - For saving and loading characters
 using System;
+using System.Buffers;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.IO;
 using System.Text.Json;
-using System.Xml.Serialization;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.Win32.SafeHandles;
 
 namespace GameCharacterManager
 {
     public class CharacterRepository
     {
-        private const string JsonFilePath = "characters.json";
-        private const string XmlFilePath = "characters.xml";
+        private const int FileBufferSize = 64 * 1024;
 
-        // Save characters to JSON file
-        public void SaveToJson(List<Character> characters)
+        // Characters between cancellation checks and progress reports of the binary async paths
+        private const int ObserveInterval = 4096;
+
+        // Journal size at which SaveChanges folds it into a fresh JSON snapshot
+        public const long JournalCompactionThreshold = 1024 * 1024;
+
+        public string JsonFilePath { get; }
+        public string XmlFilePath { get; }
+        public string BinaryFilePath { get; }
+
+        // The journal and shard manifest sit next to the JSON roster they belong to
+        private readonly string _manifestFilePath;
+        private readonly CharacterJournal _journal;
+        private readonly List<JournalEntry> _pendingChanges = new List<JournalEntry>();
+        private readonly SemaphoreSlim _gate = new SemaphoreSlim(1, 1);
+        private Task _compaction = Task.CompletedTask;
+
+        // Paging view of the snapshot and journal, for the snapshot and journal length it was built on
+        private JournalOverlay _overlay;
+        private SnapshotFingerprint _overlaySnapshot;
+        private long _overlayJournalLength;
+
+        // Guards the recorded changes, which the UI thread adds to while a save holds the gate
+        private readonly object _journalLock = new object();
+
+        // Set while the caller's list is the JSON snapshot plus journal, so changes can be appended
+        private bool _tracksJsonSnapshot;
+
+        public CharacterRepository()
+            : this("characters.json", "characters.xml", "characters.bin")
         {
-            var options = new JsonSerializerOptions { WriteIndented = true };
-            string jsonString = JsonSerializer.Serialize(characters, options);
-            File.WriteAllText(JsonFilePath, jsonString);
         }
 
-        // Load characters from JSON file
-        public List<Character> LoadFromJson()
+        // Default files with the JSON and XML rosters compressed, as characters.json.gz. The
+        // binary roster is memory-mapped and stays uncompressed.
+        public CharacterRepository(RosterCompression compression)
+            : this("characters.json" + CompressedRosterStream.ExtensionOf(compression),
+                "characters.xml" + CompressedRosterStream.ExtensionOf(compression), "characters.bin")
         {
-            if (!File.Exists(JsonFilePath))
-                return new List<Character>();
+        }
 
-            string jsonString = File.ReadAllText(JsonFilePath);
-            return JsonSerializer.Deserialize<List<Character>>(jsonString) ?? new List<Character>();
+        public CharacterRepository(string jsonFilePath, string xmlFilePath, string binaryFilePath)
+        {
+            JsonFilePath = jsonFilePath ?? throw new ArgumentNullException(nameof(jsonFilePath));
+            XmlFilePath = xmlFilePath ?? throw new ArgumentNullException(nameof(xmlFilePath));
+            BinaryFilePath = binaryFilePath ?? throw new ArgumentNullException(nameof(binaryFilePath));
+            _manifestFilePath = SidecarPath(jsonFilePath, ".shards.json");
+            _journal = new CharacterJournal(SidecarPath(jsonFilePath, ".journal"));
         }
 
-        // Save characters to XML file
-        public void SaveToXml(List<Character> characters)
+        // characters.journal beside characters.json; a compressed roster keeps its full name, as in
+        // characters.json.gz.journal, so the plain, .gz and .br rosters never share a sidecar
+        private static string SidecarPath(string jsonFilePath, string extension)
+        {
+            return IsCompressedName(jsonFilePath) ? jsonFilePath + extension : Path.ChangeExtension(jsonFilePath, extension);
+        }
+
+        // Save characters to JSON file, replacing the snapshot and discarding its journal.
+        // Written aside and moved into place, so header-only characters still read the old file.
+        public void SaveToJson(List<Character> characters)
         {
-            XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
-            using (FileStream fs = new FileStream(XmlFilePath, FileMode.Create))
+            using (RosterMetrics.Start("save", "json"))
+            using (Exclusive())
             {
-                serializer.Serialize(fs, characters);
+                SaveJsonSnapshot(characters);
             }
         }
 
-        // Load characters from XML file
-        public List<Character> LoadFromXml()
+        private void SaveJsonSnapshot(List<Character> characters)
         {
-            if (!File.Exists(XmlFilePath))
-                return new List<Character>();
+            WriteFile(JsonFilePath, (fs, index) => CharacterJsonCodec.Write(fs, characters, index));
+            ReplaceJsonSnapshot();
+        }
 
-            XmlSerializer serializer = new XmlSerializer(typeof(List<Character>));
-            using (FileStream fs = new FileStream(XmlFilePath, FileMode.Open))
+        // characters.json has just been written: it supersedes the shards and the journal
+        private void ReplaceJsonSnapshot()
+        {
+            DeleteShards();
+            _journal.Delete();
+            _overlay = null;
+            lock (_journalLock)
             {
-                return (List<Character>)serializer.Deserialize(fs) ?? new List<Character>();
+                _pendingChanges.Clear();
+                _tracksJsonSnapshot = true;
             }
         }
-    }
-}
 
-// 3. MainForm.cs - Main application window
-using System;
-using System.Collections.Generic;
-using System.Windows.Forms;
+        // Load characters from JSON file, replaying the journal on top of the snapshot
+        public List<Character> LoadFromJson()
+        {
+            using (RosterMetrics.Start("load", "json"))
+            using (Exclusive())
+            {
+                return LoadJsonSnapshot();
+            }
+        }
 
-namespace GameCharacterManager
-{
-    public partial class MainForm : Form
-    {
-        private List<Character> _characters;
-        private CharacterRepository _repository;
+        private List<Character> LoadJsonSnapshot()
+        {
+            RosterManifest shards = CurrentShards();
+            List<Character> characters = shards != null
+                ? ReadShards(shards, null, CancellationToken.None)
+                : new List<Character>(StreamJsonSnapshot());
+            ReplayLoadedJournal(characters);
+            return characters;
+        }
 
-        public MainForm()
+        // The loaded list is now the snapshot plus journal, so its changes can be appended
+        private void ReplayLoadedJournal(List<Character> characters)
         {
-            InitializeComponent();
-            _repository = new CharacterRepository();
-            _characters = new List<Character>();
-            
-            // Load characters on startup
-            try
+            ReplayJournal(SnapshotFingerprint.Of(JsonFilePath), characters);
+            lock (_journalLock)
             {
-                _characters = _repository.LoadFromJson();
-                UpdateCharactersList();
+                _pendingChanges.Clear();
+                _tracksJsonSnapshot = true;
             }
-            catch (Exception ex)
+        }
+
+        // Reload into an existing list: its characters go back to pool and the new ones are
+        // rented from it, so repeated reloads reuse the same objects instead of a fresh graph
+        public void LoadFromJson(List<Character> characters, CharacterPool pool)
+        {
+            using (RosterMetrics.Start("load", "json"))
+            using (Exclusive())
             {
-                MessageBox.Show($"Error loading characters: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                pool.ReturnAll(characters);
+                characters.AddRange(StreamJsonSnapshot(pool));
+                ReplayLoadedJournal(characters);
             }
         }
 
-        private void UpdateCharactersList()
+        // Asynchronous SaveToJson. The snapshot is written to a temporary file and only replaces
+        // characters.json once complete, so cancelling leaves the previous save intact.
+        public async Task SaveToJsonAsync(List<Character> characters, IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
         {
-            listBoxCharacters.Items.Clear();
-            foreach (var character in _characters)
+            using (RosterMetrics.Start("save", "json", false))
+            using (await ExclusiveAsync(cancellationToken).ConfigureAwait(false))
             {
-                listBoxCharacters.Items.Add(character);
+                await SaveJsonSnapshotAsync(characters, progress, cancellationToken).ConfigureAwait(false);
             }
         }
 
-        private void btnCreate_Click(object sender, EventArgs e)
+        private async Task SaveJsonSnapshotAsync(List<Character> characters, IProgress<(long done, long total)> progress,
+            CancellationToken cancellationToken)
         {
-            using (CharacterForm form = new CharacterForm())
+            await WriteFileAsync(JsonFilePath, characters, CharacterJsonCodec.WriteAsync, progress, cancellationToken).ConfigureAwait(false);
+            ReplaceJsonSnapshot();
+        }
+
+        // Asynchronous LoadFromJson; progress reports bytes read out of the file length
+        public async Task<List<Character>> LoadFromJsonAsync(IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            using (RosterMetrics.Start("load", "json", false))
+            using (await ExclusiveAsync(cancellationToken).ConfigureAwait(false))
             {
-                if (form.ShowDialog() == DialogResult.OK)
+                var characters = new List<Character>();
+                RosterManifest shards = CurrentShards();
+                if (shards != null)
+                {
+                    characters = await Task.Run(() => ReadShards(shards, progress, cancellationToken), cancellationToken).ConfigureAwait(false);
+                }
+                else if (File.Exists(JsonFilePath))
                 {
-                    _characters.Add(form.Character);
-                    UpdateCharactersList();
+                    using (FileStream fs = OpenReadAsync(JsonFilePath))
+                    using (Stream contents = CompressedRosterStream.ForRead(fs, JsonFilePath))
+                    {
+                        long total = fs.Length;
+                        long reported = -1;
+                        await foreach (Character character in CharacterJsonCodec.ReadAsync(contents, cancellationToken).ConfigureAwait(false))
+                        {
+                            characters.Add(character);
+                            ReportPosition(fs, total, ref reported, progress);
+                        }
+                        progress?.Report((total, total));
+                    }
                 }
+
+                ReplayLoadedJournal(characters);
+                return characters;
             }
         }
 
-        private void btnClone_Click(object sender, EventArgs e)
+        // LoadFromJson reading only Id, Name, Level and Class. The rest of each character stays in
+        // the file until it is first used, so the cost no longer grows with ability counts.
+        public List<Character> LoadHeadersFromJson()
         {
-            if (listBoxCharacters.SelectedItem is Character selectedCharacter)
+            using (RosterMetrics.Start("load-headers", "json"))
+            using (Exclusive())
             {
-                Character clonedCharacter = (Character)selectedCharacter.Clone();
-                _characters.Add(clonedCharacter);
-                UpdateCharactersList();
-                listBoxCharacters.SelectedItem = clonedCharacter;
-            }
-            else
-            {
-                MessageBox.Show("Please select a character to clone.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                var characters = new List<Character>();
+                RosterManifest shards = CurrentShards();
+                if (shards != null)
+                {
+                    // Shards are loaded in full, as they are read in parallel anyway
+                    characters = ReadShards(shards, null, CancellationToken.None);
+                }
+                else if (IsCompressed(JsonFilePath))
+                {
+                    // Deferred details are read back by offset, which a compressed file lacks
+                    characters.AddRange(StreamJsonSnapshot());
+                }
+                else if (File.Exists(JsonFilePath))
+                {
+                    CharacterDetailSource details = CharacterDetailSource.Open(JsonFilePath);
+                    try
+                    {
+                        using (FileStream fs = OpenRead(JsonFilePath))
+                        {
+                            characters.AddRange(CharacterJsonCodec.ReadHeaders(fs, details));
+                        }
+                    }
+                    catch
+                    {
+                        details.Dispose();
+                        throw;
+                    }
+                    ReleaseIfUnused(details);
+                }
+
+                ReplayLoadedJournal(characters);
+                return characters;
             }
         }
 
-        private void btnEdit_Click(object sender, EventArgs e)
+        // Asynchronous LoadHeadersFromJson, the header pass of LoadFromJsonAsync
+        public async Task<List<Character>> LoadHeadersFromJsonAsync(IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
         {
-            if (listBoxCharacters.SelectedItem is Character selectedCharacter)
+            using (RosterMetrics.Start("load-headers", "json", false))
+            using (await ExclusiveAsync(cancellationToken).ConfigureAwait(false))
             {
-                int index = _characters.IndexOf(selectedCharacter);
-                using (CharacterForm form = new CharacterForm(selectedCharacter))
+                var characters = new List<Character>();
+                RosterManifest shards = CurrentShards();
+                if (shards != null)
                 {
-                    if (form.ShowDialog() == DialogResult.OK)
+                    // As LoadHeadersFromJson, shards are loaded in full
+                    characters = await Task.Run(() => ReadShards(shards, progress, cancellationToken), cancellationToken).ConfigureAwait(false);
+                }
+                else if (IsCompressed(JsonFilePath))
+                {
+                    // As LoadHeadersFromJson, a compressed file is loaded in full
+                    using (FileStream fs = OpenReadAsync(JsonFilePath))
+                    using (Stream contents = CompressedRosterStream.ForRead(fs, JsonFilePath))
+                    {
+                        long total = fs.Length;
+                        long reported = -1;
+                        await foreach (Character character in CharacterJsonCodec.ReadAsync(contents, cancellationToken).ConfigureAwait(false))
+                        {
+                            characters.Add(character);
+                            ReportPosition(fs, total, ref reported, progress);
+                        }
+                        progress?.Report((total, total));
+                    }
+                }
+                else if (File.Exists(JsonFilePath))
+                {
+                    CharacterDetailSource details = CharacterDetailSource.Open(JsonFilePath);
+                    try
+                    {
+                        using (FileStream fs = OpenReadAsync(JsonFilePath))
+                        {
+                            long total = fs.Length;
+                            long reported = -1;
+                            await foreach (Character character in CharacterJsonCodec.ReadHeadersAsync(fs, details, cancellationToken).ConfigureAwait(false))
+                            {
+                                characters.Add(character);
+                                ReportPosition(fs, total, ref reported, progress);
+                            }
+                            progress?.Report((total, total));
+                        }
+                    }
+                    catch
                     {
-                        _characters[index] = form.Character;
-                        UpdateCharactersList();
+                        details.Dispose();
+                        throw;
                     }
+                    ReleaseIfUnused(details);
                 }
+
+                ReplayLoadedJournal(characters);
+                return characters;
             }
-            else
+        }
+
+        // Enumerate characters from JSON file one at a time; a pending journal is replayed first
+        public IEnumerable<Character> StreamFromJson()
+        {
+            using (Exclusive())
             {
-                MessageBox.Show("Please select a character to edit.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                return StreamJsonWithJournal();
+            }
+        }
+
+        private IEnumerable<Character> StreamJsonWithJournal()
+        {
+            SnapshotFingerprint snapshot = SnapshotFingerprint.Of(JsonFilePath);
+            if (!_journal.HasEntries(snapshot))
+                return StreamJsonSnapshot();
+
+            var characters = new List<Character>(StreamJsonSnapshot());
+            ReplayJournal(snapshot, characters);
+            return characters;
+        }
+
+        // Save characters as shard files written in parallel, one per core at most, and a manifest
+        // naming them; the plain characters.json and its journal are removed. A single shard is
+        // saved as the plain characters.json instead, which every JSON load reads as before.
+        public void SaveToJsonShards(List<Character> characters, RosterSharding sharding, CancellationToken cancellationToken = default)
+        {
+            using (RosterMetrics.Start("save", "json-shards", false))
+            using (Exclusive())
+            {
+                SaveJsonShards(characters, sharding, cancellationToken);
             }
         }
 
-        private void btnSaveJson_Click(object sender, EventArgs e)
+        private void SaveJsonShards(List<Character> characters, RosterSharding sharding, CancellationToken cancellationToken)
         {
+            if (sharding.ShardCount == 1)
+            {
+                SaveJsonSnapshot(characters);
+                return;
+            }
+
+            // New shard files are complete before the manifest switches to them
+            RosterManifest previous = ReadManifest();
+            var manifest = new RosterManifest
+            {
+                Version = RosterManifest.CurrentVersion,
+                Generation = (previous?.Generation ?? 0) + 1,
+                Partition = sharding.Partition,
+                ShardCount = sharding.ShardCount
+            };
+
+            List<List<Character>> shards = RosterShards.Split(characters, sharding, out List<ShardRun> order);
+            var infos = new RosterShardInfo[shards.Count];
+            var written = new ConcurrentQueue<string>();
+            var options = new ParallelOptions { CancellationToken = cancellationToken };
             try
             {
-                _repository.SaveToJson(_characters);
-                MessageBox.Show("Characters saved to JSON successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                Parallel.For(0, shards.Count, options, i =>
+                {
+                    string path = ShardPath(manifest.Generation, i);
+                    WriteFile(path, (fs, index) => CharacterJsonCodec.Write(fs, shards[i], index));
+                    written.Enqueue(path);
+                    infos[i] = RosterShards.Describe(path, shards[i], manifest);
+                });
+                manifest.Shards = new List<RosterShardInfo>(infos);
+
+                if (order != null)
+                {
+                    manifest.Order = OrderPath(manifest.Generation);
+                    WriteFile(manifest.Order, fs => RosterShards.WriteOrder(fs, order));
+                    written.Enqueue(manifest.Order);
+                }
+                WriteManifest(manifest);
             }
-            catch (Exception ex)
+            catch
             {
-                MessageBox.Show($"Error saving to JSON: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                foreach (string path in written)
+                    DeleteShardFile(path);
+                throw;
             }
+
+            DeleteShardFiles(previous);
+            File.Delete(JsonFilePath);
+            File.Delete(RosterOffsetIndex.PathFor(JsonFilePath));
+            _journal.Delete();
+            StopTrackingJsonSnapshot();
         }
 
-        private void btnSaveXml_Click(object sender, EventArgs e)
+        // Load a roster saved by SaveToJsonShards, reading its shards in parallel and merging
+        // them back in roster order. Without a manifest this is LoadFromJson.
+        public List<Character> LoadFromJsonShards(CancellationToken cancellationToken = default)
         {
-            try
+            using (RosterMetrics.Start("load", "json-shards", false))
+            using (Exclusive())
             {
-                _repository.SaveToXml(_characters);
-                MessageBox.Show("Characters saved to XML successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                RosterManifest manifest = ReadManifest();
+                if (manifest == null)
+                    return LoadJsonSnapshot();
+
+                List<Character> characters = ReadShards(manifest, null, cancellationToken);
+                StopTrackingJsonSnapshot();
+                return characters;
             }
-            catch (Exception ex)
+        }
+
+        // Whole JSON operations run one at a time: snapshot writes and reads, journal replay and
+        // appends, and compaction. A Monitor cannot be held across the async paths' awaits.
+        private IDisposable Exclusive()
+        {
+            _gate.Wait();
+            return new GateRelease(_gate);
+        }
+
+        private async Task<IDisposable> ExclusiveAsync(CancellationToken cancellationToken)
+        {
+            await _gate.WaitAsync(cancellationToken).ConfigureAwait(false);
+            return new GateRelease(_gate);
+        }
+
+        private sealed class GateRelease : IDisposable
+        {
+            private SemaphoreSlim _gate;
+
+            public GateRelease(SemaphoreSlim gate)
             {
-                MessageBox.Show($"Error saving to XML: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                _gate = gate;
+            }
+
+            public void Dispose()
+            {
+                Interlocked.Exchange(ref _gate, null)?.Release();
             }
         }
 
-        private void btnLoadJson_Click(object sender, EventArgs e)
+        // Manifest of the sharded roster when there is no plain characters.json, so that the JSON
+        // loads, counts and pages read the shards instead
+        private RosterManifest CurrentShards()
+        {
+            return File.Exists(JsonFilePath) ? null : ReadManifest();
+        }
+
+        // Every shard read in parallel and merged; progress reports the bytes of the shards read
+        private static List<Character> ReadShards(RosterManifest manifest, IProgress<(long done, long total)> progress,
+            CancellationToken cancellationToken)
+        {
+            long total = 0;
+            foreach (RosterShardInfo info in manifest.Shards)
+                total += new FileInfo(info.File).Length;
+            long done = 0;
+
+            var shards = new List<Character>[manifest.Shards.Count];
+            var options = new ParallelOptions { CancellationToken = cancellationToken };
+            Parallel.For(0, shards.Length, options, i =>
+            {
+                RosterShardInfo info = manifest.Shards[i];
+                var shard = new List<Character>((int)Math.Min(info.Count, Array.MaxLength));
+                using (FileStream fs = OpenRead(info.File))
+                using (Stream contents = CompressedRosterStream.ForRead(fs, info.File))
+                {
+                    shard.AddRange(CharacterJsonCodec.Read(contents));
+                    progress?.Report((Interlocked.Add(ref done, fs.Length), total));
+                }
+                if (shard.Count != info.Count)
+                    throw new InvalidDataException($"{info.File} holds {shard.Count} characters, the manifest expects {info.Count}.");
+                shards[i] = shard;
+            });
+            return RosterShards.Merge(shards, ReadOrder(manifest));
+        }
+
+        // The sharded roster one character at a time, with a reader open on each shard
+        private static IEnumerable<Character> StreamShards(RosterManifest manifest, CharacterPool pool)
         {
+            List<ShardRun> order = ReadOrder(manifest);
+            var streams = new List<IDisposable>();
+            var readers = new IEnumerator<Character>[manifest.Shards.Count];
             try
             {
-                _characters = _repository.LoadFromJson();
-                UpdateCharactersList();
-                MessageBox.Show("Characters loaded from JSON successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                foreach (ShardRun run in order)
+                {
+                    RosterShardInfo info = manifest.Shards[run.Shard];
+                    IEnumerator<Character> reader = readers[run.Shard];
+                    if (reader == null)
+                    {
+                        FileStream fs = OpenRead(info.File);
+                        streams.Add(fs);
+                        Stream contents = CompressedRosterStream.ForRead(fs, info.File);
+                        streams.Add(contents);
+                        reader = readers[run.Shard] = CharacterJsonCodec.Read(contents, pool).GetEnumerator();
+                        streams.Add(reader);
+                    }
+
+                    for (int i = 0; i < run.Length; i++)
+                    {
+                        if (!reader.MoveNext())
+                            throw new InvalidDataException($"{info.File} holds fewer characters than the manifest expects.");
+                        yield return reader.Current;
+                    }
+                }
             }
-            catch (Exception ex)
+            finally
             {
-                MessageBox.Show($"Error loading from JSON: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                for (int i = streams.Count - 1; i >= 0; i--)
+                    streams[i].Dispose();
             }
         }
 
-        private void btnLoadXml_Click(object sender, EventArgs e)
+        // Characters [offset, offset + count) of the sharded roster, each piece read from its
+        // shard through the shard's offset index
+        private List<Character> ReadShardPage(RosterManifest manifest, long offset, int count)
         {
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            var page = new List<Character>(count);
+            var indexes = new RosterOffsetIndex[manifest.Shards.Count];
+            var starts = new long[manifest.Shards.Count];
             try
             {
-                _characters = _repository.LoadFromXml();
-                UpdateCharactersList();
-                MessageBox.Show("Characters loaded from XML successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+                long position = 0;
+                foreach (ShardRun run in ReadOrder(manifest))
+                {
+                    long end = offset + count;
+                    if (position >= end)
+                        break;
+
+                    long from = Math.Max(offset, position);
+                    long to = Math.Min(end, position + run.Length);
+                    if (from < to)
+                    {
+                        string file = manifest.Shards[run.Shard].File;
+                        long start = starts[run.Shard] + from - position;
+                        int length = (int)(to - from);
+                        indexes[run.Shard] ??= OpenIndex(file, ScanJson);
+                        if (indexes[run.Shard] != null)
+                            page.AddRange(ReadPage(file, indexes[run.Shard].ReadBounds(start, length), CharacterJsonCodec.ReadPage));
+                        else
+                            page.AddRange(PageOf(StreamShard(file), start, length));
+                    }
+                    starts[run.Shard] += run.Length;
+                    position += run.Length;
+                }
             }
-            catch (Exception ex)
+            finally
             {
-                MessageBox.Show($"Error loading from XML: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+                foreach (RosterOffsetIndex index in indexes)
+                    index?.Dispose();
             }
+            return page;
         }
-    }
-}
 
-// 4. CharacterForm.cs - Form for creating/editing characters
-using System;
-using System.Collections.Generic;
-using System.Windows.Forms;
-
-namespace GameCharacterManager
-{
-    public partial class CharacterForm : Form
-    {
-        public Character Character { get; private set; }
-
-        // Constructor for creating a new character
-        public CharacterForm()
+        private static IEnumerable<Character> StreamShard(string file)
         {
-            InitializeComponent();
-            Character = new Character();
-            SetupForm();
+            using (FileStream fs = OpenRead(file))
+            using (Stream contents = CompressedRosterStream.ForRead(fs, file))
+            {
+                foreach (Character character in CharacterJsonCodec.Read(contents))
+                    yield return character;
+            }
         }
 
-        // Constructor for editing an existing character
-        public CharacterForm(Character character)
+        private static List<ShardRun> ReadOrder(RosterManifest manifest)
         {
-            InitializeComponent();
-            Character = (Character)character.Clone();
-            SetupForm();
-            
-            // Populate form with character data
-            txtName.Text = Character.Name;
-            numLevel.Value = Character.Level;
-            numHealth.Value = Character.Health;
-            numMana.Value = Character.Mana;
-            cmbClass.SelectedItem = Character.Class;
-            txtWeapon.Text = Character.WeaponType;
-            txtArmor.Text = Character.ArmorType;
-            
-            // Populate abilities list
-            listBoxAbilities.Items.Clear();
-            foreach (var ability in Character.Abilities)
+            if (manifest.Order == null)
+                return RosterShards.Consecutive(manifest);
+
+            using (FileStream fs = OpenRead(manifest.Order))
             {
-                listBoxAbilities.Items.Add(ability);
+                return RosterShards.ReadOrder(fs, manifest, manifest.Order);
             }
         }
 
-        private void SetupForm()
+        // Manifest of the sharded roster, or null when the roster is a plain characters.json
+        public RosterManifest ReadManifest()
         {
-            // Set up the class combo box
-            cmbClass.DataSource = Enum.GetValues(typeof(CharacterClass));
+            if (!File.Exists(_manifestFilePath))
+                return null;
+
+            RosterManifest manifest = JsonSerializer.Deserialize(File.ReadAllBytes(_manifestFilePath), CharacterJsonContext.Default.RosterManifest);
+            if (manifest == null || manifest.Version != RosterManifest.CurrentVersion || manifest.Shards == null)
+                throw new InvalidDataException($"{_manifestFilePath} is not a version {RosterManifest.CurrentVersion} roster manifest.");
+            return manifest;
         }
 
-        private void btnSave_Click(object sender, EventArgs e)
+        // Shards are compressed like the JSON roster they replace
+        private string ShardPath(long generation, int shard)
         {
-            // Update character properties from form inputs
-            Character.Name = txtName.Text;
-            Character.Level = (int)numLevel.Value;
-            Character.Health = (int)numHealth.Value;
-            Character.Mana = (int)numMana.Value;
-            Character.Class = (CharacterClass)cmbClass.SelectedItem;
-            Character.WeaponType = txtWeapon.Text;
-            Character.ArmorType = txtArmor.Text;
-            
-            // Update abilities
-            Character.Abilities.Clear();
-            foreach (var item in listBoxAbilities.Items)
-            {
-                Character.Abilities.Add(item.ToString());
-            }
-            
-            DialogResult = DialogResult.OK;
+            string json = CompressedRosterStream.WithoutCompressionExtension(JsonFilePath);
+            return Path.ChangeExtension(json, $".{generation}-{shard}.json")
+                + CompressedRosterStream.ExtensionOf(CompressedRosterStream.FromExtension(JsonFilePath));
         }
 
-        private void btnCancel_Click(object sender, EventArgs e)
+        private string OrderPath(long generation)
         {
-            DialogResult = DialogResult.Cancel;
+            return SidecarPath(JsonFilePath, $".{generation}.order");
         }
 
-        private void btnAddAbility_Click(object sender, EventArgs e)
+        private void WriteManifest(RosterManifest manifest)
         {
-            if (!string.IsNullOrWhiteSpace(txtAbility.Text))
+            string tempPath = _manifestFilePath + ".tmp";
+            using (FileStream fs = OpenWrite(tempPath))
             {
-                listBoxAbilities.Items.Add(txtAbility.Text);
-                txtAbility.Clear();
-                txtAbility.Focus();
+                JsonSerializer.Serialize(fs, manifest, CharacterJsonContext.Default.RosterManifest);
             }
+            File.Move(tempPath, _manifestFilePath, true);
         }
 
-        private void btnRemoveAbility_Click(object sender, EventArgs e)
+        // A plain characters.json replaces the sharded roster; the manifest goes first, so a crash
+        // leaves unreferenced shard files rather than a manifest naming missing ones
+        private void DeleteShards()
         {
-            if (listBoxAbilities.SelectedIndex != -1)
-            {
-                listBoxAbilities.Items.RemoveAt(listBoxAbilities.SelectedIndex);
-            }
+            RosterManifest manifest = ReadManifest();
+            if (manifest == null)
+                return;
+            File.Delete(_manifestFilePath);
+            DeleteShardFiles(manifest);
         }
-    }
-}
 
-// 5. Designer files for MainForm.Designer.cs
-namespace GameCharacterManager
-{
-    partial class MainForm
-    {
-        private System.ComponentModel.IContainer components = null;
-
-        protected override void Dispose(bool disposing)
+        private static void DeleteShardFiles(RosterManifest manifest)
         {
-            if (disposing && (components != null))
-            {
-                components.Dispose();
-            }
-            base.Dispose(disposing);
+            if (manifest == null)
+                return;
+            foreach (RosterShardInfo info in manifest.Shards)
+                DeleteShardFile(info.File);
+            if (manifest.Order != null)
+                DeleteShardFile(manifest.Order);
         }
 
-        #region Windows Form Designer generated code
-
-        private void InitializeComponent()
+        private static void DeleteShardFile(string path)
         {
-            this.listBoxCharacters = new System.Windows.Forms.ListBox();
-            this.btnCreate = new System.Windows.Forms.Button();
-            this.btnClone = new System.Windows.Forms.Button();
-            this.btnEdit = new System.Windows.Forms.Button();
-            this.btnSaveJson = new System.Windows.Forms.Button();
-            this.btnSaveXml = new System.Windows.Forms.Button();
-            this.btnLoadJson = new System.Windows.Forms.Button();
-            this.btnLoadXml = new System.Windows.Forms.Button();
-            this.label1 = new System.Windows.Forms.Label();
-            this.groupBox1 = new System.Windows.Forms.GroupBox();
-            this.groupBox2 = new System.Windows.Forms.GroupBox();
-            this.SuspendLayout();
-            // 
-            // listBoxCharacters
-            // 
-            this.listBoxCharacters.FormattingEnabled = true;
-            this.listBoxCharacters.ItemHeight = 16;
-            this.listBoxCharacters.Location = new System.Drawing.Point(16, 36);
-            this.listBoxCharacters.Name = "listBoxCharacters";
-            this.listBoxCharacters.Size = new System.Drawing.Size(380, 324);
-            this.listBoxCharacters.TabIndex = 0;
-            // 
-            // btnCreate
-            // 
-            this.btnCreate.Location = new System.Drawing.Point(413, 36);
-            this.btnCreate.Name = "btnCreate";
-            this.btnCreate.Size = new System.Drawing.Size(160, 35);
-            this.btnCreate.TabIndex = 1;
-            this.btnCreate.Text = "Create New";
-            this.btnCreate.UseVisualStyleBackColor = true;
-            this.btnCreate.Click += new System.EventHandler(this.btnCreate_Click);
-            // 
-            // btnClone
-            // 
-            this.btnClone.Location = new System.Drawing.Point(413, 85);
-            this.btnClone.Name = "btnClone";
-            this.btnClone.Size = new System.Drawing.Size(160, 35);
-            this.btnClone.TabIndex = 2;
-            this.btnClone.Text = "Clone Selected";
-            this.btnClone.UseVisualStyleBackColor = true;
-            this.btnClone.Click += new System.EventHandler(this.btnClone_Click);
-            // 
-            // btnEdit
-            // 
-            this.btnEdit.Location = new System.Drawing.Point(413, 134);
-            this.btnEdit.Name = "btnEdit";
-            this.btnEdit.Size = new System.Drawing.Size(160, 35);
-            this.btnEdit.TabIndex = 3;
-            this.btnEdit.Text = "Edit Selected";
-            this.btnEdit.UseVisualStyleBackColor = true;
-            this.btnEdit.Click += new System.EventHandler(this.btnEdit_Click);
-            // 
-            // btnSaveJson
-            // 
-            this.btnSaveJson.Location = new System.Drawing.Point(413, 223);
-            this.btnSaveJson.Name = "btnSaveJson";
-            this.btnSaveJson.Size = new System.Drawing.Size(160, 35);
-            this.btnSaveJson.TabIndex = 4;
-            this.btnSaveJson.Text = "Save as JSON";
-            this.btnSaveJson.UseVisualStyleBackColor = true;
-            this.btnSaveJson.Click += new System.EventHandler(this.btnSaveJson_Click);
-            // 
-            // btnSaveXml
-            // 
-            this.btnSaveXml.Location = new System.Drawing.Point(413, 264);
-            this.btnSaveXml.Name = "btnSaveXml";
-            this.btnSaveXml.Size = new System.Drawing.Size(160, 35);
-            this.btnSaveXml.TabIndex = 5;
-            this.btnSaveXml.Text = "Save as XML";
-            this.btnSaveXml.UseVisualStyleBackColor = true;
-            this.btnSaveXml.Click += new System.EventHandler(this.btnSaveXml_Click);
-            // 
-            // btnLoadJson
-            // 
-            this.btnLoadJson.Location = new System.Drawing.Point(413, 305);
-            this.btnLoadJson.Name = "btnLoadJson";
-            this.btnLoadJson.Size = new System.Drawing.Size(160, 35);
-            this.btnLoadJson.TabIndex = 6;
-            this.btnLoadJson.Text = "Load from JSON";
-            this.btnLoadJson.UseVisualStyleBackColor = true;
-            this.btnLoadJson.Click += new System.EventHandler(this.btnLoadJson_Click);
-            // 
-            // btnLoadXml
-            // 
-            this.btnLoadXml.Location = new System.Drawing.Point(413, 346);
-            this.btnLoadXml.Name = "btnLoadXml";
-            this.btnLoadXml.Size = new System.Drawing.Size(160, 35);
-            this.btnLoadXml.TabIndex = 7;
-            this.btnLoadXml.Text = "Load from XML";
-            this.btnLoadXml.UseVisualStyleBackColor = true;
-            this.btnLoadXml.Click += new System.EventHandler(this.btnLoadXml_Click);
-            // 
-            // label1
-            // 
-            this.label1.AutoSize = true;
-            this.label1.Font = new System.Drawing.Font("Microsoft Sans Serif", 9F, System.Drawing.FontStyle.Bold, System.Drawing.GraphicsUnit.Point, ((byte)(0)));
-            this.label1.Location = new System.Drawing.Point(13, 13);
-            this.label1.Name = "label1";
-            this.label1.Size = new System.Drawing.Size(140, 18);
-            this.label1.TabIndex = 8;
-            this.label1.Text = "Game Characters";
-            // 
-            // groupBox1
-            // 
-            this.groupBox1.Location = new System.Drawing.Point(403, 11);
-            this.groupBox1.Name = "groupBox1";
-            this.groupBox1.Size = new System.Drawing.Size(179, 173);
-            this.groupBox1.TabIndex = 9;
-            this.groupBox1.TabStop = false;
-            this.groupBox1.Text = "Character Actions";
-            // 
-            // groupBox2
-            // 
-            this.groupBox2.Location = new System.Drawing.Point(403, 202);
-            this.groupBox2.Name = "groupBox2";
-            this.groupBox2.Size = new System.Drawing.Size(179, 193);
-            this.groupBox2.TabIndex = 10;
-            this.groupBox2.TabStop = false;
-            this.groupBox2.Text = "Save/Load";
-            // 
-            // MainForm
-            // 
-            this.AutoScaleDimensions = new System.Drawing.SizeF(8F, 16F);
-            this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
-            this.ClientSize = new System.Drawing.Size(594, 407);
-            this.Controls.Add(this.label1);
-            this.Controls.Add(this.btnLoadXml);
-            this.Controls.Add(this.btnLoadJson);
-            this.Controls.Add(this.btnSaveXml);
-            this.Controls.Add(this.btnSaveJson);
-            this.Controls.Add(this.btnEdit);
-            this.Controls.Add(this.btnClone);
-            this.Controls.Add(this.btnCreate);
-            this.Controls.Add(this.listBoxCharacters);
-            this.Controls.Add(this.groupBox1);
-            this.Controls.Add(this.groupBox2);
-            this.FormBorderStyle = System.Windows.Forms.FormBorderStyle.FixedSingle;
-            this.MaximizeBox = false;
-            this.Name = "MainForm";
-            this.StartPosition = System.Windows.Forms.FormStartPosition.CenterScreen;
-            this.Text = "Game Character Manager";
-            this.ResumeLayout(false);
-            this.PerformLayout();
+            File.Delete(path);
+            File.Delete(RosterOffsetIndex.PathFor(path));
         }
 
-        #endregion
+        // Number of characters in characters.json, read from its offset index. A compressed
+        // file has none and is counted by reading it; a sharded roster by its manifest.
+        public long CountJson()
+        {
+            using (Exclusive())
+            {
+                RosterManifest shards = CurrentShards();
+                if (shards != null)
+                {
+                    long total = 0;
+                    foreach (RosterShardInfo info in shards.Shards)
+                        total += info.Count;
+                    return total;
+                }
 
-        private System.Windows.Forms.ListBox listBoxCharacters;
-        private System.Windows.Forms.Button btnCreate;
-        private System.Windows.Forms.Button btnClone;
-        private System.Windows.Forms.Button btnEdit;
-        private System.Windows.Forms.Button btnSaveJson;
-        private System.Windows.Forms.Button btnSaveXml;
-        private System.Windows.Forms.Button btnLoadJson;
-        private System.Windows.Forms.Button btnLoadXml;
-        private System.Windows.Forms.Label label1;
-        private System.Windows.Forms.GroupBox groupBox1;
-        private System.Windows.Forms.GroupBox groupBox2;
-    }
-}
+                if (!File.Exists(JsonFilePath))
+                    return 0;
+                using (RosterOffsetIndex index = OpenJsonIndex())
+                {
+                    if (index != null)
+                        return PendingJournal()?.Count ?? index.Count;
+                }
 
-// 6. Designer files for CharacterForm.Designer.cs
-namespace GameCharacterManager
-{
-    partial class CharacterForm
-    {
-        private System.ComponentModel.IContainer components = null;
+                long count = 0;
+                foreach (Character _ in StreamJsonWithJournal())
+                    count++;
+                return count;
+            }
+        }
 
-        protected override void Dispose(bool disposing)
+        // Characters [offset, offset + count) of characters.json. The offset index locates the
+        // page, so only its bytes are read from the roster however large it is.
+        public List<Character> LoadPageFromJson(long offset, int count)
         {
-            if (disposing && (components != null))
+            using (RosterMetrics.Start("load-page", "json"))
+            using (Exclusive())
             {
-                components.Dispose();
+                RosterManifest shards = CurrentShards();
+                if (shards != null)
+                    return ReadShardPage(shards, offset, count);
+
+                if (!File.Exists(JsonFilePath))
+                    return new List<Character>();
+                using (RosterOffsetIndex index = OpenJsonIndex())
+                {
+                    if (index != null)
+                    {
+                        JournalOverlay overlay = PendingJournal();
+                        if (overlay == null)
+                            return ReadPage(JsonFilePath, index.ReadBounds(offset, count), CharacterJsonCodec.ReadPage);
+                        return overlay.Page(offset, count,
+                            (start, length) => ReadPage(JsonFilePath, index.ReadBounds(start, length), CharacterJsonCodec.ReadPage));
+                    }
+                }
+                return PageOf(StreamJsonWithJournal(), offset, count);
             }
-            base.Dispose(disposing);
         }
 
-        #region Windows Form Designer generated code
-
-        private void InitializeComponent()
+        // Pages address records of the snapshot, so a pending journal is laid over them in memory
+        // rather than folded in under the caller. The overlay is kept until the snapshot or the
+        // journal changes, and the compaction that makes it unnecessary runs in the background.
+        private JournalOverlay PendingJournal()
         {
-            this.label1 = new System.Windows.Forms.Label();
-            this.txtName = new System.Windows.Forms.TextBox();
-            this.label2 = new System.Windows.Forms.Label();
+            SnapshotFingerprint snapshot = SnapshotFingerprint.Of(JsonFilePath);
+            if (!_journal.HasEntries(snapshot))
+                return null;
+
+            long journalLength = _journal.Length;
+            if (_overlay == null || !_overlaySnapshot.Equals(snapshot) || _overlayJournalLength != journalLength)
+            {
+                List<long?> savedIds;
+                using (FileStream fs = OpenRead(JsonFilePath))
+                {
+                    savedIds = new List<long?>(CharacterJsonCodec.ReadIds(fs));
+                }
+                _overlay = new JournalOverlay(CharacterRoster.AssignIds(savedIds), _journal.ReadEntries(snapshot));
+                _overlaySnapshot = snapshot;
+                _overlayJournalLength = journalLength;
+            }
+
+            if (_compaction.IsCompleted)
+                _compaction = Task.Run(CompactJournal);
+            return _overlay;
+        }
+
+        private RosterOffsetIndex OpenJsonIndex()
+        {
+            return OpenIndex(JsonFilePath, ScanJson);
+        }
+
+        private static bool ScanJson(Stream fs, RosterOffsetIndexWriter index)
+        {
+            CharacterJsonCodec.WriteIndex(fs, index);
+            return true;
+        }
+
+        // Record changes made to the list returned by LoadFromJson; SaveChanges persists them.
+        // Replacements and removals are keyed by Id, so they replay correctly in any order.
+        public void RecordAdd(Character character)
+        {
+            if (character == null)
+                throw new ArgumentNullException(nameof(character));
+
+            lock (_journalLock)
+                _pendingChanges.Add(new JournalEntry(JournalOperation.Add, character.Id, character));
+        }
+
+        // character takes the place of the one with its Id
+        public void RecordReplace(Character character)
+        {
+            if (character == null)
+                throw new ArgumentNullException(nameof(character));
+            RequireId(character.Id);
+
+            lock (_journalLock)
+                _pendingChanges.Add(new JournalEntry(JournalOperation.Replace, character.Id, character));
+        }
+
+        public void RecordRemove(long id)
+        {
+            RequireId(id);
+
+            lock (_journalLock)
+                _pendingChanges.Add(new JournalEntry(JournalOperation.Remove, id, null));
+        }
+
+        // Loads give every character an Id; one added to a plain list gets it from a CharacterRoster
+        private static void RequireId(long id)
+        {
+            if (id <= 0)
+                throw new ArgumentException("Only characters with an Id can be replaced or removed through the journal.", nameof(id));
+        }
+
+        // Entries are keyed by the Ids a CharacterRoster gives the snapshot's characters, so the
+        // loaded list is numbered the same way before the journal is applied to it
+        private void ReplayJournal(SnapshotFingerprint snapshot, List<Character> characters, long limit = long.MaxValue)
+        {
+            CharacterRoster.AssignIds(characters);
+            _journal.Replay(snapshot, characters, limit);
+        }
+
+        // Append recorded changes to the journal, costing O(changed characters). Falls back to a
+        // full snapshot when the list did not come from the JSON snapshot.
+        public void SaveChanges(List<Character> characters)
+        {
+            using (RosterMetrics.Start("save-changes", "json"))
+            using (Exclusive())
+            {
+                if (AppendChanges())
+                    return;
+
+                RosterManifest manifest = ReadManifest();
+                if (manifest != null)
+                    SaveJsonShards(characters, new RosterSharding(manifest.Partition, manifest.ShardCount), CancellationToken.None);
+                else
+                    SaveJsonSnapshot(characters);
+            }
+        }
+
+        // Asynchronous SaveChanges; only a full snapshot write reports progress
+        public async Task SaveChangesAsync(List<Character> characters, IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            using (RosterMetrics.Start("save-changes", "json", false))
+            using (await ExclusiveAsync(cancellationToken).ConfigureAwait(false))
+            {
+                if (AppendChanges())
+                    return;
+
+                RosterManifest manifest = ReadManifest();
+                if (manifest != null)
+                {
+                    var sharding = new RosterSharding(manifest.Partition, manifest.ShardCount);
+                    await Task.Run(() => SaveJsonShards(characters, sharding, cancellationToken), cancellationToken).ConfigureAwait(false);
+                }
+                else
+                {
+                    await SaveJsonSnapshotAsync(characters, progress, cancellationToken).ConfigureAwait(false);
+                }
+            }
+        }
+
+        // Journal the recorded changes when the list derives from the JSON snapshot; false when a
+        // full save is needed instead. Compaction waits for the caller to release the gate.
+        private bool AppendChanges()
+        {
+            lock (_journalLock)
+            {
+                if (!_tracksJsonSnapshot || !File.Exists(JsonFilePath))
+                    return false;
+                if (_pendingChanges.Count == 0)
+                    return true;
+
+                _journal.Append(SnapshotFingerprint.Of(JsonFilePath), _pendingChanges);
+                _pendingChanges.Clear();
+            }
+
+            if (_journal.Length >= JournalCompactionThreshold && _compaction.IsCompleted)
+                _compaction = Task.Run(CompactJournal);
+            return true;
+        }
+
+        // Block until a background compaction, if any, has finished
+        public void WaitForCompaction()
+        {
+            try
+            {
+                _compaction.Wait();
+            }
+            catch (AggregateException)
+            {
+                // A failed compaction leaves the snapshot and journal intact; the next save retries
+            }
+        }
+
+        public async Task WaitForCompactionAsync()
+        {
+            try
+            {
+                await _compaction.ConfigureAwait(false);
+            }
+            catch (Exception)
+            {
+                // Same as WaitForCompaction: a failed compaction is retried by the next save
+            }
+        }
+
+        // Rebuild the snapshot from snapshot + journal off the UI thread. It holds the gate, so no
+        // save can replace characters.json under it; one that ran first leaves nothing to fold.
+        private void CompactJournal()
+        {
+            using (Exclusive())
+            {
+                if (File.Exists(JsonFilePath) && _journal.HasEntries(SnapshotFingerprint.Of(JsonFilePath)))
+                    CompactJournalSnapshot();
+            }
+        }
+
+        // The rebased journal is staged before the new snapshot is moved into place, so a crash
+        // at any point loses nothing
+        private void CompactJournalSnapshot()
+        {
+            using (RosterMetrics.Start("compact", "json", false))
+            {
+                SnapshotFingerprint snapshot = SnapshotFingerprint.Of(JsonFilePath);
+                long compactedLength = _journal.Length;
+
+                var characters = new List<Character>(StreamJsonSnapshot());
+                ReplayJournal(snapshot, characters, compactedLength);
+
+                string tempPath = JsonFilePath + ".tmp";
+                RosterCompression compression = CompressedRosterStream.FromExtension(JsonFilePath);
+                using (var index = new RosterOffsetIndexWriter(JsonFilePath))
+                {
+                    using (FileStream fs = OpenWrite(tempPath))
+                    using (Stream output = CompressedRosterStream.ForWrite(fs, compression))
+                    {
+                        CharacterJsonCodec.Write(output, characters, compression == RosterCompression.None ? index : null);
+                    }
+
+                    _journal.BeginRebase(SnapshotFingerprint.Of(tempPath), compactedLength);
+                    File.Move(tempPath, JsonFilePath, true);
+                    _journal.CommitRebase();
+                    _overlay = null;
+                    if (compression == RosterCompression.None)
+                        index.Commit(SnapshotFingerprint.Of(JsonFilePath));
+                }
+                RosterMetrics.FileWritten(JsonFilePath);
+            }
+        }
+
+        // The caller's list no longer derives from the JSON snapshot, so the next save is a full one
+        private void StopTrackingJsonSnapshot()
+        {
+            lock (_journalLock)
+            {
+                _pendingChanges.Clear();
+                _tracksJsonSnapshot = false;
+            }
+        }
+
+        // characters.json, or when it has been replaced by shards, the shards in roster order
+        private IEnumerable<Character> StreamJsonSnapshot(CharacterPool pool = null)
+        {
+            if (!File.Exists(JsonFilePath))
+            {
+                RosterManifest shards = ReadManifest();
+                if (shards != null)
+                {
+                    foreach (Character character in StreamShards(shards, pool))
+                        yield return character;
+                }
+                yield break;
+            }
+
+            using (FileStream fs = OpenRead(JsonFilePath))
+            using (Stream contents = CompressedRosterStream.ForRead(fs, JsonFilePath))
+            {
+                foreach (Character character in CharacterJsonCodec.Read(contents, pool))
+                    yield return character;
+            }
+        }
+
+        // Save characters to XML file
+        public void SaveToXml(List<Character> characters)
+        {
+            using (RosterMetrics.Start("save", "xml"))
+            {
+                WriteFile(XmlFilePath, (fs, index) => CharacterXmlCodec.Write(fs, characters, index));
+            }
+        }
+
+        // Asynchronous SaveToXml, replacing characters.xml only once the write completes
+        public async Task SaveToXmlAsync(List<Character> characters, IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            using (RosterMetrics.Start("save", "xml", false))
+            {
+                await WriteFileAsync(XmlFilePath, characters, CharacterXmlCodec.WriteAsync, progress, cancellationToken).ConfigureAwait(false);
+            }
+        }
+
+        // Load characters from XML file
+        public List<Character> LoadFromXml()
+        {
+            using (RosterMetrics.Start("load", "xml"))
+            {
+                StopTrackingJsonSnapshot();
+                return new List<Character>(StreamFromXml());
+            }
+        }
+
+        // Pooled reload, as LoadFromJson(characters, pool)
+        public void LoadFromXml(List<Character> characters, CharacterPool pool)
+        {
+            using (RosterMetrics.Start("load", "xml"))
+            {
+                StopTrackingJsonSnapshot();
+                pool.ReturnAll(characters);
+                if (!File.Exists(XmlFilePath))
+                    return;
+
+                using (FileStream fs = OpenRead(XmlFilePath))
+                using (Stream contents = CompressedRosterStream.ForRead(fs, XmlFilePath))
+                {
+                    characters.AddRange(CharacterXmlCodec.Read(contents, pool));
+                }
+            }
+        }
+
+        // Asynchronous LoadFromXml. The XML scanner pulls bytes from deep inside its parse,
+        // so it runs on a pool thread rather than awaiting each read.
+        public Task<List<Character>> LoadFromXmlAsync(IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            StopTrackingJsonSnapshot();
+            return Task.Run(() =>
+            {
+                using (RosterMetrics.Start("load", "xml"))
+                {
+                    var characters = new List<Character>();
+                    if (!File.Exists(XmlFilePath))
+                        return characters;
+
+                    using (FileStream fs = OpenRead(XmlFilePath))
+                    using (Stream contents = CompressedRosterStream.ForRead(fs, XmlFilePath))
+                    {
+                        long total = fs.Length;
+                        long reported = -1;
+                        foreach (Character character in CharacterXmlCodec.Read(contents))
+                        {
+                            cancellationToken.ThrowIfCancellationRequested();
+                            characters.Add(character);
+                            ReportPosition(fs, total, ref reported, progress);
+                        }
+                        progress?.Report((total, total));
+                    }
+                    return characters;
+                }
+            }, cancellationToken);
+        }
+
+        // Enumerate characters from XML file one at a time
+        public IEnumerable<Character> StreamFromXml()
+        {
+            if (!File.Exists(XmlFilePath))
+                yield break;
+
+            using (FileStream fs = OpenRead(XmlFilePath))
+            using (Stream contents = CompressedRosterStream.ForRead(fs, XmlFilePath))
+            {
+                foreach (Character character in CharacterXmlCodec.Read(contents))
+                    yield return character;
+            }
+        }
+
+        // Number of characters in characters.xml, read from its offset index
+        public long CountXml()
+        {
+            if (!File.Exists(XmlFilePath))
+                return 0;
+
+            using (RosterOffsetIndex index = OpenIndex(XmlFilePath, CharacterXmlCodec.WriteIndex))
+            {
+                if (index != null)
+                    return index.Count;
+            }
+
+            long count = 0;
+            foreach (Character _ in StreamFromXml())
+                count++;
+            return count;
+        }
+
+        // Characters [offset, offset + count) of characters.xml, as LoadPageFromJson. Documents
+        // in other encodings than UTF-8 cannot be indexed and are read up to the page instead.
+        public List<Character> LoadPageFromXml(long offset, int count)
+        {
+            using (RosterMetrics.Start("load-page", "xml"))
+            {
+                if (offset < 0)
+                    throw new ArgumentOutOfRangeException(nameof(offset));
+                if (count < 0)
+                    throw new ArgumentOutOfRangeException(nameof(count));
+                if (!File.Exists(XmlFilePath))
+                    return new List<Character>();
+
+                using (RosterOffsetIndex index = OpenIndex(XmlFilePath, CharacterXmlCodec.WriteIndex))
+                {
+                    if (index != null)
+                        return ReadPage(XmlFilePath, index.ReadBounds(offset, count), CharacterXmlCodec.ReadPage);
+                }
+
+                return PageOf(StreamFromXml(), offset, count);
+            }
+        }
+
+        // Save characters to the compact binary file. Like the JSON and XML saves it is written
+        // aside and moved into place: truncating the file under an open MappedCharacterRoster
+        // would fault its next access, and a failed write would lose the previous roster.
+        public void SaveToBinary(List<Character> characters)
+        {
+            using (RosterMetrics.Start("save", "binary"))
+            {
+                WriteFile(BinaryFilePath, fs => CharacterBinaryCodec.Write(fs, characters));
+            }
+        }
+
+        // Load characters from the compact binary file
+        public List<Character> LoadFromBinary()
+        {
+            using (RosterMetrics.Start("load", "binary"))
+            {
+                StopTrackingJsonSnapshot();
+                if (!File.Exists(BinaryFilePath))
+                    return new List<Character>();
+
+                using (MappedCharacterRoster roster = OpenBinaryRoster())
+                {
+                    var characters = new List<Character>(roster.Count);
+                    characters.AddRange(roster);
+                    return characters;
+                }
+            }
+        }
+
+        // Asynchronous SaveToBinary on a worker thread. Cancelling stops the encoder between
+        // characters and leaves the previous file in place.
+        public Task SaveToBinaryAsync(List<Character> characters, IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            return Task.Run(() =>
+            {
+                using (RosterMetrics.Start("save", "binary", false))
+                {
+                    WriteFile(BinaryFilePath, fs => CharacterBinaryCodec.Write(fs, Observe(characters, characters.Count, progress, cancellationToken)));
+                }
+            }, cancellationToken);
+        }
+
+        // Asynchronous LoadFromBinary on a worker thread; progress counts characters decoded
+        public Task<List<Character>> LoadFromBinaryAsync(IProgress<(long done, long total)> progress = null,
+            CancellationToken cancellationToken = default)
+        {
+            return Task.Run(() =>
+            {
+                using (RosterMetrics.Start("load", "binary", false))
+                {
+                    StopTrackingJsonSnapshot();
+                    if (!File.Exists(BinaryFilePath))
+                        return new List<Character>();
+
+                    using (MappedCharacterRoster roster = OpenBinaryRoster())
+                    {
+                        var characters = new List<Character>(roster.Count);
+                        characters.AddRange(Observe(roster, roster.Count, progress, cancellationToken));
+                        return characters;
+                    }
+                }
+            }, cancellationToken);
+        }
+
+        // Pooled reload, as LoadFromJson(characters, pool)
+        public void LoadFromBinary(List<Character> characters, CharacterPool pool)
+        {
+            using (RosterMetrics.Start("load", "binary"))
+            {
+                StopTrackingJsonSnapshot();
+                pool.ReturnAll(characters);
+                if (!File.Exists(BinaryFilePath))
+                    return;
+
+                using (MappedCharacterRoster roster = OpenBinaryRoster())
+                {
+                    if (characters.Capacity < roster.Count)
+                        characters.Capacity = roster.Count;
+                    foreach (CharacterRecord record in roster.Records)
+                        characters.Add(record.ToCharacter(pool));
+                }
+            }
+        }
+
+        // Map the binary file for random access without loading it; dispose when done
+        public MappedCharacterRoster OpenBinaryRoster()
+        {
+            // Not counted as read: the mapping only touches the pages of records that are decoded
+            return MappedCharacterRoster.Open(BinaryFilePath);
+        }
+
+        // Enumerate characters from the binary file one at a time
+        public IEnumerable<Character> StreamFromBinary()
+        {
+            if (!File.Exists(BinaryFilePath))
+                yield break;
+
+            using (FileStream fs = OpenRead(BinaryFilePath))
+            {
+                foreach (Character character in CharacterBinaryCodec.Read(fs))
+                    yield return character;
+            }
+        }
+
+        // Load rosters straight into columnar storage for bulk statistics
+        public CharacterStore LoadStoreFromJson()
+        {
+            return CharacterStore.Load(StreamFromJson());
+        }
+
+        public CharacterStore LoadStoreFromXml()
+        {
+            return CharacterStore.Load(StreamFromXml());
+        }
+
+        public CharacterStore LoadStoreFromBinary()
+        {
+            if (!File.Exists(BinaryFilePath))
+                return new CharacterStore();
+
+            using (MappedCharacterRoster roster = OpenBinaryRoster())
+            {
+                return CharacterStore.Load(roster);
+            }
+        }
+
+        // Format conversions stream record by record, so the roster is never held in memory
+        public void ConvertJsonToBinary()
+        {
+            using (RosterMetrics.Start("convert", "json-binary"))
+            {
+                WriteFile(BinaryFilePath, fs => CharacterBinaryCodec.Write(fs, StreamFromJson()));
+            }
+        }
+
+        public void ConvertXmlToBinary()
+        {
+            using (RosterMetrics.Start("convert", "xml-binary"))
+            {
+                WriteFile(BinaryFilePath, fs => CharacterBinaryCodec.Write(fs, StreamFromXml()));
+            }
+        }
+
+        public void ConvertBinaryToJson()
+        {
+            using (RosterMetrics.Start("convert", "binary-json"))
+            using (Exclusive())
+            {
+                WriteFile(JsonFilePath, (fs, index) => CharacterJsonCodec.Write(fs, StreamFromBinary(), index));
+                DeleteShards();
+                _journal.Delete();
+                StopTrackingJsonSnapshot();
+            }
+        }
+
+        public void ConvertBinaryToXml()
+        {
+            using (RosterMetrics.Start("convert", "binary-xml"))
+            {
+                WriteFile(XmlFilePath, (fs, index) => CharacterXmlCodec.Write(fs, StreamFromBinary(), index));
+            }
+        }
+
+        // Formats are told apart by extension: .json, .xml and .bin as the repository's own files,
+        // with .gz or .br after it for a compressed JSON or XML roster
+        public static RosterFormat FormatOf(string path)
+        {
+            if (path == null)
+                throw new ArgumentNullException(nameof(path));
+
+            string extension = Path.GetExtension(CompressedRosterStream.WithoutCompressionExtension(path));
+            if (extension.Equals(".bin", StringComparison.OrdinalIgnoreCase) && CompressedRosterStream.FromExtension(path) != RosterCompression.None)
+                throw new ArgumentException($"{path} is a compressed binary roster; binary rosters are memory-mapped and stored uncompressed.", nameof(path));
+            if (extension.Equals(".json", StringComparison.OrdinalIgnoreCase))
+                return RosterFormat.Json;
+            if (extension.Equals(".xml", StringComparison.OrdinalIgnoreCase))
+                return RosterFormat.Xml;
+            if (extension.Equals(".bin", StringComparison.OrdinalIgnoreCase))
+                return RosterFormat.Binary;
+            throw new ArgumentException($"{path} is not a .json, .xml or .bin roster.", nameof(path));
+        }
+
+        // Enumerate any roster file one character at a time. A JSON file is read as it is on
+        // disk, without the journal or shards a repository may layer over it.
+        public static IEnumerable<Character> StreamFromFile(string path)
+        {
+            RosterFormat format = FormatOf(path);
+            if (!File.Exists(path))
+                throw new FileNotFoundException($"{path} does not exist.", path);
+            return StreamFromFile(path, format);
+        }
+
+        private static IEnumerable<Character> StreamFromFile(string path, RosterFormat format)
+        {
+            using (FileStream fs = OpenRead(path))
+            using (Stream contents = format == RosterFormat.Binary ? fs : CompressedRosterStream.ForRead(fs, path))
+            {
+                IEnumerable<Character> characters = format switch
+                {
+                    RosterFormat.Json => CharacterJsonCodec.Read(contents),
+                    RosterFormat.Xml => CharacterXmlCodec.Read(contents),
+                    _ => CharacterBinaryCodec.Read(contents)
+                };
+                foreach (Character character in characters)
+                    yield return character;
+            }
+        }
+
+        // Write characters to any roster file as they are enumerated, replacing the file only
+        // once the write completes. JSON and XML get an offset index for paged reads.
+        public static void SaveToFile(string path, IEnumerable<Character> characters)
+        {
+            if (characters == null)
+                throw new ArgumentNullException(nameof(characters));
+
+            RosterFormat format = FormatOf(path);
+            using (RosterMetrics.Start("save", format == RosterFormat.Json ? "json" : format == RosterFormat.Xml ? "xml" : "binary"))
+            {
+                switch (format)
+                {
+                    case RosterFormat.Json:
+                        WriteFile(path, (fs, index) => CharacterJsonCodec.Write(fs, characters, index));
+                        break;
+                    case RosterFormat.Xml:
+                        WriteFile(path, (fs, index) => CharacterXmlCodec.Write(fs, characters, index));
+                        break;
+                    default:
+                        WriteFile(path, fs => CharacterBinaryCodec.Write(fs, characters));
+                        break;
+                }
+            }
+        }
+
+        private static void WriteFile(string path, Action<Stream, RosterOffsetIndexWriter> write)
+        {
+            // Offsets into compressed bytes would address nothing, so such files are not indexed
+            if (IsCompressedName(path))
+            {
+                WriteFile(path, fs => write(fs, null));
+                return;
+            }
+
+            string tempPath = path + ".tmp";
+            using (var index = new RosterOffsetIndexWriter(path))
+            {
+                try
+                {
+                    using (FileStream fs = OpenWrite(tempPath))
+                    {
+                        write(fs, index);
+                    }
+                    File.Move(tempPath, path, true);
+                }
+                catch
+                {
+                    File.Delete(tempPath);
+                    throw;
+                }
+                index.Commit(SnapshotFingerprint.Of(path));
+            }
+            RosterMetrics.FileWritten(path);
+            RosterMetrics.FileWritten(RosterOffsetIndex.PathFor(path));
+        }
+
+        // WriteFile for formats without an offset index, compressing when path asks for it
+        private static void WriteFile(string path, Action<Stream> write)
+        {
+            string tempPath = path + ".tmp";
+            try
+            {
+                using (FileStream fs = OpenWrite(tempPath))
+                using (Stream output = CompressedRosterStream.ForWrite(fs, CompressedRosterStream.FromExtension(path)))
+                {
+                    write(output);
+                }
+                File.Move(tempPath, path, true);
+            }
+            catch
+            {
+                File.Delete(tempPath);
+                throw;
+            }
+            RosterMetrics.FileWritten(path);
+        }
+
+        // Write through a temporary file and move it over path once the write has completed.
+        // The offset index recorded on the way is moved in after it.
+        private static async Task WriteFileAsync(string path, List<Character> characters,
+            Func<Stream, IReadOnlyCollection<Character>, RosterOffsetIndexWriter, IProgress<(long done, long total)>, CancellationToken, Task> write,
+            IProgress<(long done, long total)> progress, CancellationToken cancellationToken)
+        {
+            string tempPath = path + ".tmp";
+            RosterCompression compression = CompressedRosterStream.FromExtension(path);
+            using (var index = new RosterOffsetIndexWriter(path))
+            {
+                try
+                {
+                    if (compression == RosterCompression.None)
+                    {
+                        using (FileStream fs = OpenWriteAsync(tempPath))
+                        {
+                            await write(fs, characters, index, progress, cancellationToken).ConfigureAwait(false);
+                        }
+                    }
+                    else
+                    {
+                        // The compressing thread writes the file synchronously
+                        using (FileStream fs = OpenWrite(tempPath))
+                        using (Stream output = CompressedRosterStream.ForWrite(fs, compression))
+                        {
+                            await write(output, characters, null, progress, cancellationToken).ConfigureAwait(false);
+                        }
+                    }
+                    File.Move(tempPath, path, true);
+                }
+                catch
+                {
+                    File.Delete(tempPath);
+                    throw;
+                }
+                if (compression == RosterCompression.None)
+                    index.Commit(SnapshotFingerprint.Of(path));
+            }
+            RosterMetrics.FileWritten(path);
+            if (compression == RosterCompression.None)
+                RosterMetrics.FileWritten(RosterOffsetIndex.PathFor(path));
+        }
+
+        // The sidecar index of path, rebuilt by scanning the file when it is missing or stale.
+        // Null when the file cannot be indexed.
+        private static RosterOffsetIndex OpenIndex(string path, Func<Stream, RosterOffsetIndexWriter, bool> scan)
+        {
+            if (IsCompressed(path))
+                return null;
+
+            RosterOffsetIndex index = RosterOffsetIndex.TryOpen(path);
+            if (index != null)
+                return index;
+
+            using (var writer = new RosterOffsetIndexWriter(path))
+            {
+                SnapshotFingerprint source = SnapshotFingerprint.Of(path);
+                using (FileStream fs = OpenRead(path))
+                {
+                    if (!scan(fs, writer))
+                        return null;
+                }
+                writer.Commit(source);
+            }
+            return RosterOffsetIndex.TryOpen(path) ?? throw new IOException($"{path} changed while it was being indexed.");
+        }
+
+        // Read just the bytes of one page and decode them
+        private static List<Character> ReadPage(string path, long[] bounds, Func<byte[], long[], List<Character>> decode)
+        {
+            if (bounds.Length == 0)
+                return new List<Character>();
+
+            long length = bounds[bounds.Length - 1] - bounds[0];
+            if (length > Array.MaxLength)
+                throw new ArgumentOutOfRangeException(nameof(bounds), "The page is too large to read at once.");
+
+            byte[] page = ArrayPool<byte>.Shared.Rent((int)length);
+            try
+            {
+                using (SafeFileHandle file = File.OpenHandle(path, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete))
+                {
+                    RosterOffsetIndex.ReadExactly(file, new Span<byte>(page, 0, (int)length), bounds[0]);
+                }
+                RosterMetrics.Read(path, length);
+                return decode(page, bounds);
+            }
+            finally
+            {
+                ArrayPool<byte>.Shared.Return(page);
+            }
+        }
+
+        // Pass characters through, checking for cancellation and reporting how many have gone
+        // by every ObserveInterval characters
+        private static IEnumerable<Character> Observe(IEnumerable<Character> characters, long total,
+            IProgress<(long done, long total)> progress, CancellationToken cancellationToken)
+        {
+            long done = 0;
+            foreach (Character character in characters)
+            {
+                if (done % ObserveInterval == 0)
+                {
+                    cancellationToken.ThrowIfCancellationRequested();
+                    progress?.Report((done, total));
+                }
+                done++;
+                yield return character;
+            }
+            progress?.Report((total, total));
+        }
+
+        // Page of a roster without an offset index, read up to its end
+        private static List<Character> PageOf(IEnumerable<Character> characters, long offset, int count)
+        {
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            var page = new List<Character>();
+            long position = 0;
+            foreach (Character character in characters)
+            {
+                if (position++ < offset)
+                    continue;
+                if (page.Count == count)
+                    break;
+                page.Add(character);
+            }
+            return page;
+        }
+
+        private static bool IsCompressedName(string path)
+        {
+            return CompressedRosterStream.FromExtension(path) != RosterCompression.None;
+        }
+
+        // By name or, for a gzip file under a plain name, by content
+        private static bool IsCompressed(string path)
+        {
+            return CompressedRosterStream.Detect(path) != RosterCompression.None;
+        }
+
+        // An empty roster defers nothing, so nothing would ever close the handle
+        private static void ReleaseIfUnused(CharacterDetailSource details)
+        {
+            if (details.Pending == 0)
+                details.Dispose();
+        }
+
+        // Report once per buffer refill rather than once per character
+        private static void ReportPosition(FileStream fs, long total, ref long reported, IProgress<(long done, long total)> progress)
+        {
+            if (progress != null && fs.Position != reported)
+            {
+                reported = fs.Position;
+                progress.Report((reported, total));
+            }
+        }
+
+        // Opening for a read counts the whole file as read
+        private static FileStream OpenReadAsync(string path)
+        {
+            var fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read, FileBufferSize, true);
+            RosterMetrics.FileRead(path);
+            return fs;
+        }
+
+        private static FileStream OpenWriteAsync(string path)
+        {
+            return new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, FileBufferSize, true);
+        }
+
+        private static FileStream OpenRead(string path)
+        {
+            var fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read, FileBufferSize);
+            RosterMetrics.FileRead(path);
+            return fs;
+        }
+
+        private static FileStream OpenWrite(string path)
+        {
+            return new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.None, FileBufferSize);
+        }
+    }
+
+    public enum RosterFormat
+    {
+        Json,
+        Xml,
+        Binary
+    }
+}
+
+// 3. MainForm.cs - Main application window
+using System;
+using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Windows.Forms;
+
+namespace GameCharacterManager
+{
+    public partial class MainForm : Form
+    {
+        private RosterViewModel _view;
+        private CharacterRepository _repository;
+        private CancellationTokenSource _operation;
+
+        public MainForm()
+        {
+            InitializeComponent();
+            _repository = new CharacterRepository();
+            _view = new RosterViewModel();
+            _view.Changed += View_Changed;
+        }
+
+        private Character SelectedCharacter =>
+            listViewCharacters.SelectedIndices.Count > 0 ? _view[listViewCharacters.SelectedIndices[0]] : null;
+
+        // Load characters on startup, once the window is showing. Only what the list shows is
+        // read; the rest of a character is read when it is selected.
+        private async void MainForm_Load(object sender, EventArgs e)
+        {
+            try
+            {
+                _view.Load(new CharacterRoster(await RunFileOperationAsync(_repository.LoadHeadersFromJsonAsync)));
+            }
+            catch (OperationCanceledException)
+            {
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error loading characters: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        protected override void OnFormClosing(FormClosingEventArgs e)
+        {
+            _operation?.Cancel();
+
+            // Let a background journal compaction finish before the process exits
+            _repository.WaitForCompaction();
+            base.OnFormClosing(e);
+        }
+
+        private async Task RunFileOperationAsync(Func<IProgress<(long done, long total)>, CancellationToken, Task> operation)
+        {
+            await RunFileOperationAsync<object>(async (progress, token) =>
+            {
+                await operation(progress, token);
+                return null;
+            });
+        }
+
+        // Run one file operation at a time with the progress bar and Cancel button wired up.
+        // Everything that touches the roster is disabled until it finishes.
+        private async Task<T> RunFileOperationAsync<T>(Func<IProgress<(long done, long total)>, CancellationToken, Task<T>> operation)
+        {
+            using (var operationSource = new CancellationTokenSource())
+            {
+                _operation = operationSource;
+                SetBusy(true);
+                var progress = new Progress<(long done, long total)>(p =>
+                {
+                    // Reports are posted, so ignore any that arrive after the operation ended
+                    if (_operation == operationSource && p.total > 0)
+                        progressBar.Value = (int)(p.done * progressBar.Maximum / p.total);
+                });
+
+                try
+                {
+                    return await operation(progress, operationSource.Token);
+                }
+                finally
+                {
+                    _operation = null;
+                    SetBusy(false);
+                }
+            }
+        }
+
+        private void SetBusy(bool busy)
+        {
+            foreach (Button button in new[] { btnCreate, btnClone, btnEdit, btnDelete, btnSaveJson, btnSaveXml, btnLoadJson, btnLoadXml, btnSaveBinary, btnLoadBinary })
+                button.Enabled = !busy;
+            listViewCharacters.Enabled = !busy;
+            txtSearch.Enabled = !busy;
+            btnCancel.Enabled = busy;
+            progressBar.Value = 0;
+        }
+
+        private void btnCancel_Click(object sender, EventArgs e)
+        {
+            _operation?.Cancel();
+        }
+
+        // The list runs in virtual mode: it asks for the rows it paints, so a change only
+        // needs the new row count and a repaint of what is on screen
+        private void View_Changed(object sender, RosterChangedEventArgs e)
+        {
+            if (e.Kind == RosterChangeKind.Replace)
+            {
+                listViewCharacters.RedrawItems(e.Index, e.Index, false);
+                return;
+            }
+
+            // Selected rows are kept by index, which no longer points at the same character
+            listViewCharacters.SelectedIndices.Clear();
+            listViewCharacters.VirtualListSize = _view.Count;
+            listViewCharacters.Invalidate();
+        }
+
+        private void listViewCharacters_RetrieveVirtualItem(object sender, RetrieveVirtualItemEventArgs e)
+        {
+            e.Item = new ListViewItem(_view.GetText(e.ItemIndex));
+        }
+
+        private void listViewCharacters_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            try
+            {
+                SelectedCharacter?.LoadDetails();
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error loading character: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private void SelectRow(long id)
+        {
+            int row = _view.IndexOf(id);
+            if (row < 0)
+                return;
+            listViewCharacters.SelectedIndices.Clear();
+            listViewCharacters.SelectedIndices.Add(row);
+            listViewCharacters.EnsureVisible(row);
+        }
+
+        private void txtSearch_TextChanged(object sender, EventArgs e)
+        {
+            _view.Search(txtSearch.Text);
+        }
+
+        private void btnCreate_Click(object sender, EventArgs e)
+        {
+            using (CharacterForm form = new CharacterForm())
+            {
+                if (form.ShowDialog() == DialogResult.OK)
+                {
+                    _view.Add(form.Character);
+                    _repository.RecordAdd(form.Character);
+                    SelectRow(form.Character.Id);
+                }
+            }
+        }
+
+        private void btnClone_Click(object sender, EventArgs e)
+        {
+            if (SelectedCharacter is Character selectedCharacter)
+            {
+                Character clonedCharacter = (Character)selectedCharacter.Clone();
+                _view.Add(clonedCharacter);
+                _repository.RecordAdd(clonedCharacter);
+                SelectRow(clonedCharacter.Id);
+            }
+            else
+            {
+                MessageBox.Show("Please select a character to clone.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+        }
+
+        private void btnEdit_Click(object sender, EventArgs e)
+        {
+            if (SelectedCharacter is Character selectedCharacter)
+            {
+                using (CharacterForm form = new CharacterForm(selectedCharacter))
+                {
+                    if (form.ShowDialog() == DialogResult.OK)
+                    {
+                        // The edited copy keeps the Id, which locates the original in O(1) here
+                        // and when the journal is replayed
+                        _view.Replace(form.Character);
+                        _repository.RecordReplace(form.Character);
+                    }
+                }
+            }
+            else
+            {
+                MessageBox.Show("Please select a character to edit.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+        }
+
+        private void btnDelete_Click(object sender, EventArgs e)
+        {
+            if (SelectedCharacter is Character selectedCharacter)
+            {
+                _view.Remove(selectedCharacter.Id);
+                _repository.RecordRemove(selectedCharacter.Id);
+            }
+            else
+            {
+                MessageBox.Show("Please select a character to delete.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+        }
+
+        private async void btnSaveJson_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                // Only the changes since the last load/save are appended to the journal
+                await RunFileOperationAsync((progress, token) => _repository.SaveChangesAsync(_view.Roster.ToList(), progress, token));
+                MessageBox.Show("Characters saved to JSON successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Saving to JSON was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error saving to JSON: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private async void btnSaveXml_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                await RunFileOperationAsync((progress, token) => _repository.SaveToXmlAsync(_view.Roster.ToList(), progress, token));
+                MessageBox.Show("Characters saved to XML successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Saving to XML was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error saving to XML: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private async void btnSaveBinary_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                await RunFileOperationAsync((progress, token) => _repository.SaveToBinaryAsync(_view.Roster.ToList(), progress, token));
+                MessageBox.Show("Characters saved to binary file successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Saving to binary file was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error saving to binary file: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private async void btnLoadJson_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                _view.Load(new CharacterRoster(await RunFileOperationAsync(_repository.LoadHeadersFromJsonAsync)));
+                MessageBox.Show("Characters loaded from JSON successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Loading from JSON was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error loading from JSON: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private async void btnLoadXml_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                _view.Load(new CharacterRoster(await RunFileOperationAsync(_repository.LoadFromXmlAsync)));
+                MessageBox.Show("Characters loaded from XML successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Loading from XML was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error loading from XML: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+
+        private async void btnLoadBinary_Click(object sender, EventArgs e)
+        {
+            try
+            {
+                _view.Load(new CharacterRoster(await RunFileOperationAsync(_repository.LoadFromBinaryAsync)));
+                MessageBox.Show("Characters loaded from binary file successfully!", "Success", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (OperationCanceledException)
+            {
+                MessageBox.Show("Loading from binary file was cancelled.", "Information", MessageBoxButtons.OK, MessageBoxIcon.Information);
+            }
+            catch (Exception ex)
+            {
+                MessageBox.Show($"Error loading from binary file: {ex.Message}", "Error", MessageBoxButtons.OK, MessageBoxIcon.Error);
+            }
+        }
+    }
+}
+
+// 4. CharacterForm.cs - Form for creating/editing characters
+using System;
+using System.Collections.Generic;
+using System.Windows.Forms;
+
+namespace GameCharacterManager
+{
+    public partial class CharacterForm : Form
+    {
+        public Character Character { get; private set; }
+
+        // Constructor for creating a new character
+        public CharacterForm()
+        {
+            InitializeComponent();
+            Character = new Character();
+            SetupForm();
+        }
+
+        // Constructor for editing an existing character; the copy keeps its name and Id
+        public CharacterForm(Character character)
+        {
+            InitializeComponent();
+            Character = character.CopyWithName(character.Name);
+            Character.Id = character.Id;
+            SetupForm();
+            
+            // Populate form with character data
+            txtName.Text = Character.Name;
+            numLevel.Value = Character.Level;
+            numHealth.Value = Character.Health;
+            numMana.Value = Character.Mana;
+            cmbClass.SelectedItem = Character.Class;
+            txtWeapon.Text = Character.WeaponType;
+            txtArmor.Text = Character.ArmorType;
+            
+            // Populate abilities list
+            listBoxAbilities.Items.Clear();
+            foreach (var ability in Character.Abilities)
+            {
+                listBoxAbilities.Items.Add(ability);
+            }
+        }
+
+        private void SetupForm()
+        {
+            // Set up the class combo box
+            cmbClass.DataSource = Enum.GetValues(typeof(CharacterClass));
+        }
+
+        private void btnSave_Click(object sender, EventArgs e)
+        {
+            // Update character properties from form inputs
+            Character.Name = txtName.Text;
+            Character.Level = (int)numLevel.Value;
+            Character.Health = (int)numHealth.Value;
+            Character.Mana = (int)numMana.Value;
+            Character.Class = (CharacterClass)cmbClass.SelectedItem;
+            Character.WeaponType = txtWeapon.Text;
+            Character.ArmorType = txtArmor.Text;
+            
+            // Update abilities
+            Character.Abilities.Clear();
+            foreach (var item in listBoxAbilities.Items)
+            {
+                Character.Abilities.Add(item.ToString());
+            }
+            
+            DialogResult = DialogResult.OK;
+        }
+
+        private void btnCancel_Click(object sender, EventArgs e)
+        {
+            DialogResult = DialogResult.Cancel;
+        }
+
+        private void btnAddAbility_Click(object sender, EventArgs e)
+        {
+            if (!string.IsNullOrWhiteSpace(txtAbility.Text))
+            {
+                listBoxAbilities.Items.Add(txtAbility.Text);
+                txtAbility.Clear();
+                txtAbility.Focus();
+            }
+        }
+
+        private void btnRemoveAbility_Click(object sender, EventArgs e)
+        {
+            if (listBoxAbilities.SelectedIndex != -1)
+            {
+                listBoxAbilities.Items.RemoveAt(listBoxAbilities.SelectedIndex);
+            }
+        }
+    }
+}
+
+// 5. Designer files for MainForm.Designer.cs
+namespace GameCharacterManager
+{
+    partial class MainForm
+    {
+        private System.ComponentModel.IContainer components = null;
+
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing && (components != null))
+            {
+                components.Dispose();
+            }
+            base.Dispose(disposing);
+        }
+
+        #region Windows Form Designer generated code
+
+        private void InitializeComponent()
+        {
+            this.listViewCharacters = new System.Windows.Forms.ListView();
+            this.columnCharacter = new System.Windows.Forms.ColumnHeader();
+            this.btnCreate = new System.Windows.Forms.Button();
+            this.btnClone = new System.Windows.Forms.Button();
+            this.btnEdit = new System.Windows.Forms.Button();
+            this.btnDelete = new System.Windows.Forms.Button();
+            this.btnSaveJson = new System.Windows.Forms.Button();
+            this.btnSaveXml = new System.Windows.Forms.Button();
+            this.btnLoadJson = new System.Windows.Forms.Button();
+            this.btnLoadXml = new System.Windows.Forms.Button();
+            this.btnSaveBinary = new System.Windows.Forms.Button();
+            this.btnLoadBinary = new System.Windows.Forms.Button();
+            this.progressBar = new System.Windows.Forms.ProgressBar();
+            this.btnCancel = new System.Windows.Forms.Button();
+            this.label1 = new System.Windows.Forms.Label();
+            this.txtSearch = new System.Windows.Forms.TextBox();
+            this.groupBox1 = new System.Windows.Forms.GroupBox();
+            this.groupBox2 = new System.Windows.Forms.GroupBox();
+            this.SuspendLayout();
+            // 
+            // listViewCharacters
+            // 
+            this.listViewCharacters.Columns.AddRange(new System.Windows.Forms.ColumnHeader[] {
+            this.columnCharacter});
+            this.listViewCharacters.FullRowSelect = true;
+            this.listViewCharacters.HeaderStyle = System.Windows.Forms.ColumnHeaderStyle.None;
+            this.listViewCharacters.HideSelection = false;
+            this.listViewCharacters.Location = new System.Drawing.Point(16, 36);
+            this.listViewCharacters.MultiSelect = false;
+            this.listViewCharacters.Name = "listViewCharacters";
+            this.listViewCharacters.Size = new System.Drawing.Size(380, 436);
+            this.listViewCharacters.TabIndex = 0;
+            this.listViewCharacters.UseCompatibleStateImageBehavior = false;
+            this.listViewCharacters.View = System.Windows.Forms.View.Details;
+            this.listViewCharacters.VirtualMode = true;
+            this.listViewCharacters.RetrieveVirtualItem += new System.Windows.Forms.RetrieveVirtualItemEventHandler(this.listViewCharacters_RetrieveVirtualItem);
+            this.listViewCharacters.SelectedIndexChanged += new System.EventHandler(this.listViewCharacters_SelectedIndexChanged);
+            // 
+            // columnCharacter
+            // 
+            this.columnCharacter.Width = 355;
+            // 
+            // btnCreate
+            // 
+            this.btnCreate.Location = new System.Drawing.Point(413, 36);
+            this.btnCreate.Name = "btnCreate";
+            this.btnCreate.Size = new System.Drawing.Size(160, 35);
+            this.btnCreate.TabIndex = 1;
+            this.btnCreate.Text = "Create New";
+            this.btnCreate.UseVisualStyleBackColor = true;
+            this.btnCreate.Click += new System.EventHandler(this.btnCreate_Click);
+            // 
+            // btnClone
+            // 
+            this.btnClone.Location = new System.Drawing.Point(413, 85);
+            this.btnClone.Name = "btnClone";
+            this.btnClone.Size = new System.Drawing.Size(160, 35);
+            this.btnClone.TabIndex = 2;
+            this.btnClone.Text = "Clone Selected";
+            this.btnClone.UseVisualStyleBackColor = true;
+            this.btnClone.Click += new System.EventHandler(this.btnClone_Click);
+            // 
+            // btnEdit
+            // 
+            this.btnEdit.Location = new System.Drawing.Point(413, 134);
+            this.btnEdit.Name = "btnEdit";
+            this.btnEdit.Size = new System.Drawing.Size(160, 35);
+            this.btnEdit.TabIndex = 3;
+            this.btnEdit.Text = "Edit Selected";
+            this.btnEdit.UseVisualStyleBackColor = true;
+            this.btnEdit.Click += new System.EventHandler(this.btnEdit_Click);
+            // 
+            // btnDelete
+            // 
+            this.btnDelete.Location = new System.Drawing.Point(413, 183);
+            this.btnDelete.Name = "btnDelete";
+            this.btnDelete.Size = new System.Drawing.Size(160, 35);
+            this.btnDelete.TabIndex = 13;
+            this.btnDelete.Text = "Delete Selected";
+            this.btnDelete.UseVisualStyleBackColor = true;
+            this.btnDelete.Click += new System.EventHandler(this.btnDelete_Click);
+            // 
+            // btnSaveJson
+            // 
+            this.btnSaveJson.Location = new System.Drawing.Point(413, 272);
+            this.btnSaveJson.Name = "btnSaveJson";
+            this.btnSaveJson.Size = new System.Drawing.Size(160, 35);
+            this.btnSaveJson.TabIndex = 4;
+            this.btnSaveJson.Text = "Save as JSON";
+            this.btnSaveJson.UseVisualStyleBackColor = true;
+            this.btnSaveJson.Click += new System.EventHandler(this.btnSaveJson_Click);
+            // 
+            // btnSaveXml
+            // 
+            this.btnSaveXml.Location = new System.Drawing.Point(413, 313);
+            this.btnSaveXml.Name = "btnSaveXml";
+            this.btnSaveXml.Size = new System.Drawing.Size(160, 35);
+            this.btnSaveXml.TabIndex = 5;
+            this.btnSaveXml.Text = "Save as XML";
+            this.btnSaveXml.UseVisualStyleBackColor = true;
+            this.btnSaveXml.Click += new System.EventHandler(this.btnSaveXml_Click);
+            // 
+            // btnLoadJson
+            // 
+            this.btnLoadJson.Location = new System.Drawing.Point(413, 354);
+            this.btnLoadJson.Name = "btnLoadJson";
+            this.btnLoadJson.Size = new System.Drawing.Size(160, 35);
+            this.btnLoadJson.TabIndex = 6;
+            this.btnLoadJson.Text = "Load from JSON";
+            this.btnLoadJson.UseVisualStyleBackColor = true;
+            this.btnLoadJson.Click += new System.EventHandler(this.btnLoadJson_Click);
+            // 
+            // btnLoadXml
+            // 
+            this.btnLoadXml.Location = new System.Drawing.Point(413, 395);
+            this.btnLoadXml.Name = "btnLoadXml";
+            this.btnLoadXml.Size = new System.Drawing.Size(160, 35);
+            this.btnLoadXml.TabIndex = 7;
+            this.btnLoadXml.Text = "Load from XML";
+            this.btnLoadXml.UseVisualStyleBackColor = true;
+            this.btnLoadXml.Click += new System.EventHandler(this.btnLoadXml_Click);
+            // 
+            // btnSaveBinary
+            // 
+            this.btnSaveBinary.Location = new System.Drawing.Point(413, 436);
+            this.btnSaveBinary.Name = "btnSaveBinary";
+            this.btnSaveBinary.Size = new System.Drawing.Size(160, 35);
+            this.btnSaveBinary.TabIndex = 11;
+            this.btnSaveBinary.Text = "Save as Binary";
+            this.btnSaveBinary.UseVisualStyleBackColor = true;
+            this.btnSaveBinary.Click += new System.EventHandler(this.btnSaveBinary_Click);
+            // 
+            // btnLoadBinary
+            // 
+            this.btnLoadBinary.Location = new System.Drawing.Point(413, 477);
+            this.btnLoadBinary.Name = "btnLoadBinary";
+            this.btnLoadBinary.Size = new System.Drawing.Size(160, 35);
+            this.btnLoadBinary.TabIndex = 12;
+            this.btnLoadBinary.Text = "Load from Binary";
+            this.btnLoadBinary.UseVisualStyleBackColor = true;
+            this.btnLoadBinary.Click += new System.EventHandler(this.btnLoadBinary_Click);
+            // 
+            // progressBar
+            // 
+            this.progressBar.Location = new System.Drawing.Point(16, 486);
+            this.progressBar.Maximum = 1000;
+            this.progressBar.Name = "progressBar";
+            this.progressBar.Size = new System.Drawing.Size(284, 23);
+            this.progressBar.TabIndex = 14;
+            // 
+            // btnCancel
+            // 
+            this.btnCancel.Enabled = false;
+            this.btnCancel.Location = new System.Drawing.Point(306, 480);
+            this.btnCancel.Name = "btnCancel";
+            this.btnCancel.Size = new System.Drawing.Size(90, 35);
+            this.btnCancel.TabIndex = 15;
+            this.btnCancel.Text = "Cancel";
+            this.btnCancel.UseVisualStyleBackColor = true;
+            this.btnCancel.Click += new System.EventHandler(this.btnCancel_Click);
+            // 
+            // label1
+            // 
+            this.label1.AutoSize = true;
+            this.label1.Font = new System.Drawing.Font("Microsoft Sans Serif", 9F, System.Drawing.FontStyle.Bold, System.Drawing.GraphicsUnit.Point, ((byte)(0)));
+            this.label1.Location = new System.Drawing.Point(13, 13);
+            this.label1.Name = "label1";
+            this.label1.Size = new System.Drawing.Size(140, 18);
+            this.label1.TabIndex = 8;
+            this.label1.Text = "Game Characters";
+            // 
+            // txtSearch
+            // 
+            this.txtSearch.Location = new System.Drawing.Point(176, 8);
+            this.txtSearch.Name = "txtSearch";
+            this.txtSearch.PlaceholderText = "Search by name";
+            this.txtSearch.Size = new System.Drawing.Size(220, 22);
+            this.txtSearch.TabIndex = 16;
+            this.txtSearch.TextChanged += new System.EventHandler(this.txtSearch_TextChanged);
+            // 
+            // groupBox1
+            // 
+            this.groupBox1.Location = new System.Drawing.Point(403, 11);
+            this.groupBox1.Name = "groupBox1";
+            this.groupBox1.Size = new System.Drawing.Size(179, 222);
+            this.groupBox1.TabIndex = 9;
+            this.groupBox1.TabStop = false;
+            this.groupBox1.Text = "Character Actions";
+            // 
+            // groupBox2
+            // 
+            this.groupBox2.Location = new System.Drawing.Point(403, 251);
+            this.groupBox2.Name = "groupBox2";
+            this.groupBox2.Size = new System.Drawing.Size(179, 275);
+            this.groupBox2.TabIndex = 10;
+            this.groupBox2.TabStop = false;
+            this.groupBox2.Text = "Save/Load";
+            // 
+            // MainForm
+            // 
+            this.AutoScaleDimensions = new System.Drawing.SizeF(8F, 16F);
+            this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
+            this.ClientSize = new System.Drawing.Size(594, 538);
+            this.Controls.Add(this.btnCancel);
+            this.Controls.Add(this.progressBar);
+            this.Controls.Add(this.label1);
+            this.Controls.Add(this.txtSearch);
+            this.Controls.Add(this.btnLoadBinary);
+            this.Controls.Add(this.btnSaveBinary);
+            this.Controls.Add(this.btnLoadXml);
+            this.Controls.Add(this.btnLoadJson);
+            this.Controls.Add(this.btnSaveXml);
+            this.Controls.Add(this.btnSaveJson);
+            this.Controls.Add(this.btnDelete);
+            this.Controls.Add(this.btnEdit);
+            this.Controls.Add(this.btnClone);
+            this.Controls.Add(this.btnCreate);
+            this.Controls.Add(this.listViewCharacters);
+            this.Controls.Add(this.groupBox1);
+            this.Controls.Add(this.groupBox2);
+            this.FormBorderStyle = System.Windows.Forms.FormBorderStyle.FixedSingle;
+            this.MaximizeBox = false;
+            this.Name = "MainForm";
+            this.StartPosition = System.Windows.Forms.FormStartPosition.CenterScreen;
+            this.Text = "Game Character Manager";
+            this.Load += new System.EventHandler(this.MainForm_Load);
+            this.ResumeLayout(false);
+            this.PerformLayout();
+        }
+
+        #endregion
+
+        private System.Windows.Forms.ListView listViewCharacters;
+        private System.Windows.Forms.ColumnHeader columnCharacter;
+        private System.Windows.Forms.Button btnCreate;
+        private System.Windows.Forms.Button btnClone;
+        private System.Windows.Forms.Button btnEdit;
+        private System.Windows.Forms.Button btnDelete;
+        private System.Windows.Forms.Button btnSaveJson;
+        private System.Windows.Forms.Button btnSaveXml;
+        private System.Windows.Forms.Button btnLoadJson;
+        private System.Windows.Forms.Button btnLoadXml;
+        private System.Windows.Forms.Button btnSaveBinary;
+        private System.Windows.Forms.Button btnLoadBinary;
+        private System.Windows.Forms.ProgressBar progressBar;
+        private System.Windows.Forms.Button btnCancel;
+        private System.Windows.Forms.Label label1;
+        private System.Windows.Forms.TextBox txtSearch;
+        private System.Windows.Forms.GroupBox groupBox1;
+        private System.Windows.Forms.GroupBox groupBox2;
+    }
+}
+
+// 6. Designer files for CharacterForm.Designer.cs
+namespace GameCharacterManager
+{
+    partial class CharacterForm
+    {
+        private System.ComponentModel.IContainer components = null;
+
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing && (components != null))
+            {
+                components.Dispose();
+            }
+            base.Dispose(disposing);
+        }
+
+        #region Windows Form Designer generated code
+
+        private void InitializeComponent()
+        {
+            this.label1 = new System.Windows.Forms.Label();
+            this.txtName = new System.Windows.Forms.TextBox();
+            this.label2 = new System.Windows.Forms.Label();
             this.numLevel = new System.Windows.Forms.NumericUpDown();
             this.label3 = new System.Windows.Forms.Label();
             this.numHealth = new System.Windows.Forms.NumericUpDown();
@@ -869,49 +2813,9142 @@ namespace GameCharacterManager
             this.PerformLayout();
         }
 
-        #endregion
+        #endregion
+
+        private System.Windows.Forms.Label label1;
+        private System.Windows.Forms.TextBox txtName;
+        private System.Windows.Forms.Label label2;
+        private System.Windows.Forms.NumericUpDown numLevel;
+        private System.Windows.Forms.Label label3;
+        private System.Windows.Forms.NumericUpDown numHealth;
+        private System.Windows.Forms.Label label4;
+        private System.Windows.Forms.NumericUpDown numMana;
+        private System.Windows.Forms.Label label5;
+        private System.Windows.Forms.ComboBox cmbClass;
+        private System.Windows.Forms.Label label6;
+        private System.Windows.Forms.TextBox txtWeapon;
+        private System.Windows.Forms.Label label7;
+        private System.Windows.Forms.TextBox txtArmor;
+        private System.Windows.Forms.GroupBox groupBox1;
+        private System.Windows.Forms.Button btnRemoveAbility;
+        private System.Windows.Forms.Button btnAddAbility;
+        private System.Windows.Forms.TextBox txtAbility;
+        private System.Windows.Forms.ListBox listBoxAbilities;
+        private System.Windows.Forms.Button btnSave;
+        private System.Windows.Forms.Button btnCancel;
+    }
+}
+
+// 7. Program.cs - Application entry point
+using System;
+using System.Windows.Forms;
+
+namespace GameCharacterManager
+{
+    static class Program
+    {
+        /// <summary>
+        /// The main entry point for the application.
+        /// </summary>
+        [STAThread]
+        static void Main()
+        {
+            Application.EnableVisualStyles();
+            Application.SetCompatibleTextRenderingDefault(false);
+            Application.Run(new MainForm());
+        }
+    }
+}
+
+// 8. CharacterJsonCodec.cs - Streaming JSON reader/writer for character rosters
+using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.CompilerServices;
+using System.Text.Json;
+using System.Threading;
+using System.Threading.Tasks;
+using Microsoft.Win32.SafeHandles;
+
+namespace GameCharacterManager
+{
+    // Writes and reads a roster one character at a time over UTF-8 buffers.
+    // The output is identical to JsonSerializer.Serialize(list) with WriteIndented = true.
+    public static class CharacterJsonCodec
+    {
+        private const int FlushThreshold = 32 * 1024;
+
+        private static readonly JsonWriterOptions WriterOptions = new JsonWriterOptions { Indented = true };
+
+        // Write characters to a stream as an indented JSON array
+        public static void Write(Stream stream, IEnumerable<Character> characters)
+        {
+            Write(stream, characters, null);
+        }
+
+        // Write, recording where every element starts in index when one is given
+        public static void Write(Stream stream, IEnumerable<Character> characters, RosterOffsetIndexWriter index)
+        {
+            using (var writer = new Utf8JsonWriter(stream, WriterOptions))
+            {
+                if (characters == null)
+                {
+                    writer.WriteNullValue();
+                    index?.Complete(0);
+                    return;
+                }
+
+                writer.WriteStartArray();
+                foreach (Character character in characters)
+                {
+                    index?.Add(writer.BytesCommitted + writer.BytesPending);
+                    JsonSerializer.Serialize(writer, character, CharacterJsonContext.Default.Character);
+
+                    // Keep the writer's pending buffer small instead of growing it to the whole roster
+                    if (writer.BytesPending >= FlushThreshold)
+                        writer.Flush();
+                }
+                index?.Complete(writer.BytesCommitted + writer.BytesPending);
+                writer.WriteEndArray();
+            }
+        }
+
+        // Asynchronous Write; progress reports characters written out of the total
+        public static Task WriteAsync(Stream stream, IReadOnlyCollection<Character> characters,
+            IProgress<(long done, long total)> progress = null, CancellationToken cancellationToken = default)
+        {
+            return WriteAsync(stream, characters, null, progress, cancellationToken);
+        }
+
+        public static async Task WriteAsync(Stream stream, IReadOnlyCollection<Character> characters, RosterOffsetIndexWriter index,
+            IProgress<(long done, long total)> progress = null, CancellationToken cancellationToken = default)
+        {
+            // JsonSerializer flushes the writer after every element, so it writes into memory
+            // and whole blocks are copied to the stream asynchronously
+            var buffer = new ArrayBufferWriter<byte>(FlushThreshold * 2);
+            using (var writer = new Utf8JsonWriter(buffer, WriterOptions))
+            {
+                if (characters == null)
+                {
+                    writer.WriteNullValue();
+                    writer.Flush();
+                    await stream.WriteAsync(buffer.WrittenMemory, cancellationToken).ConfigureAwait(false);
+                    index?.Complete(0);
+                    return;
+                }
+
+                long done = 0;
+                writer.WriteStartArray();
+                foreach (Character character in characters)
+                {
+                    index?.Add(writer.BytesCommitted + writer.BytesPending);
+                    JsonSerializer.Serialize(writer, character, CharacterJsonContext.Default.Character);
+                    done++;
+
+                    if (buffer.WrittenCount >= FlushThreshold)
+                    {
+                        await stream.WriteAsync(buffer.WrittenMemory, cancellationToken).ConfigureAwait(false);
+                        buffer.ResetWrittenCount();
+                        progress?.Report((done, characters.Count));
+                    }
+                }
+                index?.Complete(writer.BytesCommitted + writer.BytesPending);
+                writer.WriteEndArray();
+                writer.Flush();
+                await stream.WriteAsync(buffer.WrittenMemory, cancellationToken).ConfigureAwait(false);
+                progress?.Report((done, characters.Count));
+            }
+        }
+
+        // Read characters from a stream holding a JSON array
+        public static IEnumerable<Character> Read(Stream stream)
+        {
+            return Read(stream, null);
+        }
+
+        // Read, renting each character from pool when one is given
+        public static IEnumerable<Character> Read(Stream stream, CharacterPool pool)
+        {
+            using (var reader = new CharacterJsonReader(stream, pool))
+            {
+                while (reader.TryRead(out Character character))
+                    yield return character;
+            }
+        }
+
+        // Scan a roster for where its elements start, without decoding them
+        public static void WriteIndex(Stream stream, RosterOffsetIndexWriter index)
+        {
+            using (var reader = new CharacterJsonReader(stream))
+            {
+                long end = 0;
+                while (reader.TrySkip(out long start))
+                {
+                    index.Add(start);
+                    end = reader.Position;
+                }
+                index.Complete(end);
+            }
+        }
+
+        // Decode one page located through a RosterOffsetIndex: bounds holds the offset of each
+        // record and the end of the last, page the bytes from bounds[0] up to that end
+        public static List<Character> ReadPage(byte[] page, long[] bounds)
+        {
+            var characters = new List<Character>(bounds.Length - 1);
+            for (int i = 0; i + 1 < bounds.Length; i++)
+            {
+                var record = new ReadOnlySpan<byte>(page, (int)(bounds[i] - bounds[0]), (int)(bounds[i + 1] - bounds[i]));
+
+                // A record's bytes begin with the separator written before it, if any
+                int start = record.IndexOfAnyExcept(" \t\r\n,"u8);
+                var reader = new Utf8JsonReader(start >= 0 ? record.Slice(start) : default);
+                if (!reader.Read())
+                    throw new JsonException("The offset index does not match the roster.");
+                characters.Add(JsonSerializer.Deserialize(ref reader, CharacterJsonContext.Default.Character));
+            }
+            return characters;
+        }
+
+        // The Id of each element in order, 0 for one saved without and null for a null element
+        public static IEnumerable<long?> ReadIds(Stream stream)
+        {
+            using (var reader = new CharacterJsonReader(stream))
+            {
+                while (reader.TryReadId(out long? id))
+                    yield return id;
+            }
+        }
+
+        // Read only Id, Name, Level and Class; the other fields are read from details on first use.
+        // stream must start at the same byte as the file details was opened on.
+        public static IEnumerable<Character> ReadHeaders(Stream stream, CharacterDetailSource details)
+        {
+            using (var reader = new CharacterJsonReader(stream, details))
+            {
+                while (reader.TryRead(out Character character))
+                    yield return character;
+            }
+        }
+
+        // Asynchronous Read; the stream is only touched between elements
+        public static IAsyncEnumerable<Character> ReadAsync(Stream stream, CancellationToken cancellationToken = default)
+        {
+            return ReadAsync(new CharacterJsonReader(stream), cancellationToken);
+        }
+
+        public static IAsyncEnumerable<Character> ReadHeadersAsync(Stream stream, CharacterDetailSource details,
+            CancellationToken cancellationToken = default)
+        {
+            return ReadAsync(new CharacterJsonReader(stream, details), cancellationToken);
+        }
+
+        private static async IAsyncEnumerable<Character> ReadAsync(CharacterJsonReader reader, [EnumeratorCancellation] CancellationToken cancellationToken)
+        {
+            using (reader)
+            {
+                while (true)
+                {
+                    if (reader.TryReadBuffered(out Character character))
+                    {
+                        yield return character;
+                        continue;
+                    }
+                    if (reader.IsCompleted)
+                        yield break;
+                    await reader.FillAsync(cancellationToken).ConfigureAwait(false);
+                }
+            }
+        }
+    }
+
+    // Pull reader over a JSON array of characters. Only the bytes of the
+    // current element are kept in the buffer, so memory does not grow with the roster.
+    public sealed class CharacterJsonReader : IDisposable
+    {
+        private const int DefaultBufferSize = 64 * 1024;
+        private const int StringCacheSize = 256;
+        private const int MaxCachedStringBytes = 64;
+
+        private readonly Stream _stream;
+        private readonly CharacterPool _pool;
+        private readonly CharacterDetailSource _details;
+        private readonly string[] _stringCache;
+        private byte[] _buffer;
+        private int _start;
+        private int _end;
+        private long _position;
+        private bool _isFinalBlock;
+        private bool _started;
+        private bool _completed;
+        private JsonReaderState _state;
+
+        public CharacterJsonReader(Stream stream, int bufferSize = DefaultBufferSize)
+            : this(stream, (CharacterPool)null, bufferSize)
+        {
+        }
+
+        // With a pool, characters are rented from it and filled in place instead of allocated
+        public CharacterJsonReader(Stream stream, CharacterPool pool, int bufferSize = DefaultBufferSize)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _buffer = ArrayPool<byte>.Shared.Rent(bufferSize);
+            _pool = pool;
+            if (pool != null)
+                _stringCache = new string[StringCacheSize];
+        }
+
+        // With a detail source, characters carry only their header fields and an offset into the
+        // file for the rest, so abilities and the other strings are never decoded here
+        public CharacterJsonReader(Stream stream, CharacterDetailSource details, int bufferSize = DefaultBufferSize)
+            : this(stream, (CharacterPool)null, bufferSize)
+        {
+            _details = details ?? throw new ArgumentNullException(nameof(details));
+        }
+
+        public bool IsCompleted => _completed;
+
+        // Read the next character, pulling more bytes from the stream when needed
+        public bool TryRead(out Character character)
+        {
+            while (!TryReadBuffered(out character))
+            {
+                if (_completed)
+                    return false;
+                Fill();
+            }
+            return true;
+        }
+
+        // Decode the next character from bytes already in the buffer.
+        // Returns false when the array has ended or more data is needed.
+        public bool TryReadBuffered(out Character character)
+        {
+            character = null;
+            if (!TryStartElement(out Utf8JsonReader reader))
+                return false;
+
+            if (_details != null)
+            {
+                long offset = _position + reader.TokenStartIndex;
+                if (!TryReadHeader(ref reader, out character))
+                    return false;
+                if (character != null)
+                    _details.Defer(character, offset, (int)(_position + reader.BytesConsumed - offset));
+                Commit(ref reader);
+                return true;
+            }
+
+            // Make sure the whole element is buffered before handing it to the serializer
+            Utf8JsonReader lookahead = reader;
+            if (!lookahead.TrySkip())
+                return false;
+
+            character = _pool != null
+                ? ReadPooled(ref reader)
+                : JsonSerializer.Deserialize(ref reader, CharacterJsonContext.Default.Character);
+            Commit(ref reader);
+            return true;
+        }
+
+        // Offset in the stream of the next unread byte
+        public long Position => _position;
+
+        // Step over the next element without decoding it; start is where it begins in the stream.
+        // Used to build offset indexes.
+        public bool TrySkip(out long start)
+        {
+            while (!TrySkipBuffered(out start))
+            {
+                if (_completed)
+                    return false;
+                Fill();
+            }
+            return true;
+        }
+
+        // Step over the next element, decoding only its Id; null for a null element
+        public bool TryReadId(out long? id)
+        {
+            while (!TryReadIdBuffered(out id))
+            {
+                if (_completed)
+                    return false;
+                Fill();
+            }
+            return true;
+        }
+
+        private bool TryReadIdBuffered(out long? id)
+        {
+            id = null;
+            if (!TryStartElement(out Utf8JsonReader reader))
+                return false;
+            if (reader.TokenType != JsonTokenType.Null && reader.TokenType != JsonTokenType.StartObject)
+                throw new JsonException("Expected a JSON object for Character.");
+
+            if (reader.TokenType == JsonTokenType.StartObject)
+            {
+                long value = 0;
+                try
+                {
+                    while (true)
+                    {
+                        if (!reader.Read())
+                            return false;
+                        if (reader.TokenType == JsonTokenType.EndObject)
+                            break;
+
+                        bool isId = reader.ValueTextEquals("Id"u8);
+                        if (!reader.Read())
+                            return false;
+                        if (isId)
+                            value = reader.GetInt64();
+                        else if (!reader.TrySkip())
+                            return false;
+                    }
+                }
+                catch (Exception e) when (e is InvalidOperationException || e is FormatException)
+                {
+                    throw new JsonException(e.Message, e);
+                }
+                id = value;
+            }
+            Commit(ref reader);
+            return true;
+        }
+
+        private bool TrySkipBuffered(out long start)
+        {
+            start = -1;
+            if (!TryStartElement(out Utf8JsonReader reader))
+                return false;
+
+            start = _position + reader.TokenStartIndex;
+            if (!reader.TrySkip())
+                return false;
+            Commit(ref reader);
+            return true;
+        }
+
+        // Put reader on the first token of the next element, consuming the array start on the way.
+        // Returns false when the array has ended or more data is needed.
+        private bool TryStartElement(out Utf8JsonReader reader)
+        {
+            reader = default;
+            while (!_completed)
+            {
+                if (!_started && !SkipByteOrderMark())
+                    return false;
+
+                reader = new Utf8JsonReader(new ReadOnlySpan<byte>(_buffer, _start, _end - _start), _isFinalBlock, _state);
+                if (!reader.Read())
+                    return false;
+
+                if (!_started)
+                {
+                    if (reader.TokenType == JsonTokenType.Null)
+                        _completed = true;
+                    else if (reader.TokenType != JsonTokenType.StartArray)
+                        throw new JsonException("Expected a JSON array of characters.");
+                    _started = true;
+                    Commit(ref reader);
+                    continue;
+                }
+
+                if (reader.TokenType == JsonTokenType.EndArray)
+                {
+                    _completed = true;
+                    Commit(ref reader);
+                    return false;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        // Pull the next block of bytes from the stream
+        public void Fill()
+        {
+            PrepareBuffer();
+            int read = _stream.Read(_buffer, _end, _buffer.Length - _end);
+            if (read == 0)
+                _isFinalBlock = true;
+            _end += read;
+        }
+
+        public async ValueTask FillAsync(CancellationToken cancellationToken = default)
+        {
+            PrepareBuffer();
+            int read = await _stream.ReadAsync(_buffer.AsMemory(_end, _buffer.Length - _end), cancellationToken).ConfigureAwait(false);
+            if (read == 0)
+                _isFinalBlock = true;
+            _end += read;
+        }
+
+        public void Dispose()
+        {
+            if (_buffer != null)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = null;
+            }
+        }
+
+        // Decode one element into a rented character, following the generated contract:
+        // case-sensitive names, unknown properties skipped, missing ones left at their defaults
+        private Character ReadPooled(ref Utf8JsonReader reader)
+        {
+            if (reader.TokenType == JsonTokenType.Null)
+                return null;
+            if (reader.TokenType != JsonTokenType.StartObject)
+                throw new JsonException("Expected a JSON object for Character.");
+
+            Character character = _pool.Rent();
+            try
+            {
+                while (reader.Read() && reader.TokenType == JsonTokenType.PropertyName)
+                {
+                    if (reader.ValueTextEquals("Id"u8))
+                    {
+                        reader.Read();
+                        character.Id = reader.GetInt64();
+                    }
+                    else if (reader.ValueTextEquals("Name"u8))
+                    {
+                        reader.Read();
+                        character.Name = reader.GetString();
+                    }
+                    else if (reader.ValueTextEquals("Level"u8))
+                    {
+                        reader.Read();
+                        character.Level = reader.GetInt32();
+                    }
+                    else if (reader.ValueTextEquals("Health"u8))
+                    {
+                        reader.Read();
+                        character.Health = reader.GetInt32();
+                    }
+                    else if (reader.ValueTextEquals("Mana"u8))
+                    {
+                        reader.Read();
+                        character.Mana = reader.GetInt32();
+                    }
+                    else if (reader.ValueTextEquals("Abilities"u8))
+                    {
+                        reader.Read();
+                        ReadAbilities(ref reader, character);
+                    }
+                    else if (reader.ValueTextEquals("WeaponType"u8))
+                    {
+                        reader.Read();
+                        character.WeaponType = ReadCachedString(ref reader);
+                    }
+                    else if (reader.ValueTextEquals("Class"u8))
+                    {
+                        reader.Read();
+                        character.Class = (CharacterClass)reader.GetInt32();
+                    }
+                    else if (reader.ValueTextEquals("ArmorType"u8))
+                    {
+                        reader.Read();
+                        character.ArmorType = ReadCachedString(ref reader);
+                    }
+                    else
+                    {
+                        // The whole element is buffered, so this cannot run out of data
+                        reader.Read();
+                        reader.TrySkip();
+                    }
+                }
+            }
+            catch (Exception e) when (e is InvalidOperationException || e is FormatException)
+            {
+                // Wrong token types surface as JsonException, as they do from the serializer
+                throw new JsonException(e.Message, e);
+            }
+            return character;
+        }
+
+        // Decode the header fields and skip the rest without a lookahead pass over the element.
+        // Returns false when the element is not fully buffered yet; nothing is committed then.
+        private bool TryReadHeader(ref Utf8JsonReader reader, out Character character)
+        {
+            character = null;
+            if (reader.TokenType == JsonTokenType.Null)
+                return true;
+            if (reader.TokenType != JsonTokenType.StartObject)
+                throw new JsonException("Expected a JSON object for Character.");
+
+            // Missing properties keep the defaults of a new Character
+            long id = 0;
+            string name = "New Character";
+            int level = 1;
+            CharacterClass characterClass = CharacterClass.Warrior;
+            try
+            {
+                while (true)
+                {
+                    if (!reader.Read())
+                        return false;
+                    if (reader.TokenType == JsonTokenType.EndObject)
+                        break;
+
+                    if (reader.ValueTextEquals("Id"u8))
+                    {
+                        if (!reader.Read())
+                            return false;
+                        id = reader.GetInt64();
+                    }
+                    else if (reader.ValueTextEquals("Name"u8))
+                    {
+                        if (!reader.Read())
+                            return false;
+                        name = reader.GetString();
+                    }
+                    else if (reader.ValueTextEquals("Level"u8))
+                    {
+                        if (!reader.Read())
+                            return false;
+                        level = reader.GetInt32();
+                    }
+                    else if (reader.ValueTextEquals("Class"u8))
+                    {
+                        if (!reader.Read())
+                            return false;
+                        characterClass = (CharacterClass)reader.GetInt32();
+                    }
+                    else if (!reader.Read() || !reader.TrySkip())
+                    {
+                        return false;
+                    }
+                }
+            }
+            catch (Exception e) when (e is InvalidOperationException || e is FormatException)
+            {
+                throw new JsonException(e.Message, e);
+            }
+
+            character = new Character(id, name, level, characterClass);
+            return true;
+        }
+
+        private void ReadAbilities(ref Utf8JsonReader reader, Character character)
+        {
+            if (reader.TokenType == JsonTokenType.Null)
+            {
+                character.Abilities = null;
+                return;
+            }
+            if (reader.TokenType != JsonTokenType.StartArray)
+                throw new JsonException("Expected a JSON array for Abilities.");
+
+            AbilityList abilities = character.AbilityList ??= new AbilityList();
+            abilities.Clear();
+            while (reader.Read() && reader.TokenType != JsonTokenType.EndArray)
+                abilities.Add(ReadCachedString(ref reader));
+        }
+
+        // Ability, weapon and armor names repeat across a roster, so short values are looked up
+        // in a small direct-mapped cache by their UTF-8 bytes before allocating a new string
+        private string ReadCachedString(ref Utf8JsonReader reader)
+        {
+            if (reader.TokenType != JsonTokenType.String || reader.ValueIsEscaped || reader.ValueSpan.Length > MaxCachedStringBytes)
+                return reader.GetString();
+
+            uint hash = 2166136261;
+            foreach (byte b in reader.ValueSpan)
+                hash = (hash ^ b) * 16777619;
+
+            int slot = (int)(hash % StringCacheSize);
+            string cached = _stringCache[slot];
+            if (cached != null && reader.ValueTextEquals(cached))
+                return cached;
+
+            cached = reader.GetString();
+            _stringCache[slot] = cached;
+            return cached;
+        }
+
+        private void Commit(ref Utf8JsonReader reader)
+        {
+            _start += (int)reader.BytesConsumed;
+            _position += reader.BytesConsumed;
+            _state = reader.CurrentState;
+        }
+
+        // File.ReadAllText accepted a UTF-8 BOM, Utf8JsonReader does not
+        private bool SkipByteOrderMark()
+        {
+            int available = _end - _start;
+            if (available < 3 && !_isFinalBlock)
+                return false;
+            if (available >= 3 && _buffer[_start] == 0xEF && _buffer[_start + 1] == 0xBB && _buffer[_start + 2] == 0xBF)
+            {
+                _start += 3;
+                _position += 3;
+            }
+            return true;
+        }
+
+        // Move unread bytes to the front and grow the buffer if one element does not fit
+        private void PrepareBuffer()
+        {
+            if (_start > 0)
+            {
+                Buffer.BlockCopy(_buffer, _start, _buffer, 0, _end - _start);
+                _end -= _start;
+                _start = 0;
+            }
+
+            if (_end == _buffer.Length)
+            {
+                byte[] larger = ArrayPool<byte>.Shared.Rent(_buffer.Length * 2);
+                Buffer.BlockCopy(_buffer, 0, larger, 0, _end);
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = larger;
+            }
+        }
+    }
+
+    // Read handle on a JSON roster for characters loaded by ReadHeaders. It shares delete access,
+    // so a save that moves a new snapshot over the file leaves this view of the old one readable.
+    // The handle closes once the last deferred character has loaded.
+    public sealed class CharacterDetailSource : IDisposable
+    {
+        private readonly SafeFileHandle _file;
+        private readonly string _path;
+        private int _pending;
+
+        private CharacterDetailSource(SafeFileHandle file, string path)
+        {
+            _file = file;
+            _path = path;
+        }
+
+        public static CharacterDetailSource Open(string path)
+        {
+            return new CharacterDetailSource(File.OpenHandle(path, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete), path);
+        }
+
+        // Characters whose details have not been read yet
+        public int Pending => Volatile.Read(ref _pending);
+
+        public void Dispose()
+        {
+            _file.Dispose();
+        }
+
+        internal void Defer(Character character, long offset, int length)
+        {
+            character.DeferDetails(this, offset, length);
+            Interlocked.Increment(ref _pending);
+        }
+
+        // Decode the element at offset; reads are positional, so characters may load from any thread
+        internal Character Read(long offset, int length)
+        {
+            byte[] buffer = ArrayPool<byte>.Shared.Rent(length);
+            Character details;
+            try
+            {
+                for (int read = 0; read < length; )
+                {
+                    int count = RandomAccess.Read(_file, buffer.AsSpan(read, length - read), offset + read);
+                    if (count == 0)
+                        throw new EndOfStreamException("The roster file ended inside a character.");
+                    read += count;
+                }
+                RosterMetrics.Read(_path, length);
+
+                var reader = new Utf8JsonReader(new ReadOnlySpan<byte>(buffer, 0, length));
+                reader.Read();
+                details = JsonSerializer.Deserialize(ref reader, CharacterJsonContext.Default.Character)
+                    ?? throw new JsonException("Expected a JSON object for Character.");
+            }
+            finally
+            {
+                ArrayPool<byte>.Shared.Return(buffer);
+            }
+
+            Release();
+            return details;
+        }
+
+        // A deferred character loaded or went back to a pool
+        internal void Release()
+        {
+            if (Interlocked.Decrement(ref _pending) == 0)
+                Dispose();
+        }
+    }
+}
+
+// 9. CharacterJsonContext.cs - Compile-time JSON metadata for characters
+using System.Collections.Generic;
+using System.Text.Json.Serialization;
+
+namespace GameCharacterManager
+{
+    // Source-generated serialization metadata, created once and shared by every JSON code path
+    [JsonSourceGenerationOptions(WriteIndented = true)]
+    [JsonSerializable(typeof(List<Character>))]
+    [JsonSerializable(typeof(Character))]
+    [JsonSerializable(typeof(CharacterClass))]
+    [JsonSerializable(typeof(RosterManifest))]
+    internal partial class CharacterJsonContext : JsonSerializerContext
+    {
+    }
+}
+
+// 10. CharacterXmlCodec.cs - Streaming XML reader/writer for character rosters
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Xml;
+
+namespace GameCharacterManager
+{
+    // Forward-only codec for the ArrayOfCharacter schema XmlSerializer uses for List<Character>.
+    // The output matches XmlSerializer's byte for byte, so files written by either side are interchangeable.
+    // UTF-8 documents are decoded by CharacterXmlReader; other encodings fall back to XmlReader.
+    public static class CharacterXmlCodec
+    {
+        internal const string XsiNamespace = "http://www.w3.org/2001/XMLSchema-instance";
+        internal const string XsdNamespace = "http://www.w3.org/2001/XMLSchema";
+
+        // Write characters to a stream as an ArrayOfCharacter document
+        public static void Write(Stream stream, IEnumerable<Character> characters)
+        {
+            Write(stream, characters, null);
+        }
+
+        // Write, recording where every element starts in index when one is given
+        public static void Write(Stream stream, IEnumerable<Character> characters, RosterOffsetIndexWriter index)
+        {
+            using (var writer = new CharacterXmlWriter(stream))
+            {
+                writer.WriteStartDocument(characters == null);
+                if (characters != null)
+                {
+                    foreach (Character character in characters)
+                    {
+                        index?.Add(writer.Position);
+                        writer.WriteCharacter(character);
+                    }
+                }
+                index?.Complete(writer.Position);
+                writer.WriteEndDocument();
+            }
+        }
+
+        // Asynchronous Write; progress reports characters written out of the total
+        public static Task WriteAsync(Stream stream, IReadOnlyCollection<Character> characters,
+            IProgress<(long done, long total)> progress = null, CancellationToken cancellationToken = default)
+        {
+            return WriteAsync(stream, characters, null, progress, cancellationToken);
+        }
+
+        public static async Task WriteAsync(Stream stream, IReadOnlyCollection<Character> characters, RosterOffsetIndexWriter index,
+            IProgress<(long done, long total)> progress = null, CancellationToken cancellationToken = default)
+        {
+            using (var writer = new CharacterXmlWriter(stream))
+            {
+                long done = 0;
+                writer.WriteStartDocument(characters == null);
+                if (characters != null)
+                {
+                    foreach (Character character in characters)
+                    {
+                        index?.Add(writer.Position);
+                        writer.WriteCharacter(character);
+                        done++;
+
+                        if (writer.BufferedBytes >= CharacterXmlWriter.FlushThreshold)
+                        {
+                            await writer.FlushAsync(cancellationToken).ConfigureAwait(false);
+                            progress?.Report((done, characters.Count));
+                        }
+                    }
+                }
+                index?.Complete(writer.Position);
+                writer.WriteEndDocument(false);
+                await writer.FlushAsync(cancellationToken).ConfigureAwait(false);
+                progress?.Report((done, characters?.Count ?? 0));
+            }
+        }
+
+        // Read characters from an ArrayOfCharacter document, one element at a time
+        public static IEnumerable<Character> Read(Stream stream)
+        {
+            return Read(stream, null);
+        }
+
+        // Read, renting each character from pool when one is given. Non UTF-8 documents
+        // take the XmlReader fallback, which always allocates.
+        public static IEnumerable<Character> Read(Stream stream, CharacterPool pool)
+        {
+            long start = stream.CanSeek ? stream.Position : -1;
+            using (var reader = new CharacterXmlReader(stream, pool))
+            {
+                if (reader.IsUtf8)
+                {
+                    while (reader.TryRead(out Character character))
+                        yield return character;
+                    yield break;
+                }
+            }
+
+            if (start < 0)
+                throw new NotSupportedException("Only UTF-8 XML can be read from a non-seekable stream.");
+
+            stream.Position = start;
+            foreach (Character character in ReadWithXmlReader(stream))
+                yield return character;
+        }
+
+        // Scan a UTF-8 document for where its Character elements start, without decoding them.
+        // Returns false for other encodings, which are only read front to back.
+        public static bool WriteIndex(Stream stream, RosterOffsetIndexWriter index)
+        {
+            using (var reader = new CharacterXmlReader(stream))
+            {
+                if (!reader.IsUtf8)
+                    return false;
+
+                long end = 0;
+                while (reader.TrySkip(out long start))
+                {
+                    index.Add(start);
+                    end = reader.Position;
+                }
+                index.Complete(end);
+                return true;
+            }
+        }
+
+        // Decode one page located through a RosterOffsetIndex, as CharacterJsonCodec.ReadPage
+        public static List<Character> ReadPage(byte[] page, long[] bounds)
+        {
+            int count = bounds.Length - 1;
+            var characters = new List<Character>(count);
+            using (var stream = new MemoryStream(page, 0, (int)(bounds[count] - bounds[0]), false))
+            using (var reader = new CharacterXmlReader(stream, null, true))
+            {
+                while (characters.Count < count && reader.TryRead(out Character character))
+                    characters.Add(character);
+            }
+            if (characters.Count != count)
+                throw new XmlException("The offset index does not match the roster.");
+            return characters;
+        }
+
+        private static IEnumerable<Character> ReadWithXmlReader(Stream stream)
+        {
+            var names = new ElementNames(new NameTable());
+            var settings = new XmlReaderSettings
+            {
+                NameTable = names.Table,
+                IgnoreWhitespace = true,
+                IgnoreComments = true,
+                IgnoreProcessingInstructions = true
+            };
+
+            using (XmlReader reader = XmlReader.Create(stream, settings))
+            {
+                if (reader.MoveToContent() != XmlNodeType.Element || reader.IsEmptyElement)
+                    yield break;
+
+                if (reader.LocalName != "ArrayOfCharacter")
+                    throw new XmlException("Expected an ArrayOfCharacter root element.");
+
+                reader.ReadStartElement();
+                while (reader.MoveToContent() == XmlNodeType.Element)
+                {
+                    if ((object)reader.LocalName == (object)names.Character)
+                        yield return ReadCharacter(reader, names);
+                    else
+                        reader.Skip();
+                }
+            }
+        }
+
+        private static Character ReadCharacter(XmlReader reader, ElementNames names)
+        {
+            if (IsNil(reader))
+            {
+                reader.Skip();
+                return null;
+            }
+
+            var character = new Character();
+            if (reader.IsEmptyElement)
+            {
+                reader.Read();
+                return character;
+            }
+
+            reader.ReadStartElement();
+            while (reader.MoveToContent() == XmlNodeType.Element)
+            {
+                object name = reader.LocalName;
+                if (name == (object)names.Id)
+                    character.Id = reader.ReadElementContentAsLong();
+                else if (name == (object)names.Name)
+                    character.Name = reader.ReadElementContentAsString();
+                else if (name == (object)names.Level)
+                    character.Level = reader.ReadElementContentAsInt();
+                else if (name == (object)names.Health)
+                    character.Health = reader.ReadElementContentAsInt();
+                else if (name == (object)names.Mana)
+                    character.Mana = reader.ReadElementContentAsInt();
+                else if (name == (object)names.Abilities)
+                    ReadAbilities(reader, names, character.AbilityList);
+                else if (name == (object)names.WeaponType)
+                    character.WeaponType = reader.ReadElementContentAsString();
+                else if (name == (object)names.Class)
+                    character.Class = Enum.Parse<CharacterClass>(reader.ReadElementContentAsString());
+                else if (name == (object)names.ArmorType)
+                    character.ArmorType = reader.ReadElementContentAsString();
+                else
+                    reader.Skip();
+            }
+            reader.ReadEndElement();
+            return character;
+        }
+
+        private static void ReadAbilities(XmlReader reader, ElementNames names, AbilityList abilities)
+        {
+            if (reader.IsEmptyElement)
+            {
+                reader.Read();
+                return;
+            }
+
+            reader.ReadStartElement();
+            while (reader.MoveToContent() == XmlNodeType.Element)
+            {
+                if ((object)reader.LocalName != (object)names.Ability)
+                    reader.Skip();
+                else if (IsNil(reader))
+                {
+                    abilities.Add(null);
+                    reader.Skip();
+                }
+                else
+                    abilities.Add(reader.ReadElementContentAsString());
+            }
+            reader.ReadEndElement();
+        }
+
+        private static bool IsNil(XmlReader reader)
+        {
+            return reader.GetAttribute("nil", XsiNamespace) == "true";
+        }
+
+        // Element names atomized once per document so matching is a reference comparison
+        private sealed class ElementNames
+        {
+            public readonly NameTable Table;
+            public readonly string Character;
+            public readonly string Id;
+            public readonly string Name;
+            public readonly string Level;
+            public readonly string Health;
+            public readonly string Mana;
+            public readonly string Abilities;
+            public readonly string Ability;
+            public readonly string WeaponType;
+            public readonly string Class;
+            public readonly string ArmorType;
+
+            public ElementNames(NameTable table)
+            {
+                Table = table;
+                Character = table.Add("Character");
+                Id = table.Add("Id");
+                Name = table.Add("Name");
+                Level = table.Add("Level");
+                Health = table.Add("Health");
+                Mana = table.Add("Mana");
+                Abilities = table.Add("Abilities");
+                Ability = table.Add("string");
+                WeaponType = table.Add("WeaponType");
+                Class = table.Add("Class");
+                ArmorType = table.Add("ArmorType");
+            }
+        }
+    }
+}
+
+// 11. CharacterXmlWriter.cs - UTF-8 writer producing XmlSerializer's layout
+using System;
+using System.Buffers;
+using System.Buffers.Text;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace GameCharacterManager
+{
+    // Emits the same bytes as XmlSerializer (indented, NewLineHandling.Replace) straight
+    // into a pooled UTF-8 buffer, without going through XmlWriter's state machine.
+    internal sealed class CharacterXmlWriter : IDisposable
+    {
+        private const int BufferSize = 64 * 1024;
+
+        // Async callers flush between characters once this much is buffered
+        public const int FlushThreshold = 32 * 1024;
+
+        private static readonly UTF8Encoding Utf8 = new UTF8Encoding(false, true);
+        private static readonly byte[] NewLine = Utf8.GetBytes(Environment.NewLine);
+        private static readonly byte[] Declaration = Utf8.GetBytes("<?xml version=\"1.0\" encoding=\"utf-8\"?>");
+        private static readonly byte[] RootStart = Utf8.GetBytes(
+            "<ArrayOfCharacter xmlns:xsi=\"" + CharacterXmlCodec.XsiNamespace + "\" xmlns:xsd=\"" + CharacterXmlCodec.XsdNamespace + "\"");
+        private static readonly byte[] RootEnd = Utf8.GetBytes("</ArrayOfCharacter>");
+        private static readonly byte[] NilAttribute = Utf8.GetBytes(" xsi:nil=\"true\"");
+        private static readonly byte[] EmptyTagEnd = Utf8.GetBytes(" />");
+        private static readonly byte[] NilCharacter = Utf8.GetBytes(Environment.NewLine + "  <Character xsi:nil=\"true\" />");
+        private static readonly byte[] NilAbility = Utf8.GetBytes(Environment.NewLine + "      <string xsi:nil=\"true\" />");
+        private static readonly byte[] LessThan = Utf8.GetBytes("&lt;");
+        private static readonly byte[] GreaterThan = Utf8.GetBytes("&gt;");
+        private static readonly byte[] Ampersand = Utf8.GetBytes("&amp;");
+
+        private static readonly Element CharacterElement = new Element("Character", 2);
+        private static readonly Element IdElement = new Element("Id", 4);
+        private static readonly Element NameElement = new Element("Name", 4);
+        private static readonly Element LevelElement = new Element("Level", 4);
+        private static readonly Element HealthElement = new Element("Health", 4);
+        private static readonly Element ManaElement = new Element("Mana", 4);
+        private static readonly Element AbilitiesElement = new Element("Abilities", 4);
+        private static readonly Element AbilityElement = new Element("string", 6);
+        private static readonly Element WeaponTypeElement = new Element("WeaponType", 4);
+        private static readonly Element ClassElement = new Element("Class", 4);
+        private static readonly Element ArmorTypeElement = new Element("ArmorType", 4);
+        private static readonly byte[][] ClassNames = CreateClassNames();
+
+        // Characters WriteText has to escape, replace or reject
+        private static readonly SearchValues<char> SpecialChars = SearchValues.Create(
+            "\0\u0001\u0002\u0003\u0004\u0005\u0006\u0007\b\t\n\u000B\f\r\u000E\u000F" +
+            "\u0010\u0011\u0012\u0013\u0014\u0015\u0016\u0017\u0018\u0019\u001A\u001B\u001C\u001D\u001E\u001F" +
+            "<>&\uFFFE\uFFFF");
+
+        private readonly Stream _stream;
+        private byte[] _buffer;
+        private int _length;
+        private long _flushed;
+        private bool _hasCharacters;
+
+        // Encoded <string> element for each AbilityPool id seen so far
+        private byte[][] _abilityElements = new byte[16][];
+
+        public CharacterXmlWriter(Stream stream)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _buffer = ArrayPool<byte>.Shared.Rent(BufferSize);
+        }
+
+        public void WriteStartDocument(bool nil)
+        {
+            WriteRaw(Declaration);
+            WriteRaw(NewLine);
+            WriteRaw(RootStart);
+            if (nil)
+                WriteRaw(NilAttribute);
+        }
+
+        public void WriteCharacter(Character character)
+        {
+            if (!_hasCharacters)
+            {
+                WriteRaw((byte)'>');
+                _hasCharacters = true;
+            }
+
+            if (character == null)
+            {
+                WriteRaw(NilCharacter);
+                return;
+            }
+
+            WriteRaw(CharacterElement.Open);
+            WriteIntElement(IdElement, character.Id);
+            WriteStringElement(NameElement, character.Name);
+            WriteIntElement(LevelElement, character.Level);
+            WriteIntElement(HealthElement, character.Health);
+            WriteIntElement(ManaElement, character.Mana);
+            WriteAbilities(character.AbilityList);
+            WriteStringElement(WeaponTypeElement, character.WeaponType);
+            WriteClassElement(character.Class);
+            WriteStringElement(ArmorTypeElement, character.ArmorType);
+            WriteRaw(CharacterElement.Close);
+        }
+
+        public void WriteEndDocument(bool flush = true)
+        {
+            if (_hasCharacters)
+            {
+                WriteRaw(NewLine);
+                WriteRaw(RootEnd);
+            }
+            else
+            {
+                WriteRaw(EmptyTagEnd);
+            }
+            if (flush)
+                Flush();
+        }
+
+        public int BufferedBytes => _length;
+
+        // Bytes written so far, flushed or not
+        public long Position => _flushed + _length;
+
+        public void Flush()
+        {
+            if (_length > 0)
+            {
+                _stream.Write(_buffer, 0, _length);
+                _flushed += _length;
+                _length = 0;
+            }
+        }
+
+        public async ValueTask FlushAsync(CancellationToken cancellationToken = default)
+        {
+            if (_length > 0)
+            {
+                await _stream.WriteAsync(_buffer.AsMemory(0, _length), cancellationToken).ConfigureAwait(false);
+                _flushed += _length;
+                _length = 0;
+            }
+        }
+
+        public void Dispose()
+        {
+            if (_buffer != null)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = null;
+            }
+        }
+
+        private void WriteAbilities(AbilityList abilities)
+        {
+            if (abilities == null)
+                return;
+
+            if (abilities.Count == 0)
+            {
+                WriteRaw(AbilitiesElement.Empty);
+                return;
+            }
+
+            WriteRaw(AbilitiesElement.Open);
+            foreach (int id in abilities.Ids)
+                WriteRaw(AbilityElementFor(id));
+            WriteRaw(AbilitiesElement.Close);
+        }
+
+        // Abilities are pool ids, so each distinct one is escaped and encoded once per document
+        private byte[] AbilityElementFor(int id)
+        {
+            if (id == 0)
+                return NilAbility;
+            if (id >= _abilityElements.Length)
+                Array.Resize(ref _abilityElements, Math.Max(_abilityElements.Length * 2, id + 1));
+
+            byte[] element = _abilityElements[id];
+            if (element == null)
+            {
+                using (var stream = new MemoryStream())
+                {
+                    using (var writer = new CharacterXmlWriter(stream))
+                    {
+                        writer.WriteStringElement(AbilityElement, AbilityPool.GetName(id));
+                        writer.Flush();
+                    }
+                    element = _abilityElements[id] = stream.ToArray();
+                }
+            }
+            return element;
+        }
+
+        // XmlSerializer skips null strings and writes empty ones as self-closing tags
+        private void WriteStringElement(Element element, string value)
+        {
+            if (value == null)
+                return;
+
+            if (value.Length == 0)
+            {
+                WriteRaw(element.Empty);
+                return;
+            }
+
+            WriteRaw(element.Open);
+            WriteText(value);
+            WriteRaw(element.CloseTag);
+        }
+
+        private void WriteIntElement(Element element, long value)
+        {
+            WriteRaw(element.Open);
+            EnsureCapacity(20);
+            Utf8Formatter.TryFormat(value, new Span<byte>(_buffer, _length, _buffer.Length - _length), out int written);
+            _length += written;
+            WriteRaw(element.CloseTag);
+        }
+
+        private void WriteClassElement(CharacterClass value)
+        {
+            int index = (int)value;
+            if (index >= 0 && index < ClassNames.Length && ClassNames[index] != null)
+            {
+                WriteRaw(ClassElement.Open);
+                WriteRaw(ClassNames[index]);
+                WriteRaw(ClassElement.CloseTag);
+            }
+            else
+            {
+                WriteStringElement(ClassElement, value.ToString());
+            }
+        }
+
+        // Escape text content the way XmlWriter does with NewLineHandling.Replace
+        private void WriteText(string value)
+        {
+            int runStart = 0;
+            for (int i = NextSpecial(value, 0); i >= 0; i = NextSpecial(value, i + 1))
+            {
+                char c = value[i];
+                WriteChars(value, runStart, i - runStart);
+                runStart = i + 1;
+                switch (c)
+                {
+                    case '<':
+                        WriteRaw(LessThan);
+                        break;
+                    case '>':
+                        WriteRaw(GreaterThan);
+                        break;
+                    case '&':
+                        WriteRaw(Ampersand);
+                        break;
+                    case '\t':
+                        WriteRaw((byte)'\t');
+                        break;
+                    case '\r':
+                        if (i + 1 < value.Length && value[i + 1] == '\n')
+                        {
+                            i++;
+                            runStart++;
+                        }
+                        WriteRaw(NewLine);
+                        break;
+                    case '\n':
+                        WriteRaw(NewLine);
+                        break;
+                    default:
+                        throw new ArgumentException($"'{c}', hexadecimal value 0x{(int)c:X2}, is an invalid character.");
+                }
+            }
+            WriteChars(value, runStart, value.Length - runStart);
+        }
+
+        private static int NextSpecial(string value, int start)
+        {
+            int found = value.AsSpan(start).IndexOfAny(SpecialChars);
+            return found < 0 ? -1 : start + found;
+        }
+
+        private void WriteChars(string value, int start, int count)
+        {
+            if (count == 0)
+                return;
+
+            EnsureCapacity(Utf8.GetMaxByteCount(count));
+            _length += Utf8.GetBytes(value, start, count, _buffer, _length);
+        }
+
+        private void WriteRaw(byte value)
+        {
+            EnsureCapacity(1);
+            _buffer[_length++] = value;
+        }
+
+        private void WriteRaw(byte[] bytes)
+        {
+            EnsureCapacity(bytes.Length);
+            Buffer.BlockCopy(bytes, 0, _buffer, _length, bytes.Length);
+            _length += bytes.Length;
+        }
+
+        private void EnsureCapacity(int count)
+        {
+            if (_buffer.Length - _length >= count)
+                return;
+
+            Flush();
+            if (_buffer.Length < count)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = ArrayPool<byte>.Shared.Rent(count);
+            }
+        }
+
+        private static byte[][] CreateClassNames()
+        {
+            var values = (CharacterClass[])Enum.GetValues(typeof(CharacterClass));
+            int max = 0;
+            foreach (CharacterClass value in values)
+                max = Math.Max(max, (int)value);
+
+            var names = new byte[max + 1][];
+            foreach (CharacterClass value in values)
+            {
+                if ((int)value >= 0)
+                    names[(int)value] = Utf8.GetBytes(value.ToString());
+            }
+            return names;
+        }
+
+        // Pre-encoded tags for one element at a fixed indentation depth. Every tag but
+        // CloseTag starts on its own line, so it carries the line break before it.
+        private sealed class Element
+        {
+            public readonly byte[] Open;
+            public readonly byte[] Close;
+            public readonly byte[] CloseTag;
+            public readonly byte[] Empty;
+
+            public Element(string name, int indent)
+            {
+                string padding = Environment.NewLine + new string(' ', indent);
+                Open = Utf8.GetBytes(padding + "<" + name + ">");
+                Close = Utf8.GetBytes(padding + "</" + name + ">");
+                CloseTag = Utf8.GetBytes("</" + name + ">");
+                Empty = Utf8.GetBytes(padding + "<" + name + " />");
+            }
+        }
+    }
+}
+
+// 12. CharacterXmlReader.cs - UTF-8 scanner for the ArrayOfCharacter schema
+using System;
+using System.Buffers;
+using System.Buffers.Text;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Xml;
+
+namespace GameCharacterManager
+{
+    // Forward-only scanner over UTF-8 bytes. It understands exactly what the roster
+    // schema needs: elements, xsi:nil, entity and character references, CDATA,
+    // comments and processing instructions. Text is decoded into a reused buffer.
+    internal sealed class CharacterXmlReader : IDisposable
+    {
+        private const int BufferSize = 64 * 1024;
+        private const int StringCacheSize = 256;
+        private const int MaxCachedStringBytes = 64;
+
+        private static readonly UTF8Encoding Utf8 = new UTF8Encoding(false, true);
+        private static readonly byte[] RootTag = Utf8.GetBytes("ArrayOfCharacter");
+        private static readonly byte[] CharacterTag = Utf8.GetBytes("Character");
+        private static readonly byte[] IdTag = Utf8.GetBytes("Id");
+        private static readonly byte[] NameTag = Utf8.GetBytes("Name");
+        private static readonly byte[] LevelTag = Utf8.GetBytes("Level");
+        private static readonly byte[] HealthTag = Utf8.GetBytes("Health");
+        private static readonly byte[] ManaTag = Utf8.GetBytes("Mana");
+        private static readonly byte[] AbilitiesTag = Utf8.GetBytes("Abilities");
+        private static readonly byte[] AbilityTag = Utf8.GetBytes("string");
+        private static readonly byte[] WeaponTypeTag = Utf8.GetBytes("WeaponType");
+        private static readonly byte[] ClassTag = Utf8.GetBytes("Class");
+        private static readonly byte[] ArmorTypeTag = Utf8.GetBytes("ArmorType");
+        private static readonly byte[] NilAttribute = Utf8.GetBytes("nil");
+        private static readonly KeyValuePair<byte[], CharacterClass>[] ClassNames = CreateClassNames();
+        private static readonly byte[] XmlWhitespace = Utf8.GetBytes(" \t\r\n");
+        private static readonly SearchValues<byte> NameTerminators = SearchValues.Create(Utf8.GetBytes(" \t\r\n>/"));
+        private static readonly byte[] LtEntity = Utf8.GetBytes("lt");
+        private static readonly byte[] GtEntity = Utf8.GetBytes("gt");
+        private static readonly byte[] AmpEntity = Utf8.GetBytes("amp");
+        private static readonly byte[] QuotEntity = Utf8.GetBytes("quot");
+        private static readonly byte[] AposEntity = Utf8.GetBytes("apos");
+
+        private enum Tag
+        {
+            Start,
+            Empty,
+            End,
+            EndOfInput
+        }
+
+        private readonly Stream _stream;
+        private readonly CharacterPool _pool;
+        private readonly bool _fragment;
+        private byte[] _buffer;
+        private int _pos;
+        private int _end;
+        private long _base;
+        private long _tagStart;
+        private bool _eof;
+
+        private byte[] _name = new byte[64];
+        private int _nameLength;
+        private int _localNameStart;
+        private byte[] _text = new byte[256];
+        private int _textLength;
+        private bool _nil;
+
+        private readonly byte[][] _cachedText = new byte[StringCacheSize][];
+        private readonly string[] _cachedStrings = new string[StringCacheSize];
+        private readonly int[] _cachedAbilityIds = new int[StringCacheSize];
+
+        private bool _started;
+        private bool _completed;
+
+        public CharacterXmlReader(Stream stream, CharacterPool pool = null)
+            : this(stream, pool, false)
+        {
+        }
+
+        // A fragment is a run of Character elements without the root, such as one page of a roster
+        public CharacterXmlReader(Stream stream, CharacterPool pool, bool fragment)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _pool = pool;
+            _fragment = fragment;
+            _started = fragment;
+            _buffer = ArrayPool<byte>.Shared.Rent(BufferSize);
+            IsUtf8 = DetectUtf8();
+        }
+
+        // False when the document declares or starts with a non UTF-8 encoding
+        public bool IsUtf8 { get; }
+
+        // Offset in the stream of the next unread byte
+        public long Position => _base + _pos;
+
+        public bool TryRead(out Character character)
+        {
+            character = null;
+            if (!MoveToCharacter(out Tag tag))
+                return false;
+
+            character = ReadCharacter(tag);
+            return true;
+        }
+
+        // Step over the next character without decoding it; start is the offset of its tag.
+        // Used to build offset indexes.
+        public bool TrySkip(out long start)
+        {
+            start = -1;
+            if (!MoveToCharacter(out Tag tag))
+                return false;
+
+            start = _tagStart;
+            if (tag == Tag.Start)
+                SkipContent();
+            return true;
+        }
+
+        private bool MoveToCharacter(out Tag tag)
+        {
+            tag = Tag.EndOfInput;
+            if (_completed)
+                return false;
+
+            if (!_started)
+            {
+                tag = NextTag();
+                if (tag == Tag.EndOfInput)
+                    throw new XmlException("Root element is missing.");
+                if (tag == Tag.End || !LocalNameIs(RootTag))
+                    throw new XmlException("Expected an ArrayOfCharacter root element.");
+
+                _started = true;
+                if (tag == Tag.Empty)
+                {
+                    _completed = true;
+                    return false;
+                }
+            }
+
+            while (true)
+            {
+                tag = NextTag();
+                if (tag == Tag.End || tag == Tag.EndOfInput && _fragment)
+                {
+                    _completed = true;
+                    return false;
+                }
+                if (tag == Tag.EndOfInput)
+                    throw new XmlException("Unexpected end of file while reading ArrayOfCharacter.");
+
+                if (LocalNameIs(CharacterTag))
+                    return true;
+                if (tag == Tag.Start)
+                    SkipContent();
+            }
+        }
+
+        public void Dispose()
+        {
+            if (_buffer != null)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = null;
+            }
+        }
+
+        private Character ReadCharacter(Tag tag)
+        {
+            if (_nil)
+            {
+                if (tag == Tag.Start)
+                    SkipContent();
+                return null;
+            }
+
+            // Start from the defaults, as XmlSerializer does for missing elements
+            Character character = _pool != null ? _pool.Rent() : new Character();
+            if (tag == Tag.Empty)
+                return character;
+
+            while (true)
+            {
+                Tag child = NextTag();
+                if (child == Tag.End)
+                    return character;
+                if (child == Tag.EndOfInput)
+                    throw new XmlException("Unexpected end of file while reading Character.");
+
+                if (LocalNameIs(IdTag))
+                    character.Id = ReadLong(child);
+                else if (LocalNameIs(NameTag))
+                    character.Name = ReadString(child);
+                else if (LocalNameIs(LevelTag))
+                    character.Level = ReadInt(child);
+                else if (LocalNameIs(HealthTag))
+                    character.Health = ReadInt(child);
+                else if (LocalNameIs(ManaTag))
+                    character.Mana = ReadInt(child);
+                else if (LocalNameIs(AbilitiesTag))
+                    ReadAbilities(child, character.AbilityList);
+                else if (LocalNameIs(WeaponTypeTag))
+                    character.WeaponType = ReadCachedString(child);
+                else if (LocalNameIs(ClassTag))
+                    character.Class = ReadClass(child);
+                else if (LocalNameIs(ArmorTypeTag))
+                    character.ArmorType = ReadCachedString(child);
+                else if (child == Tag.Start)
+                    SkipContent();
+            }
+        }
+
+        private void ReadAbilities(Tag tag, AbilityList abilities)
+        {
+            if (tag == Tag.Empty)
+                return;
+
+            while (true)
+            {
+                Tag child = NextTag();
+                if (child == Tag.End)
+                    return;
+                if (child == Tag.EndOfInput)
+                    throw new XmlException("Unexpected end of file while reading Abilities.");
+
+                if (!LocalNameIs(AbilityTag))
+                {
+                    if (child == Tag.Start)
+                        SkipContent();
+                }
+                else if (_nil)
+                {
+                    abilities.Add(null);
+                    if (child == Tag.Start)
+                        SkipContent();
+                }
+                else
+                {
+                    abilities.AddId(ReadAbilityId(child));
+                }
+            }
+        }
+
+        private string ReadString(Tag tag)
+        {
+            if (tag == Tag.Empty)
+                return string.Empty;
+
+            ReadContent();
+            return _textLength == 0 ? string.Empty : Utf8.GetString(_text, 0, _textLength);
+        }
+
+        // Ability, weapon and armor names repeat across a roster, so short values are looked up
+        // in a small direct-mapped cache by their UTF-8 bytes before allocating a new string
+        private string ReadCachedString(Tag tag)
+        {
+            if (tag == Tag.Empty)
+                return string.Empty;
+
+            ReadContent();
+            int slot = CacheSlot();
+            return slot < 0 ? Utf8.GetString(_text, 0, _textLength) : _cachedStrings[slot];
+        }
+
+        // The cache also remembers each ability's pool id, so a repeated ability costs no lookup
+        private int ReadAbilityId(Tag tag)
+        {
+            if (tag == Tag.Empty)
+                return AbilityPool.Intern(string.Empty);
+
+            ReadContent();
+            int slot = CacheSlot();
+            if (slot < 0)
+                return AbilityPool.Intern(Utf8.GetString(_text, 0, _textLength));
+
+            int id = _cachedAbilityIds[slot];
+            if (id == 0)
+                _cachedAbilityIds[slot] = id = AbilityPool.Intern(_cachedStrings[slot]);
+            return id;
+        }
+
+        // Slot holding the current text, filled on a miss; -1 when the text is too long to cache
+        private int CacheSlot()
+        {
+            if (_textLength > MaxCachedStringBytes)
+                return -1;
+
+            ReadOnlySpan<byte> text = new ReadOnlySpan<byte>(_text, 0, _textLength);
+            uint hash = 2166136261;
+            foreach (byte b in text)
+                hash = (hash ^ b) * 16777619;
+
+            int slot = (int)(hash % StringCacheSize);
+            if (_cachedText[slot] == null || !text.SequenceEqual(_cachedText[slot]))
+            {
+                _cachedText[slot] = text.ToArray();
+                _cachedStrings[slot] = Utf8.GetString(text);
+                _cachedAbilityIds[slot] = 0;
+            }
+            return slot;
+        }
+
+        // Match the enum name without allocating a string for it
+        private CharacterClass ReadClass(Tag tag)
+        {
+            if (tag == Tag.Start)
+            {
+                ReadContent();
+                ReadOnlySpan<byte> text = new ReadOnlySpan<byte>(_text, 0, _textLength);
+                foreach (KeyValuePair<byte[], CharacterClass> entry in ClassNames)
+                {
+                    if (text.SequenceEqual(entry.Key))
+                        return entry.Value;
+                }
+            }
+            return Enum.Parse<CharacterClass>(tag == Tag.Empty ? string.Empty : Utf8.GetString(_text, 0, _textLength));
+        }
+
+        private int ReadInt(Tag tag)
+        {
+            if (tag == Tag.Empty)
+                return XmlConvert.ToInt32(string.Empty);
+
+            ReadContent();
+            ReadOnlySpan<byte> digits = new ReadOnlySpan<byte>(_text, 0, _textLength).Trim(XmlWhitespace);
+            if (Utf8Parser.TryParse(digits, out int value, out int consumed) && consumed == digits.Length)
+                return value;
+
+            // Let XmlConvert handle (and report) anything unusual such as a leading '+'
+            return XmlConvert.ToInt32(Utf8.GetString(_text, 0, _textLength));
+        }
+
+        private long ReadLong(Tag tag)
+        {
+            if (tag == Tag.Empty)
+                return XmlConvert.ToInt64(string.Empty);
+
+            ReadContent();
+            ReadOnlySpan<byte> digits = new ReadOnlySpan<byte>(_text, 0, _textLength).Trim(XmlWhitespace);
+            if (Utf8Parser.TryParse(digits, out long value, out int consumed) && consumed == digits.Length)
+                return value;
+
+            return XmlConvert.ToInt64(Utf8.GetString(_text, 0, _textLength));
+        }
+
+        // Advance to the next start, empty or end tag, skipping whitespace and misc markup
+        private Tag NextTag()
+        {
+            while (true)
+            {
+                // Text between tags is only indentation, so jump straight to the next '<'
+                if (!SkipTo((byte)'<', false))
+                    return Tag.EndOfInput;
+
+                _tagStart = Position - 1;
+                int b = Next();
+                if (b == '/')
+                {
+                    SkipTo((byte)'>');
+                    return Tag.End;
+                }
+                if (b == '?')
+                {
+                    SkipPast("?>");
+                    continue;
+                }
+                if (b == '!')
+                {
+                    SkipDeclaration();
+                    continue;
+                }
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file inside markup.");
+
+                _pos--;
+                return ReadStartTag();
+            }
+        }
+
+        private Tag ReadStartTag()
+        {
+            ReadName();
+            _nil = false;
+
+            while (true)
+            {
+                int b = SkipWhitespace();
+                if (b == '>')
+                {
+                    _pos++;
+                    return Tag.Start;
+                }
+                if (b == '/')
+                {
+                    _pos++;
+                    SkipTo((byte)'>');
+                    return Tag.Empty;
+                }
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file inside a tag.");
+
+                ReadAttribute();
+            }
+        }
+
+        // Only xsi:nil matters to the schema; other attributes are skipped
+        private void ReadAttribute()
+        {
+            int colon = -1;
+            int nameLength = 0;
+            Span<byte> name = stackalloc byte[16];
+            while (true)
+            {
+                int b = Peek();
+                if (b < 0 || b == '=' || IsWhitespace(b))
+                    break;
+                _pos++;
+                if (b == ':')
+                    colon = nameLength;
+                if (nameLength < name.Length)
+                    name[nameLength] = (byte)b;
+                nameLength++;
+            }
+
+            if (SkipWhitespace() != '=')
+                throw new XmlException("Expected '=' after attribute name.");
+            _pos++;
+
+            int quote = SkipWhitespace();
+            if (quote != '"' && quote != '\'')
+                throw new XmlException("Expected a quoted attribute value.");
+            _pos++;
+
+            int valueLength = 0;
+            bool isTrue = true;
+            const string expected = "true";
+            while (true)
+            {
+                int b = Next();
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file inside an attribute value.");
+                if (b == quote)
+                    break;
+                if (valueLength >= expected.Length || b != expected[valueLength])
+                    isTrue = false;
+                valueLength++;
+            }
+
+            int localStart = colon + 1;
+            if (nameLength <= name.Length && name.Slice(localStart, nameLength - localStart).SequenceEqual(NilAttribute))
+                _nil = isTrue && valueLength == expected.Length;
+        }
+
+        // Decode element content up to and including the matching end tag
+        private void ReadContent()
+        {
+            _textLength = 0;
+            while (true)
+            {
+                if (_pos == _end && !Refill())
+                    throw new XmlException("Unexpected end of file inside element content.");
+
+                ReadOnlySpan<byte> available = new ReadOnlySpan<byte>(_buffer, _pos, _end - _pos);
+                int special = available.IndexOfAny((byte)'<', (byte)'&', (byte)'\r');
+                int run = special < 0 ? available.Length : special;
+                AppendText(available.Slice(0, run));
+                _pos += run;
+                if (special < 0)
+                    continue;
+
+                int b = _buffer[_pos++];
+                if (b == '&')
+                {
+                    ReadReference();
+                }
+                else if (b == '\r')
+                {
+                    if (Peek() == '\n')
+                        _pos++;
+                    AppendText((byte)'\n');
+                }
+                else
+                {
+                    b = Next();
+                    if (b == '/')
+                    {
+                        SkipTo((byte)'>');
+                        return;
+                    }
+                    if (b == '?')
+                        SkipPast("?>");
+                    else if (b == '!' && Peek() == '[')
+                        ReadCData();
+                    else if (b == '!')
+                        SkipDeclaration();
+                    else
+                        throw new XmlException("Unexpected child element inside a text element.");
+                }
+            }
+        }
+
+        private void ReadReference()
+        {
+            Span<byte> entity = stackalloc byte[12];
+            int length = 0;
+            while (true)
+            {
+                int b = Next();
+                if (b == ';')
+                    break;
+                if (b < 0 || length == entity.Length)
+                    throw new XmlException("Malformed entity reference.");
+                entity[length++] = (byte)b;
+            }
+
+            ReadOnlySpan<byte> reference = entity.Slice(0, length);
+            int codePoint;
+            if (reference.Length > 1 && reference[0] == '#')
+            {
+                bool hex = reference[1] == 'x';
+                ReadOnlySpan<byte> digits = reference.Slice(hex ? 2 : 1);
+                if (!Utf8Parser.TryParse(digits, out codePoint, out int consumed, hex ? 'x' : '\0') || consumed != digits.Length)
+                    throw new XmlException("Malformed character reference.");
+            }
+            else if (reference.SequenceEqual(LtEntity))
+                codePoint = '<';
+            else if (reference.SequenceEqual(GtEntity))
+                codePoint = '>';
+            else if (reference.SequenceEqual(AmpEntity))
+                codePoint = '&';
+            else if (reference.SequenceEqual(QuotEntity))
+                codePoint = '"';
+            else if (reference.SequenceEqual(AposEntity))
+                codePoint = '\'';
+            else
+                throw new XmlException("Reference to undeclared entity.");
+
+            Span<byte> encoded = stackalloc byte[4];
+            if (!new Rune(codePoint).TryEncodeToUtf8(encoded, out int written))
+                throw new XmlException("Invalid character reference.");
+            AppendText(encoded.Slice(0, written));
+        }
+
+        // "<![CDATA[" ... "]]>" is copied verbatim
+        private void ReadCData()
+        {
+            const string open = "[CDATA[";
+            for (int i = 0; i < open.Length; i++)
+            {
+                if (Next() != open[i])
+                    throw new XmlException("Malformed CDATA section.");
+            }
+
+            int matched = 0;
+            while (matched < 3)
+            {
+                int b = Next();
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file inside CDATA.");
+
+                if (b == ']' && matched < 2)
+                {
+                    matched++;
+                    continue;
+                }
+                if (b == '>' && matched == 2)
+                {
+                    matched = 3;
+                    continue;
+                }
+
+                for (; matched > 0; matched--)
+                    AppendText((byte)']');
+                if (b == ']')
+                {
+                    matched = 1;
+                    continue;
+                }
+                AppendText((byte)b);
+            }
+        }
+
+        // Skip an element's remaining content, including nested elements
+        private void SkipContent()
+        {
+            int depth = 1;
+            while (depth > 0)
+            {
+                int b = Next();
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file while skipping an element.");
+                if (b != '<')
+                    continue;
+
+                b = Next();
+                if (b == '/')
+                {
+                    SkipTo((byte)'>');
+                    depth--;
+                }
+                else if (b == '?')
+                    SkipPast("?>");
+                else if (b == '!' && Peek() == '[')
+                {
+                    int saved = _textLength;
+                    ReadCData();
+                    _textLength = saved;
+                }
+                else if (b == '!')
+                    SkipDeclaration();
+                else
+                {
+                    _pos--;
+                    if (ReadStartTag() == Tag.Start)
+                        depth++;
+                }
+            }
+        }
+
+        // Comments and DOCTYPE declarations
+        private void SkipDeclaration()
+        {
+            if (Peek() == '-')
+                SkipPast("-->");
+            else
+                SkipTo((byte)'>');
+        }
+
+        private void ReadName()
+        {
+            _nameLength = 0;
+            while (_pos < _end || Refill())
+            {
+                ReadOnlySpan<byte> available = new ReadOnlySpan<byte>(_buffer, _pos, _end - _pos);
+                int stop = available.IndexOfAny(NameTerminators);
+                ReadOnlySpan<byte> part = stop < 0 ? available : available.Slice(0, stop);
+                if (_nameLength + part.Length > _name.Length)
+                    Array.Resize(ref _name, Math.Max(_name.Length * 2, _nameLength + part.Length));
+                part.CopyTo(new Span<byte>(_name, _nameLength, part.Length));
+                _nameLength += part.Length;
+                _pos += part.Length;
+                if (stop >= 0)
+                    break;
+            }
+            _localNameStart = new ReadOnlySpan<byte>(_name, 0, _nameLength).IndexOf((byte)':') + 1;
+        }
+
+        private bool LocalNameIs(byte[] expected)
+        {
+            return new ReadOnlySpan<byte>(_name, _localNameStart, _nameLength - _localNameStart).SequenceEqual(expected);
+        }
+
+        private void AppendText(ReadOnlySpan<byte> bytes)
+        {
+            if (_textLength + bytes.Length > _text.Length)
+                Array.Resize(ref _text, Math.Max(_text.Length * 2, _textLength + bytes.Length));
+            bytes.CopyTo(new Span<byte>(_text, _textLength, bytes.Length));
+            _textLength += bytes.Length;
+        }
+
+        private void AppendText(byte value)
+        {
+            if (_textLength == _text.Length)
+                Array.Resize(ref _text, _text.Length * 2);
+            _text[_textLength++] = value;
+        }
+
+        private int SkipWhitespace()
+        {
+            while (true)
+            {
+                int b = Peek();
+                if (b < 0 || !IsWhitespace(b))
+                    return b;
+                _pos++;
+            }
+        }
+
+        private void SkipTo(byte terminator)
+        {
+            SkipTo(terminator, true);
+        }
+
+        // Move past the next terminator; false at the end of input unless that is an error
+        private bool SkipTo(byte terminator, bool required)
+        {
+            while (_pos < _end || Refill())
+            {
+                int found = new ReadOnlySpan<byte>(_buffer, _pos, _end - _pos).IndexOf(terminator);
+                if (found >= 0)
+                {
+                    _pos += found + 1;
+                    return true;
+                }
+                _pos = _end;
+            }
+
+            if (required)
+                throw new XmlException("Unexpected end of file inside markup.");
+            return false;
+        }
+
+        private void SkipPast(string terminator)
+        {
+            int matched = 0;
+            while (matched < terminator.Length)
+            {
+                int b = Next();
+                if (b < 0)
+                    throw new XmlException("Unexpected end of file inside markup.");
+                if (b == terminator[matched])
+                    matched++;
+                else
+                    matched = b == terminator[0] ? 1 : 0;
+            }
+        }
+
+        private static bool IsWhitespace(int b)
+        {
+            return b == ' ' || b == '\n' || b == '\r' || b == '\t';
+        }
+
+        private int Peek()
+        {
+            if (_pos == _end && !Refill())
+                return -1;
+            return _buffer[_pos];
+        }
+
+        private int Next()
+        {
+            if (_pos == _end && !Refill())
+                return -1;
+            return _buffer[_pos++];
+        }
+
+        private bool Refill()
+        {
+            if (_eof)
+                return false;
+
+            _base += _end;
+            _pos = 0;
+            _end = _stream.Read(_buffer, 0, _buffer.Length);
+            if (_end == 0)
+                _eof = true;
+            return _end > 0;
+        }
+
+        private static KeyValuePair<byte[], CharacterClass>[] CreateClassNames()
+        {
+            var names = new List<KeyValuePair<byte[], CharacterClass>>();
+            foreach (CharacterClass value in Enum.GetValues(typeof(CharacterClass)))
+                names.Add(new KeyValuePair<byte[], CharacterClass>(Utf8.GetBytes(value.ToString()), value));
+            return names.ToArray();
+        }
+
+        // Look at the byte order mark and the XML declaration's encoding attribute
+        private bool DetectUtf8()
+        {
+            while (_end < 512 && !_eof)
+            {
+                int read = _stream.Read(_buffer, _end, _buffer.Length - _end);
+                if (read == 0)
+                    _eof = true;
+                _end += read;
+            }
+
+            ReadOnlySpan<byte> head = new ReadOnlySpan<byte>(_buffer, 0, _end);
+            if (head.Length >= 3 && head[0] == 0xEF && head[1] == 0xBB && head[2] == 0xBF)
+            {
+                _pos = 3;
+                head = head.Slice(3);
+            }
+            else if (head.Length >= 2 && (head[0] == 0 || head[1] == 0 || head[0] == 0xFE || head[0] == 0xFF))
+            {
+                return false;
+            }
+
+            if (!head.StartsWith(Utf8.GetBytes("<?xml")))
+                return true;
+
+            int declarationEnd = head.IndexOf(Utf8.GetBytes("?>"));
+            if (declarationEnd < 0)
+                return false;
+
+            ReadOnlySpan<byte> declaration = head.Slice(0, declarationEnd);
+            int encoding = declaration.IndexOf(Utf8.GetBytes("encoding"));
+            if (encoding < 0)
+                return true;
+
+            ReadOnlySpan<byte> rest = declaration.Slice(encoding + "encoding".Length);
+            int quote = rest.IndexOfAny((byte)'"', (byte)'\'');
+            if (quote < 0)
+                return false;
+            rest = rest.Slice(quote + 1);
+            int close = rest.IndexOf(declaration[encoding + "encoding".Length + quote]);
+            if (close < 0)
+                return false;
+
+            string name = Encoding.ASCII.GetString(rest.Slice(0, close));
+            return string.Equals(name, "utf-8", StringComparison.OrdinalIgnoreCase)
+                || string.Equals(name, "utf8", StringComparison.OrdinalIgnoreCase);
+        }
+    }
+}
+
+// 13. CharacterBinaryCodec.cs - Compact binary roster format
+using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace GameCharacterManager
+{
+    // Layout (little-endian, varints are LEB128, signed values zigzag-encoded):
+    //   header     "CHRB" magic, ushort version, ushort flags
+    //   records    one per character, see WriteRecord
+    //   dictionary varint count, then varint length + UTF-8 bytes per string
+    //   index      byte entry width (4 or 8), then one record offset per character
+    //   footer     long record count, long dictionary offset, long index offset (0 = none), "CHRB"
+    // WeaponType, ArmorType and abilities are stored as dictionary ids (0 = null, n = entry n - 1).
+    // The dictionary is written after the records, so a roster can be streamed out in one pass.
+    // Version 2 added character ids; version 1 files are still read, with every Id 0.
+    public static class CharacterBinaryCodec
+    {
+        public const ushort Version = 2;
+        internal const int HeaderSize = 8;
+        internal const int FooterSize = 28;
+        internal static readonly byte[] Magic = { (byte)'C', (byte)'H', (byte)'R', (byte)'B' };
+
+        internal const byte NullCharacterFlag = 1;
+        internal const byte NullAbilitiesFlag = 2;
+        internal const byte HasIdFlag = 4;
+
+        // Write characters to a stream in the binary roster format
+        public static void Write(Stream stream, IEnumerable<Character> characters)
+        {
+            using (var writer = new BinaryRosterWriter(stream))
+            {
+                var dictionary = new Dictionary<string, int>(StringComparer.Ordinal);
+                var entries = new List<string>();
+
+                writer.WriteBytes(Magic);
+                writer.WriteUInt16(Version);
+                writer.WriteUInt16(0);
+
+                var offsets = new List<long>(characters is ICollection<Character> collection ? collection.Count : 0);
+                if (characters != null)
+                {
+                    foreach (Character character in characters)
+                    {
+                        offsets.Add(writer.Position);
+                        WriteRecord(writer, character, dictionary, entries);
+                    }
+                }
+
+                long dictionaryOffset = writer.Position;
+                writer.WriteVarUInt((uint)entries.Count);
+                foreach (string entry in entries)
+                    writer.WriteString(entry);
+
+                long indexOffset = writer.Position;
+                WriteIndex(writer, offsets);
+
+                writer.WriteInt64(offsets.Count);
+                writer.WriteInt64(dictionaryOffset);
+                writer.WriteInt64(indexOffset);
+                writer.WriteBytes(Magic);
+            }
+        }
+
+        // Read characters from a seekable stream holding a binary roster
+        public static IEnumerable<Character> Read(Stream stream)
+        {
+            if (!stream.CanSeek)
+                throw new NotSupportedException("Binary rosters are read from seekable streams.");
+
+            long start = stream.Position;
+            Footer footer = ReadFooter(stream, start);
+
+            string[] dictionary;
+            stream.Position = start + footer.DictionaryOffset;
+            using (var reader = new BinaryRosterReader(stream))
+                dictionary = ReadDictionary(reader);
+
+            var abilityIds = new AbilityIdMap(dictionary);
+            stream.Position = start + HeaderSize;
+            using (var reader = new BinaryRosterReader(stream))
+            {
+                for (long i = 0; i < footer.Count; i++)
+                    yield return ReadRecord(reader, dictionary, abilityIds);
+            }
+        }
+
+        // Record: byte flags, zigzag Id when non-zero, zigzag Level/Health/Mana, varint Class,
+        // varint WeaponType id, varint ArmorType id, varint ability count + ids, then Name
+        // (varint length + 1, 0 = null). Fixed-size fields come first and the name last,
+        // so headers can be decoded cheaply.
+        private static void WriteRecord(BinaryRosterWriter writer, Character character, Dictionary<string, int> dictionary, List<string> entries)
+        {
+            if (character == null)
+            {
+                writer.WriteByte(NullCharacterFlag);
+                return;
+            }
+
+            byte flags = character.Abilities == null ? NullAbilitiesFlag : (byte)0;
+            if (character.Id != 0)
+                flags |= HasIdFlag;
+            writer.WriteByte(flags);
+            if (character.Id != 0)
+                writer.WriteVarInt64(character.Id);
+            writer.WriteVarInt(character.Level);
+            writer.WriteVarInt(character.Health);
+            writer.WriteVarInt(character.Mana);
+            writer.WriteVarInt((int)character.Class);
+            writer.WriteVarUInt(GetId(character.WeaponType, dictionary, entries));
+            writer.WriteVarUInt(GetId(character.ArmorType, dictionary, entries));
+
+            if (character.Abilities != null)
+            {
+                writer.WriteVarUInt((uint)character.Abilities.Count);
+                foreach (string ability in character.Abilities)
+                    writer.WriteVarUInt(GetId(ability, dictionary, entries));
+            }
+
+            writer.WriteString(character.Name);
+        }
+
+        private static Character ReadRecord(BinaryRosterReader reader, string[] dictionary, AbilityIdMap abilityIds)
+        {
+            byte flags = reader.ReadByte();
+            if ((flags & NullCharacterFlag) != 0)
+                return null;
+
+            var character = new Character
+            {
+                Id = (flags & HasIdFlag) != 0 ? reader.ReadVarInt64() : 0,
+                Level = reader.ReadVarInt(),
+                Health = reader.ReadVarInt(),
+                Mana = reader.ReadVarInt(),
+                Class = (CharacterClass)reader.ReadVarInt(),
+                WeaponType = Lookup(dictionary, reader.ReadVarUInt()),
+                ArmorType = Lookup(dictionary, reader.ReadVarUInt())
+            };
+
+            if ((flags & NullAbilitiesFlag) != 0)
+            {
+                character.Abilities = null;
+            }
+            else
+            {
+                int abilityCount = (int)reader.ReadVarUInt();
+                var abilities = new AbilityList(abilityCount);
+                for (int i = 0; i < abilityCount; i++)
+                    abilities.AddId(abilityIds.GetPoolId(reader.ReadVarUInt()));
+                character.Abilities = abilities;
+            }
+
+            character.Name = reader.ReadString();
+            return character;
+        }
+
+        // Offsets use 4-byte entries unless the records section outgrows them
+        private static void WriteIndex(BinaryRosterWriter writer, List<long> offsets)
+        {
+            bool wide = offsets.Count > 0 && offsets[offsets.Count - 1] > uint.MaxValue;
+            writer.WriteByte(wide ? (byte)8 : (byte)4);
+            foreach (long offset in offsets)
+            {
+                if (wide)
+                    writer.WriteInt64(offset);
+                else
+                    writer.WriteUInt32((uint)offset);
+            }
+        }
+
+        private static uint GetId(string value, Dictionary<string, int> dictionary, List<string> entries)
+        {
+            if (value == null)
+                return 0;
+
+            if (!dictionary.TryGetValue(value, out int index))
+            {
+                index = entries.Count;
+                entries.Add(value);
+                dictionary.Add(value, index);
+            }
+            return (uint)index + 1;
+        }
+
+        internal static string Lookup(string[] dictionary, uint id)
+        {
+            if (id == 0)
+                return null;
+            if (id > dictionary.Length)
+                throw new InvalidDataException($"Dictionary id {id} is out of range.");
+            return dictionary[id - 1];
+        }
+
+        internal static string[] ReadDictionary(BinaryRosterReader reader)
+        {
+            var dictionary = new string[reader.ReadVarUInt()];
+            for (int i = 0; i < dictionary.Length; i++)
+                dictionary[i] = reader.ReadString() ?? throw new InvalidDataException("Null dictionary entry.");
+            return dictionary;
+        }
+
+        internal static Footer ReadFooter(Stream stream, long start)
+        {
+            long length = stream.Length - start;
+            if (length < HeaderSize + FooterSize)
+                throw new InvalidDataException("File is too short to be a binary roster.");
+
+            var header = new byte[HeaderSize];
+            stream.Position = start;
+            ReadExactly(stream, header);
+            var footer = new byte[FooterSize];
+            stream.Position = start + length - FooterSize;
+            ReadExactly(stream, footer);
+
+            return ParseFooter(header, footer, length);
+        }
+
+        internal static Footer ParseFooter(ReadOnlySpan<byte> header, ReadOnlySpan<byte> footer, long length)
+        {
+            if (!header.Slice(0, 4).SequenceEqual(Magic) || !footer.Slice(FooterSize - 4).SequenceEqual(Magic))
+                throw new InvalidDataException("Not a binary roster file.");
+
+            ushort version = BitConverter.ToUInt16(header.Slice(4, 2));
+            if (version > Version)
+                throw new InvalidDataException($"Binary roster version {version} is newer than supported version {Version}.");
+
+            var result = new Footer(
+                version,
+                BitConverter.ToInt64(footer.Slice(0, 8)),
+                BitConverter.ToInt64(footer.Slice(8, 8)),
+                BitConverter.ToInt64(footer.Slice(16, 8)));
+
+            if (result.Count < 0 || result.DictionaryOffset < HeaderSize || result.DictionaryOffset > length - FooterSize ||
+                result.IndexOffset != 0 && (result.IndexOffset < result.DictionaryOffset || result.IndexOffset >= length - FooterSize))
+                throw new InvalidDataException("Corrupt binary roster footer.");
+            return result;
+        }
+
+        private static void ReadExactly(Stream stream, byte[] buffer)
+        {
+            int offset = 0;
+            while (offset < buffer.Length)
+            {
+                int read = stream.Read(buffer, offset, buffer.Length - offset);
+                if (read == 0)
+                    throw new EndOfStreamException();
+                offset += read;
+            }
+        }
+
+        internal readonly struct Footer
+        {
+            public readonly ushort Version;
+            public readonly long Count;
+            public readonly long DictionaryOffset;
+            public readonly long IndexOffset;
+
+            public Footer(ushort version, long count, long dictionaryOffset, long indexOffset)
+            {
+                Version = version;
+                Count = count;
+                DictionaryOffset = dictionaryOffset;
+                IndexOffset = indexOffset;
+            }
+        }
+    }
+
+    // Buffered little-endian writer with LEB128 varints; tracks its own position
+    // so non-seekable output streams work too.
+    internal sealed class BinaryRosterWriter : IDisposable
+    {
+        private const int BufferSize = 64 * 1024;
+        private static readonly UTF8Encoding Utf8 = new UTF8Encoding(false, true);
+
+        private readonly Stream _stream;
+        private byte[] _buffer;
+        private int _length;
+        private long _flushed;
+
+        public BinaryRosterWriter(Stream stream)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _buffer = ArrayPool<byte>.Shared.Rent(BufferSize);
+        }
+
+        public long Position => _flushed + _length;
+
+        public void WriteByte(byte value)
+        {
+            EnsureCapacity(1);
+            _buffer[_length++] = value;
+        }
+
+        public void WriteUInt16(ushort value)
+        {
+            EnsureCapacity(2);
+            BitConverter.TryWriteBytes(new Span<byte>(_buffer, _length, 2), value);
+            _length += 2;
+        }
+
+        public void WriteUInt32(uint value)
+        {
+            EnsureCapacity(4);
+            BitConverter.TryWriteBytes(new Span<byte>(_buffer, _length, 4), value);
+            _length += 4;
+        }
+
+        public void WriteInt64(long value)
+        {
+            EnsureCapacity(8);
+            BitConverter.TryWriteBytes(new Span<byte>(_buffer, _length, 8), value);
+            _length += 8;
+        }
+
+        public void WriteBytes(ReadOnlySpan<byte> bytes)
+        {
+            EnsureCapacity(bytes.Length);
+            bytes.CopyTo(new Span<byte>(_buffer, _length, bytes.Length));
+            _length += bytes.Length;
+        }
+
+        public void WriteVarInt(int value)
+        {
+            WriteVarUInt((uint)((value << 1) ^ (value >> 31)));
+        }
+
+        public void WriteVarUInt(uint value)
+        {
+            EnsureCapacity(5);
+            while (value >= 0x80)
+            {
+                _buffer[_length++] = (byte)(value | 0x80);
+                value >>= 7;
+            }
+            _buffer[_length++] = (byte)value;
+        }
+
+        public void WriteVarInt64(long value)
+        {
+            ulong zigzag = (ulong)((value << 1) ^ (value >> 63));
+            EnsureCapacity(10);
+            while (zigzag >= 0x80)
+            {
+                _buffer[_length++] = (byte)(zigzag | 0x80);
+                zigzag >>= 7;
+            }
+            _buffer[_length++] = (byte)zigzag;
+        }
+
+        // Varint byte length + 1 (0 means null), then UTF-8 bytes
+        public void WriteString(string value)
+        {
+            if (value == null)
+            {
+                WriteVarUInt(0);
+                return;
+            }
+
+            int byteCount = Utf8.GetByteCount(value);
+            WriteVarUInt((uint)byteCount + 1);
+            EnsureCapacity(byteCount);
+            _length += Utf8.GetBytes(value, 0, value.Length, _buffer, _length);
+        }
+
+        public void Flush()
+        {
+            if (_length > 0)
+            {
+                _stream.Write(_buffer, 0, _length);
+                _flushed += _length;
+                _length = 0;
+            }
+        }
+
+        public void Dispose()
+        {
+            if (_buffer != null)
+            {
+                Flush();
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = null;
+            }
+        }
+
+        private void EnsureCapacity(int count)
+        {
+            if (_buffer.Length - _length >= count)
+                return;
+
+            Flush();
+            if (_buffer.Length < count)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = ArrayPool<byte>.Shared.Rent(count);
+            }
+        }
+    }
+
+    // Buffered reader matching BinaryRosterWriter
+    internal sealed class BinaryRosterReader : IDisposable
+    {
+        private const int BufferSize = 64 * 1024;
+        private static readonly UTF8Encoding Utf8 = new UTF8Encoding(false, true);
+
+        private readonly Stream _stream;
+        private byte[] _buffer;
+        private int _pos;
+        private int _end;
+
+        public BinaryRosterReader(Stream stream)
+        {
+            _stream = stream ?? throw new ArgumentNullException(nameof(stream));
+            _buffer = ArrayPool<byte>.Shared.Rent(BufferSize);
+        }
+
+        public byte ReadByte()
+        {
+            if (_pos == _end)
+                Fill(1);
+            return _buffer[_pos++];
+        }
+
+        public int ReadVarInt()
+        {
+            uint value = ReadVarUInt();
+            return (int)(value >> 1) ^ -(int)(value & 1);
+        }
+
+        public uint ReadVarUInt()
+        {
+            uint value = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                byte b = ReadByte();
+                value |= (uint)(b & 0x7F) << shift;
+                if (b < 0x80)
+                    return value;
+            }
+            throw new InvalidDataException("Malformed varint.");
+        }
+
+        public long ReadVarInt64()
+        {
+            ulong value = 0;
+            for (int shift = 0; shift < 70; shift += 7)
+            {
+                byte b = ReadByte();
+                value |= (ulong)(b & 0x7F) << shift;
+                if (b < 0x80)
+                    return (long)(value >> 1) ^ -(long)(value & 1);
+            }
+            throw new InvalidDataException("Malformed varint.");
+        }
+
+        public string ReadString()
+        {
+            uint prefix = ReadVarUInt();
+            if (prefix == 0)
+                return null;
+
+            int length = (int)(prefix - 1);
+            if (_end - _pos < length)
+                Fill(length);
+            string value = Utf8.GetString(_buffer, _pos, length);
+            _pos += length;
+            return value;
+        }
+
+        public void Dispose()
+        {
+            if (_buffer != null)
+            {
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = null;
+            }
+        }
+
+        // Make at least count bytes available, growing the buffer for oversized strings
+        private void Fill(int count)
+        {
+            int remaining = _end - _pos;
+            if (_buffer.Length < count)
+            {
+                byte[] larger = ArrayPool<byte>.Shared.Rent(count);
+                Buffer.BlockCopy(_buffer, _pos, larger, 0, remaining);
+                ArrayPool<byte>.Shared.Return(_buffer);
+                _buffer = larger;
+            }
+            else
+            {
+                Buffer.BlockCopy(_buffer, _pos, _buffer, 0, remaining);
+            }
+
+            _pos = 0;
+            _end = remaining;
+            while (_end < count)
+            {
+                int read = _stream.Read(_buffer, _end, _buffer.Length - _end);
+                if (read == 0)
+                    throw new EndOfStreamException("Unexpected end of binary roster.");
+                _end += read;
+            }
+        }
+    }
+}
+
+// 14. MappedCharacterRoster.cs - Read-only, memory-mapped view over a binary roster
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Runtime.CompilerServices;
+using System.Text;
+
+namespace GameCharacterManager
+{
+    // Opening maps the file and decodes only the footer and string dictionary; records are
+    // decoded on access, so resident memory tracks the records actually touched.
+    // Files without an offset table are scanned once on open to build one.
+    public sealed unsafe class MappedCharacterRoster : IReadOnlyList<Character>, IDisposable
+    {
+        private static readonly UTF8Encoding Utf8 = new UTF8Encoding(false, true);
+
+        private readonly MemoryMappedFile _file;
+        private readonly MemoryMappedViewAccessor _view;
+        private readonly string[] _dictionary;
+        private readonly AbilityIdMap _abilityIds;
+        private readonly long _recordsEnd;
+        private readonly int _count;
+        private readonly long _indexStart;
+        private readonly int _indexWidth;
+        private readonly long[] _scannedOffsets;
+        private byte* _base;
+
+        private MappedCharacterRoster(MemoryMappedFile file, long length)
+        {
+            _file = file;
+            _view = file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+
+            byte* pointer = null;
+            _view.SafeMemoryMappedViewHandle.AcquirePointer(ref pointer);
+            _base = pointer + _view.PointerOffset;
+
+            CharacterBinaryCodec.Footer footer = CharacterBinaryCodec.ParseFooter(
+                new ReadOnlySpan<byte>(_base, CharacterBinaryCodec.HeaderSize),
+                new ReadOnlySpan<byte>(_base + length - CharacterBinaryCodec.FooterSize, CharacterBinaryCodec.FooterSize),
+                length);
+            if (footer.Count > int.MaxValue)
+                throw new InvalidDataException("Roster has too many records to map.");
+
+            _count = (int)footer.Count;
+            _recordsEnd = footer.DictionaryOffset;
+            _dictionary = ReadDictionary(footer.DictionaryOffset, footer.IndexOffset != 0 ? footer.IndexOffset : length - CharacterBinaryCodec.FooterSize);
+            _abilityIds = new AbilityIdMap(_dictionary);
+
+            if (footer.IndexOffset != 0)
+            {
+                _indexWidth = _base[footer.IndexOffset];
+                _indexStart = footer.IndexOffset + 1;
+                if (_indexWidth != 4 && _indexWidth != 8 || _indexStart + (long)_count * _indexWidth > length - CharacterBinaryCodec.FooterSize)
+                    throw new InvalidDataException("Corrupt binary roster index.");
+            }
+            else
+            {
+                _scannedOffsets = ScanOffsets();
+            }
+        }
+
+        // Map a binary roster file for reading. A save may move a new file over it meanwhile;
+        // the mapping keeps the one it opened.
+        public static MappedCharacterRoster Open(string path)
+        {
+            var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete);
+            MemoryMappedFile file = null;
+            try
+            {
+                long length = stream.Length;
+                if (length < CharacterBinaryCodec.HeaderSize + CharacterBinaryCodec.FooterSize)
+                    throw new InvalidDataException("File is too short to be a binary roster.");
+
+                file = MemoryMappedFile.CreateFromFile(stream, null, 0, MemoryMappedFileAccess.Read, HandleInheritability.None, false);
+                return new MappedCharacterRoster(file, length);
+            }
+            catch
+            {
+                if (file != null)
+                    file.Dispose();
+                else
+                    stream.Dispose();
+                throw;
+            }
+        }
+
+        public int Count => _count;
+
+        // Decode a single character; only this record's pages are touched
+        public Character this[int index] => GetRecord(index).ToCharacter();
+
+        // Lazy view of one record; strings are only materialized when read
+        public CharacterRecord GetRecord(int index)
+        {
+            if ((uint)index >= (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+            ThrowIfDisposed();
+            return DecodeRecord(GetOffset(index), out _);
+        }
+
+        // Sequential, allocation-free iteration over lazy records
+        public RecordEnumerable Records => new RecordEnumerable(this);
+
+        public IEnumerator<Character> GetEnumerator()
+        {
+            foreach (CharacterRecord record in Records)
+                yield return record.ToCharacter();
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        public void Dispose()
+        {
+            if (_base != null)
+            {
+                _base = null;
+                _view.SafeMemoryMappedViewHandle.ReleasePointer();
+                _view.Dispose();
+                _file.Dispose();
+            }
+        }
+
+        private long GetOffset(int index)
+        {
+            if (_scannedOffsets != null)
+                return _scannedOffsets[index];
+
+            byte* entry = _base + _indexStart + (long)index * _indexWidth;
+            long offset = _indexWidth == 4 ? Unsafe.ReadUnaligned<uint>(entry) : Unsafe.ReadUnaligned<long>(entry);
+            if (offset < CharacterBinaryCodec.HeaderSize || offset >= _recordsEnd)
+                throw new InvalidDataException("Corrupt binary roster index.");
+            return offset;
+        }
+
+        private long[] ScanOffsets()
+        {
+            var offsets = new long[_count];
+            long position = CharacterBinaryCodec.HeaderSize;
+            for (int i = 0; i < _count; i++)
+            {
+                offsets[i] = position;
+                DecodeRecord(position, out position);
+            }
+            return offsets;
+        }
+
+        private string[] ReadDictionary(long position, long end)
+        {
+            var dictionary = new string[ReadVarUInt(ref position, end)];
+            for (int i = 0; i < dictionary.Length; i++)
+                dictionary[i] = ReadString(ref position, end) ?? throw new InvalidDataException("Null dictionary entry.");
+            return dictionary;
+        }
+
+        // Mirrors CharacterBinaryCodec.WriteRecord: decode the numeric fields, note where the
+        // ability ids and name start, and skip over them without allocating
+        private CharacterRecord DecodeRecord(long position, out long next)
+        {
+            long end = _recordsEnd;
+            if (position >= end)
+                throw new InvalidDataException("Unexpected end of binary roster.");
+
+            byte flags = _base[position++];
+            if ((flags & CharacterBinaryCodec.NullCharacterFlag) != 0)
+            {
+                next = position;
+                return new CharacterRecord(this);
+            }
+
+            long id = (flags & CharacterBinaryCodec.HasIdFlag) != 0 ? ReadVarInt64(ref position, end) : 0;
+            int level = ReadVarInt(ref position, end);
+            int health = ReadVarInt(ref position, end);
+            int mana = ReadVarInt(ref position, end);
+            var characterClass = (CharacterClass)ReadVarInt(ref position, end);
+            uint weapon = ReadVarUInt(ref position, end);
+            uint armor = ReadVarUInt(ref position, end);
+
+            int abilityCount = -1;
+            long abilities = position;
+            if ((flags & CharacterBinaryCodec.NullAbilitiesFlag) == 0)
+            {
+                abilityCount = (int)ReadVarUInt(ref position, end);
+                abilities = position;
+                for (int i = 0; i < abilityCount; i++)
+                    ReadVarUInt(ref position, end);
+            }
+
+            long name = position;
+            uint nameLength = ReadVarUInt(ref position, end);
+            if (nameLength > 0)
+                position += nameLength - 1;
+            if (position > end)
+                throw new InvalidDataException("Unexpected end of binary roster.");
+
+            next = position;
+            return new CharacterRecord(this, id, level, health, mana, characterClass, weapon, armor, abilityCount, abilities, name);
+        }
+
+        internal string Lookup(uint id)
+        {
+            return CharacterBinaryCodec.Lookup(_dictionary, id);
+        }
+
+        internal string ReadAbility(long position, int index)
+        {
+            ThrowIfDisposed();
+            for (int i = 0; i < index; i++)
+                ReadVarUInt(ref position, _recordsEnd);
+            return Lookup(ReadVarUInt(ref position, _recordsEnd));
+        }
+
+        internal AbilityList ReadAbilities(long position, int count)
+        {
+            var abilities = new AbilityList(count);
+            ReadAbilities(position, count, abilities);
+            return abilities;
+        }
+
+        // Append the abilities to an existing list
+        internal void ReadAbilities(long position, int count, AbilityList abilities)
+        {
+            ThrowIfDisposed();
+            for (int i = 0; i < count; i++)
+                abilities.AddId(_abilityIds.GetPoolId(ReadVarUInt(ref position, _recordsEnd)));
+        }
+
+        internal string ReadName(long position)
+        {
+            ThrowIfDisposed();
+            return ReadString(ref position, _recordsEnd);
+        }
+
+        private string ReadString(ref long position, long end)
+        {
+            uint prefix = ReadVarUInt(ref position, end);
+            if (prefix == 0)
+                return null;
+
+            int length = (int)(prefix - 1);
+            if (position + length > end)
+                throw new InvalidDataException("Unexpected end of binary roster.");
+            string value = Utf8.GetString(_base + position, length);
+            position += length;
+            return value;
+        }
+
+        private int ReadVarInt(ref long position, long end)
+        {
+            uint value = ReadVarUInt(ref position, end);
+            return (int)(value >> 1) ^ -(int)(value & 1);
+        }
+
+        private uint ReadVarUInt(ref long position, long end)
+        {
+            uint value = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                if (position >= end)
+                    throw new InvalidDataException("Unexpected end of binary roster.");
+                byte b = _base[position++];
+                value |= (uint)(b & 0x7F) << shift;
+                if (b < 0x80)
+                    return value;
+            }
+            throw new InvalidDataException("Malformed varint.");
+        }
+
+        private long ReadVarInt64(ref long position, long end)
+        {
+            ulong value = 0;
+            for (int shift = 0; shift < 70; shift += 7)
+            {
+                if (position >= end)
+                    throw new InvalidDataException("Unexpected end of binary roster.");
+                byte b = _base[position++];
+                value |= (ulong)(b & 0x7F) << shift;
+                if (b < 0x80)
+                    return (long)(value >> 1) ^ -(long)(value & 1);
+            }
+            throw new InvalidDataException("Malformed varint.");
+        }
+
+        private void ThrowIfDisposed()
+        {
+            if (_base == null)
+                throw new ObjectDisposedException(nameof(MappedCharacterRoster));
+        }
+
+        public struct RecordEnumerable
+        {
+            private readonly MappedCharacterRoster _roster;
+
+            internal RecordEnumerable(MappedCharacterRoster roster)
+            {
+                _roster = roster;
+            }
+
+            public RecordEnumerator GetEnumerator()
+            {
+                return new RecordEnumerator(_roster);
+            }
+        }
+
+        public struct RecordEnumerator
+        {
+            private readonly MappedCharacterRoster _roster;
+            private long _position;
+            private int _index;
+            private CharacterRecord _current;
+
+            internal RecordEnumerator(MappedCharacterRoster roster)
+            {
+                _roster = roster;
+                _position = CharacterBinaryCodec.HeaderSize;
+                _index = 0;
+                _current = default;
+            }
+
+            public CharacterRecord Current => _current;
+
+            public bool MoveNext()
+            {
+                if (_index >= _roster._count)
+                    return false;
+
+                _roster.ThrowIfDisposed();
+                _current = _roster.DecodeRecord(_position, out _position);
+                _index++;
+                return true;
+            }
+        }
+    }
+
+    // A decoded record header. Numbers and dictionary values cost nothing to read;
+    // Name and abilities are decoded from the mapped file when accessed.
+    public readonly struct CharacterRecord
+    {
+        private readonly MappedCharacterRoster _roster;
+        private readonly uint _weapon;
+        private readonly uint _armor;
+        private readonly long _abilities;
+        private readonly long _name;
+
+        internal CharacterRecord(MappedCharacterRoster roster)
+        {
+            this = default;
+            _roster = roster;
+            IsNull = true;
+        }
+
+        internal CharacterRecord(MappedCharacterRoster roster, long id, int level, int health, int mana, CharacterClass characterClass,
+            uint weapon, uint armor, int abilityCount, long abilities, long name)
+        {
+            _roster = roster;
+            Id = id;
+            Level = level;
+            Health = health;
+            Mana = mana;
+            Class = characterClass;
+            _weapon = weapon;
+            _armor = armor;
+            AbilityCount = abilityCount;
+            _abilities = abilities;
+            _name = name;
+            IsNull = false;
+        }
+
+        // True for null entries in the saved list
+        public bool IsNull { get; }
+        public long Id { get; }
+        public int Level { get; }
+        public int Health { get; }
+        public int Mana { get; }
+        public CharacterClass Class { get; }
+
+        // -1 when the saved Abilities list was null
+        public int AbilityCount { get; }
+
+        public string Name => IsNull ? null : _roster.ReadName(_name);
+        public string WeaponType => _roster?.Lookup(_weapon);
+        public string ArmorType => _roster?.Lookup(_armor);
+
+        public string GetAbility(int index)
+        {
+            if ((uint)index >= (uint)AbilityCount)
+                throw new ArgumentOutOfRangeException(nameof(index));
+            return _roster.ReadAbility(_abilities, index);
+        }
+
+        // Decode all abilities into a new list, or null when none were saved
+        public AbilityList GetAbilities()
+        {
+            return AbilityCount >= 0 ? _roster.ReadAbilities(_abilities, AbilityCount) : null;
+        }
+
+        // Materialize a full Character
+        public Character ToCharacter()
+        {
+            if (IsNull)
+                return null;
+
+            AbilityList abilities = GetAbilities();
+            return new Character
+            {
+                Id = Id,
+                Name = Name,
+                Level = Level,
+                Health = Health,
+                Mana = Mana,
+                Abilities = abilities,
+                WeaponType = WeaponType,
+                Class = Class,
+                ArmorType = ArmorType
+            };
+        }
+
+        // Materialize into a character rented from pool, reusing its ability storage
+        public Character ToCharacter(CharacterPool pool)
+        {
+            if (pool == null)
+                return ToCharacter();
+            if (IsNull)
+                return null;
+
+            Character character = pool.Rent();
+            character.Id = Id;
+            character.Name = Name;
+            character.Level = Level;
+            character.Health = Health;
+            character.Mana = Mana;
+            if (AbilityCount >= 0)
+                _roster.ReadAbilities(_abilities, AbilityCount, character.AbilityList ??= new AbilityList());
+            else
+                character.Abilities = null;
+            character.WeaponType = WeaponType;
+            character.Class = Class;
+            character.ArmorType = ArmorType;
+            return character;
+        }
+    }
+}
+
+// 15. CharacterJournal.cs - Append-only change log layered over a roster snapshot
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace GameCharacterManager
+{
+    public enum JournalOperation : byte
+    {
+        Add = 1,
+        Replace = 2,
+        Remove = 3
+    }
+
+    // One recorded change to the character with Id; Character is null for Remove
+    public readonly struct JournalEntry
+    {
+        public JournalOperation Operation { get; }
+        public long Id { get; }
+        public Character Character { get; }
+
+        public JournalEntry(JournalOperation operation, long id, Character character)
+        {
+            Operation = operation;
+            Id = id;
+            Character = character;
+        }
+    }
+
+    // Applies entries to a snapshot's characters in O(snapshot + entries): positions are looked
+    // up by Id, and removals leave a gap that Complete closes in one pass
+    internal sealed class JournalReplay
+    {
+        private readonly List<Character> _characters;
+        private readonly HashSet<int> _removed = new HashSet<int>();
+        private Dictionary<long, int> _positions;
+        private long _nextId = 1;
+
+        public JournalReplay(List<Character> characters)
+        {
+            _characters = characters;
+        }
+
+        public void Apply(JournalEntry entry)
+        {
+            Dictionary<long, int> positions = Positions();
+            switch (entry.Operation)
+            {
+                case JournalOperation.Add:
+                    Character added = entry.Character;
+                    if (added != null)
+                    {
+                        // As CharacterRoster.Add, a missing or taken Id is replaced by a new one
+                        if (added.Id <= 0 || positions.ContainsKey(added.Id))
+                            added.Id = _nextId++;
+                        else if (added.Id >= _nextId)
+                            _nextId = added.Id + 1;
+                        positions.Add(added.Id, _characters.Count);
+                    }
+                    _characters.Add(added);
+                    break;
+                case JournalOperation.Replace when positions.TryGetValue(entry.Id, out int position):
+                    if (entry.Character != null)
+                        entry.Character.Id = entry.Id;
+                    _characters[position] = entry.Character;
+                    break;
+                case JournalOperation.Remove when positions.Remove(entry.Id, out int position):
+                    _removed.Add(position);
+                    break;
+                default:
+                    throw new InvalidDataException($"Journal {entry.Operation} of Id {entry.Id} does not match the roster.");
+            }
+        }
+
+        public void Complete()
+        {
+            if (_removed.Count == 0)
+                return;
+
+            int write = 0;
+            for (int read = 0; read < _characters.Count; read++)
+            {
+                if (!_removed.Contains(read))
+                    _characters[write++] = _characters[read];
+            }
+            _characters.RemoveRange(write, _characters.Count - write);
+        }
+
+        // Built on the first entry; the characters already carry CharacterRoster's Ids
+        private Dictionary<long, int> Positions()
+        {
+            if (_positions == null)
+            {
+                _positions = new Dictionary<long, int>(_characters.Count);
+                for (int i = 0; i < _characters.Count; i++)
+                {
+                    Character character = _characters[i];
+                    if (character == null)
+                        continue;
+                    _positions.TryAdd(character.Id, i);
+                    if (character.Id >= _nextId)
+                        _nextId = character.Id + 1;
+                }
+            }
+            return _positions;
+        }
+    }
+
+    // Snapshot + journal as positions in the snapshot, so it can be paged without being loaded or
+    // compacted: the snapshot's Ids locate removals and replacements, and added characters
+    // follow its last one, as JournalReplay would leave them
+    internal sealed class JournalOverlay
+    {
+        private readonly long[] _ids;
+        private readonly long[] _removed;
+        private readonly Dictionary<long, Character> _replaced = new Dictionary<long, Character>();
+        private readonly List<Character> _added = new List<Character>();
+
+        // ids are those CharacterRoster.AssignIds gives the snapshot, 0 for a null character
+        public JournalOverlay(long[] ids, IEnumerable<JournalEntry> entries)
+        {
+            _ids = ids;
+
+            // A snapshot position, or the complement of an index into _added
+            var positions = new Dictionary<long, long>(ids.Length);
+            long nextId = 1;
+            for (long i = 0; i < ids.Length; i++)
+            {
+                if (ids[i] == 0)
+                    continue;
+                positions.TryAdd(ids[i], i);
+                if (ids[i] >= nextId)
+                    nextId = ids[i] + 1;
+            }
+
+            var removed = new List<long>();
+            var removedAdded = new HashSet<int>();
+            foreach (JournalEntry entry in entries)
+            {
+                switch (entry.Operation)
+                {
+                    case JournalOperation.Add:
+                        Character added = entry.Character;
+                        if (added != null)
+                        {
+                            if (added.Id <= 0 || positions.ContainsKey(added.Id))
+                                added.Id = nextId++;
+                            else if (added.Id >= nextId)
+                                nextId = added.Id + 1;
+                            positions.Add(added.Id, ~(long)_added.Count);
+                        }
+                        _added.Add(added);
+                        break;
+                    case JournalOperation.Replace when positions.TryGetValue(entry.Id, out long position):
+                        if (entry.Character != null)
+                            entry.Character.Id = entry.Id;
+                        if (position >= 0)
+                            _replaced[position] = entry.Character;
+                        else
+                            _added[(int)~position] = entry.Character;
+                        break;
+                    case JournalOperation.Remove when positions.Remove(entry.Id, out long position):
+                        if (position >= 0)
+                            removed.Add(position);
+                        else
+                            removedAdded.Add((int)~position);
+                        break;
+                    default:
+                        throw new InvalidDataException($"Journal {entry.Operation} of Id {entry.Id} does not match the roster.");
+                }
+            }
+
+            removed.Sort();
+            _removed = removed.ToArray();
+            if (removedAdded.Count > 0)
+            {
+                int write = 0;
+                for (int read = 0; read < _added.Count; read++)
+                {
+                    if (!removedAdded.Contains(read))
+                        _added[write++] = _added[read];
+                }
+                _added.RemoveRange(write, _added.Count - write);
+            }
+        }
+
+        public long Count => _ids.Length - _removed.Length + _added.Count;
+
+        // Characters [offset, offset + count). Runs of kept snapshot positions are read through
+        // readSnapshot(position, length); journal characters are copied, as the overlay is reused.
+        public List<Character> Page(long offset, int count, Func<long, int, List<Character>> readSnapshot)
+        {
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            var page = new List<Character>(count);
+            long kept = _ids.Length - _removed.Length;
+            long end = Math.Min(offset + count, Count);
+            long index = offset;
+
+            // removed[k] - k grows with k, so the removals before index are found by bisection
+            int k = 0;
+            for (int high = _removed.Length; k < high; )
+            {
+                int middle = (k + high) >> 1;
+                if (_removed[middle] - middle > index)
+                    high = middle;
+                else
+                    k = middle + 1;
+            }
+
+            long position = index + k;
+            long snapshotEnd = Math.Min(end, kept);
+            while (index < snapshotEnd)
+            {
+                while (k < _removed.Length && _removed[k] == position)
+                {
+                    position++;
+                    k++;
+                }
+
+                long runEnd = k < _removed.Length ? _removed[k] : _ids.Length;
+                int length = (int)Math.Min(runEnd - position, snapshotEnd - index);
+                List<Character> run = readSnapshot(position, length);
+                for (int i = 0; i < length; i++)
+                {
+                    if (_replaced.TryGetValue(position + i, out Character replaced))
+                    {
+                        page.Add(Copy(replaced));
+                    }
+                    else
+                    {
+                        if (run[i] != null)
+                            run[i].Id = _ids[position + i];
+                        page.Add(run[i]);
+                    }
+                }
+                index += length;
+                position += length;
+            }
+
+            for (; index < end; index++)
+                page.Add(Copy(_added[(int)(index - kept)]));
+            return page;
+        }
+
+        private static Character Copy(Character character)
+        {
+            if (character == null)
+                return null;
+            Character copy = character.CopyWithName(character.Name);
+            copy.Id = character.Id;
+            return copy;
+        }
+    }
+
+    // Identifies the snapshot a journal applies to; a rewritten snapshot invalidates its journal
+    public readonly struct SnapshotFingerprint : IEquatable<SnapshotFingerprint>
+    {
+        public long Length { get; }
+        public long LastWriteTicks { get; }
+
+        public SnapshotFingerprint(long length, long lastWriteTicks)
+        {
+            Length = length;
+            LastWriteTicks = lastWriteTicks;
+        }
+
+        public static SnapshotFingerprint Of(string path)
+        {
+            var info = new FileInfo(path);
+            return info.Exists ? new SnapshotFingerprint(info.Length, info.LastWriteTimeUtc.Ticks) : default;
+        }
+
+        public bool Equals(SnapshotFingerprint other) => Length == other.Length && LastWriteTicks == other.LastWriteTicks;
+        public override bool Equals(object obj) => obj is SnapshotFingerprint other && Equals(other);
+        public override int GetHashCode() => HashCode.Combine(Length, LastWriteTicks);
+    }
+
+    // Layout: "CHRJ" magic, ushort version, ushort flags, long snapshot length, long snapshot
+    // write time, then entries framed as int payload length, uint CRC-32, payload. A torn or
+    // corrupt entry ends the journal; the next append truncates it away.
+    public sealed class CharacterJournal
+    {
+        // Version 2 keys entries by Id instead of list position
+        public const ushort Version = 2;
+        private const int HeaderSize = 24;
+        private const int FrameSize = 8;
+        private static readonly byte[] Magic = { (byte)'C', (byte)'H', (byte)'R', (byte)'J' };
+
+        private readonly string _path;
+        private long _validLength = -1;
+
+        public CharacterJournal(string path)
+        {
+            _path = path;
+        }
+
+        public string Path => _path;
+
+        // Pending rebased journal, written before a compacted snapshot is moved into place
+        private string RebasePath => _path + ".tmp";
+
+        public long Length => File.Exists(_path) ? new FileInfo(_path).Length : 0;
+
+        // True when the journal belongs to the snapshot and holds at least one entry
+        public bool HasEntries(SnapshotFingerprint snapshot)
+        {
+            RecoverRebase(snapshot);
+            using (FileStream fs = TryOpenRead(_path))
+                return fs != null && fs.Length > HeaderSize && HeaderMatches(fs, snapshot);
+        }
+
+        // Apply entries up to limit (or the end of the journal) to a snapshot's characters.
+        // Returns false when there is no journal for this snapshot.
+        public bool Replay(SnapshotFingerprint snapshot, List<Character> characters, long limit = long.MaxValue)
+        {
+            byte[] data = ReadData(snapshot, limit);
+            if (data == null)
+                return false;
+
+            long position = HeaderSize;
+            var replay = new JournalReplay(characters);
+            while (TryReadEntry(data, ref position, out JournalEntry entry))
+                replay.Apply(entry);
+            replay.Complete();
+
+            if (limit == long.MaxValue)
+                _validLength = position;
+            return true;
+        }
+
+        // Every entry for the snapshot, in order; empty when there is no journal for it
+        public List<JournalEntry> ReadEntries(SnapshotFingerprint snapshot)
+        {
+            var entries = new List<JournalEntry>();
+            byte[] data = ReadData(snapshot, long.MaxValue);
+            if (data == null)
+                return entries;
+
+            long position = HeaderSize;
+            while (TryReadEntry(data, ref position, out JournalEntry entry))
+                entries.Add(entry);
+            _validLength = position;
+            return entries;
+        }
+
+        // The journal up to limit, or null when it does not belong to the snapshot
+        private byte[] ReadData(SnapshotFingerprint snapshot, long limit)
+        {
+            RecoverRebase(snapshot);
+
+            byte[] data;
+            using (FileStream fs = TryOpenRead(_path))
+            {
+                if (fs == null || fs.Length < HeaderSize || !HeaderMatches(fs, snapshot))
+                    return null;
+
+                data = new byte[Math.Min(fs.Length, limit)];
+                fs.Position = 0;
+                ReadExactly(fs, data, data.Length);
+            }
+            RosterMetrics.Read(_path, data.Length);
+            return data;
+        }
+
+        // Durably append entries, starting a fresh journal if the snapshot has changed
+        public void Append(SnapshotFingerprint snapshot, IReadOnlyList<JournalEntry> entries)
+        {
+            byte[] frames = Encode(entries);
+
+            using (var fs = new FileStream(_path, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.Read))
+            {
+                if (fs.Length < HeaderSize || !HeaderMatches(fs, snapshot))
+                {
+                    fs.SetLength(0);
+                    WriteHeader(fs, snapshot);
+                    _validLength = HeaderSize;
+                }
+                else if (_validLength < HeaderSize || _validLength > fs.Length)
+                {
+                    _validLength = FindValidLength(fs);
+                }
+
+                fs.SetLength(_validLength);
+                fs.Position = _validLength;
+                fs.Write(frames, 0, frames.Length);
+                fs.Flush(true);
+                _validLength = fs.Position;
+            }
+            RosterMetrics.Written(_path, frames.Length);
+        }
+
+        // Stage a journal for a compacted snapshot, carrying over entries written after
+        // compactedLength; CommitRebase moves it into place once the snapshot has been swapped
+        public void BeginRebase(SnapshotFingerprint compactedSnapshot, long compactedLength)
+        {
+            using (var target = new FileStream(RebasePath, FileMode.Create, FileAccess.Write, FileShare.None))
+            {
+                WriteHeader(target, compactedSnapshot);
+
+                using (FileStream source = TryOpenRead(_path))
+                {
+                    long end = _validLength >= HeaderSize ? _validLength : source?.Length ?? 0;
+                    if (source != null && end > compactedLength)
+                    {
+                        var tail = new byte[end - compactedLength];
+                        source.Position = compactedLength;
+                        ReadExactly(source, tail, tail.Length);
+                        target.Write(tail, 0, tail.Length);
+                    }
+                }
+                target.Flush(true);
+            }
+        }
+
+        public void CommitRebase()
+        {
+            File.Move(RebasePath, _path, true);
+            _validLength = -1;
+        }
+
+        public void Delete()
+        {
+            File.Delete(_path);
+            File.Delete(RebasePath);
+            _validLength = -1;
+        }
+
+        // A crash between swapping the snapshot and committing the rebase leaves the staged
+        // journal as the only one matching the new snapshot
+        private void RecoverRebase(SnapshotFingerprint snapshot)
+        {
+            using (FileStream fs = TryOpenRead(RebasePath))
+            {
+                if (fs == null || fs.Length < HeaderSize || !HeaderMatches(fs, snapshot))
+                    return;
+            }
+            CommitRebase();
+        }
+
+        private static byte[] Encode(IReadOnlyList<JournalEntry> entries)
+        {
+            var payloads = new MemoryStream();
+            var bounds = new long[entries.Count + 1];
+            using (var writer = new BinaryRosterWriter(payloads))
+            {
+                for (int i = 0; i < entries.Count; i++)
+                {
+                    bounds[i] = writer.Position;
+                    WriteEntry(writer, entries[i]);
+                }
+                bounds[entries.Count] = writer.Position;
+            }
+
+            byte[] payload = payloads.GetBuffer();
+            var frames = new byte[payloads.Length + (long)entries.Count * FrameSize];
+            int offset = 0;
+            for (int i = 0; i < entries.Count; i++)
+            {
+                int start = (int)bounds[i];
+                int length = (int)(bounds[i + 1] - start);
+                BitConverter.TryWriteBytes(new Span<byte>(frames, offset, 4), length);
+                BitConverter.TryWriteBytes(new Span<byte>(frames, offset + 4, 4), Crc32.Compute(new ReadOnlySpan<byte>(payload, start, length)));
+                Buffer.BlockCopy(payload, start, frames, offset + FrameSize, length);
+                offset += FrameSize + length;
+            }
+            return frames;
+        }
+
+        // Payload: byte operation, varint Id, then for Add/Replace the character with inline strings.
+        // Character flags: 1 = present, 2 = null abilities, 4 = zigzag Id follows.
+        private static void WriteEntry(BinaryRosterWriter writer, JournalEntry entry)
+        {
+            writer.WriteByte((byte)entry.Operation);
+            writer.WriteVarInt64(entry.Id);
+            if (entry.Operation == JournalOperation.Remove)
+                return;
+
+            Character character = entry.Character;
+            if (character == null)
+            {
+                writer.WriteByte(0);
+                return;
+            }
+
+            byte flags = character.Abilities == null ? (byte)3 : (byte)1;
+            if (character.Id != 0)
+                flags |= 4;
+            writer.WriteByte(flags);
+            if (character.Id != 0)
+                writer.WriteVarInt64(character.Id);
+            writer.WriteString(character.Name);
+            writer.WriteVarInt(character.Level);
+            writer.WriteVarInt(character.Health);
+            writer.WriteVarInt(character.Mana);
+            writer.WriteVarInt((int)character.Class);
+            writer.WriteString(character.WeaponType);
+            writer.WriteString(character.ArmorType);
+            if (character.Abilities != null)
+            {
+                writer.WriteVarUInt((uint)character.Abilities.Count);
+                foreach (string ability in character.Abilities)
+                    writer.WriteString(ability);
+            }
+        }
+
+        private static JournalEntry ReadEntry(BinaryRosterReader reader)
+        {
+            var operation = (JournalOperation)reader.ReadByte();
+            long id = reader.ReadVarInt64();
+            if (operation == JournalOperation.Remove)
+                return new JournalEntry(operation, id, null);
+            if (operation != JournalOperation.Add && operation != JournalOperation.Replace)
+                throw new InvalidDataException($"Unknown journal operation {operation}.");
+
+            byte flags = reader.ReadByte();
+            if (flags == 0)
+                return new JournalEntry(operation, id, null);
+
+            var character = new Character
+            {
+                Id = (flags & 4) != 0 ? reader.ReadVarInt64() : 0,
+                Name = reader.ReadString(),
+                Level = reader.ReadVarInt(),
+                Health = reader.ReadVarInt(),
+                Mana = reader.ReadVarInt(),
+                Class = (CharacterClass)reader.ReadVarInt(),
+                WeaponType = reader.ReadString(),
+                ArmorType = reader.ReadString(),
+                Abilities = null
+            };
+
+            if ((flags & 2) == 0)
+            {
+                int count = (int)reader.ReadVarUInt();
+                character.Abilities = new AbilityList(count);
+                for (int i = 0; i < count; i++)
+                    character.Abilities.Add(reader.ReadString());
+            }
+            return new JournalEntry(operation, id, character);
+        }
+
+        // Stops at the first incomplete or corrupt frame, leaving position at its start
+        private static bool TryReadEntry(byte[] data, ref long position, out JournalEntry entry)
+        {
+            entry = default;
+            if (data.Length - position < FrameSize)
+                return false;
+
+            int length = BitConverter.ToInt32(data, (int)position);
+            uint crc = BitConverter.ToUInt32(data, (int)position + 4);
+            if (length <= 0 || length > data.Length - position - FrameSize)
+                return false;
+
+            int start = (int)position + FrameSize;
+            if (Crc32.Compute(new ReadOnlySpan<byte>(data, start, length)) != crc)
+                return false;
+
+            using (var reader = new BinaryRosterReader(new MemoryStream(data, start, length, false)))
+                entry = ReadEntry(reader);
+            position = start + length;
+            return true;
+        }
+
+        private static long FindValidLength(FileStream fs)
+        {
+            var data = new byte[fs.Length];
+            fs.Position = 0;
+            ReadExactly(fs, data, data.Length);
+
+            long position = HeaderSize;
+            while (TryReadEntry(data, ref position, out _))
+            {
+            }
+            return position;
+        }
+
+        private static void WriteHeader(Stream stream, SnapshotFingerprint snapshot)
+        {
+            var header = new byte[HeaderSize];
+            Magic.CopyTo(header, 0);
+            BitConverter.TryWriteBytes(new Span<byte>(header, 4, 2), Version);
+            BitConverter.TryWriteBytes(new Span<byte>(header, 8, 8), snapshot.Length);
+            BitConverter.TryWriteBytes(new Span<byte>(header, 16, 8), snapshot.LastWriteTicks);
+            stream.Write(header, 0, header.Length);
+        }
+
+        private static bool HeaderMatches(FileStream fs, SnapshotFingerprint snapshot)
+        {
+            var header = new byte[HeaderSize];
+            fs.Position = 0;
+            if (fs.Length < HeaderSize)
+                return false;
+            ReadExactly(fs, header, HeaderSize);
+
+            return new ReadOnlySpan<byte>(header, 0, 4).SequenceEqual(Magic) &&
+                BitConverter.ToUInt16(header, 4) == Version &&
+                new SnapshotFingerprint(BitConverter.ToInt64(header, 8), BitConverter.ToInt64(header, 16)).Equals(snapshot);
+        }
+
+        private static FileStream TryOpenRead(string path)
+        {
+            try
+            {
+                return new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite | FileShare.Delete);
+            }
+            catch (FileNotFoundException)
+            {
+                return null;
+            }
+        }
+
+        private static void ReadExactly(Stream stream, byte[] buffer, int count)
+        {
+            int offset = 0;
+            while (offset < count)
+            {
+                int read = stream.Read(buffer, offset, count - offset);
+                if (read == 0)
+                    throw new EndOfStreamException();
+                offset += read;
+            }
+        }
+    }
+
+    // CRC-32 (IEEE 802.3), used to detect torn journal writes
+    internal static class Crc32
+    {
+        private static readonly uint[] Table = CreateTable();
+
+        public static uint Compute(ReadOnlySpan<byte> data)
+        {
+            uint crc = 0xFFFFFFFF;
+            foreach (byte b in data)
+                crc = Table[(crc ^ b) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        private static uint[] CreateTable()
+        {
+            var table = new uint[256];
+            for (uint i = 0; i < table.Length; i++)
+            {
+                uint value = i;
+                for (int bit = 0; bit < 8; bit++)
+                    value = (value & 1) != 0 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+                table[i] = value;
+            }
+            return table;
+        }
+    }
+}
+
+// 16. CharacterStore.cs - Columnar (struct-of-arrays) roster for bulk statistics
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager
+{
+    public enum CharacterColumn
+    {
+        Level,
+        Health,
+        Mana
+    }
+
+    public readonly struct ColumnStatistics
+    {
+        public int Count { get; }
+        public long Sum { get; }
+        public int Min { get; }
+        public int Max { get; }
+
+        public ColumnStatistics(int count, long sum, int min, int max)
+        {
+            Count = count;
+            Sum = sum;
+            Min = min;
+            Max = max;
+        }
+
+        public double Mean => Count == 0 ? 0 : (double)Sum / Count;
+
+        public override string ToString()
+        {
+            return $"count {Count}, sum {Sum}, min {Min}, max {Max}, mean {Mean:F2}";
+        }
+    }
+
+    // Keeps Level/Health/Mana in contiguous int columns and Class/WeaponType/ArmorType as
+    // byte codes, so bulk statistics run over flat arrays instead of chasing Character objects.
+    // Null entries in the source roster are skipped.
+    public sealed class CharacterStore
+    {
+        private const int DefaultCapacity = 1024;
+
+        private long[] _ids;
+        private int[] _levels;
+        private int[] _healths;
+        private int[] _manas;
+        private byte[] _classes;
+        private byte[] _weapons;
+        private byte[] _armors;
+        private string[] _names;
+        private AbilityList[] _abilities;
+        private int _count;
+
+        private readonly CategoryCodes _weaponCodes = new CategoryCodes(nameof(Character.WeaponType));
+        private readonly CategoryCodes _armorCodes = new CategoryCodes(nameof(Character.ArmorType));
+
+        public CharacterStore(int capacity = DefaultCapacity)
+        {
+            capacity = Math.Max(capacity, 1);
+            _ids = new long[capacity];
+            _levels = new int[capacity];
+            _healths = new int[capacity];
+            _manas = new int[capacity];
+            _classes = new byte[capacity];
+            _weapons = new byte[capacity];
+            _armors = new byte[capacity];
+            _names = new string[capacity];
+            _abilities = new AbilityList[capacity];
+        }
+
+        public int Count => _count;
+
+        public ReadOnlySpan<long> Ids => new ReadOnlySpan<long>(_ids, 0, _count);
+        public ReadOnlySpan<int> Levels => new ReadOnlySpan<int>(_levels, 0, _count);
+        public ReadOnlySpan<int> Healths => new ReadOnlySpan<int>(_healths, 0, _count);
+        public ReadOnlySpan<int> Manas => new ReadOnlySpan<int>(_manas, 0, _count);
+        public ReadOnlySpan<byte> Classes => new ReadOnlySpan<byte>(_classes, 0, _count);
+
+        // Codes index WeaponTypes/ArmorTypes; code 0 stands for null
+        public ReadOnlySpan<byte> WeaponCodes => new ReadOnlySpan<byte>(_weapons, 0, _count);
+        public ReadOnlySpan<byte> ArmorCodes => new ReadOnlySpan<byte>(_armors, 0, _count);
+        public IReadOnlyList<string> WeaponTypes => _weaponCodes.Values;
+        public IReadOnlyList<string> ArmorTypes => _armorCodes.Values;
+
+        public ReadOnlySpan<int> GetColumn(CharacterColumn column)
+        {
+            switch (column)
+            {
+                case CharacterColumn.Level:
+                    return Levels;
+                case CharacterColumn.Health:
+                    return Healths;
+                case CharacterColumn.Mana:
+                    return Manas;
+                default:
+                    throw new ArgumentOutOfRangeException(nameof(column));
+            }
+        }
+
+        public static CharacterStore Load(IEnumerable<Character> characters)
+        {
+            var store = new CharacterStore(characters is ICollection<Character> collection ? collection.Count : DefaultCapacity);
+            foreach (Character character in characters)
+            {
+                if (character != null)
+                    store.Add(character);
+            }
+            return store;
+        }
+
+        // Fill columns from the mapped binary roster without materializing Character objects
+        public static CharacterStore Load(MappedCharacterRoster roster)
+        {
+            var store = new CharacterStore(roster.Count);
+            foreach (CharacterRecord record in roster.Records)
+            {
+                if (record.IsNull)
+                    continue;
+
+                int index = store.Reserve();
+                store._ids[index] = record.Id;
+                store._levels[index] = record.Level;
+                store._healths[index] = record.Health;
+                store._manas[index] = record.Mana;
+                store._classes[index] = checked((byte)record.Class);
+                store._weapons[index] = store._weaponCodes.GetCode(record.WeaponType);
+                store._armors[index] = store._armorCodes.GetCode(record.ArmorType);
+                store._names[index] = record.Name;
+                store._abilities[index] = record.GetAbilities();
+            }
+            return store;
+        }
+
+        public void Add(Character character)
+        {
+            if (character == null)
+                throw new ArgumentNullException(nameof(character));
+
+            int index = Reserve();
+            _ids[index] = character.Id;
+            _levels[index] = character.Level;
+            _healths[index] = character.Health;
+            _manas[index] = character.Mana;
+            _classes[index] = checked((byte)character.Class);
+            _weapons[index] = _weaponCodes.GetCode(character.WeaponType);
+            _armors[index] = _armorCodes.GetCode(character.ArmorType);
+            _names[index] = character.Name;
+            _abilities[index] = character.AbilityList;
+        }
+
+        // Materialize one row as a Character
+        public Character GetCharacter(int index)
+        {
+            if ((uint)index >= (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            return new Character
+            {
+                Id = _ids[index],
+                Name = _names[index],
+                Level = _levels[index],
+                Health = _healths[index],
+                Mana = _manas[index],
+                Abilities = _abilities[index] != null ? new AbilityList(_abilities[index]) : null,
+                WeaponType = _weaponCodes.Values[_weapons[index]],
+                Class = (CharacterClass)_classes[index],
+                ArmorType = _armorCodes.Values[_armors[index]]
+            };
+        }
+
+        public List<Character> ToList()
+        {
+            var characters = new List<Character>(_count);
+            for (int i = 0; i < _count; i++)
+                characters.Add(GetCharacter(i));
+            return characters;
+        }
+
+        // Count, sum, min and max of a column in a single vectorized pass
+        public ColumnStatistics GetStatistics(CharacterColumn column)
+        {
+            ReadOnlySpan<int> values = GetColumn(column);
+            if (values.IsEmpty)
+                return default;
+
+            ColumnKernels.Summarize(values, out long sum, out int min, out int max);
+            return new ColumnStatistics(values.Length, sum, min, max);
+        }
+
+        public int CountInRange(CharacterColumn column, int min, int max)
+        {
+            return ColumnKernels.CountInRange(GetColumn(column), min, max);
+        }
+
+        // Buckets of bucketWidth starting at min; values outside the buckets are not counted
+        public int[] Histogram(CharacterColumn column, int min, int bucketWidth, int bucketCount)
+        {
+            var counts = new int[bucketCount];
+            ColumnKernels.Histogram(GetColumn(column), min, bucketWidth, counts);
+            return counts;
+        }
+
+        // Characters per CharacterClass, indexed by the enum value
+        public int[] ClassHistogram()
+        {
+            var counts = new int[Enum.GetValues(typeof(CharacterClass)).Length];
+            ColumnKernels.Histogram(Classes, counts);
+            return counts;
+        }
+
+        private int Reserve()
+        {
+            if (_count == _levels.Length)
+            {
+                int capacity = _levels.Length * 2;
+                Array.Resize(ref _ids, capacity);
+                Array.Resize(ref _levels, capacity);
+                Array.Resize(ref _healths, capacity);
+                Array.Resize(ref _manas, capacity);
+                Array.Resize(ref _classes, capacity);
+                Array.Resize(ref _weapons, capacity);
+                Array.Resize(ref _armors, capacity);
+                Array.Resize(ref _names, capacity);
+                Array.Resize(ref _abilities, capacity);
+            }
+            return _count++;
+        }
+
+        // Maps a small closed set of strings to byte codes, 0 reserved for null
+        private sealed class CategoryCodes
+        {
+            private readonly string _field;
+            private readonly Dictionary<string, byte> _codes = new Dictionary<string, byte>(StringComparer.Ordinal);
+            private readonly List<string> _values = new List<string> { null };
+
+            public CategoryCodes(string field)
+            {
+                _field = field;
+            }
+
+            public IReadOnlyList<string> Values => _values;
+
+            public byte GetCode(string value)
+            {
+                if (value == null)
+                    return 0;
+                if (_codes.TryGetValue(value, out byte code))
+                    return code;
+                if (_values.Count > byte.MaxValue)
+                    throw new InvalidOperationException($"{_field} has more than {byte.MaxValue} distinct values to store as byte codes.");
+
+                code = (byte)_values.Count;
+                _values.Add(value);
+                _codes.Add(value, code);
+                return code;
+            }
+        }
+    }
+}
+
+// 17. ColumnKernels.cs - Vectorized scans over character columns
+using System;
+using System.Numerics;
+using System.Runtime.InteropServices;
+
+namespace GameCharacterManager
+{
+    // Kernels use Vector<T>, which maps to the widest SIMD registers the JIT supports
+    // (AVX2 on current x64, AdvSIMD on ARM64), and finish the tail with scalar code.
+    public static class ColumnKernels
+    {
+        public static long Sum(ReadOnlySpan<int> values)
+        {
+            Summarize(values, out long sum, out _, out _);
+            return sum;
+        }
+
+        public static int Min(ReadOnlySpan<int> values)
+        {
+            Summarize(values, out _, out int min, out _);
+            return min;
+        }
+
+        public static int Max(ReadOnlySpan<int> values)
+        {
+            Summarize(values, out _, out _, out int max);
+            return max;
+        }
+
+        // Sum (widened to long so it cannot overflow), min and max in one pass.
+        // An empty span yields sum 0, min int.MaxValue and max int.MinValue.
+        public static void Summarize(ReadOnlySpan<int> values, out long sum, out int min, out int max)
+        {
+            sum = 0;
+            min = int.MaxValue;
+            max = int.MinValue;
+            int i = 0;
+
+            if (Vector.IsHardwareAccelerated && values.Length >= Vector<int>.Count)
+            {
+                ReadOnlySpan<Vector<int>> vectors = MemoryMarshal.Cast<int, Vector<int>>(values);
+                var sums = Vector<long>.Zero;
+                var mins = new Vector<int>(int.MaxValue);
+                var maxes = new Vector<int>(int.MinValue);
+
+                foreach (Vector<int> vector in vectors)
+                {
+                    Vector.Widen(vector, out Vector<long> low, out Vector<long> high);
+                    sums += low + high;
+                    mins = Vector.Min(mins, vector);
+                    maxes = Vector.Max(maxes, vector);
+                }
+
+                sum = Vector.Sum(sums);
+                for (int lane = 0; lane < Vector<int>.Count; lane++)
+                {
+                    min = Math.Min(min, mins[lane]);
+                    max = Math.Max(max, maxes[lane]);
+                }
+                i = vectors.Length * Vector<int>.Count;
+            }
+
+            for (; i < values.Length; i++)
+            {
+                int value = values[i];
+                sum += value;
+                min = Math.Min(min, value);
+                max = Math.Max(max, value);
+            }
+        }
+
+        // Number of values in [min, max]
+        public static int CountInRange(ReadOnlySpan<int> values, int min, int max)
+        {
+            int count = 0;
+            int i = 0;
+
+            if (Vector.IsHardwareAccelerated && values.Length >= Vector<int>.Count)
+            {
+                ReadOnlySpan<Vector<int>> vectors = MemoryMarshal.Cast<int, Vector<int>>(values);
+                var low = new Vector<int>(min);
+                var high = new Vector<int>(max);
+                var counts = Vector<int>.Zero;
+
+                // Comparison masks are all ones (-1) per matching lane
+                foreach (Vector<int> vector in vectors)
+                    counts -= Vector.GreaterThanOrEqual(vector, low) & Vector.LessThanOrEqual(vector, high);
+
+                count = Vector.Sum(counts);
+                i = vectors.Length * Vector<int>.Count;
+            }
+
+            for (; i < values.Length; i++)
+            {
+                if (values[i] >= min && values[i] <= max)
+                    count++;
+            }
+            return count;
+        }
+
+        // Scatter increments do not vectorize, so histograms count into four interleaved
+        // tables to break the store-to-load dependency between equal neighbouring values.
+        // Offsets are divided by multiplying with a precomputed 64-bit reciprocal, which is
+        // exact for 32-bit dividends (Lemire's fastdiv) and far cheaper than idiv.
+        public static void Histogram(ReadOnlySpan<int> values, int min, int bucketWidth, Span<int> counts)
+        {
+            if (bucketWidth <= 0)
+                throw new ArgumentOutOfRangeException(nameof(bucketWidth));
+
+            int buckets = counts.Length;
+            ulong span = Math.Min((ulong)bucketWidth * (ulong)buckets, 1UL << 32);
+            ulong reciprocal = ulong.MaxValue / (ulong)bucketWidth + 1;
+            int[] tables = new int[buckets * 4];
+
+            for (int i = 0; i < values.Length; i++)
+            {
+                ulong offset = (ulong)((long)values[i] - min);
+                if (offset >= span)
+                    continue;
+
+                int bucket = bucketWidth == 1 ? (int)offset : (int)Math.BigMul(reciprocal, offset, out _);
+                tables[(i & 3) * buckets + bucket]++;
+            }
+
+            for (int b = 0; b < buckets; b++)
+                counts[b] += tables[b] + tables[buckets + b] + tables[2 * buckets + b] + tables[3 * buckets + b];
+        }
+
+        // Histogram of byte codes; codes beyond counts.Length are ignored
+        public static void Histogram(ReadOnlySpan<byte> codes, Span<int> counts)
+        {
+            Span<int> tables = stackalloc int[256 * 4];
+            tables.Clear();
+
+            int i = 0;
+            for (; i + 4 <= codes.Length; i += 4)
+            {
+                tables[codes[i]]++;
+                tables[256 + codes[i + 1]]++;
+                tables[512 + codes[i + 2]]++;
+                tables[768 + codes[i + 3]]++;
+            }
+            for (; i < codes.Length; i++)
+                tables[codes[i]]++;
+
+            for (int code = 0; code < counts.Length && code < 256; code++)
+                counts[code] += tables[code] + tables[256 + code] + tables[512 + code] + tables[768 + code];
+        }
+    }
+}
+
+// 18. AbilityPool.cs - Process-wide ability name table and compact ability lists
+using System;
+using System.Collections;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace GameCharacterManager
+{
+    // Maps each distinct ability name to a small integer id, so characters store ids instead of
+    // their own string copies. Id 0 stands for a null entry. Safe to use from any thread;
+    // ids are never reused or removed for the lifetime of the process.
+    public static class AbilityPool
+    {
+        private static readonly object Sync = new object();
+        private static readonly ConcurrentDictionary<string, int> Ids = new ConcurrentDictionary<string, int>(StringComparer.Ordinal);
+        private static string[] _names = new string[64];
+        private static int _count = 1;
+
+        // Number of distinct abilities interned so far
+        public static int Count => Volatile.Read(ref _count) - 1;
+
+        public static int Intern(string name)
+        {
+            if (name == null)
+                return 0;
+            if (Ids.TryGetValue(name, out int id))
+                return id;
+
+            lock (Sync)
+            {
+                if (Ids.TryGetValue(name, out id))
+                    return id;
+
+                id = _count;
+                if (id == _names.Length)
+                {
+                    var names = new string[_names.Length * 2];
+                    Array.Copy(_names, names, _names.Length);
+                    Volatile.Write(ref _names, names);
+                }
+
+                // Publish the name before the id can be looked up
+                _names[id] = name;
+                Volatile.Write(ref _count, id + 1);
+                Ids[name] = id;
+                return id;
+            }
+        }
+
+        public static bool TryGetId(string name, out int id)
+        {
+            if (name == null)
+            {
+                id = 0;
+                return true;
+            }
+            return Ids.TryGetValue(name, out id);
+        }
+
+        public static string GetName(int id)
+        {
+            string[] names = Volatile.Read(ref _names);
+            if ((uint)id >= (uint)Volatile.Read(ref _count))
+                throw new ArgumentOutOfRangeException(nameof(id));
+            return names[id];
+        }
+    }
+
+    // Translates a binary roster's dictionary ids into AbilityPool ids, interning each
+    // entry the first time it is used as an ability. Concurrent callers race benignly.
+    internal sealed class AbilityIdMap
+    {
+        private readonly string[] _dictionary;
+        private readonly int[] _poolIds;
+
+        public AbilityIdMap(string[] dictionary)
+        {
+            _dictionary = dictionary;
+            _poolIds = new int[dictionary.Length + 1];
+        }
+
+        public int GetPoolId(uint id)
+        {
+            if (id == 0)
+                return 0;
+            if (id > _dictionary.Length)
+                throw new System.IO.InvalidDataException($"Dictionary id {id} is out of range.");
+
+            // Interned names have ids from 1, so 0 marks an entry not mapped yet
+            int poolId = _poolIds[id];
+            if (poolId == 0)
+                _poolIds[id] = poolId = AbilityPool.Intern(_dictionary[id - 1]);
+            return poolId;
+        }
+    }
+
+    // List of abilities stored as AbilityPool ids. Reads return the pooled string instance,
+    // so every "Fireball" in the roster is the same object. Copies share the id array
+    // copy-on-write: whichever list is mutated first takes its own copy.
+    //
+    // Character.Abilities used to be a List<string> and is now an IList<string> backed by this
+    // list. A List<string> assigned to it is copied, and the List<string> methods callers used
+    // are kept below.
+    public sealed class AbilityList : IList<string>, IReadOnlyList<string>
+    {
+        private int[] _ids;
+        private int _count;
+        private bool _shared;
+
+        public AbilityList()
+        {
+            _ids = Array.Empty<int>();
+        }
+
+        public AbilityList(int capacity)
+        {
+            _ids = capacity > 0 ? new int[capacity] : Array.Empty<int>();
+        }
+
+        public AbilityList(IEnumerable<string> abilities)
+        {
+            if (abilities is AbilityList other)
+            {
+                ShareFrom(other);
+                return;
+            }
+
+            _ids = abilities is ICollection<string> collection && collection.Count > 0 ? new int[collection.Count] : Array.Empty<int>();
+            foreach (string ability in abilities)
+                Add(ability);
+        }
+
+        public static implicit operator AbilityList(List<string> abilities)
+        {
+            return abilities == null ? null : new AbilityList(abilities);
+        }
+
+        // O(1) copy sharing this list's storage until either side changes
+        public AbilityList Share()
+        {
+            return new AbilityList(this);
+        }
+
+        // Replace this list's contents with source's, sharing its storage the same way
+        internal void ShareFrom(AbilityList source)
+        {
+            if (source == this)
+                return;
+
+            _ids = source._ids;
+            _count = source._count;
+            _shared = source._shared = true;
+        }
+
+        public int Count => _count;
+
+        public bool IsReadOnly => false;
+
+        // Pool ids of the abilities, in order
+        public ReadOnlySpan<int> Ids => new ReadOnlySpan<int>(_ids, 0, _count);
+
+        public string this[int index]
+        {
+            get
+            {
+                if ((uint)index >= (uint)_count)
+                    throw new ArgumentOutOfRangeException(nameof(index));
+                return AbilityPool.GetName(_ids[index]);
+            }
+            set
+            {
+                if ((uint)index >= (uint)_count)
+                    throw new ArgumentOutOfRangeException(nameof(index));
+                Unshare();
+                _ids[index] = AbilityPool.Intern(value);
+            }
+        }
+
+        public void Add(string ability)
+        {
+            AddId(AbilityPool.Intern(ability));
+        }
+
+        // Append an id already obtained from AbilityPool
+        public void AddId(int id)
+        {
+            if (_count == _ids.Length)
+                Resize(Math.Max(4, _ids.Length * 2));
+            else
+                Unshare();
+            _ids[_count++] = id;
+        }
+
+        public void Insert(int index, string ability)
+        {
+            if ((uint)index > (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            AddId(0);
+            Array.Copy(_ids, index, _ids, index + 1, _count - index - 1);
+            _ids[index] = AbilityPool.Intern(ability);
+        }
+
+        public void RemoveAt(int index)
+        {
+            if ((uint)index >= (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            Unshare();
+            _count--;
+            Array.Copy(_ids, index + 1, _ids, index, _count - index);
+        }
+
+        public bool Remove(string ability)
+        {
+            int index = IndexOf(ability);
+            if (index < 0)
+                return false;
+            RemoveAt(index);
+            return true;
+        }
+
+        // A name that was never interned cannot be in any list
+        public int IndexOf(string ability)
+        {
+            return AbilityPool.TryGetId(ability, out int id) ? Array.IndexOf(_ids, id, 0, _count) : -1;
+        }
+
+        public bool Contains(string ability)
+        {
+            return IndexOf(ability) >= 0;
+        }
+
+        public void Clear()
+        {
+            if (_shared)
+            {
+                _ids = Array.Empty<int>();
+                _shared = false;
+            }
+            _count = 0;
+        }
+
+        public void CopyTo(string[] array, int arrayIndex)
+        {
+            for (int i = 0; i < _count; i++)
+                array[arrayIndex + i] = AbilityPool.GetName(_ids[i]);
+        }
+
+        // The List<string> members beyond IList<string>, with the same behaviour
+        public void AddRange(IEnumerable<string> abilities)
+        {
+            if (abilities == null)
+                throw new ArgumentNullException(nameof(abilities));
+            foreach (string ability in abilities)
+                Add(ability);
+        }
+
+        public void InsertRange(int index, IEnumerable<string> abilities)
+        {
+            if (abilities == null)
+                throw new ArgumentNullException(nameof(abilities));
+            if ((uint)index > (uint)_count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            foreach (string ability in new List<string>(abilities))
+                Insert(index++, ability);
+        }
+
+        public void RemoveRange(int index, int count)
+        {
+            if (index < 0 || count < 0 || _count - index < count)
+                throw new ArgumentOutOfRangeException(index < 0 ? nameof(index) : nameof(count));
+            if (count == 0)
+                return;
+
+            Unshare();
+            _count -= count;
+            Array.Copy(_ids, index + count, _ids, index, _count - index);
+        }
+
+        public int RemoveAll(Predicate<string> match)
+        {
+            if (match == null)
+                throw new ArgumentNullException(nameof(match));
+
+            Unshare();
+            int kept = 0;
+            for (int i = 0; i < _count; i++)
+            {
+                if (!match(AbilityPool.GetName(_ids[i])))
+                    _ids[kept++] = _ids[i];
+            }
+            int removed = _count - kept;
+            _count = kept;
+            return removed;
+        }
+
+        public bool Exists(Predicate<string> match)
+        {
+            return FindIndex(match) >= 0;
+        }
+
+        public string Find(Predicate<string> match)
+        {
+            int index = FindIndex(match);
+            return index >= 0 ? AbilityPool.GetName(_ids[index]) : null;
+        }
+
+        public List<string> FindAll(Predicate<string> match)
+        {
+            if (match == null)
+                throw new ArgumentNullException(nameof(match));
+
+            var found = new List<string>();
+            foreach (string ability in this)
+            {
+                if (match(ability))
+                    found.Add(ability);
+            }
+            return found;
+        }
+
+        public int FindIndex(Predicate<string> match)
+        {
+            if (match == null)
+                throw new ArgumentNullException(nameof(match));
+
+            for (int i = 0; i < _count; i++)
+            {
+                if (match(AbilityPool.GetName(_ids[i])))
+                    return i;
+            }
+            return -1;
+        }
+
+        public bool TrueForAll(Predicate<string> match)
+        {
+            if (match == null)
+                throw new ArgumentNullException(nameof(match));
+            return FindIndex(ability => !match(ability)) < 0;
+        }
+
+        public void ForEach(Action<string> action)
+        {
+            if (action == null)
+                throw new ArgumentNullException(nameof(action));
+            foreach (string ability in this)
+                action(ability);
+        }
+
+        public List<string> GetRange(int index, int count)
+        {
+            if (index < 0 || count < 0 || _count - index < count)
+                throw new ArgumentOutOfRangeException(index < 0 ? nameof(index) : nameof(count));
+
+            var range = new List<string>(count);
+            for (int i = index; i < index + count; i++)
+                range.Add(AbilityPool.GetName(_ids[i]));
+            return range;
+        }
+
+        public string[] ToArray()
+        {
+            var array = new string[_count];
+            CopyTo(array, 0);
+            return array;
+        }
+
+        // Sorted by name like List<string>.Sort; the ids move with their names
+        public void Sort()
+        {
+            Sort(Comparer<string>.Default);
+        }
+
+        public void Sort(Comparison<string> comparison)
+        {
+            if (comparison == null)
+                throw new ArgumentNullException(nameof(comparison));
+            Sort(Comparer<string>.Create(comparison));
+        }
+
+        public void Sort(IComparer<string> comparer)
+        {
+            if (_count < 2)
+                return;
+
+            Unshare();
+            Array.Sort(ToArray(), _ids, 0, _count, comparer ?? Comparer<string>.Default);
+        }
+
+        public void Reverse()
+        {
+            Unshare();
+            Array.Reverse(_ids, 0, _count);
+        }
+
+        public Enumerator GetEnumerator()
+        {
+            return new Enumerator(this);
+        }
+
+        // Take a private copy of shared storage before the first write
+        private void Unshare()
+        {
+            if (_shared)
+                Resize(_ids.Length);
+        }
+
+        private void Resize(int capacity)
+        {
+            var ids = new int[capacity];
+            Array.Copy(_ids, ids, _count);
+            _ids = ids;
+            _shared = false;
+        }
+
+        IEnumerator<string> IEnumerable<string>.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        public struct Enumerator : IEnumerator<string>
+        {
+            private readonly AbilityList _list;
+            private int _index;
+
+            internal Enumerator(AbilityList list)
+            {
+                _list = list;
+                _index = -1;
+            }
+
+            public string Current => AbilityPool.GetName(_list._ids[_index]);
+
+            object IEnumerator.Current => Current;
+
+            public bool MoveNext()
+            {
+                return ++_index < _list._count;
+            }
+
+            public void Reset()
+            {
+                _index = -1;
+            }
+
+            public void Dispose()
+            {
+            }
+        }
+    }
+}
+
+// 19. PrototypeRegistry.cs - Named character templates and bulk spawning
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Threading.Tasks;
+
+namespace GameCharacterManager
+{
+    // Random +/- spread applied to each spawned clone's stats. Clone i draws from
+    // SplitMix64(Seed, i), so a given seed yields the same roster serially or in parallel.
+    public readonly struct StatVariation
+    {
+        private const ulong Golden = 0x9E3779B97F4A7C15;
+
+        public int Level { get; }
+        public int Health { get; }
+        public int Mana { get; }
+        public ulong Seed { get; }
+
+        public StatVariation(int level, int health, int mana, ulong seed)
+        {
+            if (level < 0 || health < 0 || mana < 0)
+                throw new ArgumentOutOfRangeException(level < 0 ? nameof(level) : health < 0 ? nameof(health) : nameof(mana));
+
+            Level = level;
+            Health = health;
+            Mana = mana;
+            Seed = seed;
+        }
+
+        public bool IsNone => Level == 0 && Health == 0 && Mana == 0;
+
+        internal void ApplyTo(Character clone, long index)
+        {
+            ulong state = Seed + (ulong)index * 3 * Golden;
+            if (Level != 0)
+                clone.Level = Math.Max(1, clone.Level + Next(ref state, Level));
+            if (Health != 0)
+                clone.Health = Math.Max(0, clone.Health + Next(ref state, Health));
+            if (Mana != 0)
+                clone.Mana = Math.Max(0, clone.Mana + Next(ref state, Mana));
+        }
+
+        // Uniform in [-spread, spread]
+        private static int Next(ref ulong state, int spread)
+        {
+            state += Golden;
+            ulong z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+            z ^= z >> 31;
+
+            ulong range = (ulong)spread * 2 + 1;
+            return (int)(((z >> 32) * range) >> 32) - spread;
+        }
+    }
+
+    // Templates keyed by name, e.g. "Goblin Lv5 Warrior", and the bulk clone used to spawn them.
+    // The registry keeps its own copy of each prototype, so editing the character that was
+    // registered does not change later spawns. Safe to use from any thread.
+    public class PrototypeRegistry
+    {
+        // Below this many clones a single thread is faster than partitioning the work
+        public const int ParallelThreshold = 16 * 1024;
+
+        private const int ChunkSize = 4096;
+
+        private readonly ConcurrentDictionary<string, Character> _prototypes =
+            new ConcurrentDictionary<string, Character>(StringComparer.Ordinal);
+
+        public int Count => _prototypes.Count;
+
+        public IEnumerable<string> Names => _prototypes.Keys;
+
+        // Add or replace the template stored under name
+        public void Register(string name, Character prototype)
+        {
+            if (name == null)
+                throw new ArgumentNullException(nameof(name));
+            if (prototype == null)
+                throw new ArgumentNullException(nameof(prototype));
+
+            _prototypes[name] = prototype.CopyWithName(prototype.Name);
+        }
+
+        public bool Remove(string name)
+        {
+            return _prototypes.TryRemove(name, out _);
+        }
+
+        public bool Contains(string name)
+        {
+            return _prototypes.ContainsKey(name);
+        }
+
+        // Single instance of a template, or null when no template has that name
+        public Character Spawn(string name)
+        {
+            return _prototypes.TryGetValue(name, out Character prototype)
+                ? prototype.CloneWithName(prototype.Name)
+                : null;
+        }
+
+        public Character[] SpawnMany(string name, int count, StatVariation variation = default, Action<Character, int> mutator = null)
+        {
+            if (!_prototypes.TryGetValue(name, out Character prototype))
+                throw new KeyNotFoundException($"No prototype named '{name}'.");
+
+            return CloneMany(prototype, count, variation, mutator);
+        }
+
+        // SpawnMany into a caller-owned array, drawing the instances from pool
+        public void SpawnMany(string name, Character[] destination, int offset, int count, CharacterPool pool,
+                              StatVariation variation = default, Action<Character, int> mutator = null)
+        {
+            if (!_prototypes.TryGetValue(name, out Character prototype))
+                throw new KeyNotFoundException($"No prototype named '{name}'.");
+
+            CloneMany(prototype, destination, offset, count, variation, mutator, pool);
+        }
+
+        public static Character[] CloneMany(Character prototype, int count, StatVariation variation = default, Action<Character, int> mutator = null)
+        {
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            var clones = new Character[count];
+            CloneMany(prototype, clones, 0, count, variation, mutator);
+            return clones;
+        }
+
+        // Fill destination[offset..offset+count) with clones of prototype. Clones keep the
+        // prototype's name and share its ability storage copy-on-write; variation is applied
+        // before mutator, which receives the clone and its index within the batch. With a pool,
+        // the clones are rented from it instead of allocated.
+        public static void CloneMany(Character prototype, Character[] destination, int offset, int count,
+                                     StatVariation variation = default, Action<Character, int> mutator = null,
+                                     CharacterPool pool = null)
+        {
+            if (prototype == null)
+                throw new ArgumentNullException(nameof(prototype));
+            if (destination == null)
+                throw new ArgumentNullException(nameof(destination));
+            if (offset < 0 || count < 0 || offset > destination.Length - count)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            RosterMetrics.Cloned(count);
+            using (RosterMetrics.Start("clone", "bulk", count < ParallelThreshold))
+            {
+                if (count < ParallelThreshold)
+                {
+                    CloneRange(prototype, destination, offset, 0, count, variation, mutator, pool);
+                    return;
+                }
+
+                // Whole chunks per task keep delegate overhead and false sharing on destination low
+                int chunks = (count + ChunkSize - 1) / ChunkSize;
+                Parallel.For(0, chunks, chunk =>
+                {
+                    int start = chunk * ChunkSize;
+                    CloneRange(prototype, destination, offset, start, Math.Min(count, start + ChunkSize), variation, mutator, pool);
+                });
+            }
+        }
+
+        private static void CloneRange(Character prototype, Character[] destination, int offset, int start, int end,
+                                       StatVariation variation, Action<Character, int> mutator, CharacterPool pool)
+        {
+            string name = prototype.Name;
+            bool vary = !variation.IsNone;
+
+            // One pool lock per chunk rather than per clone
+            pool?.Rent(destination, offset + start, end - start);
+
+            for (int i = start; i < end; i++)
+            {
+                Character clone;
+                if (pool != null)
+                {
+                    clone = destination[offset + i];
+                    clone.CopyFrom(prototype, name);
+                }
+                else
+                {
+                    clone = prototype.CopyWithName(name);
+                }
+                if (vary)
+                    variation.ApplyTo(clone, i);
+                mutator?.Invoke(clone, i);
+                destination[offset + i] = clone;
+            }
+        }
+    }
+}
+
+// 20. CharacterPool.cs - Reusable Character instances for reload and spawn loops
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager
+{
+    // Keeps returned characters, and their ability storage, for the next Rent instead of
+    // leaving them to the GC. A returned character is reset to the state of new Character();
+    // it must not be used or returned again by the caller afterwards. Safe to use from any thread.
+    public sealed class CharacterPool
+    {
+        public const int DefaultMaxRetained = 1024 * 1024;
+
+        private readonly object _sync = new object();
+        private readonly int _maxRetained;
+        private Character[] _items = new Character[64];
+        private int _count;
+
+        public CharacterPool(int maxRetained = DefaultMaxRetained)
+        {
+            if (maxRetained < 0)
+                throw new ArgumentOutOfRangeException(nameof(maxRetained));
+
+            _maxRetained = maxRetained;
+        }
+
+        public static CharacterPool Shared { get; } = new CharacterPool();
+
+        public int MaxRetained => _maxRetained;
+
+        // Characters waiting to be rented
+        public int Count
+        {
+            get
+            {
+                lock (_sync)
+                {
+                    return _count;
+                }
+            }
+        }
+
+        // A character in its default state, reused when one is available
+        public Character Rent()
+        {
+            lock (_sync)
+            {
+                if (_count > 0)
+                {
+                    Character character = _items[--_count];
+                    _items[_count] = null;
+                    return character;
+                }
+            }
+            return new Character();
+        }
+
+        // Fill destination[offset..offset+count) under one lock, allocating only what the pool lacks
+        public void Rent(Character[] destination, int offset, int count)
+        {
+            if (destination == null)
+                throw new ArgumentNullException(nameof(destination));
+            if (offset < 0 || count < 0 || offset > destination.Length - count)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            int taken;
+            lock (_sync)
+            {
+                taken = Math.Min(count, _count);
+                _count -= taken;
+                Array.Copy(_items, _count, destination, offset, taken);
+                Array.Clear(_items, _count, taken);
+            }
+
+            for (int i = taken; i < count; i++)
+                destination[offset + i] = new Character();
+        }
+
+        public void Return(Character character)
+        {
+            if (character == null)
+                return;
+
+            character.Reset();
+            lock (_sync)
+            {
+                if (_count < _maxRetained)
+                    Push(character);
+            }
+        }
+
+        // Return every character in the list and leave it empty, keeping its capacity
+        public void ReturnAll(List<Character> characters)
+        {
+            if (characters == null)
+                return;
+
+            foreach (Character character in characters)
+                character?.Reset();
+
+            lock (_sync)
+            {
+                foreach (Character character in characters)
+                {
+                    if (_count == _maxRetained)
+                        break;
+                    if (character != null)
+                        Push(character);
+                }
+            }
+            characters.Clear();
+        }
+
+        // Drop everything retained
+        public void Clear()
+        {
+            lock (_sync)
+            {
+                Array.Clear(_items, 0, _count);
+                _count = 0;
+            }
+        }
+
+        private void Push(Character character)
+        {
+            if (_count == _items.Length)
+                Array.Resize(ref _items, (int)Math.Min(_maxRetained, _items.Length * 2L));
+            _items[_count++] = character;
+        }
+    }
+}
+
+// 21. CharacterRoster.cs - Id-keyed roster with hash and sorted secondary indexes
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace GameCharacterManager
+{
+    // The character list the UI edits, with indexes kept current by Add, Replace and Remove:
+    // Id and Name are hashed (O(1)), Level and Class are sorted (O(log n)). A character joining
+    // without an Id, or with one already taken, gets the next free Id. Call Replace after
+    // editing a character in place so the secondary indexes see the change.
+    //
+    // Entries keep the slot they were added in. Removing one leaves its slot empty instead of
+    // moving every later entry, and positions are counted over the live slots in O(log n).
+    // The gaps are closed in one pass once they outnumber the characters.
+    public sealed class CharacterRoster : IReadOnlyList<Character>
+    {
+        // Fewest empty slots worth a pass to close
+        private const int MinGapsToClose = 64;
+
+        private readonly List<Entry> _slots;
+        private readonly PositionTree _positions;
+        private int _count;
+        private readonly Dictionary<long, Entry> _byId = new Dictionary<long, Entry>();
+        private readonly Dictionary<string, HashSet<long>> _byName = new Dictionary<string, HashSet<long>>(StringComparer.Ordinal);
+        private readonly SortedSet<(int Level, long Id)> _byLevel = new SortedSet<(int Level, long Id)>();
+        private readonly SortedSet<(CharacterClass Class, long Id)> _byClass = new SortedSet<(CharacterClass Class, long Id)>();
+        private NameSearchIndex _nameSearch;
+        private AbilityIndex _abilityIndex;
+        private long _nextId = 1;
+
+        public CharacterRoster()
+            : this(new List<Character>())
+        {
+        }
+
+        // Indexes a loaded list, whose characters may get new Ids; null entries keep their place
+        // but are not indexed. Later changes go to the roster, not the list.
+        public CharacterRoster(List<Character> characters)
+        {
+            if (characters == null)
+                throw new ArgumentNullException(nameof(characters));
+
+            _nextId = AssignIds(characters);
+            _slots = new List<Entry>(characters.Count);
+            for (int i = 0; i < characters.Count; i++)
+                _slots.Add(Index(characters[i], i));
+            _count = characters.Count;
+            _positions = new PositionTree(_count);
+            RosterMetrics.Track(this);
+        }
+
+        // Number the characters that have no Id, or one taken earlier in the list, from one past
+        // the highest saved Id, as a roster over the list does; returns the next free Id. The
+        // repository applies it to loaded lists so journal entries find the same Ids on replay.
+        public static long AssignIds(IList<Character> characters)
+        {
+            if (characters == null)
+                throw new ArgumentNullException(nameof(characters));
+
+            // Saved Ids win over newly assigned ones, wherever they appear in the list
+            long nextId = 1;
+            bool ascending = true;
+            long previous = 0;
+            foreach (Character character in characters)
+            {
+                if (character == null)
+                    continue;
+                if (character.Id >= nextId)
+                    nextId = character.Id + 1;
+                ascending &= character.Id > previous;
+                previous = character.Id;
+            }
+
+            // Ascending Ids are all present and distinct, the usual case for a saved roster
+            if (ascending)
+                return nextId;
+
+            var seen = new HashSet<long>();
+            foreach (Character character in characters)
+            {
+                if (character == null)
+                    continue;
+                if (character.Id <= 0 || !seen.Add(character.Id))
+                {
+                    character.Id = nextId++;
+                    seen.Add(character.Id);
+                }
+            }
+            return nextId;
+        }
+
+        // The same numbering over the Ids alone, as read by CharacterJsonCodec.ReadIds; a null
+        // character comes back as 0
+        internal static long[] AssignIds(List<long?> savedIds)
+        {
+            var ids = new long[savedIds.Count];
+            long nextId = 1;
+            bool ascending = true;
+            long previous = 0;
+            for (int i = 0; i < ids.Length; i++)
+            {
+                if (savedIds[i] is not long id)
+                    continue;
+                if (id >= nextId)
+                    nextId = id + 1;
+                ascending &= id > previous;
+                previous = id;
+                ids[i] = id;
+            }
+
+            if (ascending)
+                return ids;
+
+            var seen = new HashSet<long>();
+            for (int i = 0; i < ids.Length; i++)
+            {
+                if (savedIds[i] == null)
+                    continue;
+                if (ids[i] <= 0 || !seen.Add(ids[i]))
+                {
+                    ids[i] = nextId++;
+                    seen.Add(ids[i]);
+                }
+            }
+            return ids;
+        }
+
+        public int Count => _count;
+
+        // O(1) until something is removed, O(log n) while there are empty slots
+        public Character this[int index]
+        {
+            get
+            {
+                if ((uint)index >= (uint)_count)
+                    throw new ArgumentOutOfRangeException(nameof(index));
+                return _slots[HasGaps ? _positions.Select(index) : index].Character;
+            }
+        }
+
+        private bool HasGaps => _slots.Count != _count;
+
+        // The characters in roster order, e.g. for the repository's save methods
+        public List<Character> ToList()
+        {
+            var characters = new List<Character>(_count);
+            foreach (Character character in this)
+                characters.Add(character);
+            return characters;
+        }
+
+        public void Add(Character character)
+        {
+            if (character == null)
+                throw new ArgumentNullException(nameof(character));
+
+            _slots.Add(Index(character, _slots.Count));
+            _positions.Append();
+            _count++;
+            RosterMetrics.RosterChanged("add");
+        }
+
+        // Put character in the place of the one with the same Id and reindex it; returns its position
+        public int Replace(Character character)
+        {
+            if (character == null)
+                throw new ArgumentNullException(nameof(character));
+            if (!_byId.TryGetValue(character.Id, out Entry entry))
+                throw new KeyNotFoundException($"No character with Id {character.Id}.");
+
+            RemoveKeys(entry);
+            entry.Character = character;
+            AddKeys(entry);
+            RosterMetrics.RosterChanged("replace");
+            return PositionOf(entry);
+        }
+
+        // Remove by Id in O(log n); returns the position it had, or -1 when there was none
+        public int Remove(long id)
+        {
+            if (!_byId.TryGetValue(id, out Entry entry))
+                return -1;
+
+            int position = PositionOf(entry);
+            RemoveKeys(entry);
+            _byId.Remove(id);
+            _slots[entry.Slot] = null;
+            _positions.Remove(entry.Slot);
+            _count--;
+
+            // Closing the gaps costs O(n) once per n removals
+            if (_slots.Count - _count > Math.Max(_count, MinGapsToClose))
+                CloseGaps();
+            RosterMetrics.RosterChanged("remove");
+            return position;
+        }
+
+        public bool Contains(long id)
+        {
+            return _byId.ContainsKey(id);
+        }
+
+        public Character FindById(long id)
+        {
+            return _byId.TryGetValue(id, out Entry entry) ? entry.Character : null;
+        }
+
+        public int IndexOf(long id)
+        {
+            return _byId.TryGetValue(id, out Entry entry) ? PositionOf(entry) : -1;
+        }
+
+        public IEnumerable<Character> FindByName(string name)
+        {
+            if (name == null || !_byName.TryGetValue(name, out HashSet<long> ids))
+                yield break;
+
+            foreach (long id in ids)
+                yield return _byId[id].Character;
+        }
+
+        // Characters with min <= Level <= max, by Level then Id
+        public IEnumerable<Character> InLevelRange(int min, int max)
+        {
+            if (min > max)
+                yield break;
+
+            foreach ((int _, long id) in _byLevel.GetViewBetween((min, long.MinValue), (max, long.MaxValue)))
+                yield return _byId[id].Character;
+        }
+
+        public IEnumerable<Character> OfClass(CharacterClass characterClass)
+        {
+            foreach ((CharacterClass _, long id) in _byClass.GetViewBetween((characterClass, long.MinValue), (characterClass, long.MaxValue)))
+                yield return _byId[id].Character;
+        }
+
+        public IEnumerable<Character> OrderedByLevel()
+        {
+            foreach ((int _, long id) in _byLevel)
+                yield return _byId[id].Character;
+        }
+
+        // Prefix, then substring name matches ignoring case, or fuzzy ones when there are
+        // none; see NameSearchIndex.Search. The search index is
+        // built on the first call and kept up to date by Add, Replace and Remove from then on.
+        public List<Character> SearchNames(string text, int limit)
+        {
+            if (_nameSearch == null)
+            {
+                _nameSearch = new NameSearchIndex();
+                foreach (Entry entry in _slots)
+                {
+                    if (entry?.Character != null)
+                        _nameSearch.Add(entry.Id, entry.Name);
+                }
+            }
+
+            List<NameMatch> matches = _nameSearch.Search(text, limit);
+            var results = new List<Character>(matches.Count);
+            foreach (NameMatch match in matches)
+                results.Add(_byId[match.Id].Character);
+            return results;
+        }
+
+        // Bitmaps of Ids per ability, built on first use and kept up to date like the search index
+        public AbilityIndex AbilityIndex
+        {
+            get
+            {
+                if (_abilityIndex == null)
+                {
+                    _abilityIndex = new AbilityIndex();
+                    foreach (Entry entry in _byId.Values)
+                    {
+                        entry.Abilities = AbilitySnapshot(entry.Character);
+                        _abilityIndex.Add(entry.Id, entry.Abilities);
+                    }
+                }
+                return _abilityIndex;
+            }
+        }
+
+        // Characters having all of all, any of any (unless null or empty) and none of none, by Id
+        public List<Character> WithAbilities(IEnumerable<string> all, IEnumerable<string> any = null, IEnumerable<string> none = null)
+        {
+            CharacterBitmap ids = AbilityIndex.Query(all, any, none);
+            var results = new List<Character>((int)ids.Cardinality);
+            foreach (long id in ids)
+                results.Add(_byId[id].Character);
+            return results;
+        }
+
+        public Enumerator GetEnumerator()
+        {
+            return new Enumerator(this);
+        }
+
+        IEnumerator<Character> IEnumerable<Character>.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        private int PositionOf(Entry entry)
+        {
+            return HasGaps ? _positions.Rank(entry.Slot) : entry.Slot;
+        }
+
+        private void CloseGaps()
+        {
+            int live = 0;
+            for (int slot = 0; slot < _slots.Count; slot++)
+            {
+                Entry entry = _slots[slot];
+                if (entry == null)
+                    continue;
+                entry.Slot = live;
+                _slots[live++] = entry;
+            }
+            _slots.RemoveRange(live, _slots.Count - live);
+            _positions.Reset(live);
+        }
+
+        private Entry Index(Character character, int slot)
+        {
+            if (character == null)
+                return new Entry(null, slot);
+
+            if (character.Id <= 0 || _byId.ContainsKey(character.Id))
+                character.Id = _nextId++;
+            else if (character.Id >= _nextId)
+                _nextId = character.Id + 1;
+
+            var entry = new Entry(character, slot);
+            _byId.Add(character.Id, entry);
+            AddKeys(entry);
+            return entry;
+        }
+
+        // The indexed values are copied into the entry, so the old keys can be found
+        // again even after the character was edited in place
+        private void AddKeys(Entry entry)
+        {
+            Character character = entry.Character;
+            entry.Name = character.Name;
+            entry.Level = character.Level;
+            entry.Class = character.Class;
+
+            if (entry.Name != null)
+            {
+                if (!_byName.TryGetValue(entry.Name, out HashSet<long> ids))
+                {
+                    ids = new HashSet<long>();
+                    _byName.Add(entry.Name, ids);
+                }
+                ids.Add(entry.Id);
+                _nameSearch?.Add(entry.Id, entry.Name);
+            }
+            _byLevel.Add((entry.Level, entry.Id));
+            _byClass.Add((entry.Class, entry.Id));
+
+            if (_abilityIndex != null)
+            {
+                entry.Abilities = AbilitySnapshot(character);
+                _abilityIndex.Add(entry.Id, entry.Abilities);
+            }
+        }
+
+        private void RemoveKeys(Entry entry)
+        {
+            long id = entry.Id;
+            if (entry.Name != null && _byName.TryGetValue(entry.Name, out HashSet<long> ids))
+            {
+                ids.Remove(id);
+                if (ids.Count == 0)
+                    _byName.Remove(entry.Name);
+                _nameSearch?.Remove(id, entry.Name);
+            }
+            _byLevel.Remove((entry.Level, id));
+            _byClass.Remove((entry.Class, id));
+            _abilityIndex?.Remove(id, entry.Abilities);
+        }
+
+        private static int[] AbilitySnapshot(Character character)
+        {
+            AbilityList abilities = character.AbilityList;
+            return abilities == null || abilities.Count == 0 ? Array.Empty<int>() : abilities.Ids.ToArray();
+        }
+
+        // A null character still holds its place, without an Id or keys
+        private sealed class Entry
+        {
+            public readonly long Id;
+            public Character Character;
+            public int Slot;
+            public string Name;
+            public int Level;
+            public CharacterClass Class;
+            public int[] Abilities;
+
+            public Entry(Character character, int slot)
+            {
+                Id = character?.Id ?? 0;
+                Character = character;
+                Slot = slot;
+            }
+        }
+
+        public struct Enumerator : IEnumerator<Character>
+        {
+            private readonly List<Entry> _slots;
+            private int _slot;
+            private Character _current;
+
+            internal Enumerator(CharacterRoster roster)
+            {
+                _slots = roster._slots;
+                _slot = -1;
+                _current = null;
+            }
+
+            public Character Current => _current;
+
+            object IEnumerator.Current => _current;
+
+            public bool MoveNext()
+            {
+                while (++_slot < _slots.Count)
+                {
+                    Entry entry = _slots[_slot];
+                    if (entry != null)
+                    {
+                        _current = entry.Character;
+                        return true;
+                    }
+                }
+                _current = null;
+                return false;
+            }
+
+            public void Reset()
+            {
+                _slot = -1;
+                _current = null;
+            }
+
+            public void Dispose()
+            {
+            }
+        }
+    }
+
+    // Fenwick tree over one flag per slot, set while the slot holds a character: the position
+    // of a slot (rank) and the slot at a position (select) are both O(log n). Public for
+    // Rabotaet.cpp's roster, which keeps its slots the same way.
+    public sealed class PositionTree
+    {
+        // 1-based; _tree[i] counts the live slots in (i - lowbit(i), i]
+        private int[] _tree;
+        private int _size;
+
+        public PositionTree(int liveSlots)
+        {
+            Reset(liveSlots);
+        }
+
+        // Slots [0, count), all live, built in O(count)
+        public void Reset(int count)
+        {
+            _tree = new int[Math.Max(count, 4) + 1];
+            _size = count;
+            for (int i = 1; i <= count; i++)
+            {
+                _tree[i]++;
+                int parent = i + (i & -i);
+                if (parent <= count)
+                    _tree[parent] += _tree[i];
+            }
+        }
+
+        // A new live slot after the last one
+        public void Append()
+        {
+            if (_size + 1 == _tree.Length)
+                Array.Resize(ref _tree, _tree.Length * 2);
+
+            int i = ++_size;
+            _tree[i] = 1 + Prefix(i - 1) - Prefix(i - (i & -i));
+        }
+
+        public void Remove(int slot)
+        {
+            for (int i = slot + 1; i <= _size; i += i & -i)
+                _tree[i]--;
+        }
+
+        // Live slots before slot
+        public int Rank(int slot)
+        {
+            return Prefix(slot);
+        }
+
+        // The live slot with position live slots before it
+        public int Select(int position)
+        {
+            int slot = 0;
+            int remaining = position + 1;
+            for (int step = 1 << (31 - BitOperations.LeadingZeroCount((uint)_size)); step > 0; step >>= 1)
+            {
+                int next = slot + step;
+                if (next <= _size && _tree[next] < remaining)
+                {
+                    slot = next;
+                    remaining -= _tree[next];
+                }
+            }
+            return slot;
+        }
+
+        private int Prefix(int i)
+        {
+            int sum = 0;
+            for (; i > 0; i -= i & -i)
+                sum += _tree[i];
+            return sum;
+        }
+    }
+}
+
+// 22. CharacterQuery.cs - Query language over character fields, compiled to cached delegates
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Linq.Expressions;
+using System.Text;
+
+namespace GameCharacterManager
+{
+    // Syntax:  [filter] [order by Field [asc | desc], ...] [limit N]
+    //   filter      comparisons joined with and, or, not and parentheses
+    //   comparison  Field (= | != | < | <= | > | >=) value
+    //               Name / WeaponType / ArmorType (contains | startswith) 'text'
+    //               Abilities contains 'name'
+    //   value       integer, 'single' or "double" quoted string, bare word, null
+    // Fields are Id, Name, Level, Health, Mana, Class, WeaponType, ArmorType and Abilities.
+    // Fields and keywords ignore case; = on strings is ordinal, contains and startswith ignore case.
+    // Example: Class = Mage and Level > 50 and Mana < 100 order by Health
+    //
+    // A query compiles its filter and ordering into delegates once, and Parse caches queries by
+    // text. Against a CharacterRoster the most selective indexed condition supplies candidates;
+    // against a mapped binary file the filter runs on record headers before materializing.
+    public sealed class CharacterQuery
+    {
+        private const int CacheLimit = 256;
+        private static readonly ConcurrentDictionary<string, CharacterQuery> Cache =
+            new ConcurrentDictionary<string, CharacterQuery>(StringComparer.Ordinal);
+
+        private readonly QueryNode _filter;
+        private readonly OrderKey[] _order;
+        private readonly Func<Character, bool> _predicate;
+        private readonly Func<CharacterRecord, bool> _recordPredicate;
+        private readonly bool _recordPredicateIsExact;
+        private readonly Comparison<Character> _comparison;
+        private readonly IndexAccess _index;
+
+        private CharacterQuery(string text, QueryNode filter, OrderKey[] order, int limit)
+        {
+            Text = text;
+            Limit = limit;
+            _filter = filter;
+            _order = order;
+
+            if (filter != null)
+            {
+                _predicate = Compile<Character>(filter);
+                QueryNode headerFilter = filter.WithoutAbilities();
+                if (headerFilter != null)
+                    _recordPredicate = Compile<CharacterRecord>(headerFilter);
+                _recordPredicateIsExact = headerFilter == filter;
+            }
+            _comparison = CompileOrder(order);
+            _index = IndexAccess.Choose(filter);
+        }
+
+        public string Text { get; }
+
+        // Maximum number of results, or -1 for all
+        public int Limit { get; }
+
+        // Parse a query, or reuse the compiled one for the same text
+        public static CharacterQuery Parse(string text)
+        {
+            if (text == null)
+                throw new ArgumentNullException(nameof(text));
+            if (Cache.TryGetValue(text, out CharacterQuery cached))
+                return cached;
+
+            CharacterQuery query = new QueryParser(text).ParseQuery();
+            if (Cache.Count >= CacheLimit)
+                Cache.Clear();
+            return Cache.GetOrAdd(text, query);
+        }
+
+        public List<Character> Execute(CharacterRoster roster)
+        {
+            if (roster == null)
+                throw new ArgumentNullException(nameof(roster));
+
+            using (RosterMetrics.Start("query", "roster"))
+            {
+                if (_index == null || !_index.IsSelective(roster))
+                    return Scan(roster);
+
+                var matches = new List<Character>();
+                foreach (Character character in _index.Candidates(roster))
+                {
+                    if (_predicate(character))
+                        matches.Add(character);
+                }
+
+                // Candidates come in index order; put matches back in roster order so every path
+                // returns the same sequence
+                if (matches.Count > 1)
+                {
+                    Character[] items = matches.ToArray();
+                    var positions = new int[items.Length];
+                    for (int i = 0; i < items.Length; i++)
+                        positions[i] = roster.IndexOf(items[i].Id);
+                    Array.Sort(positions, items);
+                    matches.Clear();
+                    matches.AddRange(items);
+                }
+                return Finish(matches);
+            }
+        }
+
+        public List<Character> Execute(IEnumerable<Character> characters)
+        {
+            if (characters == null)
+                throw new ArgumentNullException(nameof(characters));
+
+            using (RosterMetrics.Start("query", "list"))
+            {
+                return Scan(characters);
+            }
+        }
+
+        private List<Character> Scan(IEnumerable<Character> characters)
+        {
+            var matches = new List<Character>();
+            foreach (Character character in characters)
+            {
+                if (character == null || _predicate != null && !_predicate(character))
+                    continue;
+                matches.Add(character);
+                if (_comparison == null && matches.Count == Limit)
+                    break;
+            }
+            return Finish(matches);
+        }
+
+        // Lazy Execute for rosters too large to hold: matches are yielded as the source is read.
+        // An order by needs every match first, so it falls back to Execute.
+        public IEnumerable<Character> Filter(IEnumerable<Character> characters)
+        {
+            if (characters == null)
+                throw new ArgumentNullException(nameof(characters));
+            return _comparison == null ? FilterIterator(characters) : Execute(characters);
+        }
+
+        private IEnumerable<Character> FilterIterator(IEnumerable<Character> characters)
+        {
+            int count = 0;
+            if (count == Limit)
+                yield break;
+            foreach (Character character in characters)
+            {
+                if (character == null || _predicate != null && !_predicate(character))
+                    continue;
+                yield return character;
+                if (++count == Limit)
+                    yield break;
+            }
+        }
+
+        // Scan a mapped binary roster; only records passing the header filter are materialized
+        public List<Character> Execute(MappedCharacterRoster roster)
+        {
+            if (roster == null)
+                throw new ArgumentNullException(nameof(roster));
+
+            using (RosterMetrics.Start("query", "mapped"))
+            {
+                var matches = new List<Character>();
+                foreach (CharacterRecord record in roster.Records)
+                {
+                    if (record.IsNull || _recordPredicate != null && !_recordPredicate(record))
+                        continue;
+
+                    Character character = record.ToCharacter();
+                    if (!_recordPredicateIsExact && !_predicate(character))
+                        continue;
+                    matches.Add(character);
+                    if (_comparison == null && matches.Count == Limit)
+                        break;
+                }
+                return Finish(matches);
+            }
+        }
+
+        public string Explain(CharacterRoster roster)
+        {
+            bool indexed = _index != null && _index.IsSelective(roster);
+            string access;
+            if (indexed)
+                access = $"{_index.Description} on a roster of {roster.Count}";
+            else if (_index != null)
+                access = $"full scan of a roster of {roster.Count}, {_index.Description} matches too much of it";
+            else
+                access = $"full scan of a roster of {roster.Count}";
+            return Explain(access, _filter == null ? "none" : indexed ? "compiled predicate on each candidate" : "compiled predicate on each character");
+        }
+
+        public string Explain(IEnumerable<Character> characters)
+        {
+            return Explain("sequential scan", _filter == null ? "none" : "compiled predicate on each character");
+        }
+
+        public string Explain(MappedCharacterRoster roster)
+        {
+            string filter;
+            if (_filter == null)
+                filter = "none";
+            else if (_recordPredicateIsExact)
+                filter = "compiled predicate on record headers, only matches are materialized";
+            else if (_recordPredicate != null)
+                filter = "record headers pre-filtered without Abilities terms, full predicate after materializing";
+            else
+                filter = "every record materialized, then compiled predicate";
+            return Explain($"mapped file scan of {roster.Count} records", filter);
+        }
+
+        public override string ToString()
+        {
+            var text = new StringBuilder();
+            if (_filter != null)
+                text.Append(_filter);
+            if (_order.Length > 0)
+            {
+                text.Append(text.Length > 0 ? " order by " : "order by ");
+                text.Append(string.Join(", ", (object[])_order));
+            }
+            if (Limit >= 0)
+                text.Append(text.Length > 0 ? " limit " : "limit ").Append(Limit);
+            return text.ToString();
+        }
+
+        private string Explain(string access, string filter)
+        {
+            var text = new StringBuilder();
+            text.AppendLine($"Query:  {this}");
+            text.AppendLine($"Access: {access}");
+            text.AppendLine($"Filter: {filter}");
+            text.AppendLine($"Order:  {(_order.Length > 0 ? string.Join(", ", (object[])_order) + " (stable)" : "source order")}");
+            text.Append($"Limit:  {(Limit >= 0 ? Limit.ToString(CultureInfo.InvariantCulture) : "none")}");
+            return text.ToString();
+        }
+
+        // Stable sort, then the limit
+        private List<Character> Finish(List<Character> matches)
+        {
+            if (_comparison != null && matches.Count > 1)
+            {
+                Character[] items = matches.ToArray();
+                var order = new int[items.Length];
+                for (int i = 0; i < order.Length; i++)
+                    order[i] = i;
+
+                Array.Sort(order, (a, b) =>
+                {
+                    int result = _comparison(items[a], items[b]);
+                    return result != 0 ? result : a.CompareTo(b);
+                });
+                for (int i = 0; i < order.Length; i++)
+                    matches[i] = items[order[i]];
+            }
+
+            if (Limit >= 0 && matches.Count > Limit)
+                matches.RemoveRange(Limit, matches.Count - Limit);
+            return matches;
+        }
+
+        private static Func<T, bool> Compile<T>(QueryNode filter)
+        {
+            ParameterExpression target = Expression.Parameter(typeof(T), "character");
+            return Expression.Lambda<Func<T, bool>>(filter.Build(target), target).Compile();
+        }
+
+        private static Comparison<Character> CompileOrder(OrderKey[] order)
+        {
+            if (order.Length == 0)
+                return null;
+
+            var comparisons = new Comparison<Character>[order.Length];
+            for (int i = 0; i < order.Length; i++)
+            {
+                OrderKey key = order[i];
+                ParameterExpression target = Expression.Parameter(typeof(Character), "character");
+                Expression value = Expression.Property(target, key.Field.ToString());
+                Comparison<Character> comparison;
+                if (value.Type == typeof(string))
+                {
+                    Func<Character, string> getter = Expression.Lambda<Func<Character, string>>(value, target).Compile();
+                    comparison = (a, b) => string.CompareOrdinal(getter(a), getter(b));
+                }
+                else
+                {
+                    Func<Character, long> getter = Expression.Lambda<Func<Character, long>>(Expression.Convert(value, typeof(long)), target).Compile();
+                    comparison = (a, b) => getter(a).CompareTo(getter(b));
+                }
+                comparisons[i] = key.Descending ? (a, b) => comparison(b, a) : comparison;
+            }
+
+            if (comparisons.Length == 1)
+                return comparisons[0];
+            return (a, b) =>
+            {
+                foreach (Comparison<Character> comparison in comparisons)
+                {
+                    int result = comparison(a, b);
+                    if (result != 0)
+                        return result;
+                }
+                return 0;
+            };
+        }
+
+        internal enum QueryField
+        {
+            Id,
+            Name,
+            Level,
+            Health,
+            Mana,
+            Class,
+            WeaponType,
+            ArmorType,
+            Abilities
+        }
+
+        internal enum QueryOperator
+        {
+            Equal,
+            NotEqual,
+            Less,
+            LessOrEqual,
+            Greater,
+            GreaterOrEqual,
+            Contains,
+            StartsWith
+        }
+
+        private sealed class OrderKey
+        {
+            public readonly QueryField Field;
+            public readonly bool Descending;
+
+            public OrderKey(QueryField field, bool descending)
+            {
+                Field = field;
+                Descending = descending;
+            }
+
+            public override string ToString() => Descending ? $"{Field} desc" : $"{Field} asc";
+        }
+
+        private abstract class QueryNode
+        {
+            // Expression over a Character or CharacterRecord, which share property names
+            public abstract Expression Build(Expression target);
+
+            // This filter with Abilities terms widened to true, for record headers that cannot
+            // see abilities cheaply; null when nothing is left to test
+            public abstract QueryNode WithoutAbilities();
+        }
+
+        private sealed class LogicalNode : QueryNode
+        {
+            public readonly bool IsAnd;
+            public readonly QueryNode Left;
+            public readonly QueryNode Right;
+
+            public LogicalNode(bool isAnd, QueryNode left, QueryNode right)
+            {
+                IsAnd = isAnd;
+                Left = left;
+                Right = right;
+            }
+
+            public override Expression Build(Expression target)
+            {
+                return IsAnd
+                    ? Expression.AndAlso(Left.Build(target), Right.Build(target))
+                    : Expression.OrElse(Left.Build(target), Right.Build(target));
+            }
+
+            public override QueryNode WithoutAbilities()
+            {
+                QueryNode left = Left.WithoutAbilities();
+                QueryNode right = Right.WithoutAbilities();
+                if (left == Left && right == Right)
+                    return this;
+                if (!IsAnd || left == null || right == null)
+                    return IsAnd ? left ?? right : null;
+                return new LogicalNode(true, left, right);
+            }
+
+            public override string ToString() => $"({Left} {(IsAnd ? "and" : "or")} {Right})";
+        }
+
+        private sealed class NotNode : QueryNode
+        {
+            public readonly QueryNode Operand;
+
+            public NotNode(QueryNode operand)
+            {
+                Operand = operand;
+            }
+
+            public override Expression Build(Expression target) => Expression.Not(Operand.Build(target));
+
+            public override QueryNode WithoutAbilities() => Operand.WithoutAbilities() == Operand ? this : null;
+
+            public override string ToString() => $"not {Operand}";
+        }
+
+        private sealed class ComparisonNode : QueryNode
+        {
+            public readonly QueryField Field;
+            public readonly QueryOperator Operator;
+            public readonly object Value;
+
+            public ComparisonNode(QueryField field, QueryOperator op, object value)
+            {
+                Field = field;
+                Operator = op;
+                Value = value;
+            }
+
+            public override Expression Build(Expression target)
+            {
+                if (Field == QueryField.Abilities)
+                    return Expression.Call(typeof(QueryFunctions), nameof(QueryFunctions.HasAbility), null,
+                        Expression.Property(target, nameof(Character.Abilities)), Expression.Constant(Value, typeof(string)));
+
+                Expression value = Expression.Property(target, Field.ToString());
+                if (value.Type != typeof(string))
+                    return Compare(Expression.Convert(value, typeof(long)), Expression.Constant(Value, typeof(long)));
+
+                var text = Expression.Constant(Value, typeof(string));
+                switch (Operator)
+                {
+                    case QueryOperator.Equal:
+                        return Expression.Equal(value, text);
+                    case QueryOperator.NotEqual:
+                        return Expression.NotEqual(value, text);
+                    case QueryOperator.Contains:
+                        return Expression.Call(typeof(QueryFunctions), nameof(QueryFunctions.ContainsIgnoreCase), null, value, text);
+                    case QueryOperator.StartsWith:
+                        return Expression.Call(typeof(QueryFunctions), nameof(QueryFunctions.StartsWithIgnoreCase), null, value, text);
+                    default:
+                        return Compare(Expression.Call(typeof(string), nameof(string.CompareOrdinal), null, value, text), Expression.Constant(0));
+                }
+            }
+
+            public override QueryNode WithoutAbilities() => Field == QueryField.Abilities ? null : this;
+
+            public override string ToString()
+            {
+                string value = Value == null ? "null"
+                    : Value is string text ? "'" + text.Replace("'", "''") + "'"
+                    : Field == QueryField.Class ? ((CharacterClass)(long)Value).ToString()
+                    : ((long)Value).ToString(CultureInfo.InvariantCulture);
+                return $"{Field} {OperatorText(Operator)} {value}";
+            }
+
+            private Expression Compare(Expression left, Expression right)
+            {
+                switch (Operator)
+                {
+                    case QueryOperator.Equal:
+                        return Expression.Equal(left, right);
+                    case QueryOperator.NotEqual:
+                        return Expression.NotEqual(left, right);
+                    case QueryOperator.Less:
+                        return Expression.LessThan(left, right);
+                    case QueryOperator.LessOrEqual:
+                        return Expression.LessThanOrEqual(left, right);
+                    case QueryOperator.Greater:
+                        return Expression.GreaterThan(left, right);
+                    default:
+                        return Expression.GreaterThanOrEqual(left, right);
+                }
+            }
+        }
+
+        internal static string OperatorText(QueryOperator op)
+        {
+            switch (op)
+            {
+                case QueryOperator.Equal: return "=";
+                case QueryOperator.NotEqual: return "!=";
+                case QueryOperator.Less: return "<";
+                case QueryOperator.LessOrEqual: return "<=";
+                case QueryOperator.Greater: return ">";
+                case QueryOperator.GreaterOrEqual: return ">=";
+                case QueryOperator.Contains: return "contains";
+                default: return "startswith";
+            }
+        }
+
+        // Roster index that supplies candidates for a filter. Only conditions every match must
+        // satisfy (top-level and terms) qualify; preference goes Id, Name, then a Level range.
+        // Class has too few values for its index to beat a scan.
+        private sealed class IndexAccess
+        {
+            // A step through a SortedSet view plus the Id lookup costs roughly this many
+            // sequential predicate calls
+            private const int WalkCost = 32;
+            private const int SampleSize = 256;
+
+            public readonly string Description;
+            public readonly Func<CharacterRoster, IEnumerable<Character>> Candidates;
+            private readonly Func<Character, bool> _range;
+
+            private IndexAccess(string description, Func<CharacterRoster, IEnumerable<Character>> candidates, Func<Character, bool> range = null)
+            {
+                Description = description;
+                Candidates = candidates;
+                _range = range;
+            }
+
+            // Equality lookups always win; a range is used only when a sample of the roster
+            // suggests it matches less than 1/WalkCost of it
+            public bool IsSelective(CharacterRoster roster)
+            {
+                if (_range == null || roster.Count <= SampleSize)
+                    return true;
+
+                int step = roster.Count / SampleSize, sampled = 0, hits = 0;
+                for (int i = 0; i < roster.Count; i += step)
+                {
+                    Character character = roster[i];
+                    if (character == null)
+                        continue;
+                    sampled++;
+                    if (_range(character))
+                        hits++;
+                }
+                return hits * WalkCost <= sampled;
+            }
+
+            public static IndexAccess Choose(QueryNode filter)
+            {
+                if (filter == null)
+                    return null;
+
+                var terms = new List<ComparisonNode>();
+                CollectConjuncts(filter, terms);
+
+                long minLevel = long.MinValue, maxLevel = long.MaxValue;
+                ComparisonNode name = null;
+                foreach (ComparisonNode term in terms)
+                {
+                    if (term.Field == QueryField.Id && term.Operator == QueryOperator.Equal)
+                    {
+                        long id = (long)term.Value;
+                        return new IndexAccess($"Id index, Id = {id}", roster => Single(roster.FindById(id)));
+                    }
+                    if (term.Field == QueryField.Name && term.Operator == QueryOperator.Equal && term.Value != null)
+                        name = name ?? term;
+                    else if (term.Field == QueryField.Level)
+                        Narrow(term, ref minLevel, ref maxLevel);
+                }
+
+                if (name != null)
+                {
+                    string value = (string)name.Value;
+                    return new IndexAccess($"Name index, Name = '{value}'", roster => roster.FindByName(value));
+                }
+                if (minLevel == long.MinValue && maxLevel == long.MaxValue)
+                    return null;
+
+                int min = (int)Math.Clamp(minLevel, int.MinValue, int.MaxValue);
+                int max = (int)Math.Clamp(maxLevel, int.MinValue, int.MaxValue);
+                return new IndexAccess($"Level index, range [{min}, {max}]",
+                    roster => minLevel > maxLevel ? Array.Empty<Character>() : roster.InLevelRange(min, max),
+                    character => character.Level >= minLevel && character.Level <= maxLevel);
+            }
+
+            private static void CollectConjuncts(QueryNode node, List<ComparisonNode> terms)
+            {
+                if (node is LogicalNode logical && logical.IsAnd)
+                {
+                    CollectConjuncts(logical.Left, terms);
+                    CollectConjuncts(logical.Right, terms);
+                }
+                else if (node is ComparisonNode comparison)
+                {
+                    terms.Add(comparison);
+                }
+            }
+
+            private static void Narrow(ComparisonNode term, ref long min, ref long max)
+            {
+                long value = (long)term.Value;
+                switch (term.Operator)
+                {
+                    case QueryOperator.Equal:
+                        min = Math.Max(min, value);
+                        max = Math.Min(max, value);
+                        break;
+                    case QueryOperator.Greater:
+                        min = Math.Max(min, value == long.MaxValue ? value : value + 1);
+                        if (value == long.MaxValue)
+                            max = long.MinValue;
+                        break;
+                    case QueryOperator.GreaterOrEqual:
+                        min = Math.Max(min, value);
+                        break;
+                    case QueryOperator.Less:
+                        max = Math.Min(max, value == long.MinValue ? value : value - 1);
+                        if (value == long.MinValue)
+                            min = long.MaxValue;
+                        break;
+                    case QueryOperator.LessOrEqual:
+                        max = Math.Min(max, value);
+                        break;
+                }
+            }
+
+            private static IEnumerable<Character> Single(Character character)
+            {
+                if (character != null)
+                    yield return character;
+            }
+        }
+
+        // Recursive descent over the grammar at the top of the class
+        private sealed class QueryParser
+        {
+            private readonly string _text;
+            private int _pos;
+
+            public QueryParser(string text)
+            {
+                _text = text;
+            }
+
+            public CharacterQuery ParseQuery()
+            {
+                QueryNode filter = null;
+                if (!AtEnd && !PeekKeyword("order") && !PeekKeyword("limit"))
+                    filter = ParseOr();
+
+                var order = new List<OrderKey>();
+                if (TryKeyword("order"))
+                {
+                    ExpectKeyword("by");
+                    do
+                    {
+                        QueryField field = ParseField();
+                        if (field == QueryField.Abilities)
+                            throw Error("cannot order by Abilities");
+                        bool descending = TryKeyword("desc");
+                        if (!descending)
+                            TryKeyword("asc");
+                        order.Add(new OrderKey(field, descending));
+                    }
+                    while (TrySymbol(","));
+                }
+
+                int limit = -1;
+                if (TryKeyword("limit"))
+                {
+                    object value = ParseValue();
+                    if (!(value is long count) || count < 0 || count > int.MaxValue)
+                        throw Error("limit must be a non-negative integer");
+                    limit = (int)count;
+                }
+
+                SkipWhitespace();
+                if (!AtEnd)
+                    throw Error($"unexpected '{_text.Substring(_pos)}'");
+                return new CharacterQuery(_text, filter, order.ToArray(), limit);
+            }
+
+            private bool AtEnd
+            {
+                get
+                {
+                    SkipWhitespace();
+                    return _pos >= _text.Length;
+                }
+            }
+
+            private QueryNode ParseOr()
+            {
+                QueryNode node = ParseAnd();
+                while (TryKeyword("or"))
+                    node = new LogicalNode(false, node, ParseAnd());
+                return node;
+            }
+
+            private QueryNode ParseAnd()
+            {
+                QueryNode node = ParseUnary();
+                while (TryKeyword("and"))
+                    node = new LogicalNode(true, node, ParseUnary());
+                return node;
+            }
+
+            private QueryNode ParseUnary()
+            {
+                if (TryKeyword("not"))
+                    return new NotNode(ParseUnary());
+                if (TrySymbol("("))
+                {
+                    QueryNode node = ParseOr();
+                    if (!TrySymbol(")"))
+                        throw Error("expected ')'");
+                    return node;
+                }
+                return ParseComparison();
+            }
+
+            private QueryNode ParseComparison()
+            {
+                int fieldStart = _pos;
+                QueryField field = ParseField();
+                QueryOperator op = ParseOperator();
+                int valueStart = _pos;
+                object value = ParseValue();
+
+                bool isString = field == QueryField.Name || field == QueryField.WeaponType || field == QueryField.ArmorType;
+                if (field == QueryField.Abilities)
+                {
+                    if (op != QueryOperator.Contains || !(value is string))
+                        throw Error("Abilities only supports contains 'name'", fieldStart);
+                }
+                else if (op == QueryOperator.Contains || op == QueryOperator.StartsWith)
+                {
+                    if (!isString || !(value is string))
+                        throw Error($"{OperatorText(op)} needs a text field and a string", fieldStart);
+                }
+                else if (isString)
+                {
+                    if (value is long number)
+                        value = number.ToString(CultureInfo.InvariantCulture);
+                    if (value == null && op != QueryOperator.Equal && op != QueryOperator.NotEqual)
+                        throw Error("null only supports = and !=", valueStart);
+                }
+                else if (field == QueryField.Class)
+                {
+                    if (value is string name)
+                    {
+                        if (!Enum.TryParse(name, true, out CharacterClass parsed) || !Enum.IsDefined(parsed) || char.IsDigit(name[0]))
+                            throw Error($"unknown class '{name}'", valueStart);
+                        value = (long)parsed;
+                    }
+                    else if (value == null)
+                    {
+                        throw Error("Class cannot be null", valueStart);
+                    }
+                }
+                else if (!(value is long))
+                {
+                    throw Error($"{field} needs an integer", valueStart);
+                }
+                return new ComparisonNode(field, op, value);
+            }
+
+            private QueryField ParseField()
+            {
+                int start = _pos;
+                string word = ReadWord();
+                if (word == null || !Enum.TryParse(word, true, out QueryField field))
+                    throw Error(word == null ? "expected a field name" : $"unknown field '{word}'", start);
+                return field;
+            }
+
+            private QueryOperator ParseOperator()
+            {
+                SkipWhitespace();
+                foreach ((string symbol, QueryOperator op) in new[]
+                {
+                    ("!=", QueryOperator.NotEqual), ("<>", QueryOperator.NotEqual), ("==", QueryOperator.Equal),
+                    ("<=", QueryOperator.LessOrEqual), (">=", QueryOperator.GreaterOrEqual),
+                    ("=", QueryOperator.Equal), ("<", QueryOperator.Less), (">", QueryOperator.Greater)
+                })
+                {
+                    if (TrySymbol(symbol))
+                        return op;
+                }
+                if (TryKeyword("contains"))
+                    return QueryOperator.Contains;
+                if (TryKeyword("startswith"))
+                    return QueryOperator.StartsWith;
+                throw Error("expected a comparison operator");
+            }
+
+            // long, string, or null for the null keyword
+            private object ParseValue()
+            {
+                SkipWhitespace();
+                if (_pos >= _text.Length)
+                    throw Error("expected a value");
+
+                char c = _text[_pos];
+                if (c == '\'' || c == '"')
+                    return ReadQuoted(c);
+
+                if (char.IsDigit(c) || c == '-' && _pos + 1 < _text.Length && char.IsDigit(_text[_pos + 1]))
+                {
+                    int start = _pos++;
+                    while (_pos < _text.Length && char.IsDigit(_text[_pos]))
+                        _pos++;
+                    if (!long.TryParse(_text.AsSpan(start, _pos - start), NumberStyles.AllowLeadingSign, CultureInfo.InvariantCulture, out long number))
+                        throw Error("number out of range", start);
+                    return number;
+                }
+
+                int wordStart = _pos;
+                string word = ReadWord();
+                if (word == null)
+                    throw Error("expected a value", wordStart);
+                return string.Equals(word, "null", StringComparison.OrdinalIgnoreCase) ? null : word;
+            }
+
+            // Quotes inside are doubled: 'O''Brien'
+            private string ReadQuoted(char quote)
+            {
+                int start = _pos++;
+                var value = new StringBuilder();
+                while (true)
+                {
+                    if (_pos >= _text.Length)
+                        throw Error("unterminated string", start);
+                    char c = _text[_pos++];
+                    if (c != quote)
+                    {
+                        value.Append(c);
+                    }
+                    else if (_pos < _text.Length && _text[_pos] == quote)
+                    {
+                        value.Append(quote);
+                        _pos++;
+                    }
+                    else
+                    {
+                        return value.ToString();
+                    }
+                }
+            }
+
+            private string ReadWord()
+            {
+                SkipWhitespace();
+                int start = _pos;
+                if (_pos < _text.Length && (char.IsLetter(_text[_pos]) || _text[_pos] == '_'))
+                {
+                    while (_pos < _text.Length && (char.IsLetterOrDigit(_text[_pos]) || _text[_pos] == '_'))
+                        _pos++;
+                }
+                return _pos > start ? _text.Substring(start, _pos - start) : null;
+            }
+
+            private bool PeekKeyword(string keyword)
+            {
+                int start = _pos;
+                bool found = TryKeyword(keyword);
+                _pos = start;
+                return found;
+            }
+
+            private bool TryKeyword(string keyword)
+            {
+                int start = _pos;
+                string word = ReadWord();
+                if (word != null && string.Equals(word, keyword, StringComparison.OrdinalIgnoreCase))
+                    return true;
+                _pos = start;
+                return false;
+            }
+
+            private void ExpectKeyword(string keyword)
+            {
+                if (!TryKeyword(keyword))
+                    throw Error($"expected '{keyword}'");
+            }
+
+            private bool TrySymbol(string symbol)
+            {
+                SkipWhitespace();
+                if (string.CompareOrdinal(_text, _pos, symbol, 0, symbol.Length) != 0)
+                    return false;
+                _pos += symbol.Length;
+                return true;
+            }
+
+            private void SkipWhitespace()
+            {
+                while (_pos < _text.Length && char.IsWhiteSpace(_text[_pos]))
+                    _pos++;
+            }
+
+            private FormatException Error(string message, int position = -1)
+            {
+                SkipWhitespace();
+                return new FormatException($"Query error at position {(position >= 0 ? position : _pos) + 1}: {message}.");
+            }
+        }
+    }
+
+    // Null-safe helpers called from compiled query expressions
+    internal static class QueryFunctions
+    {
+        public static bool ContainsIgnoreCase(string value, string text)
+        {
+            return value != null && value.Contains(text, StringComparison.OrdinalIgnoreCase);
+        }
+
+        public static bool StartsWithIgnoreCase(string value, string text)
+        {
+            return value != null && value.StartsWith(text, StringComparison.OrdinalIgnoreCase);
+        }
+
+        public static bool HasAbility(AbilityList abilities, string ability)
+        {
+            return abilities != null && abilities.Contains(ability);
+        }
+    }
+}
+
+// 23. NameSearchIndex.cs - Incremental prefix, substring and fuzzy search over character names
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager
+{
+    public enum NameMatchKind
+    {
+        Prefix,
+        Substring,
+        Fuzzy
+    }
+
+    public readonly struct NameMatch
+    {
+        public NameMatch(long id, NameMatchKind kind, int distance)
+        {
+            Id = id;
+            Kind = kind;
+            Distance = distance;
+        }
+
+        public long Id { get; }
+        public NameMatchKind Kind { get; }
+
+        // Edit distance from the query for fuzzy matches, 0 otherwise
+        public int Distance { get; }
+    }
+
+    // Names are folded to lower case and cut into trigrams, padded with two marks at each end so
+    // the leading trigrams also identify prefixes. Each distinct folded name gets a slot, and
+    // each trigram keeps the ascending list of slots containing it. Lookups start from the
+    // shortest list among the query's trigrams and check each candidate against its name.
+    //
+    // Removing the last character with a name leaves a dead slot that lookups skip; the lists
+    // are rebuilt once dead slots outnumber live ones. Not thread-safe; CharacterRoster owns one.
+    public sealed class NameSearchIndex
+    {
+        private const char Pad = '\0';
+        private const int CompactMinimum = 1024;
+
+        // Trigram list entries a fuzzy lookup may count through beyond the ones it must
+        private const int FuzzyScanBudget = 256 * 1024;
+
+        private readonly Dictionary<string, int> _slotByKey = new Dictionary<string, int>(StringComparer.Ordinal);
+        private readonly Dictionary<long, List<int>> _postings = new Dictionary<long, List<int>>();
+        private Slot[] _slots = new Slot[16];
+        private int[] _marks = new int[16];
+        private int[] _counts = new int[16];
+        private int _slotCount;
+        private int _deadSlots;
+        private int _mark;
+
+        // Number of indexed Ids
+        public int Count { get; private set; }
+
+        public void Add(long id, string name)
+        {
+            if (name == null)
+                return;
+
+            string key = Fold(name);
+            if (_slotByKey.TryGetValue(key, out int slot))
+            {
+                (_slots[slot].MoreIds ??= new List<long>()).Add(id);
+            }
+            else
+            {
+                slot = NewSlot(key, id);
+                AddGrams(key, slot);
+            }
+            Count++;
+        }
+
+        // Remove one Id under the name it was added with; false when it was not there
+        public bool Remove(long id, string name)
+        {
+            if (name == null || !_slotByKey.TryGetValue(Fold(name), out int slot))
+                return false;
+
+            ref Slot entry = ref _slots[slot];
+            if (entry.Id == id)
+            {
+                if (entry.MoreIds != null && entry.MoreIds.Count > 0)
+                {
+                    entry.Id = entry.MoreIds[entry.MoreIds.Count - 1];
+                    entry.MoreIds.RemoveAt(entry.MoreIds.Count - 1);
+                }
+                else
+                {
+                    _slotByKey.Remove(entry.Key);
+                    entry = default;
+                    _deadSlots++;
+                }
+            }
+            else if (entry.MoreIds == null || !entry.MoreIds.Remove(id))
+            {
+                return false;
+            }
+
+            Count--;
+            if (_deadSlots > CompactMinimum && _deadSlots > _slotCount - _deadSlots)
+                Compact();
+            return true;
+        }
+
+        public void Clear()
+        {
+            _slotByKey.Clear();
+            _postings.Clear();
+            Array.Clear(_slots, 0, _slotCount);
+            _slotCount = 0;
+            _deadSlots = 0;
+            Count = 0;
+        }
+
+        // Names starting with prefix, in insertion order
+        public List<NameMatch> FindPrefix(string prefix, int limit)
+        {
+            var results = new List<NameMatch>();
+            CollectPrefix(Fold(prefix), limit, results, null);
+            return results;
+        }
+
+        // Names containing text anywhere, in insertion order
+        public List<NameMatch> FindSubstring(string text, int limit)
+        {
+            var results = new List<NameMatch>();
+            CollectSubstring(Fold(text), limit, results, null);
+            return results;
+        }
+
+        // Names within maxDistance edits (insert, delete, substitute) of text, nearest first.
+        // The distance is lowered when the query is too short for the trigram filter to apply.
+        public List<NameMatch> FindFuzzy(string text, int maxDistance, int limit)
+        {
+            var results = new List<NameMatch>();
+            CollectFuzzy(Fold(text), maxDistance, limit, results, null);
+            return results;
+        }
+
+        // Search box lookup: prefix matches first, then substring ones, each name once. Only
+        // when nothing contains the text are fuzzy matches tried, as a typo fallback.
+        public List<NameMatch> Search(string text, int limit)
+        {
+            var results = new List<NameMatch>();
+            string key = Fold(text);
+            var seen = new HashSet<int>();
+            CollectPrefix(key, limit, results, seen);
+            CollectSubstring(key, limit, results, seen);
+            if (results.Count == 0)
+                CollectFuzzy(key, DefaultDistance(key.Length), limit, results, seen);
+            return results;
+        }
+
+        // Typos allowed for a query of the given length
+        public static int DefaultDistance(int length)
+        {
+            return length < 4 ? 0 : length < 8 ? 1 : 2;
+        }
+
+        private void CollectPrefix(string key, int limit, List<NameMatch> results, HashSet<int> seen)
+        {
+            if (results.Count >= limit)
+                return;
+            if (key.Length == 0)
+            {
+                CollectScan(key, NameMatchKind.Prefix, limit, results, seen);
+                return;
+            }
+
+            // The padded grams that start inside "\0\0" + key are exactly the leading grams of
+            // any name with this prefix
+            List<int> candidates = ShortestPosting(key, -2, key.Length - 3);
+            if (candidates == null)
+                return;
+            foreach (int slot in candidates)
+            {
+                string name = _slots[slot].Key;
+                if (name != null && name.StartsWith(key, StringComparison.Ordinal) && Emit(slot, NameMatchKind.Prefix, 0, limit, results, seen))
+                    return;
+            }
+        }
+
+        private void CollectSubstring(string key, int limit, List<NameMatch> results, HashSet<int> seen)
+        {
+            if (results.Count >= limit)
+                return;
+            if (key.Length < 3)
+            {
+                CollectScan(key, NameMatchKind.Substring, limit, results, seen);
+                return;
+            }
+
+            List<int> candidates = ShortestPosting(key, 0, key.Length - 3);
+            if (candidates == null)
+                return;
+            foreach (int slot in candidates)
+            {
+                string name = _slots[slot].Key;
+                if (name != null && name.Contains(key, StringComparison.Ordinal) && Emit(slot, NameMatchKind.Substring, 0, limit, results, seen))
+                    return;
+            }
+        }
+
+        // Short substrings match too much of the roster for trigram lists to help, and the
+        // matches are dense, so a scan reaches the limit quickly
+        private void CollectScan(string key, NameMatchKind kind, int limit, List<NameMatch> results, HashSet<int> seen)
+        {
+            for (int slot = 0; slot < _slotCount; slot++)
+            {
+                string name = _slots[slot].Key;
+                if (name == null)
+                    continue;
+                bool match = kind == NameMatchKind.Prefix ? name.StartsWith(key, StringComparison.Ordinal) : name.Contains(key, StringComparison.Ordinal);
+                if (match && Emit(slot, kind, 0, limit, results, seen))
+                    return;
+            }
+        }
+
+        // Each edit touches at most three padded trigrams, so a name within d edits contains all
+        // but 3d of the query's distinct trigrams. Taking the k >= 3d + 1 shortest lists, a match
+        // shows up in at least k - 3d of them; only names counted that often are compared in full.
+        // Lists are added past 3d + 1 while they stay cheap, to raise that threshold.
+        private void CollectFuzzy(string key, int maxDistance, int limit, List<NameMatch> results, HashSet<int> seen)
+        {
+            if (results.Count >= limit || maxDistance < 0)
+                return;
+
+            var grams = new List<(int Length, List<int> Posting)>();
+            var distinct = new HashSet<long>();
+            for (int i = -2; i < key.Length; i++)
+            {
+                long gram = Gram(key, i);
+                if (distinct.Add(gram))
+                    grams.Add(_postings.TryGetValue(gram, out List<int> posting) ? (posting.Count, posting) : (0, null));
+            }
+
+            int distance = Math.Min(maxDistance, (grams.Count - 1) / 3);
+            if (distance == 0)
+            {
+                if (_slotByKey.TryGetValue(key, out int exact))
+                    Emit(exact, NameMatchKind.Fuzzy, 0, limit, results, seen);
+                return;
+            }
+
+            grams.Sort((a, b) => a.Length.CompareTo(b.Length));
+            int lists = 3 * distance + 1;
+            long scanned = 0;
+            for (int g = 0; g < lists; g++)
+                scanned += grams[g].Length;
+            long budget = Math.Max(2 * scanned, FuzzyScanBudget);
+            while (lists < grams.Count && scanned + grams[lists].Length <= budget)
+                scanned += grams[lists++].Length;
+            int required = lists - 3 * distance;
+
+            int mark = NextMark();
+            var candidates = new List<int>();
+            for (int g = 0; g < lists; g++)
+            {
+                if (grams[g].Posting == null)
+                    continue;
+                foreach (int slot in grams[g].Posting)
+                {
+                    if (_marks[slot] != mark)
+                    {
+                        _marks[slot] = mark;
+                        _counts[slot] = 0;
+                        candidates.Add(slot);
+                    }
+                    _counts[slot]++;
+                }
+            }
+
+            var pattern = key.Length <= 64 ? new BitPattern(key) : null;
+            var hits = new List<(int Distance, int Slot)>();
+            foreach (int slot in candidates)
+            {
+                string name = _slots[slot].Key;
+                if (_counts[slot] < required || name == null || Math.Abs(name.Length - key.Length) > distance)
+                    continue;
+                int d = pattern != null ? pattern.Distance(name) : EditDistance(key, name, distance);
+                if (d <= distance)
+                    hits.Add((d, slot));
+            }
+
+            hits.Sort();
+            foreach ((int d, int slot) in hits)
+            {
+                if (Emit(slot, NameMatchKind.Fuzzy, d, limit, results, seen))
+                    return;
+            }
+        }
+
+        // Add the Ids of slot; true once the limit is reached
+        private bool Emit(int slot, NameMatchKind kind, int distance, int limit, List<NameMatch> results, HashSet<int> seen)
+        {
+            if (seen != null && !seen.Add(slot))
+                return results.Count >= limit;
+
+            ref Slot entry = ref _slots[slot];
+            if (results.Count < limit)
+                results.Add(new NameMatch(entry.Id, kind, distance));
+            if (entry.MoreIds != null)
+            {
+                for (int i = 0; i < entry.MoreIds.Count && results.Count < limit; i++)
+                    results.Add(new NameMatch(entry.MoreIds[i], kind, distance));
+            }
+            return results.Count >= limit;
+        }
+
+        // Shortest posting among the grams starting at first..last of the padded key, or null
+        // when one of them is not indexed at all
+        private List<int> ShortestPosting(string key, int first, int last)
+        {
+            List<int> shortest = null;
+            for (int i = first; i <= last; i++)
+            {
+                if (!_postings.TryGetValue(Gram(key, i), out List<int> posting))
+                    return null;
+                if (shortest == null || posting.Count < shortest.Count)
+                    shortest = posting;
+            }
+            return shortest;
+        }
+
+        private int NewSlot(string key, long id)
+        {
+            if (_slotCount == _slots.Length)
+            {
+                Array.Resize(ref _slots, _slots.Length * 2);
+                Array.Resize(ref _marks, _slots.Length);
+                Array.Resize(ref _counts, _slots.Length);
+            }
+
+            int slot = _slotCount++;
+            _slots[slot] = new Slot { Key = key, Id = id };
+            _slotByKey.Add(key, slot);
+            return slot;
+        }
+
+        private void AddGrams(string key, int slot)
+        {
+            for (int i = -2; i < key.Length; i++)
+            {
+                long gram = Gram(key, i);
+                if (!_postings.TryGetValue(gram, out List<int> posting))
+                {
+                    posting = new List<int>();
+                    _postings.Add(gram, posting);
+                }
+
+                // Slots only grow, so a repeated gram of this name is always the last entry
+                if (posting.Count == 0 || posting[posting.Count - 1] != slot)
+                    posting.Add(slot);
+            }
+        }
+
+        // Renumber the live slots in their current order and rebuild the trigram lists
+        private void Compact()
+        {
+            Slot[] slots = _slots;
+            int count = _slotCount;
+            _postings.Clear();
+            _slotByKey.Clear();
+            _slots = new Slot[Math.Max(16, count - _deadSlots)];
+            _marks = new int[_slots.Length];
+            _counts = new int[_slots.Length];
+            _slotCount = 0;
+            _deadSlots = 0;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (slots[i].Key == null)
+                    continue;
+                int slot = NewSlot(slots[i].Key, slots[i].Id);
+                _slots[slot].MoreIds = slots[i].MoreIds;
+                AddGrams(slots[i].Key, slot);
+            }
+        }
+
+        private int NextMark()
+        {
+            if (_mark == int.MaxValue)
+            {
+                Array.Clear(_marks, 0, _marks.Length);
+                _mark = 0;
+            }
+            return ++_mark;
+        }
+
+        private static string Fold(string text)
+        {
+            return (text ?? string.Empty).ToLowerInvariant();
+        }
+
+        // The three characters starting at index i of key padded with two marks on each side
+        private static long Gram(string key, int i)
+        {
+            return (long)At(key, i) << 32 | (long)At(key, i + 1) << 16 | At(key, i + 2);
+        }
+
+        private static char At(string key, int i)
+        {
+            return (uint)i < (uint)key.Length ? key[i] : Pad;
+        }
+
+        // Levenshtein distance, or max + 1 as soon as every path through a row exceeds max
+        private static int EditDistance(string a, string b, int max)
+        {
+            Span<int> row = b.Length < 256 ? stackalloc int[b.Length + 1] : new int[b.Length + 1];
+            for (int j = 0; j <= b.Length; j++)
+                row[j] = j;
+
+            for (int i = 1; i <= a.Length; i++)
+            {
+                int diagonal = row[0];
+                int best = row[0] = i;
+                for (int j = 1; j <= b.Length; j++)
+                {
+                    int above = row[j];
+                    int value = Math.Min(Math.Min(above, row[j - 1]) + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+                    diagonal = above;
+                    row[j] = value;
+                    if (value < best)
+                        best = value;
+                }
+                if (best > max)
+                    return max + 1;
+            }
+            return Math.Min(row[b.Length], max + 1);
+        }
+
+        // Myers' bit-vector edit distance for patterns of up to 64 characters: one column of the
+        // Levenshtein table per text character, held as vertical +1/-1 delta bits
+        private sealed class BitPattern
+        {
+            private readonly ulong[] _ascii = new ulong[128];
+            private readonly Dictionary<char, ulong> _other = new Dictionary<char, ulong>();
+            private readonly ulong _last;
+            private readonly int _length;
+
+            public BitPattern(string pattern)
+            {
+                _length = pattern.Length;
+                _last = 1UL << (pattern.Length - 1);
+                for (int i = 0; i < pattern.Length; i++)
+                {
+                    char c = pattern[i];
+                    if (c < 128)
+                        _ascii[c] |= 1UL << i;
+                    else
+                        _other[c] = (_other.TryGetValue(c, out ulong mask) ? mask : 0) | 1UL << i;
+                }
+            }
+
+            public int Distance(string text)
+            {
+                ulong pv = ulong.MaxValue, mv = 0;
+                int score = _length;
+                foreach (char c in text)
+                {
+                    ulong eq = c < 128 ? _ascii[c] : _other.TryGetValue(c, out ulong mask) ? mask : 0;
+                    ulong xv = eq | mv;
+                    ulong xh = (((eq & pv) + pv) ^ pv) | eq;
+                    ulong ph = mv | ~(xh | pv);
+                    ulong mh = pv & xh;
+                    if ((ph & _last) != 0)
+                        score++;
+                    else if ((mh & _last) != 0)
+                        score--;
+
+                    // Row 0 of the table grows by one per column, so a +1 is shifted in
+                    ph = ph << 1 | 1;
+                    mh <<= 1;
+                    pv = mh | ~(xv | ph);
+                    mv = ph & xv;
+                }
+                return score;
+            }
+        }
+
+        private struct Slot
+        {
+            public string Key;
+            public long Id;
+            public List<long> MoreIds;
+        }
+    }
+}
+
+// 24. CharacterBitmap.cs - Compressed Id sets and the inverted index from ability to characters
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace GameCharacterManager
+{
+    // Set of character Ids, split into chunks of 65536 consecutive Ids. A chunk is a sorted
+    // ushort array while it holds up to 4096 Ids and a 1024-word bitmap past that; both take
+    // 8 KB at the crossover, so sparse and dense sets stay compact. And, Or and AndNot work
+    // chunk by chunk and return new bitmaps. Not thread-safe.
+    public sealed class CharacterBitmap : IEnumerable<long>
+    {
+        private const int ArrayLimit = 4096;
+        private const int Words = 1024;
+
+        private long[] _keys;
+        private Chunk[] _chunks;
+        private int _size;
+
+        public CharacterBitmap()
+            : this(0)
+        {
+        }
+
+        private CharacterBitmap(int capacity)
+        {
+            _keys = capacity == 0 ? Array.Empty<long>() : new long[capacity];
+            _chunks = capacity == 0 ? Array.Empty<Chunk>() : new Chunk[capacity];
+        }
+
+        public long Cardinality { get; private set; }
+
+        public bool IsEmpty => Cardinality == 0;
+
+        // Approximate heap size of the chunks
+        public long SizeInBytes
+        {
+            get
+            {
+                long bytes = _keys.Length * (sizeof(long) + IntPtr.Size);
+                for (int i = 0; i < _size; i++)
+                    bytes += _chunks[i].Bits != null ? Words * sizeof(ulong) : _chunks[i].Values.Length * sizeof(ushort);
+                return bytes;
+            }
+        }
+
+        public bool Add(long id)
+        {
+            int index = FindChunk(id >> 16);
+            if (index < 0)
+            {
+                index = ~index;
+                Insert(index, id >> 16, new Chunk());
+            }
+            if (!_chunks[index].Add((ushort)id))
+                return false;
+
+            Cardinality++;
+            return true;
+        }
+
+        public bool Remove(long id)
+        {
+            int index = FindChunk(id >> 16);
+            if (index < 0 || !_chunks[index].Remove((ushort)id))
+                return false;
+
+            if (_chunks[index].Count == 0)
+            {
+                _size--;
+                Array.Copy(_keys, index + 1, _keys, index, _size - index);
+                Array.Copy(_chunks, index + 1, _chunks, index, _size - index);
+                _chunks[_size] = null;
+            }
+            Cardinality--;
+            return true;
+        }
+
+        public bool Contains(long id)
+        {
+            int index = FindChunk(id >> 16);
+            return index >= 0 && _chunks[index].Contains((ushort)id);
+        }
+
+        public CharacterBitmap Clone()
+        {
+            var result = new CharacterBitmap(_size);
+            for (int i = 0; i < _size; i++)
+                result.Append(_keys[i], _chunks[i].Clone());
+            return result;
+        }
+
+        public static CharacterBitmap And(CharacterBitmap a, CharacterBitmap b)
+        {
+            var result = new CharacterBitmap(Math.Min(a._size, b._size));
+            int i = 0, j = 0;
+            while (i < a._size && j < b._size)
+            {
+                if (a._keys[i] < b._keys[j])
+                {
+                    i++;
+                }
+                else if (a._keys[i] > b._keys[j])
+                {
+                    j++;
+                }
+                else
+                {
+                    result.Append(a._keys[i], Chunk.And(a._chunks[i], b._chunks[j]));
+                    i++;
+                    j++;
+                }
+            }
+            return result;
+        }
+
+        public static CharacterBitmap Or(CharacterBitmap a, CharacterBitmap b)
+        {
+            var result = new CharacterBitmap(a._size + b._size);
+            int i = 0, j = 0;
+            while (i < a._size || j < b._size)
+            {
+                if (j == b._size || i < a._size && a._keys[i] < b._keys[j])
+                {
+                    result.Append(a._keys[i], a._chunks[i].Clone());
+                    i++;
+                }
+                else if (i == a._size || a._keys[i] > b._keys[j])
+                {
+                    result.Append(b._keys[j], b._chunks[j].Clone());
+                    j++;
+                }
+                else
+                {
+                    result.Append(a._keys[i], Chunk.Or(a._chunks[i], b._chunks[j]));
+                    i++;
+                    j++;
+                }
+            }
+            return result;
+        }
+
+        // Ids in a but not in b
+        public static CharacterBitmap AndNot(CharacterBitmap a, CharacterBitmap b)
+        {
+            var result = new CharacterBitmap(a._size);
+            int j = 0;
+            for (int i = 0; i < a._size; i++)
+            {
+                while (j < b._size && b._keys[j] < a._keys[i])
+                    j++;
+                result.Append(a._keys[i], j < b._size && b._keys[j] == a._keys[i] ? Chunk.AndNot(a._chunks[i], b._chunks[j]) : a._chunks[i].Clone());
+            }
+            return result;
+        }
+
+        public long[] ToArray()
+        {
+            var ids = new long[Cardinality];
+            int n = 0;
+            foreach (long id in this)
+                ids[n++] = id;
+            return ids;
+        }
+
+        // Ascending Ids
+        public IEnumerator<long> GetEnumerator()
+        {
+            for (int i = 0; i < _size; i++)
+            {
+                long high = _keys[i] << 16;
+                Chunk chunk = _chunks[i];
+                if (chunk.Bits == null)
+                {
+                    for (int k = 0; k < chunk.Count; k++)
+                        yield return high | chunk.Values[k];
+                    continue;
+                }
+
+                for (int w = 0; w < Words; w++)
+                {
+                    ulong word = chunk.Bits[w];
+                    while (word != 0)
+                    {
+                        yield return high | (long)(w * 64 + BitOperations.TrailingZeroCount(word));
+                        word &= word - 1;
+                    }
+                }
+            }
+        }
+
+        IEnumerator IEnumerable.GetEnumerator()
+        {
+            return GetEnumerator();
+        }
+
+        // Ids are mostly added in ascending order, so the last chunk is tried first
+        private int FindChunk(long key)
+        {
+            if (_size > 0 && _keys[_size - 1] == key)
+                return _size - 1;
+            return Array.BinarySearch(_keys, 0, _size, key);
+        }
+
+        private void Insert(int index, long key, Chunk chunk)
+        {
+            if (_size == _keys.Length)
+            {
+                int capacity = Math.Max(4, _size * 2);
+                Array.Resize(ref _keys, capacity);
+                Array.Resize(ref _chunks, capacity);
+            }
+            Array.Copy(_keys, index, _keys, index + 1, _size - index);
+            Array.Copy(_chunks, index, _chunks, index + 1, _size - index);
+            _keys[index] = key;
+            _chunks[index] = chunk;
+            _size++;
+        }
+
+        // Add a chunk after all existing ones; empty results are dropped
+        private void Append(long key, Chunk chunk)
+        {
+            if (chunk == null)
+                return;
+            Insert(_size, key, chunk);
+            Cardinality += chunk.Count;
+        }
+
+        private sealed class Chunk
+        {
+            // Sorted low 16 bits of the Ids while Bits is null
+            public ushort[] Values;
+            public ulong[] Bits;
+            public int Count;
+
+            public bool Contains(ushort value)
+            {
+                return Bits != null
+                    ? (Bits[value >> 6] & 1UL << value) != 0
+                    : Array.BinarySearch(Values, 0, Count, value) >= 0;
+            }
+
+            public bool Add(ushort value)
+            {
+                if (Bits != null)
+                {
+                    ulong mask = 1UL << value;
+                    if ((Bits[value >> 6] & mask) != 0)
+                        return false;
+                    Bits[value >> 6] |= mask;
+                    Count++;
+                    return true;
+                }
+
+                int index = Count == 0 || Values[Count - 1] < value ? ~Count : Array.BinarySearch(Values, 0, Count, value);
+                if (index >= 0)
+                    return false;
+                if (Count == ArrayLimit)
+                {
+                    Bits = ToBits(Values, Count);
+                    Values = null;
+                    return Add(value);
+                }
+
+                index = ~index;
+                if (Values == null || Count == Values.Length)
+                    Array.Resize(ref Values, Math.Min(ArrayLimit, Math.Max(4, Count * 2)));
+                Array.Copy(Values, index, Values, index + 1, Count - index);
+                Values[index] = value;
+                Count++;
+                return true;
+            }
+
+            public bool Remove(ushort value)
+            {
+                if (Bits != null)
+                {
+                    ulong mask = 1UL << value;
+                    if ((Bits[value >> 6] & mask) == 0)
+                        return false;
+                    Bits[value >> 6] &= ~mask;
+
+                    // Well below the limit, so alternating adds and removes do not convert back and forth
+                    if (--Count <= ArrayLimit / 2)
+                    {
+                        Values = ToValues(Bits, Count);
+                        Bits = null;
+                    }
+                    return true;
+                }
+
+                int index = Array.BinarySearch(Values, 0, Count, value);
+                if (index < 0)
+                    return false;
+                Count--;
+                Array.Copy(Values, index + 1, Values, index, Count - index);
+                return true;
+            }
+
+            public Chunk Clone()
+            {
+                return new Chunk
+                {
+                    Values = Values == null ? null : (ushort[])Values.Clone(),
+                    Bits = Bits == null ? null : (ulong[])Bits.Clone(),
+                    Count = Count
+                };
+            }
+
+            public static Chunk And(Chunk a, Chunk b)
+            {
+                if (a.Bits != null && b.Bits != null)
+                {
+                    var bits = new ulong[Words];
+                    int count = 0;
+                    for (int w = 0; w < Words; w++)
+                        count += BitOperations.PopCount(bits[w] = a.Bits[w] & b.Bits[w]);
+                    return FromBits(bits, count);
+                }
+                if (a.Bits != null)
+                    return Filter(b, a, true);
+                if (b.Bits != null)
+                    return Filter(a, b, true);
+
+                // Merge the sorted arrays
+                var values = new ushort[Math.Min(a.Count, b.Count)];
+                int n = 0, i = 0, j = 0;
+                while (i < a.Count && j < b.Count)
+                {
+                    if (a.Values[i] < b.Values[j])
+                        i++;
+                    else if (a.Values[i] > b.Values[j])
+                        j++;
+                    else
+                    {
+                        values[n++] = a.Values[i];
+                        i++;
+                        j++;
+                    }
+                }
+                return FromValues(values, n);
+            }
+
+            public static Chunk Or(Chunk a, Chunk b)
+            {
+                if (a.Bits == null && b.Bits == null && a.Count + b.Count <= ArrayLimit)
+                {
+                    var values = new ushort[a.Count + b.Count];
+                    int n = 0, i = 0, j = 0;
+                    while (i < a.Count || j < b.Count)
+                    {
+                        if (j == b.Count || i < a.Count && a.Values[i] < b.Values[j])
+                            values[n++] = a.Values[i++];
+                        else if (i == a.Count || a.Values[i] > b.Values[j])
+                            values[n++] = b.Values[j++];
+                        else
+                        {
+                            values[n++] = a.Values[i];
+                            i++;
+                            j++;
+                        }
+                    }
+                    return FromValues(values, n);
+                }
+
+                ulong[] bits = a.Bits != null ? (ulong[])a.Bits.Clone() : ToBits(a.Values, a.Count);
+                if (b.Bits != null)
+                {
+                    for (int w = 0; w < Words; w++)
+                        bits[w] |= b.Bits[w];
+                }
+                else
+                {
+                    for (int k = 0; k < b.Count; k++)
+                        bits[b.Values[k] >> 6] |= 1UL << b.Values[k];
+                }
+                return FromBits(bits, PopCount(bits));
+            }
+
+            public static Chunk AndNot(Chunk a, Chunk b)
+            {
+                if (a.Bits == null)
+                    return Filter(a, b, false);
+
+                var bits = (ulong[])a.Bits.Clone();
+                if (b.Bits != null)
+                {
+                    for (int w = 0; w < Words; w++)
+                        bits[w] &= ~b.Bits[w];
+                }
+                else
+                {
+                    for (int k = 0; k < b.Count; k++)
+                        bits[b.Values[k] >> 6] &= ~(1UL << b.Values[k]);
+                }
+                return FromBits(bits, PopCount(bits));
+            }
+
+            // Values of the array chunk that are (or are not) in other
+            private static Chunk Filter(Chunk array, Chunk other, bool keepContained)
+            {
+                var values = new ushort[array.Count];
+                int n = 0;
+                for (int k = 0; k < array.Count; k++)
+                {
+                    if (other.Contains(array.Values[k]) == keepContained)
+                        values[n++] = array.Values[k];
+                }
+                return FromValues(values, n);
+            }
+
+            private static Chunk FromValues(ushort[] values, int count)
+            {
+                if (count == 0)
+                    return null;
+                if (count > ArrayLimit)
+                    return new Chunk { Bits = ToBits(values, count), Count = count };
+                if (values.Length > count * 2)
+                    Array.Resize(ref values, count);
+                return new Chunk { Values = values, Count = count };
+            }
+
+            private static Chunk FromBits(ulong[] bits, int count)
+            {
+                if (count == 0)
+                    return null;
+                if (count <= ArrayLimit)
+                    return new Chunk { Values = ToValues(bits, count), Count = count };
+                return new Chunk { Bits = bits, Count = count };
+            }
+
+            private static ulong[] ToBits(ushort[] values, int count)
+            {
+                var bits = new ulong[Words];
+                for (int k = 0; k < count; k++)
+                    bits[values[k] >> 6] |= 1UL << values[k];
+                return bits;
+            }
+
+            private static ushort[] ToValues(ulong[] bits, int count)
+            {
+                var values = new ushort[Math.Max(4, count)];
+                int n = 0;
+                for (int w = 0; w < Words; w++)
+                {
+                    ulong word = bits[w];
+                    while (word != 0)
+                    {
+                        values[n++] = (ushort)(w * 64 + BitOperations.TrailingZeroCount(word));
+                        word &= word - 1;
+                    }
+                }
+                return values;
+            }
+
+            private static int PopCount(ulong[] bits)
+            {
+                int count = 0;
+                for (int w = 0; w < Words; w++)
+                    count += BitOperations.PopCount(bits[w]);
+                return count;
+            }
+        }
+    }
+
+    // Inverted index from ability to the Ids of the characters having it. Abilities are keyed by
+    // AbilityPool id, so adding a character costs one bitmap insert per ability and name
+    // lookups do not allocate. Not thread-safe; CharacterRoster owns one.
+    public sealed class AbilityIndex
+    {
+        private readonly CharacterBitmap _all = new CharacterBitmap();
+        private CharacterBitmap[] _byAbility = new CharacterBitmap[64];
+
+        // Number of indexed characters
+        public long Count => _all.Cardinality;
+
+        public void Add(long id, ReadOnlySpan<int> abilityIds)
+        {
+            _all.Add(id);
+            foreach (int ability in abilityIds)
+            {
+                if (ability == 0)
+                    continue;
+                if (ability >= _byAbility.Length)
+                    Array.Resize(ref _byAbility, Math.Max(ability + 1, _byAbility.Length * 2));
+                (_byAbility[ability] ??= new CharacterBitmap()).Add(id);
+            }
+        }
+
+        public void Remove(long id, ReadOnlySpan<int> abilityIds)
+        {
+            _all.Remove(id);
+            foreach (int ability in abilityIds)
+            {
+                if (ability > 0 && ability < _byAbility.Length)
+                    _byAbility[ability]?.Remove(id);
+            }
+        }
+
+        // Number of characters having ability
+        public long CountOf(string ability)
+        {
+            return Find(ability)?.Cardinality ?? 0;
+        }
+
+        // Ids of the characters having every ability in all, at least one in any (unless it is
+        // null or empty) and none in none; with all and any both empty, every indexed character
+        // qualifies.
+        // For example Query(new[] { "Fireball", "Heal" }, none: new[] { "Stealth" }).
+        public CharacterBitmap Query(IEnumerable<string> all, IEnumerable<string> any = null, IEnumerable<string> none = null)
+        {
+            var required = new List<CharacterBitmap>();
+            foreach (string ability in all ?? Array.Empty<string>())
+            {
+                CharacterBitmap ids = Find(ability);
+                if (ids == null)
+                    return new CharacterBitmap();
+                required.Add(ids);
+            }
+
+            // Smallest first, so every And shrinks the working set as early as possible
+            required.Sort((a, b) => a.Cardinality.CompareTo(b.Cardinality));
+            CharacterBitmap result = required.Count > 0 ? required[0] : _all;
+            for (int i = 1; i < required.Count && !result.IsEmpty; i++)
+                result = CharacterBitmap.And(result, required[i]);
+
+            if (any != null)
+            {
+                bool given = false;
+                CharacterBitmap union = null;
+                foreach (string ability in any)
+                {
+                    given = true;
+                    CharacterBitmap ids = Find(ability);
+                    if (ids != null)
+                        union = union == null ? ids : CharacterBitmap.Or(union, ids);
+                }
+                if (given)
+                    result = union == null ? new CharacterBitmap() : CharacterBitmap.And(result, union);
+            }
+
+            foreach (string ability in none ?? Array.Empty<string>())
+            {
+                CharacterBitmap ids = Find(ability);
+                if (ids != null && !result.IsEmpty)
+                    result = CharacterBitmap.AndNot(result, ids);
+            }
+
+            // Never hand out the index's own bitmaps
+            return result == _all || required.Contains(result) ? result.Clone() : result;
+        }
+
+        private CharacterBitmap Find(string ability)
+        {
+            return AbilityPool.TryGetId(ability, out int id) && id > 0 && id < _byAbility.Length ? _byAbility[id] : null;
+        }
+    }
+}
+
+// 25. RosterViewModel.cs - The rows the main window shows, with per-row change notifications
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager
+{
+    public enum RosterChangeKind
+    {
+        Insert,
+        Remove,
+        Replace,
+        Reset
+    }
+
+    public sealed class RosterChangedEventArgs : EventArgs
+    {
+        public RosterChangedEventArgs(RosterChangeKind kind, int index)
+        {
+            Kind = kind;
+            Index = index;
+        }
+
+        public RosterChangeKind Kind { get; }
+
+        // Row inserted, removed or replaced; -1 for Reset
+        public int Index { get; }
+    }
+
+    // Every character in roster order, or the matches of a name search. Edits go through here so
+    // that each one raises a single Changed event for the row it affects, and rows are handed out
+    // on demand, which is what a virtual-mode list needs: refreshing costs the visible rows, not
+    // the roster size. No WinForms dependency.
+    public sealed class RosterViewModel
+    {
+        // Search matches, by Id in row order; null when not searching
+        private List<long> _matches;
+
+        public RosterViewModel()
+            : this(new CharacterRoster())
+        {
+        }
+
+        public RosterViewModel(CharacterRoster roster)
+        {
+            Roster = roster ?? throw new ArgumentNullException(nameof(roster));
+        }
+
+        public event EventHandler<RosterChangedEventArgs> Changed;
+
+        public CharacterRoster Roster { get; private set; }
+
+        public string SearchText { get; private set; } = string.Empty;
+
+        // Most matches a search shows
+        public int SearchLimit { get; set; } = 200;
+
+        public int Count => _matches?.Count ?? Roster.Count;
+
+        public Character this[int row] => _matches != null ? Roster.FindById(_matches[row]) : Roster[row];
+
+        public string GetText(int row)
+        {
+            return this[row]?.ToString() ?? string.Empty;
+        }
+
+        // Row showing the character, or -1 when it is filtered out
+        public int IndexOf(long id)
+        {
+            return _matches != null ? _matches.IndexOf(id) : Roster.IndexOf(id);
+        }
+
+        // Show a newly loaded roster, keeping the current search
+        public void Load(CharacterRoster roster)
+        {
+            Roster = roster ?? throw new ArgumentNullException(nameof(roster));
+            RunSearch();
+            OnChanged(RosterChangeKind.Reset, -1);
+        }
+
+        public void Search(string text)
+        {
+            text = text?.Trim() ?? string.Empty;
+            if (text == SearchText)
+                return;
+
+            SearchText = text;
+            RunSearch();
+            OnChanged(RosterChangeKind.Reset, -1);
+        }
+
+        // Returns the roster position, for the journal
+        public int Add(Character character)
+        {
+            Roster.Add(character);
+            int position = Roster.Count - 1;
+            if (_matches == null)
+            {
+                OnChanged(RosterChangeKind.Insert, position);
+            }
+            else if (MatchesSearch(character))
+            {
+                _matches.Add(character.Id);
+                OnChanged(RosterChangeKind.Insert, _matches.Count - 1);
+            }
+            return position;
+        }
+
+        // Replace the character with the same Id; returns its roster position
+        public int Replace(Character character)
+        {
+            int position = Roster.Replace(character);
+            if (_matches == null)
+            {
+                OnChanged(RosterChangeKind.Replace, position);
+                return position;
+            }
+
+            int row = _matches.IndexOf(character.Id);
+            bool matches = MatchesSearch(character);
+            if (row >= 0 && matches)
+            {
+                OnChanged(RosterChangeKind.Replace, row);
+            }
+            else if (row >= 0)
+            {
+                _matches.RemoveAt(row);
+                OnChanged(RosterChangeKind.Remove, row);
+            }
+            else if (matches)
+            {
+                _matches.Add(character.Id);
+                OnChanged(RosterChangeKind.Insert, _matches.Count - 1);
+            }
+            return position;
+        }
+
+        // Returns the roster position it had, or -1 when there was none
+        public int Remove(long id)
+        {
+            int position = Roster.Remove(id);
+            if (position < 0)
+                return -1;
+
+            int row = _matches != null ? _matches.IndexOf(id) : position;
+            if (row >= 0)
+            {
+                _matches?.RemoveAt(row);
+                OnChanged(RosterChangeKind.Remove, row);
+            }
+            return position;
+        }
+
+        private void RunSearch()
+        {
+            if (SearchText.Length == 0)
+            {
+                _matches = null;
+                return;
+            }
+
+            List<Character> found = Roster.SearchNames(SearchText, SearchLimit);
+            _matches = new List<long>(found.Count);
+            foreach (Character character in found)
+                _matches.Add(character.Id);
+        }
+
+        // Until the next search reranks them, edited and new characters are kept or added when
+        // their name contains the search text
+        private bool MatchesSearch(Character character)
+        {
+            return character.Name != null && character.Name.Contains(SearchText, StringComparison.OrdinalIgnoreCase);
+        }
+
+        private void OnChanged(RosterChangeKind kind, int index)
+        {
+            Changed?.Invoke(this, new RosterChangedEventArgs(kind, index));
+        }
+    }
+}
+
+// 26. RosterOffsetIndex.cs - Sidecar index of record offsets for paged reads of JSON and XML rosters
+using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using Microsoft.Win32.SafeHandles;
+
+namespace GameCharacterManager
+{
+    // Layout: "CIDX" magic, ushort version, ushort flags, long source length, long source write
+    // time, long record count, then count + 1 longs: where each record starts in the source and
+    // where the last one ends. A record's bytes may begin with the separator before it. The index
+    // only describes the source whose length and write time it holds; any other is stale.
+    public sealed class RosterOffsetIndex : IDisposable
+    {
+        public const ushort Version = 1;
+        internal const int HeaderSize = 32;
+        internal static readonly byte[] Magic = { (byte)'C', (byte)'I', (byte)'D', (byte)'X' };
+
+        private readonly SafeFileHandle _file;
+
+        private RosterOffsetIndex(SafeFileHandle file, long count)
+        {
+            _file = file;
+            Count = count;
+        }
+
+        public long Count { get; }
+
+        public static string PathFor(string sourcePath)
+        {
+            return sourcePath + ".idx";
+        }
+
+        // Open the index of sourcePath as the file is now; null when there is none or it is stale
+        public static RosterOffsetIndex TryOpen(string sourcePath)
+        {
+            SnapshotFingerprint source = SnapshotFingerprint.Of(sourcePath);
+            SafeFileHandle file;
+            try
+            {
+                file = File.OpenHandle(PathFor(sourcePath), FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete);
+            }
+            catch (FileNotFoundException)
+            {
+                return null;
+            }
+
+            try
+            {
+                Span<byte> header = stackalloc byte[HeaderSize];
+                long length = RandomAccess.GetLength(file);
+                if (length >= HeaderSize)
+                {
+                    ReadExactly(file, header, 0);
+                    long count = BitConverter.ToInt64(header.Slice(24));
+                    if (header.StartsWith(Magic)
+                        && BitConverter.ToUInt16(header.Slice(4)) == Version
+                        && new SnapshotFingerprint(BitConverter.ToInt64(header.Slice(8)), BitConverter.ToInt64(header.Slice(16))).Equals(source)
+                        && count >= 0 && length == HeaderSize + (count + 1) * sizeof(long))
+                    {
+                        return new RosterOffsetIndex(file, count);
+                    }
+                }
+            }
+            catch
+            {
+                file.Dispose();
+                throw;
+            }
+
+            file.Dispose();
+            return null;
+        }
+
+        // Bounds of records [first, first + count), clipped to the roster: one offset per record
+        // and the end of the last. Only these entries are read from the index file.
+        public long[] ReadBounds(long first, int count)
+        {
+            if (first < 0)
+                throw new ArgumentOutOfRangeException(nameof(first));
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            count = (int)Math.Max(0, Math.Min(count, Count - first));
+            if (count == 0)
+                return Array.Empty<long>();
+
+            var bounds = new long[count + 1];
+            ReadExactly(_file, MemoryMarshal.AsBytes(bounds.AsSpan()), HeaderSize + first * sizeof(long));
+            return bounds;
+        }
+
+        public void Dispose()
+        {
+            _file.Dispose();
+        }
+
+        internal static void ReadExactly(SafeFileHandle file, Span<byte> buffer, long offset)
+        {
+            while (buffer.Length > 0)
+            {
+                int read = RandomAccess.Read(file, buffer, offset);
+                if (read == 0)
+                    throw new EndOfStreamException("Unexpected end of file.");
+                buffer = buffer.Slice(read);
+                offset += read;
+            }
+        }
+    }
+
+    // Streams offsets into a staged index while a roster is written or scanned. Commit stamps it
+    // with the finished source and moves it into place; disposing without a commit discards it.
+    public sealed class RosterOffsetIndexWriter : IDisposable
+    {
+        private const int BufferSize = 64 * 1024;
+
+        private readonly string _path;
+        private readonly FileStream _stream;
+        private readonly byte[] _buffer = new byte[BufferSize];
+        private int _length;
+        private long _count;
+        private long _last;
+        private bool _completed;
+        private bool _committed;
+
+        public RosterOffsetIndexWriter(string sourcePath)
+        {
+            _path = RosterOffsetIndex.PathFor(sourcePath);
+            _stream = new FileStream(TempPath, FileMode.Create, FileAccess.Write, FileShare.None, 0);
+            _length = RosterOffsetIndex.HeaderSize;
+        }
+
+        public long Count => _count;
+
+        private string TempPath => _path + ".tmp";
+
+        // Where the next record starts
+        public void Add(long offset)
+        {
+            if (_completed)
+                throw new InvalidOperationException("The index has already been completed.");
+            Append(offset);
+            _count++;
+        }
+
+        // Where the last record ends
+        public void Complete(long end)
+        {
+            if (_completed)
+                throw new InvalidOperationException("The index has already been completed.");
+            Append(end);
+            _completed = true;
+        }
+
+        public void Commit(SnapshotFingerprint source)
+        {
+            if (!_completed)
+                throw new InvalidOperationException("The index has not been completed.");
+
+            _stream.Write(_buffer, 0, _length);
+            _length = 0;
+
+            Span<byte> header = stackalloc byte[RosterOffsetIndex.HeaderSize];
+            RosterOffsetIndex.Magic.CopyTo(header);
+            BitConverter.TryWriteBytes(header.Slice(4), RosterOffsetIndex.Version);
+            BitConverter.TryWriteBytes(header.Slice(6), (ushort)0);
+            BitConverter.TryWriteBytes(header.Slice(8), source.Length);
+            BitConverter.TryWriteBytes(header.Slice(16), source.LastWriteTicks);
+            BitConverter.TryWriteBytes(header.Slice(24), _count);
+            _stream.Position = 0;
+            _stream.Write(header);
+            _stream.Dispose();
+
+            File.Move(TempPath, _path, true);
+            _committed = true;
+        }
+
+        public void Dispose()
+        {
+            if (_committed)
+                return;
+            _stream.Dispose();
+            File.Delete(TempPath);
+        }
+
+        private void Append(long offset)
+        {
+            if (offset < _last)
+                throw new ArgumentOutOfRangeException(nameof(offset), "Record offsets must not decrease.");
+            _last = offset;
+
+            if (_length + sizeof(long) > _buffer.Length)
+            {
+                _stream.Write(_buffer, 0, _length);
+                _length = 0;
+            }
+            BitConverter.TryWriteBytes(new Span<byte>(_buffer, _length, sizeof(long)), offset);
+            _length += sizeof(long);
+        }
+    }
+}
+
+// 27. RosterShards.cs - Splitting a roster across shard files and merging the shards back
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace GameCharacterManager
+{
+    public enum RosterPartition
+    {
+        IdRange,
+        Class
+    }
+
+    // How SaveToJsonShards splits a roster
+    public sealed class RosterSharding
+    {
+        public RosterSharding(RosterPartition partition, int shardCount)
+        {
+            if (shardCount < 1)
+                throw new ArgumentOutOfRangeException(nameof(shardCount));
+            Partition = partition;
+            ShardCount = shardCount;
+        }
+
+        public RosterPartition Partition { get; }
+        public int ShardCount { get; }
+
+        // Shards of about equal size, one per core unless told otherwise
+        public static RosterSharding ByIdRange(int shardCount = 0)
+        {
+            return new RosterSharding(RosterPartition.IdRange, shardCount > 0 ? shardCount : Environment.ProcessorCount);
+        }
+
+        // One shard per class unless told otherwise; classes share shards round robin
+        public static RosterSharding ByClass(int shardCount = 0)
+        {
+            return new RosterSharding(RosterPartition.Class, shardCount > 0 ? shardCount : Enum.GetValues<CharacterClass>().Length);
+        }
+    }
+
+    // characters.shards.json (characters.json.gz.shards.json for a compressed roster): the shard
+    // files of the current save and what each one holds
+    public sealed class RosterManifest
+    {
+        // Version 2 keeps shards in roster order and adds the order file
+        public const int CurrentVersion = 2;
+
+        public int Version { get; set; }
+
+        // Bumped by every save, which writes new shard files before switching the manifest to them
+        public long Generation { get; set; }
+        public RosterPartition Partition { get; set; }
+        public int ShardCount { get; set; }
+        public List<RosterShardInfo> Shards { get; set; }
+
+        // Which shard each run of roster positions comes from; null when the roster is the
+        // shards one after another
+        public string Order { get; set; }
+    }
+
+    public sealed class RosterShardInfo
+    {
+        public string File { get; set; }
+        public long Count { get; set; }
+
+        // Smallest and largest Id in the shard
+        public long MinId { get; set; }
+        public long MaxId { get; set; }
+
+        // For a Class partition, the classes kept in the shard
+        public List<CharacterClass> Classes { get; set; }
+    }
+
+    // Every shard keeps its characters in roster order. Where the shards do not simply follow
+    // one another, an order file records the shard each run of roster positions comes from,
+    // so merging rebuilds the roster exactly.
+    internal static class RosterShards
+    {
+        // Ids sampled to place Id range boundaries
+        private const int SampleSize = 64 * 1024;
+
+        private static readonly byte[] OrderMagic = { (byte)'C', (byte)'O', (byte)'R', (byte)'D' };
+        private const ushort OrderVersion = 1;
+
+        // Split into shards of consecutive Id ranges or of classes; empty shards are left out.
+        // order gets the runs of roster positions, or null when the shards follow one another.
+        public static List<List<Character>> Split(IReadOnlyList<Character> characters, RosterSharding sharding,
+            out List<ShardRun> order)
+        {
+            int shardCount = sharding.ShardCount;
+            long[] bounds = sharding.Partition == RosterPartition.IdRange ? RangeBounds(characters, shardCount) : null;
+
+            var shards = new List<Character>[shardCount];
+            for (int i = 0; i < shardCount; i++)
+                shards[i] = new List<Character>(characters.Count / shardCount + 1);
+
+            var runs = new List<ShardRun>();
+            foreach (Character character in characters)
+            {
+                int shard;
+                if (bounds != null)
+                {
+                    shard = Array.BinarySearch(bounds, IdOf(character));
+                    shard = shard >= 0 ? shard + 1 : ~shard;
+                }
+                else
+                {
+                    shard = (int)(character?.Class ?? 0) % shardCount;
+                }
+                shards[shard].Add(character);
+
+                if (runs.Count > 0 && runs[runs.Count - 1].Shard == shard)
+                    runs[runs.Count - 1] = new ShardRun(shard, runs[runs.Count - 1].Length + 1);
+                else
+                    runs.Add(new ShardRun(shard, 1));
+            }
+
+            // Renumber the runs for the shards that are kept
+            var kept = new int[shardCount];
+            var result = new List<List<Character>>(shardCount);
+            for (int i = 0; i < shardCount; i++)
+            {
+                kept[i] = result.Count;
+                if (shards[i].Count > 0)
+                    result.Add(shards[i]);
+            }
+            if (result.Count == 0)
+                result.Add(shards[0]);
+
+            bool consecutive = runs.Count == result.Count;
+            for (int i = 0; i < runs.Count; i++)
+            {
+                runs[i] = new ShardRun(kept[runs[i].Shard], runs[i].Length);
+                consecutive &= runs[i].Shard == i;
+            }
+            order = consecutive ? null : runs;
+            return result;
+        }
+
+        public static RosterShardInfo Describe(string file, List<Character> shard, RosterManifest manifest)
+        {
+            var info = new RosterShardInfo
+            {
+                File = file,
+                Count = shard.Count,
+                MinId = shard.Count > 0 ? long.MaxValue : 0,
+                MaxId = shard.Count > 0 ? long.MinValue : 0
+            };
+            foreach (Character character in shard)
+            {
+                info.MinId = Math.Min(info.MinId, IdOf(character));
+                info.MaxId = Math.Max(info.MaxId, IdOf(character));
+            }
+
+            if (manifest.Partition == RosterPartition.Class)
+            {
+                info.Classes = new List<CharacterClass>();
+                var seen = new HashSet<CharacterClass>();
+                foreach (Character character in shard)
+                {
+                    CharacterClass characterClass = character?.Class ?? 0;
+                    if (seen.Add(characterClass))
+                        info.Classes.Add(characterClass);
+                }
+                info.Classes.Sort();
+            }
+            return info;
+        }
+
+        // Layout: "CORD" magic, ushort version, then the run count and each run's shard and
+        // length as 7-bit encoded integers
+        public static void WriteOrder(Stream stream, List<ShardRun> order)
+        {
+            using (var writer = new BinaryWriter(stream, Encoding.UTF8, true))
+            {
+                writer.Write(OrderMagic);
+                writer.Write(OrderVersion);
+                writer.Write7BitEncodedInt(order.Count);
+                foreach (ShardRun run in order)
+                {
+                    writer.Write7BitEncodedInt(run.Shard);
+                    writer.Write7BitEncodedInt(run.Length);
+                }
+            }
+        }
+
+        // Runs of the manifest's roster, checked against its shard counts
+        public static List<ShardRun> ReadOrder(Stream stream, RosterManifest manifest, string path)
+        {
+            var order = new List<ShardRun>();
+            try
+            {
+                using (var reader = new BinaryReader(stream, Encoding.UTF8, true))
+                {
+                    if (!reader.ReadBytes(OrderMagic.Length).AsSpan().SequenceEqual(OrderMagic) || reader.ReadUInt16() != OrderVersion)
+                        throw new InvalidDataException($"{path} is not a version {OrderVersion} shard order file.");
+
+                    int count = reader.Read7BitEncodedInt();
+                    for (int i = 0; i < count; i++)
+                        order.Add(new ShardRun(reader.Read7BitEncodedInt(), reader.Read7BitEncodedInt()));
+                }
+            }
+            catch (EndOfStreamException)
+            {
+                throw new InvalidDataException($"{path} ends before its last run.");
+            }
+
+            var counts = new long[manifest.Shards.Count];
+            foreach (ShardRun run in order)
+            {
+                if (run.Shard < 0 || run.Shard >= counts.Length || run.Length <= 0)
+                    throw new InvalidDataException($"{path} names a shard the manifest does not have.");
+                counts[run.Shard] += run.Length;
+            }
+            for (int i = 0; i < counts.Length; i++)
+            {
+                if (counts[i] != manifest.Shards[i].Count)
+                    throw new InvalidDataException($"{path} takes {counts[i]} characters from {manifest.Shards[i].File}, the manifest expects {manifest.Shards[i].Count}.");
+            }
+            return order;
+        }
+
+        // Runs of a manifest without an order file: each shard in turn
+        public static List<ShardRun> Consecutive(RosterManifest manifest)
+        {
+            var order = new List<ShardRun>(manifest.Shards.Count);
+            for (int i = 0; i < manifest.Shards.Count; i++)
+            {
+                if (manifest.Shards[i].Count > 0)
+                    order.Add(new ShardRun(i, (int)manifest.Shards[i].Count));
+            }
+            return order;
+        }
+
+        public static List<Character> Merge(List<Character>[] shards, List<ShardRun> order)
+        {
+            long total = 0;
+            foreach (List<Character> shard in shards)
+                total += shard.Count;
+
+            var characters = new List<Character>((int)Math.Min(total, Array.MaxLength));
+            var taken = new int[shards.Length];
+            foreach (ShardRun run in order)
+            {
+                characters.AddRange(shards[run.Shard].GetRange(taken[run.Shard], run.Length));
+                taken[run.Shard] += run.Length;
+            }
+            return characters;
+        }
+
+        // Upper bounds (exclusive) of each Id range but the last, at quantiles of a strided sample
+        private static long[] RangeBounds(IReadOnlyList<Character> characters, int shardCount)
+        {
+            int sampleSize = Math.Min(characters.Count, SampleSize);
+            if (sampleSize == 0)
+                return new long[shardCount - 1];
+
+            var sample = new long[sampleSize];
+            for (int i = 0; i < sampleSize; i++)
+                sample[i] = IdOf(characters[(int)((long)i * characters.Count / sampleSize)]);
+            Array.Sort(sample);
+
+            var bounds = new long[shardCount - 1];
+            for (int i = 1; i < shardCount; i++)
+                bounds[i - 1] = sample[(int)((long)i * sampleSize / shardCount)];
+            return bounds;
+        }
+
+        private static long IdOf(Character character)
+        {
+            return character?.Id ?? 0;
+        }
+    }
+
+    // Consecutive roster positions that all come from one shard
+    internal readonly struct ShardRun
+    {
+        public ShardRun(int shard, int length)
+        {
+            Shard = shard;
+            Length = length;
+        }
+
+        public int Shard { get; }
+        public int Length { get; }
+    }
+}
+
+// 28. RosterGenerator.cs - Seeded synthetic rosters with configurable distributions
+using System;
+using System.Collections.Generic;
+
+namespace GameCharacterManager
+{
+    // Integer stat drawn uniformly from [Min, Max], or normally around Mean and clamped to it
+    public readonly struct StatDistribution
+    {
+        private StatDistribution(int min, int max, double mean, double standardDeviation)
+        {
+            if (min > max)
+                throw new ArgumentOutOfRangeException(nameof(max));
+            if (standardDeviation < 0)
+                throw new ArgumentOutOfRangeException(nameof(standardDeviation));
+            Min = min;
+            Max = max;
+            Mean = mean;
+            StandardDeviation = standardDeviation;
+        }
+
+        public int Min { get; }
+        public int Max { get; }
+        public double Mean { get; }
+
+        // 0 for a uniform distribution
+        public double StandardDeviation { get; }
+
+        public static StatDistribution Uniform(int min, int max)
+        {
+            return new StatDistribution(min, max, 0, 0);
+        }
+
+        public static StatDistribution Normal(double mean, double standardDeviation, int min, int max)
+        {
+            return new StatDistribution(min, max, mean, standardDeviation);
+        }
+
+        internal int Sample(Random random)
+        {
+            if (StandardDeviation == 0)
+                return (int)(Min + random.NextInt64((long)Max - Min + 1));
+
+            // Box-Muller; 1 - NextDouble() is in (0, 1], so the logarithm is finite
+            double u = 1.0 - random.NextDouble();
+            double v = random.NextDouble();
+            double value = Mean + StandardDeviation * Math.Sqrt(-2.0 * Math.Log(u)) * Math.Cos(2.0 * Math.PI * v);
+            return (int)Math.Clamp(Math.Round(value), Min, Max);
+        }
+    }
+
+    // What RosterGenerator produces. Weights are relative and need not sum to 1; a null weight
+    // array means equal weights. Skews are Zipf exponents: 0 is uniform, 1 and up favour the
+    // first entries more and more.
+    public sealed class RosterGeneratorOptions
+    {
+        public int Seed { get; set; } = 1;
+
+        public StatDistribution Level { get; set; } = StatDistribution.Uniform(1, 100);
+        public StatDistribution Health { get; set; } = StatDistribution.Normal(500, 200, 1, 1000);
+        public StatDistribution Mana { get; set; } = StatDistribution.Normal(400, 250, 0, 1000);
+
+        // Indexed by CharacterClass
+        public double[] ClassWeights { get; set; }
+
+        public string[] Weapons { get; set; } = { "Sword", "Bow", "Staff", "Dagger", "Axe", "Hammer" };
+        public double[] WeaponWeights { get; set; } = { 30, 20, 20, 15, 10, 5 };
+        public string[] Armors { get; set; } = { "Light", "Medium", "Heavy", "Magic" };
+        public double[] ArmorWeights { get; set; } = { 40, 30, 20, 10 };
+
+        // Ability counts in [MinAbilities, MaxAbilities], skewed towards MinAbilities
+        public int MinAbilities { get; set; }
+        public int MaxAbilities { get; set; } = 4;
+        public double AbilityCountSkew { get; set; } = 0.5;
+
+        // Distinct ability names to draw from, skewed towards the first ones
+        public int AbilityVocabulary { get; set; } = 64;
+        public double AbilitySkew { get; set; } = 1.0;
+
+        // Chance that a character takes the name of an earlier one instead of a new name
+        public double NameCollisionRate { get; set; }
+
+        // Number characters 1 to N; otherwise they keep Id 0 for a roster to assign
+        public bool AssignIds { get; set; } = true;
+    }
+
+    // Produces the same characters for the same options every time, one at a time, so a roster
+    // of any size streams straight into CharacterRepository.SaveToFile. Nothing is kept per
+    // character: a colliding name is rebuilt from the index of the earlier character.
+    public sealed class RosterGenerator
+    {
+        private static readonly string[] NameStarts =
+        {
+            "Ael", "Bran", "Cor", "Dra", "El", "Fen", "Gar", "Hal",
+            "Isk", "Jor", "Kael", "Lor", "Mor", "Nym", "Or", "Vex"
+        };
+        private static readonly string[] NameEnds =
+        {
+            "a", "ric", "wen", "dor", "is", "an", "eth", "ion",
+            "ara", "os", "ith", "un", "iel", "ak", "ys", "or"
+        };
+        private static readonly string[] AbilityNames =
+        {
+            "Fireball", "Heal", "Stealth", "Shield Bash", "Frost Nova", "Backstab", "Volley", "Smite",
+            "Charge", "Blink", "Poison Blade", "Holy Light", "Multishot", "Taunt", "Arcane Missile", "Vanish"
+        };
+
+        private readonly RosterGeneratorOptions _options;
+        private readonly WeightedSampler _classes;
+        private readonly WeightedSampler _weapons;
+        private readonly WeightedSampler _armors;
+        private readonly WeightedSampler _abilityCounts;
+        private readonly WeightedSampler _abilities;
+        private readonly int[] _abilityIds;
+
+        public RosterGenerator(RosterGeneratorOptions options)
+        {
+            _options = options ?? throw new ArgumentNullException(nameof(options));
+            if (options.MinAbilities < 0 || options.MaxAbilities < options.MinAbilities)
+                throw new ArgumentException("MaxAbilities must be at least MinAbilities, which cannot be negative.", nameof(options));
+            if (options.MaxAbilities > options.AbilityVocabulary)
+                throw new ArgumentException("A character cannot have more distinct abilities than AbilityVocabulary.", nameof(options));
+            if (options.NameCollisionRate < 0 || options.NameCollisionRate > 1)
+                throw new ArgumentException("NameCollisionRate must be between 0 and 1.", nameof(options));
+
+            int classCount = Enum.GetValues<CharacterClass>().Length;
+            _classes = WeightedSampler.FromWeights(options.ClassWeights, classCount, nameof(options.ClassWeights));
+            _weapons = WeightedSampler.FromWeights(options.WeaponWeights, options.Weapons?.Length ?? 0, nameof(options.Weapons));
+            _armors = WeightedSampler.FromWeights(options.ArmorWeights, options.Armors?.Length ?? 0, nameof(options.Armors));
+            _abilityCounts = WeightedSampler.Zipf(options.MaxAbilities - options.MinAbilities + 1, options.AbilityCountSkew);
+            _abilities = WeightedSampler.Zipf(Math.Max(1, options.AbilityVocabulary), options.AbilitySkew);
+
+            // Interned once, so each character's list is filled with ids and no lookups
+            _abilityIds = new int[options.AbilityVocabulary];
+            for (int i = 0; i < _abilityIds.Length; i++)
+                _abilityIds[i] = AbilityPool.Intern(AbilityName(i));
+        }
+
+        public IEnumerable<Character> Generate(long count)
+        {
+            return Generate(count, null);
+        }
+
+        // With a pool, each character goes back to it when the next one is requested, so a long
+        // run allocates only names. Use the characters before moving on, as a writer does.
+        public IEnumerable<Character> Generate(long count, CharacterPool pool)
+        {
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+            return GenerateIterator(count, pool);
+        }
+
+        private IEnumerable<Character> GenerateIterator(long count, CharacterPool pool)
+        {
+            var random = new Random(_options.Seed);
+            Character previous = null;
+            for (long i = 0; i < count; i++)
+            {
+                if (previous != null)
+                    pool.Return(previous);
+
+                Character character = pool != null ? pool.Rent() : new Character();
+                Fill(character, i, random);
+                if (pool != null)
+                    previous = character;
+                yield return character;
+            }
+            if (previous != null)
+                pool.Return(previous);
+        }
+
+        private void Fill(Character character, long index, Random random)
+        {
+            long nameIndex = index > 0 && random.NextDouble() < _options.NameCollisionRate
+                ? random.NextInt64(index)
+                : index;
+
+            character.Id = _options.AssignIds ? index + 1 : 0;
+            character.Name = Name(nameIndex);
+            character.Level = _options.Level.Sample(random);
+            character.Health = _options.Health.Sample(random);
+            character.Mana = _options.Mana.Sample(random);
+            character.Class = (CharacterClass)_classes.Sample(random);
+            character.WeaponType = _options.Weapons[_weapons.Sample(random)];
+            character.ArmorType = _options.Armors[_armors.Sample(random)];
+
+            AbilityList abilities = character.AbilityList;
+            abilities.Clear();
+            int abilityCount = _options.MinAbilities + _abilityCounts.Sample(random);
+            while (abilities.Count < abilityCount)
+            {
+                int id = _abilityIds[_abilities.Sample(random)];
+                if (!abilities.Ids.Contains(id))
+                    abilities.AddId(id);
+            }
+        }
+
+        // Distinct for every index: 256 base names, then numbered
+        private static string Name(long index)
+        {
+            string name = NameStarts[index % NameStarts.Length] + NameEnds[index / NameStarts.Length % NameEnds.Length];
+            long round = index / (NameStarts.Length * NameEnds.Length);
+            return round == 0 ? name : $"{name} {round}";
+        }
+
+        private static string AbilityName(int index)
+        {
+            string name = AbilityNames[index % AbilityNames.Length];
+            int round = index / AbilityNames.Length;
+            return round == 0 ? name : $"{name} {round + 1}";
+        }
+
+        // Draws an index with probability proportional to its weight, by binary search over
+        // the running totals of the weights
+        private sealed class WeightedSampler
+        {
+            private readonly double[] _cumulative;
+
+            private WeightedSampler(double[] weights)
+            {
+                _cumulative = new double[weights.Length];
+                double total = 0;
+                for (int i = 0; i < weights.Length; i++)
+                {
+                    total += weights[i];
+                    _cumulative[i] = total;
+                }
+            }
+
+            public static WeightedSampler FromWeights(double[] weights, int count, string name)
+            {
+                if (count == 0)
+                    throw new ArgumentException($"{name} has nothing to choose from.", name);
+                if (weights == null)
+                    return Zipf(count, 0);
+                if (weights.Length != count)
+                    throw new ArgumentException($"{name} needs {count} weights, not {weights.Length}.", name);
+
+                double total = 0;
+                foreach (double weight in weights)
+                {
+                    if (weight < 0 || double.IsNaN(weight))
+                        throw new ArgumentException($"{name} cannot hold negative weights.", name);
+                    total += weight;
+                }
+                if (total <= 0)
+                    throw new ArgumentException($"{name} needs a positive weight.", name);
+                return new WeightedSampler(weights);
+            }
+
+            // Weight 1 / rank^exponent for ranks 1 to count
+            public static WeightedSampler Zipf(int count, double exponent)
+            {
+                var weights = new double[count];
+                for (int i = 0; i < count; i++)
+                    weights[i] = 1.0 / Math.Pow(i + 1, exponent);
+                return new WeightedSampler(weights);
+            }
+
+            public int Sample(Random random)
+            {
+                if (_cumulative.Length == 1)
+                    return 0;
+
+                // First entry whose running total exceeds the target; a zero-weight entry
+                // shares its predecessor's total, so it is never the first
+                double target = random.NextDouble() * _cumulative[_cumulative.Length - 1];
+                int low = 0;
+                int high = _cumulative.Length - 1;
+                while (low < high)
+                {
+                    int middle = (low + high) >> 1;
+                    if (_cumulative[middle] > target)
+                        high = middle;
+                    else
+                        low = middle + 1;
+                }
+                return low;
+            }
+        }
+    }
+}
+
+// 29. RosterMetrics.cs - Meter instruments for repository, roster, clone and query operations
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Diagnostics.Metrics;
+using System.IO;
+using System.Runtime.CompilerServices;
+
+namespace GameCharacterManager
+{
+    // Published on the "GameCharacterManager" meter, so any MeterListener or OpenTelemetry
+    // exporter sees them, and on Linux too:
+    //   dotnet-counters monitor -n <process> --counters GameCharacterManager
+    // Instruments nobody listens to cost a flag check; timestamps, allocation counts and file
+    // sizes are only taken while a listener is attached, so they can stay on in production.
+    public static class RosterMetrics
+    {
+        public const string MeterName = "GameCharacterManager";
+
+        private static readonly Meter Meter = new Meter(MeterName, "1.0");
+
+        private static readonly Counter<long> Operations = Meter.CreateCounter<long>(
+            "gcm.operations", "{operation}", "Saves, loads, bulk clones and queries, by operation and format");
+        private static readonly Histogram<double> Duration = Meter.CreateHistogram<double>(
+            "gcm.operation.duration", "ms", "Time taken by each save, load, bulk clone and query");
+        private static readonly Histogram<long> Allocated = Meter.CreateHistogram<long>(
+            "gcm.operation.allocated", "By", "Bytes allocated by each synchronous operation on its thread");
+        private static readonly Counter<long> BytesRead = Meter.CreateCounter<long>(
+            "gcm.repository.bytes_read", "By", "Bytes of roster files read, by file type");
+        private static readonly Counter<long> BytesWritten = Meter.CreateCounter<long>(
+            "gcm.repository.bytes_written", "By", "Bytes of roster files written, by file type");
+        private static readonly Counter<long> Clones = Meter.CreateCounter<long>(
+            "gcm.clones", "{character}", "Characters cloned, singly or in bulk");
+        private static readonly Counter<long> RosterChanges = Meter.CreateCounter<long>(
+            "gcm.roster.changes", "{change}", "Characters added to, replaced in and removed from rosters");
+
+        // Rosters are held weakly and only walked when the gauge is observed
+        private static readonly ConditionalWeakTable<CharacterRoster, object> Rosters = new ConditionalWeakTable<CharacterRoster, object>();
+
+        static RosterMetrics()
+        {
+            Meter.CreateObservableGauge("gcm.roster.size", ObserveRosterSize, "{character}", "Characters in live rosters");
+        }
+
+        // Count, time and, when measureAllocations, weigh the operation until the scope is disposed.
+        // Allocations are read from the calling thread, so pass false for async or parallel work.
+        public static OperationScope Start(string operation, string format, bool measureAllocations = true)
+        {
+            if (!Operations.Enabled && !Duration.Enabled && !Allocated.Enabled)
+                return default;
+            return new OperationScope(operation, format, measureAllocations && Allocated.Enabled);
+        }
+
+        // Record the size of a file read or written whole
+        public static void FileRead(string path)
+        {
+            if (BytesRead.Enabled && File.Exists(path))
+                BytesRead.Add(new FileInfo(path).Length, FileType(path));
+        }
+
+        public static void FileWritten(string path)
+        {
+            if (BytesWritten.Enabled && File.Exists(path))
+                BytesWritten.Add(new FileInfo(path).Length, FileType(path));
+        }
+
+        // Part of a file, such as a page or a character's deferred fields
+        public static void Read(string path, long bytes)
+        {
+            if (BytesRead.Enabled)
+                BytesRead.Add(bytes, FileType(path));
+        }
 
-        private System.Windows.Forms.Label label1;
-        private System.Windows.Forms.TextBox txtName;
-        private System.Windows.Forms.Label label2;
-        private System.Windows.Forms.NumericUpDown numLevel;
-        private System.Windows.Forms.Label label3;
-        private System.Windows.Forms.NumericUpDown numHealth;
-        private System.Windows.Forms.Label label4;
-        private System.Windows.Forms.NumericUpDown numMana;
-        private System.Windows.Forms.Label label5;
-        private System.Windows.Forms.ComboBox cmbClass;
-        private System.Windows.Forms.Label label6;
-        private System.Windows.Forms.TextBox txtWeapon;
-        private System.Windows.Forms.Label label7;
-        private System.Windows.Forms.TextBox txtArmor;
-        private System.Windows.Forms.GroupBox groupBox1;
-        private System.Windows.Forms.Button btnRemoveAbility;
-        private System.Windows.Forms.Button btnAddAbility;
-        private System.Windows.Forms.TextBox txtAbility;
-        private System.Windows.Forms.ListBox listBoxAbilities;
-        private System.Windows.Forms.Button btnSave;
-        private System.Windows.Forms.Button btnCancel;
+        public static void Written(string path, long bytes)
+        {
+            if (BytesWritten.Enabled)
+                BytesWritten.Add(bytes, FileType(path));
+        }
+
+        internal static void Cloned(int count)
+        {
+            Clones.Add(count);
+        }
+
+        // kind is "add", "replace" or "remove"
+        internal static void RosterChanged(string kind)
+        {
+            if (RosterChanges.Enabled)
+                RosterChanges.Add(1, new KeyValuePair<string, object>("kind", kind));
+        }
+
+        internal static void Track(CharacterRoster roster)
+        {
+            Rosters.AddOrUpdate(roster, null);
+        }
+
+        private static long ObserveRosterSize()
+        {
+            long size = 0;
+            foreach (KeyValuePair<CharacterRoster, object> entry in Rosters)
+                size += entry.Key.Count;
+            return size;
+        }
+
+        // "json", "xml", "bin", "journal", "idx", from the extension; a .gz or .br file by the
+        // format it holds
+        private static KeyValuePair<string, object> FileType(string path)
+        {
+            string extension = Path.GetExtension(CompressedRosterStream.WithoutCompressionExtension(path));
+            return new KeyValuePair<string, object>("type", extension.Length > 1 ? extension.Substring(1).ToLowerInvariant() : "none");
+        }
+
+        public readonly struct OperationScope : IDisposable
+        {
+            private readonly string _operation;
+            private readonly string _format;
+            private readonly long _start;
+            private readonly long _allocated;
+
+            internal OperationScope(string operation, string format, bool measureAllocations)
+            {
+                _operation = operation;
+                _format = format;
+                _allocated = measureAllocations ? GC.GetAllocatedBytesForCurrentThread() : -1;
+                _start = Stopwatch.GetTimestamp();
+            }
+
+            public void Dispose()
+            {
+                if (_start == 0)
+                    return;
+
+                double milliseconds = Stopwatch.GetElapsedTime(_start).TotalMilliseconds;
+                var operation = new KeyValuePair<string, object>("operation", _operation);
+                var format = new KeyValuePair<string, object>("format", _format);
+                Operations.Add(1, operation, format);
+                Duration.Record(milliseconds, operation, format);
+                if (_allocated >= 0)
+                    Allocated.Record(GC.GetAllocatedBytesForCurrentThread() - _allocated, operation, format);
+            }
+        }
     }
 }
 
-// 7. Program.cs - Application entry point
+// 30. CompressedRosterStream.cs - GZip and Brotli roster files, compressed on a background thread
 using System;
-using System.Windows.Forms;
+using System.Buffers;
+using System.Collections.Concurrent;
+using System.IO;
+using System.IO.Compression;
+using System.Threading;
+using System.Threading.Tasks;
 
 namespace GameCharacterManager
 {
-    static class Program
+    public enum RosterCompression
     {
-        /// <summary>
-        /// The main entry point for the application.
-        /// </summary>
-        [STAThread]
-        static void Main()
+        None,
+        GZip,
+        Brotli
+    }
+
+    // A roster file is compressed when its name ends in .gz or .br after the format extension,
+    // as in characters.json.gz. GZip files are also recognised by their magic bytes whatever
+    // their name; Brotli has no magic, so it needs the extension.
+    //
+    // Compression runs on its own thread: the serializer hands over filled chunks and goes on
+    // with the next characters while the previous ones are compressed and written, so a save
+    // takes about as long as the slower of the two rather than their sum. Loads decompress
+    // ahead of the parser the same way.
+    public static class CompressedRosterStream
+    {
+        private const int ChunkSize = 128 * 1024;
+
+        // Chunks in flight between the two threads
+        private const int QueueLength = 8;
+
+        public static RosterCompression FromExtension(string path)
         {
-            Application.EnableVisualStyles();
-            Application.SetCompatibleTextRenderingDefault(false);
-            Application.Run(new MainForm());
+            if (path == null)
+                throw new ArgumentNullException(nameof(path));
+
+            string extension = Path.GetExtension(path);
+            if (extension.Equals(".gz", StringComparison.OrdinalIgnoreCase))
+                return RosterCompression.GZip;
+            if (extension.Equals(".br", StringComparison.OrdinalIgnoreCase))
+                return RosterCompression.Brotli;
+            return RosterCompression.None;
+        }
+
+        public static string ExtensionOf(RosterCompression compression)
+        {
+            switch (compression)
+            {
+                case RosterCompression.GZip:
+                    return ".gz";
+                case RosterCompression.Brotli:
+                    return ".br";
+                default:
+                    return "";
+            }
+        }
+
+        // path without its .gz or .br, so the format extension can be read
+        public static string WithoutCompressionExtension(string path)
+        {
+            return FromExtension(path) == RosterCompression.None ? path : path.Substring(0, path.Length - Path.GetExtension(path).Length);
+        }
+
+        // From the extension, or for any other name the file's first bytes
+        public static RosterCompression Detect(string path)
+        {
+            RosterCompression compression = FromExtension(path);
+            if (compression != RosterCompression.None || !File.Exists(path))
+                return compression;
+
+            using (FileStream fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete, 1))
+            {
+                return HasGZipMagic(fs) ? RosterCompression.GZip : RosterCompression.None;
+            }
+        }
+
+        // Stream that compresses into file; disposing it finishes the file but leaves it open.
+        // With no compression, file itself.
+        public static Stream ForWrite(Stream file, RosterCompression compression)
+        {
+            if (file == null)
+                throw new ArgumentNullException(nameof(file));
+            return compression == RosterCompression.None ? file : new PipelinedCompressor(file, compression);
+        }
+
+        // Stream of the decompressed contents of file, opened from path, positioned at its start
+        public static Stream ForRead(FileStream file, string path)
+        {
+            if (file == null)
+                throw new ArgumentNullException(nameof(file));
+
+            RosterCompression compression = FromExtension(path);
+            if (compression == RosterCompression.None && HasGZipMagic(file))
+                compression = RosterCompression.GZip;
+            return compression == RosterCompression.None ? file : new PipelinedDecompressor(file, compression);
+        }
+
+        private static bool HasGZipMagic(FileStream file)
+        {
+            if (!file.CanSeek || file.Length < 2)
+                return false;
+
+            long position = file.Position;
+            int first = file.ReadByte();
+            int second = file.ReadByte();
+            file.Position = position;
+            return first == 0x1F && second == 0x8B;
+        }
+
+        private static Stream Compressor(Stream file, RosterCompression compression)
+        {
+            // Fastest keeps the compressing thread ahead of the serializer
+            if (compression == RosterCompression.GZip)
+                return new GZipStream(file, CompressionLevel.Fastest, true);
+            return new BrotliStream(file, CompressionLevel.Fastest, true);
+        }
+
+        private static Stream Decompressor(Stream file, RosterCompression compression)
+        {
+            if (compression == RosterCompression.GZip)
+                return new GZipStream(file, CompressionMode.Decompress, true);
+            return new BrotliStream(file, CompressionMode.Decompress, true);
+        }
+
+        private readonly struct Chunk
+        {
+            public Chunk(byte[] buffer, int length)
+            {
+                Buffer = buffer;
+                Length = length;
+            }
+
+            public byte[] Buffer { get; }
+            public int Length { get; }
+        }
+
+        // Base for the two pipelines: a bounded chunk queue and the thread on its other side.
+        // A failure on that thread cancels the queue and is rethrown to the caller.
+        private abstract class PipelinedStream : Stream
+        {
+            protected readonly BlockingCollection<Chunk> Queue = new BlockingCollection<Chunk>(QueueLength);
+            protected readonly CancellationTokenSource Cancellation = new CancellationTokenSource();
+            private Thread _thread;
+            private Exception _failure;
+            private bool _disposed;
+
+            protected void StartThread(string name)
+            {
+                _thread = new Thread(() =>
+                {
+                    try
+                    {
+                        Run();
+                    }
+                    catch (OperationCanceledException) when (Cancellation.IsCancellationRequested)
+                    {
+                    }
+                    catch (Exception ex)
+                    {
+                        _failure = ex;
+                        Cancellation.Cancel();
+                    }
+                })
+                {
+                    IsBackground = true,
+                    Name = name
+                };
+                _thread.Start();
+            }
+
+            // The compressing or decompressing side
+            protected abstract void Run();
+
+            protected void ThrowIfFailed()
+            {
+                if (_failure != null)
+                    throw new IOException("Roster compression failed.", _failure);
+            }
+
+            protected void JoinThread()
+            {
+                _thread?.Join();
+            }
+
+            protected void ReturnQueued()
+            {
+                while (Queue.TryTake(out Chunk chunk))
+                    ArrayPool<byte>.Shared.Return(chunk.Buffer);
+            }
+
+            protected override void Dispose(bool disposing)
+            {
+                if (disposing && !_disposed)
+                {
+                    _disposed = true;
+                    try
+                    {
+                        Finish();
+                    }
+                    finally
+                    {
+                        ReturnQueued();
+                        Queue.Dispose();
+                        Cancellation.Dispose();
+                    }
+                }
+                base.Dispose(disposing);
+            }
+
+            // Complete or abandon the pipeline and wait for the thread
+            protected abstract void Finish();
+
+            public override bool CanSeek => false;
+            public override long Length => throw new NotSupportedException();
+
+            public override long Position
+            {
+                get => throw new NotSupportedException();
+                set => throw new NotSupportedException();
+            }
+
+            public override long Seek(long offset, SeekOrigin origin) => throw new NotSupportedException();
+            public override void SetLength(long value) => throw new NotSupportedException();
+        }
+
+        private sealed class PipelinedCompressor : PipelinedStream
+        {
+            private readonly Stream _file;
+            private readonly RosterCompression _compression;
+            private byte[] _buffer;
+            private int _length;
+
+            public PipelinedCompressor(Stream file, RosterCompression compression)
+            {
+                _file = file;
+                _compression = compression;
+                StartThread("Roster compression");
+            }
+
+            public override bool CanRead => false;
+            public override bool CanWrite => true;
+
+            public override void Write(byte[] buffer, int offset, int count)
+            {
+                Write(new ReadOnlySpan<byte>(buffer, offset, count));
+            }
+
+            public override void Write(ReadOnlySpan<byte> buffer)
+            {
+                while (!buffer.IsEmpty)
+                {
+                    _buffer ??= ArrayPool<byte>.Shared.Rent(ChunkSize);
+                    int count = Math.Min(buffer.Length, _buffer.Length - _length);
+                    buffer.Slice(0, count).CopyTo(_buffer.AsSpan(_length));
+                    _length += count;
+                    buffer = buffer.Slice(count);
+                    if (_length == _buffer.Length)
+                        HandOver();
+                }
+            }
+
+            public override void WriteByte(byte value)
+            {
+                Write(new ReadOnlySpan<byte>(new[] { value }));
+            }
+
+            // Copying into the chunk is all a write does and only a full queue blocks it, until
+            // the compressing thread takes a chunk, so there is nothing worth awaiting
+            public override Task WriteAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+            {
+                return WriteAsync(new ReadOnlyMemory<byte>(buffer, offset, count), cancellationToken).AsTask();
+            }
+
+            public override ValueTask WriteAsync(ReadOnlyMemory<byte> buffer, CancellationToken cancellationToken = default)
+            {
+                if (cancellationToken.IsCancellationRequested)
+                    return ValueTask.FromCanceled(cancellationToken);
+                try
+                {
+                    Write(buffer.Span);
+                    return default;
+                }
+                catch (Exception ex)
+                {
+                    return ValueTask.FromException(ex);
+                }
+            }
+
+            // JsonSerializer flushes after every character; handing those slivers over one at a
+            // time would cost more than compressing them, so chunks only go over when full and
+            // the last one when the stream is disposed
+            public override void Flush()
+            {
+                ThrowIfFailed();
+            }
+
+            public override Task FlushAsync(CancellationToken cancellationToken)
+            {
+                if (cancellationToken.IsCancellationRequested)
+                    return Task.FromCanceled(cancellationToken);
+                Flush();
+                return Task.CompletedTask;
+            }
+
+            private void HandOver()
+            {
+                ThrowIfFailed();
+                try
+                {
+                    Queue.Add(new Chunk(_buffer, _length), Cancellation.Token);
+                }
+                catch (OperationCanceledException)
+                {
+                    ThrowIfFailed();
+                    throw;
+                }
+                _buffer = null;
+                _length = 0;
+            }
+
+            protected override void Run()
+            {
+                using (Stream compressor = Compressor(_file, _compression))
+                {
+                    foreach (Chunk chunk in Queue.GetConsumingEnumerable(Cancellation.Token))
+                    {
+                        compressor.Write(chunk.Buffer, 0, chunk.Length);
+                        ArrayPool<byte>.Shared.Return(chunk.Buffer);
+                    }
+                }
+                _file.Flush();
+            }
+
+            protected override void Finish()
+            {
+                try
+                {
+                    if (_length > 0)
+                        HandOver();
+                }
+                finally
+                {
+                    if (_buffer != null)
+                        ArrayPool<byte>.Shared.Return(_buffer);
+                    _buffer = null;
+                    Queue.CompleteAdding();
+                    JoinThread();
+                }
+                ThrowIfFailed();
+            }
+
+            public override int Read(byte[] buffer, int offset, int count) => throw new NotSupportedException();
+        }
+
+        private sealed class PipelinedDecompressor : PipelinedStream
+        {
+            private readonly FileStream _file;
+            private readonly RosterCompression _compression;
+            private Chunk _current;
+            private int _offset;
+            private bool _ended;
+
+            public PipelinedDecompressor(FileStream file, RosterCompression compression)
+            {
+                _file = file;
+                _compression = compression;
+                StartThread("Roster decompression");
+            }
+
+            public override bool CanRead => true;
+            public override bool CanWrite => false;
+
+            public override int Read(byte[] buffer, int offset, int count)
+            {
+                return Read(new Span<byte>(buffer, offset, count));
+            }
+
+            public override int Read(Span<byte> buffer)
+            {
+                if (buffer.IsEmpty)
+                    return 0;
+
+                while (_current.Buffer == null || _offset == _current.Length)
+                {
+                    if (_current.Buffer != null)
+                        ArrayPool<byte>.Shared.Return(_current.Buffer);
+                    _current = default;
+                    _offset = 0;
+                    if (_ended || !TryTake(out _current))
+                    {
+                        _ended = true;
+                        return 0;
+                    }
+                }
+
+                int count = Math.Min(buffer.Length, _current.Length - _offset);
+                _current.Buffer.AsSpan(_offset, count).CopyTo(buffer);
+                _offset += count;
+                return count;
+            }
+
+            // As the compressor's writes: the decompressing thread is usually a chunk ahead
+            public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+            {
+                return ReadAsync(new Memory<byte>(buffer, offset, count), cancellationToken).AsTask();
+            }
+
+            public override ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+            {
+                if (cancellationToken.IsCancellationRequested)
+                    return ValueTask.FromCanceled<int>(cancellationToken);
+                try
+                {
+                    return new ValueTask<int>(Read(buffer.Span));
+                }
+                catch (Exception ex)
+                {
+                    return ValueTask.FromException<int>(ex);
+                }
+            }
+
+            private bool TryTake(out Chunk chunk)
+            {
+                try
+                {
+                    chunk = default;
+                    foreach (Chunk next in Queue.GetConsumingEnumerable(Cancellation.Token))
+                    {
+                        chunk = next;
+                        return true;
+                    }
+                }
+                catch (OperationCanceledException)
+                {
+                    ThrowIfFailed();
+                    throw;
+                }
+                ThrowIfFailed();
+                return false;
+            }
+
+            protected override void Run()
+            {
+                try
+                {
+                    using (Stream decompressor = Decompressor(_file, _compression))
+                    {
+                        while (true)
+                        {
+                            byte[] buffer = ArrayPool<byte>.Shared.Rent(ChunkSize);
+                            int length = 0;
+                            int read;
+                            while (length < buffer.Length && (read = decompressor.Read(buffer, length, buffer.Length - length)) > 0)
+                                length += read;
+
+                            if (length == 0)
+                            {
+                                ArrayPool<byte>.Shared.Return(buffer);
+                                break;
+                            }
+                            Queue.Add(new Chunk(buffer, length), Cancellation.Token);
+                        }
+                    }
+                }
+                finally
+                {
+                    Queue.CompleteAdding();
+                }
+            }
+
+            // A reader that stops early cancels the thread rather than waiting for the whole file
+            protected override void Finish()
+            {
+                if (_current.Buffer != null)
+                    ArrayPool<byte>.Shared.Return(_current.Buffer);
+                _current = default;
+                Cancellation.Cancel();
+                JoinThread();
+                ThrowIfFailed();
+            }
+
+            public override void Flush()
+            {
+            }
+
+            public override void Write(byte[] buffer, int offset, int count) => throw new NotSupportedException();
         }
     }
 }